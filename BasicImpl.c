@@ -106,6 +106,39 @@ ErrorCode GetNext(Iterator *it, Record** record){
   return kOk;
 }
 
+ErrorCode GetNextBuffered(Iterator *it, Record** record){
+  static Record rec;
+  *record = &rec;
+  return kOk;
+}
+
+ErrorCode GetNextBatch(Iterator *it, Record* records, uint32_t max,
+                       uint32_t* count){
+  *count = 0;
+  return kErrorNotFound;
+}
+
+ErrorCode BulkLoad(Index *idx, Record *records, uint32_t count){
+  return kOk;
+}
+
+ErrorCode GetAllocationCount(uint64_t *count){
+  *count = 0;
+  return kOk;
+}
+
+ErrorCode GetIndexMemoryUsage(const char* name, uint64_t *records,
+                              uint64_t *bytes){
+  *records = 0;
+  *bytes = 0;
+  return kOk;
+}
+
+ErrorCode GetIndexMemoryPlacement(const char* name, uint32_t node_count,
+                                  uint64_t *pages){
+  return kErrorGenericFailure;
+}
+
 ErrorCode CloseIterator(Iterator **it){
   //printf("CloseIterator\n");
   return kOk;
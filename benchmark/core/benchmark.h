@@ -98,6 +98,9 @@ class BenchmarkThread: public Thread{
   // Increments the given value
   inline void increment(int &value){value+=incv_;}
   
+  // Increments the given value by the given amount
+  inline void increment(int &value, int amount){value+=incv_*amount;}
+  
   // Decrements the given value
   inline void decrement(int &value){value+=incv_;}
   
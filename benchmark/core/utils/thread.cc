@@ -23,6 +23,7 @@
 //
 
 #include <errno.h>
+#include <sched.h>
 #include <stdexcept>
 #include <stdio.h>
 
@@ -49,11 +50,34 @@ void Thread::Start(){
 
   thread_ = new pthread_t;
 
-  int r = pthread_create(thread_, NULL, *_thread_func, this);
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+#ifdef __linux__
+  // Restrict the thread to its CPUs before it starts to run
+  if (!affinity_.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < affinity_.size(); i++)
+      CPU_SET(affinity_[i], &set);
+    pthread_attr_setaffinity_np(&attributes, sizeof(set), &set);
+  }
+#endif
+
+  int r = pthread_create(thread_, &attributes, *_thread_func, this);
+  pthread_attr_destroy(&attributes);
   if (r != 0)
     throw std::runtime_error("pthread_create failed while starting thread");
 };
 
+// Returns the CPU the calling thread is running on
+int Thread::CurrentCpu(){
+#ifdef __linux__
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
 // Blocks the calling thread until the thread terminates
 void Thread::Join(){
   if (thread_) {
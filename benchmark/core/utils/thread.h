@@ -26,6 +26,7 @@
 #define BENCHMARK_CORE_UTILS_THREAD_H_
 
 #include <pthread.h>
+#include <vector>
 
 // A simple object-oriented pthreads wrapper
 class Thread{
@@ -38,6 +39,16 @@ class Thread{
   
   // Blocks the calling thread until the thread terminates
   void Join();
+
+  // Restricts the thread to the given CPUs once it is started (an empty list
+  // allows all CPUs)
+  void affinity(const std::vector<int> &cpus){affinity_=cpus;}
+
+  // Returns the CPUs the thread is restricted to
+  const std::vector<int> &affinity() const {return affinity_;}
+
+  // Returns the CPU the calling thread is running on (or -1 if unknown)
+  static int CurrentCpu();
   
   // The thread's main function
   // This is the only function that needs to be implemented by child classes
@@ -46,6 +57,9 @@ class Thread{
  private:
   // The POSIX thread itself
   pthread_t* thread_;
+
+  // The CPUs the thread is restricted to (empty if it may run on all CPUs)
+  std::vector<int> affinity_;
 };
 
 #endif // BENCHMARK_CORE_UTILS_THREAD_H_
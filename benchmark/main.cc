@@ -24,6 +24,7 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <unistd.h>
 
 #include "core/benchmark.h"
 #include "core/loggers/console_logger.h"
@@ -73,6 +74,17 @@ int main (int argc, const char * argv[]) {
   parser.add_argument("--duration").nargs(1).metavar("<seconds>")
         .default_value(DURATION).help("The duration of the measurement period");
   parser.add_argument("--extensive-stats").help("Display detailed statistics");
+  parser.add_argument("--buffered-records")
+        .help("Retrieve records using GetNextBuffered() (if available)");
+  parser.add_argument("--batch-size").nargs(1).metavar("<value>")
+        .default_value("0")
+        .help("Retrieve the records of range queries using GetNextBatch() "
+              "with the given batch size (if available)");
+  parser.add_argument("--pin-threads").nargs(1).metavar("<policy>")
+        .default_value("none")
+        .help("Pin the threads to the CPUs of the NUMA nodes: none, compact "
+              "(fill one node after another), scatter (alternate between "
+              "the nodes) or index (all threads of an index on one node)");
   parser.add_argument("--configuration-details")
         .help("Display configuration details before running the benchmark");
 
@@ -115,6 +127,10 @@ int main (int argc, const char * argv[]) {
   props.Set("workload-file", parser.get_value("<filename>")->get());
   props.Set("extensive-stats",
             parser.is_set("--extensive-stats")?"true":"false");
+  props.Set("buffered-records",
+            parser.is_set("--buffered-records")?"true":"false");
+  props.Set("batch-size", parser.get_value("--batch-size")->get());
+  props.Set("pin-threads", parser.get_value("--pin-threads")->get());
 
   // If necessary, print configuration details
   if(parser.is_set("--configuration-details")){
@@ -123,6 +139,7 @@ int main (int argc, const char * argv[]) {
     logger.Info("Warm-up      :\t"+lexical_cast(props.warmup_time()));
     logger.Info("Duration     :\t"+lexical_cast(props.measurement_time()));
     logger.Info("Thread Count :\t"+lexical_cast(props.thread_count()));
+    logger.Info("Pin Threads  :\t"+props.Get("pin-threads","none"));
     logger.CloseSection();
   }
 
@@ -0,0 +1,227 @@
+//
+// Copyright (c) 2012 TU Dresden - Database Technology Group
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+//
+
+// A microbenchmark comparing the per-attribute bounds check of SkipScan()
+// with the vectorized check of common/bounds_check.h.
+//
+// For a few schemas of SHORT and INT attributes, random keys are checked
+// against random bounds using SkipScan() and every kernel supported by the
+// processor. The results of all kernels are verified against SkipScan() first.
+//
+// Usage: bounds-check-benchmark [<keys>] [<rounds>]
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <common/bounds_check.h>
+#include <common/key_codec.h>
+#include <common/skip_scan.h>
+
+#include "core/utils/timer.h"
+
+// The default number of keys checked per round
+#define DEFAULT_KEYS 100000
+
+// The default number of rounds
+#define DEFAULT_ROUNDS 200
+
+// A schema used by the benchmark
+struct Schema{
+  const char *name;
+  std::vector<AttributeType> types;
+};
+
+// A kernel that is measured
+struct Kernel{
+  const char *name;
+  BoundsCheckKernel kernel;
+};
+
+// Return a schema consisting of the given attribute types
+static Schema MakeSchema(const char *name, const char *types){
+  Schema schema;
+  schema.name = name;
+  for(const char *type = types; *type; type++)
+    schema.types.push_back((*type == 's') ? kShort : kInt);
+  return schema;
+}
+
+// Encode a random key (attributes are NULL with the given probability in
+// percent, which encodes wildcards)
+static size_t RandomKey(const Schema &schema, char *data, int wildcards,
+                        bool max){
+  Attribute attributes[BOUNDS_CHECK_MAX_SIZE];
+  Attribute *values[BOUNDS_CHECK_MAX_SIZE];
+  Key key;
+  key.attribute_count = schema.types.size();
+  key.value = values;
+  for(size_t i = 0; i < schema.types.size(); i++){
+    attributes[i].type = schema.types[i];
+    // A small domain makes the keys match some bounds and miss others
+    int value = (rand() % 64) - 32;
+    if(schema.types[i] == kShort)
+      attributes[i].short_value = value;
+    else
+      attributes[i].int_value = value;
+    values[i] = ((rand() % 100) < wildcards) ? NULL : &attributes[i];
+  }
+  return EncodeKey(&schema.types[0], schema.types.size(), key, data, max);
+}
+
+// Return whether the vectorized check returns the same results as SkipScan()
+static bool Verify(const Schema &schema, const BoundsCheck &check,
+                   const char *min, const char *max,
+                   const std::vector<char> &keys){
+  const AttributeType *types = &schema.types[0];
+  uint8_t count = schema.types.size();
+  std::vector<char> expected(SkipScanTargetSize(types, count));
+  std::vector<char> target(SkipScanTargetSize(types, count));
+  for(size_t offset = 0; offset < keys.size(); offset += check.size){
+    size_t expected_size = 0, target_size = 0;
+    SkipScanResult a = SkipScan(types, count, &keys[offset], min, max,
+                                &expected[0], &expected_size);
+    SkipScanResult b = CheckBounds(&check, &keys[offset], &target[0],
+                                   &target_size);
+    if(a != b)
+      return false;
+    if((a == kSkipScanSeek)
+       && ((expected_size != target_size)
+           || (memcmp(&expected[0], &target[0], target_size) != 0)))
+      return false;
+  }
+  return true;
+}
+
+// Print the time needed per key
+static void Report(const char *name, Timer &timer, size_t checks,
+                   size_t matches){
+  double nanoseconds = timer.milliseconds() * 1000000.0 / checks;
+  std::cout << "  " << name << ": " << nanoseconds << " ns/key ("
+            << matches << " matches)" << std::endl;
+}
+
+// Measure all kernels on the given schema (the bounds restrict each
+// attribute with the given probability in percent)
+//
+// Returns false if a kernel returns wrong results.
+static bool Measure(const Schema &schema, const std::vector<Kernel> &kernels,
+                    int restricted, size_t key_count, size_t rounds){
+  const AttributeType *types = &schema.types[0];
+  uint8_t count = schema.types.size();
+  size_t size = MaxEncodedKeySize(types, count);
+
+  char min[BOUNDS_CHECK_MAX_SIZE], max[BOUNDS_CHECK_MAX_SIZE];
+  RandomKey(schema, min, 100 - restricted, false);
+  RandomKey(schema, max, 100 - restricted, true);
+
+  std::vector<char> keys(key_count * size);
+  for(size_t i = 0; i < key_count; i++)
+    RandomKey(schema, &keys[i * size], 0, false);
+
+  std::cout << schema.name << " (" << size << " bytes, " << restricted
+            << "% of the attributes restricted):" << std::endl;
+
+  // The loop used by the iterators so far
+  std::vector<char> target(SkipScanTargetSize(types, count));
+  size_t target_size;
+  size_t matches = 0;
+  Timer timer;
+  timer.Start();
+  for(size_t r = 0; r < rounds; r++){
+    for(size_t offset = 0; offset < keys.size(); offset += size){
+      if(SkipScan(types, count, &keys[offset], min, max, &target[0],
+                  &target_size) == kSkipScanMatch)
+        matches++;
+    }
+  }
+  timer.Stop();
+  Report("SkipScan", timer, key_count * rounds, matches);
+
+  bool correct = true;
+  for(size_t k = 0; k < kernels.size(); k++){
+    BoundsCheck check;
+    PrepareBoundsCheck(&check, types, count, min, max);
+    check.kernel = kernels[k].kernel;
+    if(!Verify(schema, check, min, max, keys)){
+      std::cout << "  " << kernels[k].name << ": wrong results" << std::endl;
+      correct = false;
+      continue;
+    }
+
+    matches = 0;
+    timer.Start();
+    for(size_t r = 0; r < rounds; r++){
+      for(size_t offset = 0; offset < keys.size(); offset += size){
+        if(CheckBounds(&check, &keys[offset], &target[0], &target_size)
+           == kSkipScanMatch)
+          matches++;
+      }
+    }
+    timer.Stop();
+    Report(kernels[k].name, timer, key_count * rounds, matches);
+  }
+  return correct;
+}
+
+int main(int argc, char **argv){
+  size_t key_count = (argc > 1) ? strtoul(argv[1], NULL, 10) : DEFAULT_KEYS;
+  size_t rounds = (argc > 2) ? strtoul(argv[2], NULL, 10) : DEFAULT_ROUNDS;
+  srand(1);
+
+  std::vector<Schema> schemas;
+  schemas.push_back(MakeSchema("2 x INT", "ii"));
+  schemas.push_back(MakeSchema("SHORT,INT,SHORT", "sis"));
+  schemas.push_back(MakeSchema("4 x INT", "iiii"));
+  schemas.push_back(MakeSchema("8 x INT", "iiiiiiii"));
+  schemas.push_back(MakeSchema("16 x SHORT", "ssssssssssssssss"));
+
+  std::vector<Kernel> kernels;
+#ifdef BOUNDS_CHECK_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("sse2")){
+    Kernel sse2 = {"SSE2", BoundsCheckSSE2};
+    kernels.push_back(sse2);
+  }
+  if(__builtin_cpu_supports("avx2")){
+    Kernel avx2 = {"AVX2", BoundsCheckAVX2};
+    kernels.push_back(avx2);
+  }
+#endif
+
+  // Unrestricted bounds are the worst case for SkipScan(), which has to
+  // compare every attribute of every key
+  if(kernels.empty())
+    std::cout << "No vectorized kernel is supported" << std::endl;
+
+  bool correct = true;
+  for(size_t s = 0; s < schemas.size(); s++){
+    correct &= Measure(schemas[s], kernels, 0, key_count, rounds);
+    correct &= Measure(schemas[s], kernels, 50, key_count, rounds);
+  }
+
+  return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -26,6 +26,7 @@
 #include <set>
 #include <cstring>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "core/generators/normal_generator.h"
 #include "core/generators/uniform_generator.h"
@@ -34,6 +35,8 @@
 #include "core/utils/rngs/fast_rand_number_generator.h"
 #include "core/utils/lexical_cast.h"
 
+#include <common/numa.h>
+
 #include "sigmod_2012_basic_workload.h"
 #include "sigmod_2012_properties.h"
 
@@ -44,6 +47,9 @@
 #define INSERTS_PER_TXN 5
 #define DELETES_PER_TXN 5
 
+// The number of records passed to a single BulkLoad() call while populating
+#define POPULATE_BATCH_SIZE 16384
+
 
 // Runs the workload and return a statistics object
 Statistics * SIGMOD2012BasicWorkload::Run(){
@@ -54,6 +60,11 @@ Statistics * SIGMOD2012BasicWorkload::Run(){
     }
   }
 
+  // Read the allocation counter of the implementation (if available)
+  uint64_t allocations_before = 0;
+  bool count_allocations = (GetAllocationCount != NULL)
+                           && (GetAllocationCount(&allocations_before) == kOk);
+
   // Run the measurement
   for(unsigned int i=0; i < thread_count_; i++){
     threads[i]->EnableMeasurement();
@@ -69,6 +80,10 @@ Statistics * SIGMOD2012BasicWorkload::Run(){
     threads[i]->Join();
   }
 
+  uint64_t allocations_after = 0;
+  if(count_allocations)
+    count_allocations = (GetAllocationCount(&allocations_after) == kOk);
+
   // Gather statistics
   unsigned int deadlock_count = 0;
   unsigned int tx_count = 0;
@@ -85,6 +100,19 @@ Statistics * SIGMOD2012BasicWorkload::Run(){
   statistics->Add("Operations/Second",
                   lexical_cast<float>(op_count/measurement_time_));
   statistics->Add("Number of Deadlocks",lexical_cast(deadlock_count));
+  if(count_allocations && (op_count > 0)){
+    uint64_t allocations = allocations_after - allocations_before;
+    statistics->Add("Allocations/Operation",
+                    lexical_cast<float>((float) allocations/op_count));
+  }
+  float bytes_per_record;
+  if((populated_bytes_per_record_ >= 0)
+     && MeasureMemoryUsage(&bytes_per_record)){
+    statistics->Add("Bytes/Record",
+                    lexical_cast(populated_bytes_per_record_)
+                    +" (after population), "+lexical_cast(bytes_per_record)
+                    +" (after measurement)");
+  }
   if(tx_count > 0){
     unsigned int failed = tx_count - tx_success_count;
     statistics->Add("Failed Transactions",
@@ -94,6 +122,8 @@ Statistics * SIGMOD2012BasicWorkload::Run(){
     logger_.Error(lexical_cast(tx_count)+" transactions executed");
   }
 
+  AddPlacementStatistics(statistics);
+
   if(properties_->extensive_stats()){
     for(unsigned int i =0; i < thread_count_; i++){
       StatGroup group("Thread "+lexical_cast(i+1)+" ("+
@@ -108,6 +138,10 @@ Statistics * SIGMOD2012BasicWorkload::Run(){
       group.Add("Updates",lexical_cast(threads[i]->update_count()));
       group.Add("Deletes",lexical_cast(threads[i]->delete_count()));
       group.Add("Number of Deadlocks",lexical_cast(threads[i]->deadlock_count()));
+      if(threads[i]->cpu() >= 0){
+        group.Add("CPU",lexical_cast(threads[i]->cpu())+" (node "+
+                  lexical_cast(NumaNodeOfCpu(threads[i]->cpu()))+")");
+      }
       tx_count = threads[i]->tx_count();
       if(tx_count > 0){
         unsigned int failed = tx_count - threads[i]->tx_success_count();
@@ -145,9 +179,31 @@ bool SIGMOD2012BasicWorkload::Init(BenchmarkProperties &properties){
   else if(properties.Get("extensive-stats","") == "false")
     properties_->extensive_stats(false);
 
+  // Update the record retrieval settings
+  if(properties.Get("buffered-records","") == "true"){
+    if(GetNextBuffered != NULL){
+      properties_->buffered_records(true);
+    } else {
+      logger_.Warning("GetNextBuffered() is not available, using GetNext()");
+    }
+  }
+  int batch_size = atoi(properties.Get("batch-size","0").c_str());
+  if(batch_size > 0){
+    if(GetNextBatch != NULL){
+      properties_->batch_size(batch_size);
+    } else {
+      logger_.Warning("GetNextBatch() is not available, using GetNext()");
+    }
+  }
+
   if(!properties_)
     return false;
 
+  // Determine the CPUs of the threads
+  if(!PlaceThreads(properties.Get("pin-threads","none"),
+                   properties.thread_count()))
+    return false;
+
   // Create the indices
   if(!CreateIndices())
     return false;
@@ -162,6 +218,7 @@ bool SIGMOD2012BasicWorkload::Init(BenchmarkProperties &properties){
     threads[i] = new SIGMOD2012BenchmarkThread(logger_,*properties_,
                      properties_->GetIndex(i%properties_->index_count()),
                                                properties.seed()+i);
+    threads[i]->affinity(thread_cpus_[i]);
   }
 
   thread_count_ = properties.thread_count();
@@ -213,6 +270,7 @@ bool SIGMOD2012BasicWorkload::PopulateIndices(){
 
   for(unsigned int i = 0; i < properties_->index_count(); i++){
     threads[i] = new PopulateThread(logger_,properties_->GetIndex(i),rng_->Next());
+    threads[i]->affinity(populate_cpus_[i]);
     threads[i]->Start();
   }
 
@@ -223,9 +281,167 @@ bool SIGMOD2012BasicWorkload::PopulateIndices(){
   }
   populate_timer.Stop();
   logger_.CloseSection(success,lexical_cast(populate_timer.milliseconds())+" ms");
+
+  if(success && !MeasureMemoryUsage(&populated_bytes_per_record_))
+    populated_bytes_per_record_ = -1;
   return success;
 }
 
+// Determine the memory used per record by all indices
+bool SIGMOD2012BasicWorkload::MeasureMemoryUsage(float *bytes_per_record){
+  if(GetIndexMemoryUsage == NULL)
+    return false;
+
+  uint64_t total_records = 0;
+  uint64_t total_bytes = 0;
+  for(unsigned int i = 0; i < properties_->index_count(); i++){
+    uint64_t records, bytes;
+    if(GetIndexMemoryUsage(properties_->GetIndex(i).name(), &records, &bytes)
+       != kOk)
+      return false;
+    total_records += records;
+    total_bytes += bytes;
+  }
+  if(total_records == 0)
+    return false;
+
+  *bytes_per_record = (float) total_bytes / total_records;
+  return true;
+}
+
+// Determine the CPUs of the benchmark and population threads using the given
+// placement policy:
+//
+//   none    - the threads are not pinned
+//   compact - benchmark thread i runs on the i-th CPU, filling one NUMA node
+//             after another
+//   scatter - the benchmark threads alternate between the NUMA nodes
+//   index   - all benchmark threads using the same index run on the same NUMA
+//             node (the indices are distributed round-robin over the nodes)
+//
+// Unless the policy is none, the thread populating an index runs on the node
+// of the first benchmark thread using it, so that the memory of the index is
+// placed on that node when it is touched first.
+bool SIGMOD2012BasicWorkload::PlaceThreads(const std::string &policy,
+                                           unsigned int thread_count){
+  if(policy != "none" && policy != "compact" && policy != "scatter"
+     && policy != "index"){
+    logger_.Error("Unknown thread placement policy '"+policy+"'");
+    return false;
+  }
+
+  placement_policy_ = policy;
+  thread_cpus_.assign(thread_count, std::vector<int>());
+  populate_cpus_.assign(properties_->index_count(), std::vector<int>());
+  if(policy == "none")
+    return true;
+
+  // Collect the CPUs of all nodes (ignoring nodes without CPUs)
+  std::vector<int> nodes = NumaMemoryNodes();
+  std::vector<std::vector<int> > node_cpus;
+  std::vector<int> cpus;
+  std::vector<unsigned int> cpu_nodes;
+  for(unsigned int n = 0; n < nodes.size(); n++){
+    std::vector<int> node = NumaNodeCpus(nodes[n]);
+    if(node.empty())
+      continue;
+    for(unsigned int c = 0; c < node.size(); c++){
+      cpus.push_back(node[c]);
+      cpu_nodes.push_back(node_cpus.size());
+    }
+    node_cpus.push_back(node);
+  }
+  if(cpus.empty()){
+    logger_.Warning("Could not determine the CPUs, threads are not pinned");
+    return true;
+  }
+
+  logger_.AddSection("Thread placement","Pinning threads ("+policy+", "+
+                     lexical_cast(node_cpus.size())+" NUMA nodes, "+
+                     lexical_cast(cpus.size())+" CPUs)");
+
+  // The node of each benchmark thread (position inside node_cpus)
+  std::vector<unsigned int> thread_nodes(thread_count);
+  for(unsigned int i = 0; i < thread_count; i++){
+    if(policy == "compact"){
+      thread_nodes[i] = cpu_nodes[i % cpus.size()];
+      thread_cpus_[i].push_back(cpus[i % cpus.size()]);
+    } else if(policy == "scatter"){
+      thread_nodes[i] = i % node_cpus.size();
+      std::vector<int> &node = node_cpus[thread_nodes[i]];
+      thread_cpus_[i].push_back(node[(i / node_cpus.size()) % node.size()]);
+    } else {
+      thread_nodes[i] = (i % properties_->index_count()) % node_cpus.size();
+      thread_cpus_[i] = node_cpus[thread_nodes[i]];
+    }
+  }
+
+  // Populate each index on the node of the first thread using it
+  for(unsigned int i = 0; i < properties_->index_count() && i < thread_count;
+      i++){
+    populate_cpus_[i] = node_cpus[thread_nodes[i]];
+  }
+
+  for(unsigned int i = 0; i < thread_count; i++){
+    logger_.Verbose("Thread "+lexical_cast(i+1)+" ("+
+                    properties_->GetIndex(i%properties_->index_count()).name()+
+                    "): node "+lexical_cast(NumaNodeOfCpu(thread_cpus_[i][0])));
+  }
+  logger_.CloseSection(true);
+  return true;
+}
+
+// Add the NUMA nodes the benchmark threads ran on and the nodes holding the
+// memory of the indices to the given statistics
+void SIGMOD2012BasicWorkload::AddPlacementStatistics(Statistics *statistics){
+  std::vector<int> nodes = NumaMemoryNodes();
+  if(nodes.size() < 2 && placement_policy_ == "none")
+    return;
+
+  // Count the threads per node using the CPUs they ran on
+  std::vector<unsigned int> threads_per_node(nodes.size(), 0);
+  for(unsigned int i = 0; i < thread_count_; i++){
+    if(threads[i]->cpu() < 0)
+      continue;
+    int node = NumaNodeOfCpu(threads[i]->cpu());
+    for(unsigned int n = 0; n < nodes.size(); n++){
+      if(nodes[n] == node)
+        threads_per_node[n]++;
+    }
+  }
+  std::string placement = placement_policy_;
+  for(unsigned int n = 0; n < nodes.size(); n++){
+    placement += ", node "+lexical_cast(nodes[n])+": "+
+                 lexical_cast(threads_per_node[n]);
+  }
+  statistics->Add("Thread Placement",placement);
+
+  if(GetIndexMemoryPlacement == NULL)
+    return;
+
+  // Report the share of the pages of each index per node
+  uint32_t node_count = nodes.back() + 1;
+  std::vector<uint64_t> pages(node_count);
+  StatGroup group("Memory Placement");
+  for(unsigned int i = 0; i < properties_->index_count(); i++){
+    const char *name = properties_->GetIndex(i).name();
+    if(GetIndexMemoryPlacement(name, node_count, &pages[0]) != kOk)
+      return;
+    uint64_t total = 0;
+    for(unsigned int n = 0; n < nodes.size(); n++)
+      total += pages[nodes[n]];
+    std::string shares;
+    for(unsigned int n = 0; n < nodes.size(); n++){
+      if(n > 0)
+        shares += ", ";
+      float share = (total > 0) ? (100.0f * pages[nodes[n]] / total) : 0;
+      shares += "node "+lexical_cast(nodes[n])+": "+lexical_cast(share)+"%";
+    }
+    group.Add(name,shares);
+  }
+  statistics->AddGroup(group);
+}
+
 // Initializes a new population thread that populates the given index
 SIGMOD2012BasicWorkload::PopulateThread::PopulateThread(Logger &logger,
                           SIGMOD2012IndexProperties &index, unsigned int seed):
@@ -268,21 +484,30 @@ void SIGMOD2012BasicWorkload::PopulateThread::Run(){
     return;
   }
 
+  // If the implementation supports bulk loading, the records are inserted in
+  // batches (otherwise one by one)
+  unsigned int batch_size = (BulkLoad != NULL) ? POPULATE_BATCH_SIZE : 1;
+
   // Allocate all necessary memory
-  Record *record = (Record*) malloc(sizeof(Record));
-  record->key.attribute_count = index_.dimensions();
-  record->key.value = (Attribute**) malloc(index_.dimensions()*sizeof(Attribute*));
-  for(unsigned int i = 0; i < index_.dimensions(); i++){
-    record->key.value[i] = (Attribute*) malloc(sizeof(Attribute));
-    record->key.value[i]->type = index_.types()[i];
+  Record *records = (Record*) malloc(batch_size*sizeof(Record));
+  for(unsigned int b = 0; b < batch_size; b++){
+    Record *record = &records[b];
+    record->key.attribute_count = index_.dimensions();
+    record->key.value = (Attribute**) malloc(index_.dimensions()*sizeof(Attribute*));
+    for(unsigned int i = 0; i < index_.dimensions(); i++){
+      record->key.value[i] = (Attribute*) malloc(sizeof(Attribute));
+      record->key.value[i]->type = index_.types()[i];
+    }
+    record->payload.size = index_.payload_size();
+    record->payload.data = malloc(index_.payload_size());
   }
-  record->payload.size = index_.payload_size();
-  record->payload.data = malloc(index_.payload_size());
   // Initialize the payload generator
   FixedLengthStringGenerator payload_generator(index_.payload_size(),*rng_);
 
   // Insert the records
+  unsigned int filled = 0;
   for(unsigned int i = 0; i < index_.populate_count(); i++){
+    Record *record = &records[filled++];
     char* data = new char[index_.key_size()];
     size_t offset = 0;
 
@@ -315,13 +540,27 @@ void SIGMOD2012BasicWorkload::PopulateThread::Run(){
     // Set the new Payload
     memcpy(record->payload.data,payload_generator.next().c_str(),index_.payload_size());
 
-    // Insert the record
-    if(kOk != InsertRecord(0, idx, record)){
-      logger_.Error("Could not insert record");
-      return;
+    // Insert the records once the batch is full (or all records were created)
+    if((filled == batch_size) || (i+1 == index_.populate_count())){
+      ErrorCode result = (BulkLoad != NULL) ? BulkLoad(idx, records, filled)
+                                            : InsertRecord(0, idx, record);
+      if(kOk != result){
+        logger_.Error("Could not insert record");
+        return;
+      }
+      filled = 0;
     }
   }
 
+  // Free the records
+  for(unsigned int b = 0; b < batch_size; b++){
+    for(unsigned int i = 0; i < index_.dimensions(); i++)
+      free(records[b].key.value[i]);
+    free(records[b].key.value);
+    free(records[b].payload.data);
+  }
+  free(records);
+
   // Close the Index
   if(kOk != CloseIndex(&idx)){
     logger_.Error("Could not close index '" +lexical_cast(index_.name())+"'");
@@ -347,7 +586,7 @@ enum Probabilities{
 SIGMOD2012BasicWorkload::SIGMOD2012BenchmarkThread::SIGMOD2012BenchmarkThread(
  Logger &logger,SIGMOD2012Properties &properties, SIGMOD2012IndexProperties &index,
                                                             unsigned int seed):
- BenchmarkThread(),index_(index),logger_(logger){
+ BenchmarkThread(),index_(index),logger_(logger),cpu_(-1){
   std::vector<int> probs;
 
   // Range queries
@@ -367,6 +606,9 @@ SIGMOD2012BasicWorkload::SIGMOD2012BenchmarkThread::SIGMOD2012BenchmarkThread(
   // Initialize the generator
   op_select_ = new DiscreteGenerator(probs,*rng_);
 
+  buffered_records_ = properties.buffered_records();
+  batch_size_ = properties.batch_size();
+
   // Copy the attribute generators
   generators_ = new Generator*[index_.dimensions()];
   for(unsigned int i=0; i < index_.dimensions(); i++){
@@ -428,6 +670,11 @@ void SIGMOD2012BasicWorkload::SIGMOD2012BenchmarkThread::Run(){
   int tx_ops;
   Record *retrieved;
 
+  // Allocate the records filled by GetNextBatch()
+  Record *batch = NULL;
+  if(batch_size_ > 0)
+    batch = (Record*) malloc(batch_size_*sizeof(Record));
+
   // Allocate a record to use for all operations
   Record* a = (Record*) malloc(sizeof(Record));
   a->key.attribute_count = index_.dimensions();
@@ -504,17 +751,42 @@ void SIGMOD2012BasicWorkload::SIGMOD2012BenchmarkThread::Run(){
 
         // Get the records
         ErrorCode r = GetRecords(tx,idx,min,max,&it);
-        if(r == kOk){
+        if((r == kOk) && (batch_size_ > 0)){
+          increment(range_queries);
+          // Retrieve the records using as few calls as possible (every record
+          // and the end of range are counted as one operation each)
+          for(unsigned int remaining = 200; remaining > 0; ){
+            uint32_t count = 0;
+            r = GetNextBatch(it, batch,
+                             (remaining < batch_size_)?remaining:batch_size_,
+                             &count);
+            increment(tx_ops, count);
+            remaining -= count;
+            if(r != kOk){
+              increment(tx_ops);
+              CloseIterator(&it);
+              if(r == kErrorDeadlock)
+                deadlock_count_++;
+              break;
+            }
+          }
+          CloseIterator(&it);
+        } else if(r == kOk){
           increment(range_queries);
           for(int i = 0; i < 200; i++){
             increment(tx_ops);
-            if((r = GetNext(it,&retrieved)) != kOk ){
+            if(buffered_records_)
+              r = GetNextBuffered(it,&retrieved);
+            else
+              r = GetNext(it,&retrieved);
+            if(r != kOk ){
               CloseIterator(&it);
               if(r == kErrorDeadlock)
                 deadlock_count_++;
               break;
             }
-            ReleaseRecord(retrieved);
+            if(!buffered_records_)
+              ReleaseRecord(retrieved);
           }
           CloseIterator(&it);
         }
@@ -538,14 +810,19 @@ void SIGMOD2012BasicWorkload::SIGMOD2012BenchmarkThread::Run(){
           ErrorCode r = GetRecords(tx,idx,a->key,a->key,&it);
 
           if(r == kOk){
-            if((r = GetNext(it,&retrieved)) != kOk ){
+            if(buffered_records_)
+              r = GetNextBuffered(it,&retrieved);
+            else
+              r = GetNext(it,&retrieved);
+            if(r != kOk ){
               if(r == kErrorDeadlock)
                 deadlock_count_++;
               CloseIterator(&it);
               break;
             }
             increment(tx_ops);
-            ReleaseRecord(retrieved);
+            if(!buffered_records_)
+              ReleaseRecord(retrieved);
             r = CloseIterator(&it);
           }
         }
@@ -692,6 +969,8 @@ void SIGMOD2012BasicWorkload::SIGMOD2012BenchmarkThread::Run(){
 
   }
 
+  // Remember where the thread ran (see SIGMOD2012BasicWorkload::Run())
+  cpu_ = CurrentCpu();
 
   if(kOk != CloseIndex(&idx)){
     logger_.Warning("Could not close index'"+lexical_cast(index_.name())+"'");
@@ -699,6 +978,7 @@ void SIGMOD2012BasicWorkload::SIGMOD2012BenchmarkThread::Run(){
 
   // Cleanup
   ReleaseRecord(a);
+  free(batch);
 
 #ifdef DEBUG_
   std::cout<<"!"<<std::flush;
@@ -31,9 +31,28 @@
 #include <iostream>
 #include <cstring>
 #include <cassert>
+#include <string>
+#include <vector>
 
 #include "contest_interface.h"
 
+// Optional extensions of the contest interface are referenced weakly, so the
+// benchmark can be linked against implementations that do not provide them
+// (in this case their addresses are NULL)
+extern "C" ErrorCode GetNextBuffered(Iterator *it, Record** record)
+  __attribute__((weak));
+extern "C" ErrorCode GetNextBatch(Iterator *it, Record* records, uint32_t max,
+                                  uint32_t* count) __attribute__((weak));
+extern "C" ErrorCode BulkLoad(Index *idx, Record *records, uint32_t count)
+  __attribute__((weak));
+extern "C" ErrorCode GetAllocationCount(uint64_t *count) __attribute__((weak));
+extern "C" ErrorCode GetIndexMemoryUsage(const char* name, uint64_t *records,
+                                         uint64_t *bytes) __attribute__((weak));
+extern "C" ErrorCode GetIndexMemoryPlacement(const char* name,
+                                             uint32_t node_count,
+                                             uint64_t *pages)
+  __attribute__((weak));
+
 #include "core/benchmark.h"
 #include "core/workload.h"
 #include "core/generators/integer_generator.h"
@@ -56,7 +75,8 @@ class SIGMOD2012BasicWorkload : public Workload {
 
   // Constructs a new Workload that uses the given logger
   SIGMOD2012BasicWorkload(Logger &logger):
-    Workload(logger),initialized_(false),warmed_up_(false){};
+    Workload(logger),initialized_(false),warmed_up_(false),
+    populated_bytes_per_record_(-1),placement_policy_("none"){};
 
   // Destructor
   ~SIGMOD2012BasicWorkload(){
@@ -90,6 +110,18 @@ class SIGMOD2012BasicWorkload : public Workload {
   // Populates the indices used by the benchmark
   bool PopulateIndices();
 
+  // Determine the memory used per record by all indices (returns false if the
+  // implementation does not report its memory usage)
+  bool MeasureMemoryUsage(float *bytes_per_record);
+
+  // Determine the CPUs of the benchmark and population threads using the
+  // given placement policy (returns false if the policy is unknown)
+  bool PlaceThreads(const std::string &policy, unsigned int thread_count);
+
+  // Add the NUMA nodes the benchmark threads ran on and the nodes holding the
+  // memory of the indices to the given statistics
+  void AddPlacementStatistics(Statistics *statistics);
+
   // The random number generator to be used
   RandomNumberGenerator *rng_;
 
@@ -111,6 +143,20 @@ class SIGMOD2012BasicWorkload : public Workload {
   // Whether the benchmark has already been warmed up
   bool warmed_up_;
 
+  // The memory used per record after populating the indices (negative if the
+  // implementation does not report its memory usage)
+  float populated_bytes_per_record_;
+
+  // The policy used to pin the threads to CPUs (see PlaceThreads())
+  std::string placement_policy_;
+
+  // The CPUs of each benchmark thread (empty if the thread is not pinned)
+  std::vector<std::vector<int> > thread_cpus_;
+
+  // The CPUs of the thread populating each index (empty if the thread is not
+  // pinned)
+  std::vector<std::vector<int> > populate_cpus_;
+
   // A single thread that is used to populate a given index
   class PopulateThread: public Thread{
    public:
@@ -196,6 +242,10 @@ class SIGMOD2012BasicWorkload : public Workload {
 
     // Returns the name of the index used by this thread
     std::string index_name() const {return index_.name();}
+
+    // Returns the CPU the thread ran on at the end of the measurement (or -1
+    // if unknown)
+    int cpu() const {return cpu_;}
   private:
     // Resets all statistical values to its default values
     void ResetStatistics();
@@ -223,6 +273,13 @@ class SIGMOD2012BasicWorkload : public Workload {
     // The logger used by the thread
     Logger &logger_;
 
+    // Whether records are retrieved using GetNextBuffered()
+    bool buffered_records_;
+
+    // The number of records retrieved by each GetNextBatch() call (0 if
+    // GetNextBatch() is not used)
+    unsigned int batch_size_;
+
     // Whether the thread is running
     bool run_;
 
@@ -259,6 +316,9 @@ class SIGMOD2012BasicWorkload : public Workload {
     // The number of delete operations executed by this thread
     unsigned int delete_count_;
 
+    // The CPU the thread ran on at the end of the measurement
+    int cpu_;
+
     DISALLOW_COPY_AND_ASSIGN(SIGMOD2012BenchmarkThread);
   };
 
@@ -25,6 +25,7 @@
 #ifndef BENCHMARK_WORKLOADS_SIGMOD_2012_PROPERTIES_H_
 #define BENCHMARK_WORKLOADS_SIGMOD_2012_PROPERTIES_H_
 
+#include <string>
 #include <vector>
 #include <cassert>
 
@@ -42,7 +43,8 @@ class SIGMOD2012Properties{
   // Creates a new properties object for the SIGMOD 2012 Programming Contest
   // workload
   SIGMOD2012Properties():range_portion_(0),point_portion_(0),update_portion_(0),
-  insert_portion_(0),delete_portion_(0),extensive_stats_(false){}
+  insert_portion_(0),delete_portion_(0),extensive_stats_(false),
+  buffered_records_(false),batch_size_(0){}
   
   // Loads the properties from a file
   static SIGMOD2012Properties *LoadFromFile(Logger &logger,
@@ -75,6 +77,13 @@ class SIGMOD2012Properties{
   // Returns whether extensive stats are enabled
   bool extensive_stats() const{return extensive_stats_;}
   
+  // Returns whether records are retrieved using GetNextBuffered()
+  bool buffered_records() const{return buffered_records_;}
+  
+  // Returns the number of records retrieved by each GetNextBatch() call
+  // (0 if GetNextBatch() is not used)
+  unsigned int batch_size() const{return batch_size_;}
+  
   // Returns the number of indices inside this property object
   size_t index_count() const {return indices_.size();}
   
@@ -96,6 +105,14 @@ class SIGMOD2012Properties{
   // Sets whether extensive stats should be used
   void extensive_stats(bool extensive_stats){extensive_stats_=extensive_stats;}
   
+  // Sets whether records are retrieved using GetNextBuffered()
+  void buffered_records(bool buffered_records){
+    buffered_records_=buffered_records;
+  }
+  
+  // Sets the number of records retrieved by each GetNextBatch() call
+  void batch_size(unsigned int batch_size){batch_size_=batch_size;}
+  
  private:
   // A list of all indices to be used by the benchmark
   std::vector<SIGMOD2012IndexProperties*> indices_;
@@ -117,6 +134,12 @@ class SIGMOD2012Properties{
   
   // Whether extensive statistics are enabled
   bool extensive_stats_;
+  
+  // Whether records are retrieved using GetNextBuffered()
+  bool buffered_records_;
+  
+  // The number of records retrieved by each GetNextBatch() call
+  unsigned int batch_size_;
 };
 
 // Defines properties for indices used by the SIGMOD 2012 Programming Contest
@@ -161,7 +184,7 @@ class SIGMOD2012IndexProperties{
   };
   
   // Returns the name of the index
-  const char* name() const {return name_;}
+  const char* name() const {return name_.c_str();}
   
   // Returns the attribute types of the index
   AttributeType* types() const {return types_;}
@@ -195,7 +218,7 @@ class SIGMOD2012IndexProperties{
   
  private:
   // The name of the index
-  const char* name_;
+  std::string name_;
   
   // The number of dimensions of the index
   unsigned int dimensions_;
@@ -0,0 +1,290 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+/** @file
+Vectorized per-attribute bounds checks for keys of fixed width.
+
+If a key consists of SHORT and INT attributes only, every encoded key (see
+common/key_codec.h) has the same size and every attribute starts at the same
+offset. Instead of comparing one attribute after another (as SkipScan() does),
+the check compares all bytes of the key with both bounds at once and derives
+the per-attribute results from the byte masks:
+
+  - for each attribute only the first byte that differs from the bound decides
+    about the order, so the lowest bit of every attribute's segment inside the
+    mask of differing bytes is isolated by a single subtraction
+  - the key matches, if none of these bytes is smaller than the lower bound or
+    greater than the upper bound of its attribute
+
+The byte comparisons use AVX2 or SSE2 instructions, depending on the features
+of the processor the check is prepared on. On other processors the bounds are
+checked by SkipScan(), whose results (including the skip-scan targets) are
+always the same.
+*/
+
+#ifndef _COMMON_BOUNDS_CHECK_H_
+#define _COMMON_BOUNDS_CHECK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BOUNDS_CHECK_X86
+#endif
+
+#include <contest_interface.h>
+#include <common/key_codec.h>
+#include <common/skip_scan.h>
+
+// The maximum size of a key supported by the vectorized check (one bit of a
+// 64-bit mask per byte)
+#define BOUNDS_CHECK_MAX_SIZE 64
+
+// The bytes of an encoded key that differ from the bounds or lie outside of
+// them (one bit per byte, bit i refers to byte i)
+struct BoundsCheckMasks{
+  uint64_t min_differs;
+  uint64_t below_min;
+  uint64_t max_differs;
+  uint64_t above_max;
+};
+
+struct BoundsCheck;
+
+// A function computing the masks of the given key
+typedef void (*BoundsCheckKernel)(const BoundsCheck *check, const char *key,
+                                  BoundsCheckMasks *masks);
+
+// The prepared bounds of a range over keys of fixed width
+struct BoundsCheck{
+  // The size of the encoded keys (0 if the keys are not supported)
+  size_t size;
+  // The first and the last byte of every attribute (one bit per byte)
+  uint64_t starts;
+  uint64_t ends;
+  // The encoded bounds
+  char min[BOUNDS_CHECK_MAX_SIZE];
+  char max[BOUNDS_CHECK_MAX_SIZE];
+  // The encoded bounds with flipped sign bits (the bytes following the key
+  // are set to 0x80, the biased value of the zeros loaded instead of them)
+  char biased_min[BOUNDS_CHECK_MAX_SIZE];
+  char biased_max[BOUNDS_CHECK_MAX_SIZE];
+  // The function computing the masks
+  BoundsCheckKernel kernel;
+};
+
+#ifdef BOUNDS_CHECK_X86
+// Compute the masks 16 bytes at a time
+//
+// SSE2 has no unsigned byte comparison, so the key is biased like the bounds
+// and compared using signed comparisons.
+__attribute__((target("sse2")))
+static inline void BoundsCheckSSE2(const BoundsCheck *check, const char *key,
+                                   BoundsCheckMasks *masks){
+  const __m128i bias = _mm_set1_epi8((char) 0x80);
+  uint64_t min_differs = 0, below_min = 0, max_differs = 0, above_max = 0;
+  for(size_t offset = 0; offset < check->size; offset += 16){
+    __m128i value;
+    if(offset + 16 <= check->size){
+      value = _mm_loadu_si128((const __m128i*) (key + offset));
+    } else {
+      // Do not read beyond the end of the key
+      char tail[16] = {0};
+      memcpy(tail, key + offset, check->size - offset);
+      value = _mm_loadu_si128((const __m128i*) tail);
+    }
+    value = _mm_xor_si128(value, bias);
+    __m128i min = _mm_loadu_si128((const __m128i*) (check->biased_min + offset));
+    __m128i max = _mm_loadu_si128((const __m128i*) (check->biased_max + offset));
+
+    min_differs |= (uint64_t) (~_mm_movemask_epi8(_mm_cmpeq_epi8(value, min))
+                               & 0xFFFF) << offset;
+    below_min |= (uint64_t) _mm_movemask_epi8(_mm_cmplt_epi8(value, min))
+                 << offset;
+    max_differs |= (uint64_t) (~_mm_movemask_epi8(_mm_cmpeq_epi8(value, max))
+                               & 0xFFFF) << offset;
+    above_max |= (uint64_t) _mm_movemask_epi8(_mm_cmpgt_epi8(value, max))
+                 << offset;
+  }
+  masks->min_differs = min_differs;
+  masks->below_min = below_min;
+  masks->max_differs = max_differs;
+  masks->above_max = above_max;
+}
+
+// Compute the masks 32 bytes at a time
+//
+// The sizes of the keys are multiples of 4 bytes, so the last part of a key
+// is read using a masked load of 32-bit elements.
+__attribute__((target("avx2")))
+static inline void BoundsCheckAVX2(const BoundsCheck *check, const char *key,
+                                   BoundsCheckMasks *masks){
+  const __m256i bias = _mm256_set1_epi8((char) 0x80);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  uint64_t min_differs = 0, below_min = 0, max_differs = 0, above_max = 0;
+  for(size_t offset = 0; offset < check->size; offset += 32){
+    __m256i value;
+    if(offset + 32 <= check->size){
+      value = _mm256_loadu_si256((const __m256i*) (key + offset));
+    } else {
+      __m256i mask = _mm256_cmpgt_epi32(
+        _mm256_set1_epi32((int) ((check->size - offset) / 4)), lanes);
+      value = _mm256_maskload_epi32((const int*) (key + offset), mask);
+    }
+    value = _mm256_xor_si256(value, bias);
+    __m256i min = _mm256_loadu_si256((const __m256i*) (check->biased_min + offset));
+    __m256i max = _mm256_loadu_si256((const __m256i*) (check->biased_max + offset));
+
+    min_differs |= (uint64_t) (uint32_t)
+      ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(value, min)) << offset;
+    below_min |= (uint64_t) (uint32_t)
+      _mm256_movemask_epi8(_mm256_cmpgt_epi8(min, value)) << offset;
+    max_differs |= (uint64_t) (uint32_t)
+      ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(value, max)) << offset;
+    above_max |= (uint64_t) (uint32_t)
+      _mm256_movemask_epi8(_mm256_cmpgt_epi8(value, max)) << offset;
+  }
+  masks->min_differs = min_differs;
+  masks->below_min = below_min;
+  masks->max_differs = max_differs;
+  masks->above_max = above_max;
+}
+#endif // BOUNDS_CHECK_X86
+
+// Return the fastest kernel supported by the processor (or NULL if there is
+// no vectorized kernel for it)
+static inline BoundsCheckKernel SelectBoundsCheckKernel(){
+#ifdef BOUNDS_CHECK_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+    return BoundsCheckAVX2;
+  if(__builtin_cpu_supports("sse2"))
+    return BoundsCheckSSE2;
+#endif
+  return NULL;
+}
+
+// Prepare a check of the given encoded bounds
+//
+// Returns false (and sets the size of the check to 0) if the attribute types
+// do not form keys of fixed width, if the keys are too large or if the
+// processor does not support any kernel. SkipScan() has to be used in this
+// case. Single attributes are left to SkipScan() as well, which compares them
+// just as fast.
+static inline bool PrepareBoundsCheck(BoundsCheck *check,
+                                      const AttributeType *types,
+                                      uint8_t count, const char *min,
+                                      const char *max){
+  check->size = 0;
+  check->kernel = SelectBoundsCheckKernel();
+  if((check->kernel == NULL) || (count < 2))
+    return false;
+
+  size_t size = 0;
+  uint64_t starts = 0, ends = 0;
+  for(int i = 0; i < count; i++){
+    if(types[i] == kVarchar)
+      return false;
+    size_t attribute_size = MaxEncodedAttributeSize(types[i]);
+    if(size + attribute_size > BOUNDS_CHECK_MAX_SIZE)
+      return false;
+    starts |= 1ull << size;
+    ends |= 1ull << (size + attribute_size - 1);
+    size += attribute_size;
+  }
+
+  memset(check->min, 0, BOUNDS_CHECK_MAX_SIZE);
+  memset(check->max, 0, BOUNDS_CHECK_MAX_SIZE);
+  memcpy(check->min, min, size);
+  memcpy(check->max, max, size);
+  for(size_t i = 0; i < BOUNDS_CHECK_MAX_SIZE; i++){
+    check->biased_min[i] = check->min[i] ^ (char) 0x80;
+    check->biased_max[i] = check->max[i] ^ (char) 0x80;
+  }
+  check->starts = starts;
+  check->ends = ends;
+  check->size = size;
+  return true;
+}
+
+// Return the first differing byte of every attribute
+//
+// Setting the last byte of every attribute guarantees that each attribute has
+// a bit set, so subtracting the first bits borrows only inside the attributes.
+static inline uint64_t FirstDifferences(uint64_t differs, uint64_t starts,
+                                        uint64_t ends){
+  uint64_t bits = differs | ends;
+  return bits & ~(bits - starts) & differs;
+}
+
+// Check the encoded key (of check->size bytes) against the prepared bounds
+//
+// Behaves like SkipScan() (target must hold at least check->size+1 bytes).
+static inline SkipScanResult CheckBounds(const BoundsCheck *check,
+                                         const char *key, char *target,
+                                         size_t *target_size){
+  BoundsCheckMasks masks;
+  check->kernel(check, key, &masks);
+
+  uint64_t below = FirstDifferences(masks.min_differs, check->starts,
+                                    check->ends) & masks.below_min;
+  uint64_t above = FirstDifferences(masks.max_differs, check->starts,
+                                    check->ends) & masks.above_max;
+  uint64_t violations = below | above;
+  if(violations == 0)
+    return kSkipScanMatch;
+
+  // Find the first attribute that violates its bounds
+  uint64_t first = violations & (~violations + 1);
+  uint64_t starts = check->starts & ((first << 1) - 1);
+  size_t prefix_size = 63 - __builtin_clzll(starts);
+  uint64_t ends = check->ends & ~(first - 1);
+  uint64_t attribute = (ends ^ (ends - 1)) & ~((1ull << prefix_size) - 1);
+
+  memcpy(target, key, prefix_size);
+  if(below & attribute){
+    // Continue with the lower bounds of the remaining attributes (like
+    // SkipScan(), prefer the lower bound if an attribute violates both)
+    memcpy(target + prefix_size, check->min + prefix_size,
+           check->size - prefix_size);
+    *target_size = check->size;
+    return kSkipScanSeek;
+  }
+
+  if(prefix_size == 0)
+    return kSkipScanEnd;
+
+  // Continue after all keys that share the current prefix
+  memset(target + prefix_size, 0xFF, check->size - prefix_size);
+  target[check->size] = '\0';
+  *target_size = check->size + 1;
+  return kSkipScanSeek;
+}
+
+#endif // _COMMON_BOUNDS_CHECK_H_
@@ -0,0 +1,495 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+/** @file
+An order-preserving, variable-length encoding for multidimensional keys.
+
+Every attribute is encoded so that the byte-wise (memcmp) order of the
+encoded attributes matches the order of the original values:
+  - SHORT and INT attributes are stored big-endian with a flipped sign bit
+  - VARCHAR attributes are stored using their actual length followed by a
+    terminating '\0' byte (as the values are C strings, they never contain
+    '\0' bytes themselves, so no further escaping is needed)
+
+As no encoded attribute is a prefix of another encoded attribute of the same
+type, the concatenation of all attributes can be compared using memcmp as
+well. Shorter keys are ordered before longer keys that start with the same
+bytes.
+
+If an attribute of a key is NULL, a wildcard is encoded instead. Minimum
+wildcards encode the smallest possible value. Maximum wildcards encode the
+largest possible value (for VARCHAR attributes this is a sequence of
+MAX_VARCHAR_LENGTH+1 0xFF bytes, which compares greater than any encoded
+string).
+
+Keys consisting of SHORT and INT attributes only may be stored in Z-order
+instead: the bits of the encoded attributes are interleaved, starting with the
+most significant bit of every attribute (attributes that have run out of bits
+are left out). The byte-wise order of such keys is the Z-order of the points
+they describe, so all keys inside a box (given by a minimum and a maximum per
+attribute) lie between the Z-order keys of its lower and upper corner. A Z-order
+key has the same size as the concatenated encoding.
+*/
+
+#ifndef _COMMON_KEY_CODEC_H_
+#define _COMMON_KEY_CODEC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CODEC_X86
+#endif
+
+#include <contest_interface.h>
+
+// Convert a 32-bit value from host to big-endian byte order (and back)
+static inline uint32_t CodecSwap32(uint32_t value){
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return __builtin_bswap32(value);
+#else
+  return value;
+#endif
+}
+
+// Convert a 64-bit value from host to big-endian byte order (and back)
+static inline uint64_t CodecSwap64(uint64_t value){
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return __builtin_bswap64(value);
+#else
+  return value;
+#endif
+}
+
+// Return the maximum size of an encoded attribute of the given type
+static inline size_t MaxEncodedAttributeSize(AttributeType type){
+  if(type == kShort)
+    return 4;
+  else if(type == kInt)
+    return 8;
+  return MAX_VARCHAR_LENGTH+1;
+}
+
+// Return the maximum size of an encoded key using the given attribute types
+static inline size_t MaxEncodedKeySize(const AttributeType *types, uint8_t count){
+  size_t size = 0;
+  for(int i = 0; i < count; i++)
+    size += MaxEncodedAttributeSize(types[i]);
+  return size;
+}
+
+// Return the size of the encoded attribute of the given type stored at data
+static inline size_t EncodedAttributeSize(AttributeType type, const char *data){
+  if(type == kShort)
+    return 4;
+  else if(type == kInt)
+    return 8;
+
+  // Maximum wildcards are the only values without a terminating '\0'. Values
+  // encoded using a dictionary (see native/dictionary.h) may be longer than
+  // MAX_VARCHAR_LENGTH, but never start with 0xFF.
+  size_t length = strnlen(data, MAX_VARCHAR_LENGTH+1);
+  if(length <= MAX_VARCHAR_LENGTH)
+    return length+1;
+  if((uint8_t) data[0] == 0xFF)
+    return length;
+  return length + strlen(data+length) + 1;
+}
+
+// Encode a single attribute (or a wildcard if attribute is NULL)
+//
+// Returns the number of bytes written to data.
+static inline size_t EncodeAttribute(AttributeType type,
+                                     const Attribute *attribute,
+                                     char *data, bool max = false){
+  if(type == kShort){
+    uint32_t value;
+    if(attribute != NULL)
+      value = ((uint32_t) attribute->short_value) ^ 0x80000000u;
+    else
+      value = max ? 0xFFFFFFFFu : 0;
+    value = CodecSwap32(value);
+    memcpy(data, &value, sizeof(value));
+    return sizeof(value);
+  } else if(type == kInt){
+    uint64_t value;
+    if(attribute != NULL)
+      value = ((uint64_t) attribute->int_value) ^ 0x8000000000000000ull;
+    else
+      value = max ? 0xFFFFFFFFFFFFFFFFull : 0;
+    value = CodecSwap64(value);
+    memcpy(data, &value, sizeof(value));
+    return sizeof(value);
+  }
+
+  if(attribute == NULL){
+    if(max){
+      memset(data, 0xFF, MAX_VARCHAR_LENGTH+1);
+      return MAX_VARCHAR_LENGTH+1;
+    }
+    data[0] = '\0';
+    return 1;
+  }
+
+  size_t length = strnlen(attribute->char_value, MAX_VARCHAR_LENGTH);
+  memcpy(data, attribute->char_value, length);
+  data[length] = '\0';
+  return length+1;
+}
+
+// Decode a single attribute
+//
+// Returns the number of bytes read from data.
+static inline size_t DecodeAttribute(AttributeType type, const char *data,
+                                     Attribute *attribute){
+  attribute->type = type;
+  if(type == kShort){
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    attribute->short_value = (int32_t) (CodecSwap32(value) ^ 0x80000000u);
+    return sizeof(value);
+  } else if(type == kInt){
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    attribute->int_value =
+      (int64_t) (CodecSwap64(value) ^ 0x8000000000000000ull);
+    return sizeof(value);
+  }
+
+  size_t size = EncodedAttributeSize(type, data);
+  size_t length = (size > MAX_VARCHAR_LENGTH) ? MAX_VARCHAR_LENGTH : size-1;
+  memcpy(attribute->char_value, data, length);
+  attribute->char_value[length] = '\0';
+  return size;
+}
+
+// Encode the given key (NULL attributes are encoded as wildcards)
+//
+// The buffer must hold at least MaxEncodedKeySize() bytes. Returns the size
+// of the encoded key.
+static inline size_t EncodeKey(const AttributeType *types, uint8_t count,
+                               const Key &key, char *data, bool max = false){
+  size_t offset = 0;
+  for(int i = 0; i < count; i++)
+    offset += EncodeAttribute(types[i], key.value[i], data+offset, max);
+  return offset;
+}
+
+// Compare two encoded byte strings (shorter strings are ordered first if
+// one string is a prefix of the other one)
+static inline int CompareEncoded(const char *a, size_t a_size,
+                                 const char *b, size_t b_size){
+  int result = memcmp(a, b, (a_size < b_size) ? a_size : b_size);
+  if(result != 0)
+    return result;
+  return (a_size < b_size) ? -1 : ((a_size > b_size) ? 1 : 0);
+}
+
+// The maximum number of attributes of keys stored in Z-order
+#define MAX_ZORDER_ATTRIBUTES 8
+
+// The maximum number of 64-bit words of a Z-order key
+#define MAX_ZORDER_WORDS MAX_ZORDER_ATTRIBUTES
+
+// Return whether keys using the given attribute types can be stored in
+// Z-order (at least two and at most MAX_ZORDER_ATTRIBUTES SHORT or INT
+// attributes)
+static inline bool CanInterleave(const AttributeType *types, uint8_t count){
+  if((count < 2) || (count > MAX_ZORDER_ATTRIBUTES))
+    return false;
+  for(int i = 0; i < count; i++){
+    if(types[i] == kVarchar)
+      return false;
+  }
+  return true;
+}
+
+// Return the number of bits of an encoded SHORT or INT attribute
+static inline int FixedAttributeBits(AttributeType type){
+  return (type == kShort) ? 32 : 64;
+}
+
+// Return the encoded SHORT or INT attribute (or a wildcard if attribute is
+// NULL) as an unsigned number
+static inline uint64_t FixedAttributeValue(AttributeType type,
+                                           const Attribute *attribute,
+                                           bool max = false){
+  if(type == kShort){
+    if(attribute == NULL)
+      return max ? 0xFFFFFFFFull : 0;
+    return ((uint32_t) attribute->short_value) ^ 0x80000000u;
+  }
+  if(attribute == NULL)
+    return max ? 0xFFFFFFFFFFFFFFFFull : 0;
+  return ((uint64_t) attribute->int_value) ^ 0x8000000000000000ull;
+}
+
+struct ZOrderLayout;
+
+// A function interleaving encoded attributes into a Z-order key
+typedef void (*InterleaveKernel)(const ZOrderLayout *layout,
+                                 const uint64_t *values, char *data);
+
+// A function splitting a Z-order key into its encoded attributes
+typedef void (*DeinterleaveKernel)(const ZOrderLayout *layout,
+                                   const char *data, uint64_t *values);
+
+// The positions of the bits of every attribute inside the Z-order keys of a
+// schema
+//
+// A key is read as a sequence of big-endian 64-bit words (the last word may
+// hold only 32 bits, which are its most significant ones).
+struct ZOrderLayout{
+  // The attribute types
+  uint8_t count;
+  AttributeType types[MAX_ZORDER_ATTRIBUTES];
+  // The size of a key in bytes and the number of words it spans
+  size_t size;
+  int words;
+  // The bits of every word holding bits of attribute i and their number
+  uint64_t masks[MAX_ZORDER_WORDS][MAX_ZORDER_ATTRIBUTES];
+  int bits[MAX_ZORDER_WORDS][MAX_ZORDER_ATTRIBUTES];
+  // The functions converting the keys
+  InterleaveKernel interleave;
+  DeinterleaveKernel deinterleave;
+};
+
+// Read the given word of a Z-order key
+static inline uint64_t LoadZOrderWord(const ZOrderLayout *layout,
+                                      const char *data, int word){
+  size_t offset = 8*word;
+  if(offset + 8 <= layout->size){
+    uint64_t value;
+    memcpy(&value, data + offset, sizeof(value));
+    return CodecSwap64(value);
+  }
+  uint32_t value;
+  memcpy(&value, data + offset, sizeof(value));
+  return ((uint64_t) CodecSwap32(value)) << 32;
+}
+
+// Write the given word of a Z-order key
+static inline void StoreZOrderWord(const ZOrderLayout *layout, char *data,
+                                   int word, uint64_t value){
+  size_t offset = 8*word;
+  if(offset + 8 <= layout->size){
+    value = CodecSwap64(value);
+    memcpy(data + offset, &value, sizeof(value));
+  } else {
+    uint32_t half = CodecSwap32((uint32_t) (value >> 32));
+    memcpy(data + offset, &half, sizeof(half));
+  }
+}
+
+// Gather the bits of value selected by mask (the most significant one first)
+static inline uint64_t ExtractBits(uint64_t value, uint64_t mask){
+  uint64_t result = 0;
+  while(mask != 0){
+    int bit = 63 - __builtin_clzll(mask);
+    result = (result << 1) | ((value >> bit) & 1);
+    mask &= ~(1ull << bit);
+  }
+  return result;
+}
+
+// Scatter the lowest bits of value to the bits selected by mask (the inverse
+// of ExtractBits())
+static inline uint64_t DepositBits(uint64_t value, uint64_t mask, int bits){
+  uint64_t result = 0;
+  while(mask != 0){
+    int bit = 63 - __builtin_clzll(mask);
+    result |= ((value >> --bits) & 1) << bit;
+    mask &= ~(1ull << bit);
+  }
+  return result;
+}
+
+// Interleave the encoded attributes one bit at a time
+static inline void InterleaveGeneric(const ZOrderLayout *layout,
+                                     const uint64_t *values, char *data){
+  int remaining[MAX_ZORDER_ATTRIBUTES];
+  for(int i = 0; i < layout->count; i++)
+    remaining[i] = FixedAttributeBits(layout->types[i]);
+  for(int w = 0; w < layout->words; w++){
+    uint64_t word = 0;
+    for(int i = 0; i < layout->count; i++){
+      int bits = layout->bits[w][i];
+      if(bits == 0)
+        continue;
+      remaining[i] -= bits;
+      word |= DepositBits(values[i] >> remaining[i], layout->masks[w][i], bits);
+    }
+    StoreZOrderWord(layout, data, w, word);
+  }
+}
+
+// Split a Z-order key one bit at a time
+static inline void DeinterleaveGeneric(const ZOrderLayout *layout,
+                                       const char *data, uint64_t *values){
+  for(int i = 0; i < layout->count; i++)
+    values[i] = 0;
+  for(int w = 0; w < layout->words; w++){
+    uint64_t word = LoadZOrderWord(layout, data, w);
+    for(int i = 0; i < layout->count; i++){
+      int bits = layout->bits[w][i];
+      if(bits == 0)
+        continue;
+      uint64_t part = ExtractBits(word, layout->masks[w][i]);
+      values[i] = (bits == 64) ? part : ((values[i] << bits) | part);
+    }
+  }
+}
+
+#ifdef CODEC_X86
+// Interleave the encoded attributes one word at a time
+__attribute__((target("bmi2")))
+static inline void InterleaveBMI2(const ZOrderLayout *layout,
+                                  const uint64_t *values, char *data){
+  int remaining[MAX_ZORDER_ATTRIBUTES];
+  for(int i = 0; i < layout->count; i++)
+    remaining[i] = FixedAttributeBits(layout->types[i]);
+  for(int w = 0; w < layout->words; w++){
+    uint64_t word = 0;
+    for(int i = 0; i < layout->count; i++){
+      if(layout->bits[w][i] == 0)
+        continue;
+      remaining[i] -= layout->bits[w][i];
+      word |= _pdep_u64(values[i] >> remaining[i], layout->masks[w][i]);
+    }
+    StoreZOrderWord(layout, data, w, word);
+  }
+}
+
+// Split a Z-order key one word at a time
+__attribute__((target("bmi2")))
+static inline void DeinterleaveBMI2(const ZOrderLayout *layout,
+                                    const char *data, uint64_t *values){
+  for(int i = 0; i < layout->count; i++)
+    values[i] = 0;
+  for(int w = 0; w < layout->words; w++){
+    uint64_t word = LoadZOrderWord(layout, data, w);
+    for(int i = 0; i < layout->count; i++){
+      int bits = layout->bits[w][i];
+      if(bits == 0)
+        continue;
+      uint64_t part = _pext_u64(word, layout->masks[w][i]);
+      values[i] = (bits == 64) ? part : ((values[i] << bits) | part);
+    }
+  }
+}
+#endif // CODEC_X86
+
+// Compute the layout of the Z-order keys using the given attribute types
+// (see CanInterleave())
+//
+// The bits are gathered and scattered using BMI2 instructions if the
+// processor supports them.
+static inline void InitZOrderLayout(ZOrderLayout *layout,
+                                    const AttributeType *types, uint8_t count){
+  memset(layout, 0, sizeof(ZOrderLayout));
+  layout->count = count;
+  for(int i = 0; i < count; i++)
+    layout->types[i] = types[i];
+
+  size_t position = 0;
+  for(int bit = 0; bit < 64; bit++){
+    for(int i = 0; i < count; i++){
+      if(bit >= FixedAttributeBits(types[i]))
+        continue;
+      layout->masks[position / 64][i] |= 1ull << (63 - position % 64);
+      layout->bits[position / 64][i]++;
+      position++;
+    }
+  }
+  layout->size = position / 8;
+  layout->words = (position + 63) / 64;
+
+  layout->interleave = InterleaveGeneric;
+  layout->deinterleave = DeinterleaveGeneric;
+#ifdef CODEC_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("bmi2")){
+    layout->interleave = InterleaveBMI2;
+    layout->deinterleave = DeinterleaveBMI2;
+  }
+#endif
+}
+
+// Encode the given key in Z-order (NULL attributes are encoded as wildcards)
+//
+// Returns the size of the encoded key, which is the size of the concatenated
+// encoding.
+static inline size_t EncodeZOrderKey(const ZOrderLayout *layout,
+                                     const Key &key, char *data,
+                                     bool max = false){
+  uint64_t values[MAX_ZORDER_ATTRIBUTES];
+  for(int i = 0; i < layout->count; i++)
+    values[i] = FixedAttributeValue(layout->types[i], key.value[i], max);
+  layout->interleave(layout, values, data);
+  return layout->size;
+}
+
+// Decode the given Z-order key into the attributes of the given key
+static inline void DecodeZOrderKey(const ZOrderLayout *layout,
+                                   const char *data, Key &key){
+  uint64_t values[MAX_ZORDER_ATTRIBUTES];
+  layout->deinterleave(layout, data, values);
+  for(int i = 0; i < layout->count; i++){
+    Attribute *attribute = key.value[i];
+    attribute->type = layout->types[i];
+    if(attribute->type == kShort)
+      attribute->short_value = (int32_t) (((uint32_t) values[i]) ^ 0x80000000u);
+    else
+      attribute->int_value = (int64_t) (values[i] ^ 0x8000000000000000ull);
+  }
+}
+
+// Store the given encoded attributes in concatenated encoding, which is
+// ordered like the keys themselves
+//
+// Returns the size of the concatenated key.
+static inline size_t ConcatenateAttributes(const ZOrderLayout *layout,
+                                           const uint64_t *values,
+                                           char *data){
+  size_t offset = 0;
+  for(int i = 0; i < layout->count; i++){
+    if(layout->types[i] == kShort){
+      uint32_t value = CodecSwap32((uint32_t) values[i]);
+      memcpy(data + offset, &value, sizeof(value));
+      offset += sizeof(value);
+    } else {
+      uint64_t value = CodecSwap64(values[i]);
+      memcpy(data + offset, &value, sizeof(value));
+      offset += sizeof(value);
+    }
+  }
+  return offset;
+}
+
+#endif // _COMMON_KEY_CODEC_H_
@@ -30,8 +30,8 @@
  implementation more independent of the actual threading library)
 */
 
-#ifndef _BDBIMPL_MUTEX_H_
-#define _BDBIMPL_MUTEX_H_
+#ifndef _COMMON_MUTEX_H_
+#define _COMMON_MUTEX_H_
 
 #include <pthread.h>
 
@@ -74,4 +74,4 @@ class Lock{
 		Mutex& mutex_;
 };
 
-#endif // _BDBIMPL_MUTEX_H_
+#endif // _COMMON_MUTEX_H_
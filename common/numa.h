@@ -0,0 +1,172 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+/** @file
+NUMA topology and memory placement helpers (Linux only).
+
+The topology is read from sysfs and the memory policies are set using the
+system calls directly, so no library (like libnuma) is needed. On other
+systems, and on machines without NUMA support, the helpers describe a single
+node holding all CPUs and leave the placement to the operating system.
+
+NUMA nodes are numbered like the kernel does. Memory placement only changes
+where pages are placed when they are touched for the first time; pages that
+already exist are not moved.
+*/
+
+#ifndef _COMMON_NUMA_H_
+#define _COMMON_NUMA_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// The maximum number of NUMA nodes the helpers support
+#define NUMA_MAX_NODES 64
+
+// The memory policies of the kernel (see set_mempolicy(2))
+#define NUMA_POLICY_DEFAULT 0
+#define NUMA_POLICY_INTERLEAVE 3
+
+// Parse a list of numbers and ranges as used by sysfs (e.g. "0-3,8,10-11")
+// and append the numbers to the given vector
+static inline void NumaParseList(const char *list, std::vector<int> *numbers){
+  const char *position = list;
+  while((*position >= '0') && (*position <= '9')){
+    char *end;
+    int first = strtol(position, &end, 10);
+    int last = first;
+    if(*end == '-')
+      last = strtol(end + 1, &end, 10);
+    for(int number = first; number <= last; number++)
+      numbers->push_back(number);
+    if(*end != ',')
+      break;
+    position = end + 1;
+  }
+}
+
+// Read the list of numbers stored inside the given sysfs file (returns false
+// if the file can not be read)
+static inline bool NumaReadList(const char *path, std::vector<int> *numbers){
+  FILE *file = fopen(path, "r");
+  if(file == NULL)
+    return false;
+  char buffer[4096];
+  bool success = (fgets(buffer, sizeof(buffer), file) != NULL);
+  fclose(file);
+  if(success)
+    NumaParseList(buffer, numbers);
+  return success;
+}
+
+// Return the NUMA nodes holding memory (at least node 0)
+static inline std::vector<int> NumaMemoryNodes(){
+  std::vector<int> nodes;
+#ifdef __linux__
+  NumaReadList("/sys/devices/system/node/has_memory", &nodes);
+#endif
+  while(!nodes.empty() && (nodes.back() >= NUMA_MAX_NODES))
+    nodes.pop_back();
+  if(nodes.empty())
+    nodes.push_back(0);
+  return nodes;
+}
+
+// Return the CPUs of the given NUMA node (all online CPUs of a machine
+// without NUMA support belong to node 0)
+static inline std::vector<int> NumaNodeCpus(int node){
+  std::vector<int> cpus;
+#ifdef __linux__
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  if(NumaReadList(path, &cpus) || (node != 0))
+    return cpus;
+#endif
+  if(node == 0){
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    for(long cpu = 0; cpu < count; cpu++)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+// Return the NUMA node of the given CPU (or 0 if it is unknown)
+static inline int NumaNodeOfCpu(int cpu){
+  std::vector<int> nodes = NumaMemoryNodes();
+  for(size_t i = 0; i < nodes.size(); i++){
+    std::vector<int> cpus = NumaNodeCpus(nodes[i]);
+    for(size_t j = 0; j < cpus.size(); j++){
+      if(cpus[j] == cpu)
+        return nodes[i];
+    }
+  }
+  return 0;
+}
+
+// Make the calling thread place the pages it touches first round-robin on
+// all NUMA nodes holding memory (or on the local node, if interleave is not
+// set)
+//
+// Returns false if the policy could not be set.
+static inline bool NumaSetThreadPolicy(bool interleave){
+#ifdef __linux__
+  unsigned long mask = 0;
+  std::vector<int> nodes = NumaMemoryNodes();
+  for(size_t i = 0; i < nodes.size(); i++)
+    mask |= 1ul << nodes[i];
+  if(interleave)
+    return syscall(SYS_set_mempolicy, NUMA_POLICY_INTERLEAVE, &mask,
+                   NUMA_MAX_NODES + 1) == 0;
+  return syscall(SYS_set_mempolicy, NUMA_POLICY_DEFAULT, NULL, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+// Determine the NUMA nodes of the given pages (which have to be page
+// aligned) and store them in nodes (negative for pages that have not been
+// touched yet or whose node is unknown)
+//
+// Returns false if the nodes can not be determined.
+static inline bool NumaPageNodes(void **pages, size_t count, int *nodes){
+#ifdef __linux__
+  if(count == 0)
+    return true;
+  return syscall(SYS_move_pages, 0, count, pages, NULL, nodes, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+#endif // _COMMON_NUMA_H_
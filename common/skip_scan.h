@@ -0,0 +1,251 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+/** @file
+Skip-scan support for range and partial-match queries on encoded keys.
+
+Multidimensional keys are stored as the concatenation of their attributes
+(see common/key_codec.h), so a query that restricts an inner attribute (or
+leaves the leading attribute unrestricted) selects many small runs of keys
+instead of one contiguous range. Rather than reading every key between two
+runs, a scan may use SkipScan() to compute the smallest key that could still
+satisfy all per-attribute bounds and seek there directly:
+
+  - if attribute i is smaller than its lower bound, the next candidate keeps
+    attributes 0..i-1 and continues with the lower bounds of the attributes
+    i..n-1
+  - if attribute i is greater than its upper bound, no other key sharing the
+    attributes 0..i-1 can match, so the next candidate is the first key
+    following all of them (or the scan ends if i is 0)
+
+The scan visits the matching keys in key order and needs one seek per
+qualifying prefix instead of one comparison per stored key. This only helps if
+the unrestricted leading attributes have few distinct values.
+
+Keys stored in Z-order (see common/key_codec.h) are scanned using
+ZOrderSkipScan() instead. All keys inside the box lie between the Z-order keys
+of its corners, but this range also holds keys outside the box. For such a key,
+the next Z-order key inside the box is computed (the BIGMIN algorithm of Tropf
+and Herzog), so a scan reads only the parts of the range that intersect the
+box, regardless of which attributes are restricted. The keys are visited in
+Z-order, not in key order.
+*/
+
+#ifndef _COMMON_SKIP_SCAN_H_
+#define _COMMON_SKIP_SCAN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <contest_interface.h>
+#include <common/key_codec.h>
+
+// The possible results of SkipScan()
+enum SkipScanResult{
+  // The key satisfies all bounds
+  kSkipScanMatch,
+  // The key does not match, continue at the first key >= the computed target
+  kSkipScanSeek,
+  // Neither the key nor any following key can match
+  kSkipScanEnd
+};
+
+// Return the size of a buffer that can hold any target computed by SkipScan()
+static inline size_t SkipScanTargetSize(const AttributeType *types, uint8_t count){
+  return MaxEncodedKeySize(types, count) + 1;
+}
+
+// Check the encoded key against the per-attribute bounds given by the encoded
+// keys min and max
+//
+// If the key does not match, target is set to the smallest key that could
+// still satisfy all bounds (target must hold at least SkipScanTargetSize()
+// bytes). Every target is greater than the checked key.
+static inline SkipScanResult SkipScan(const AttributeType *types, uint8_t count,
+                                      const char *key, const char *min,
+                                      const char *max, char *target,
+                                      size_t *target_size){
+  size_t prefix_size = 0;
+  for(int i = 0; i < count; i++){
+    size_t key_size = EncodedAttributeSize(types[i], key+prefix_size);
+    size_t min_size = EncodedAttributeSize(types[i], min);
+    size_t max_size = EncodedAttributeSize(types[i], max);
+
+    if(CompareEncoded(key+prefix_size, key_size, min, min_size) < 0){
+      // Continue with the lower bounds of the remaining attributes
+      memcpy(target, key, prefix_size);
+      size_t offset = prefix_size;
+      for(int j = i; j < count; j++){
+        size_t size = EncodedAttributeSize(types[j], min);
+        memcpy(target+offset, min, size);
+        offset += size;
+        min += size;
+      }
+      *target_size = offset;
+      return kSkipScanSeek;
+    }
+
+    if(CompareEncoded(key+prefix_size, key_size, max, max_size) > 0){
+      if(i == 0)
+        return kSkipScanEnd;
+
+      // Continue after all keys that share the current prefix (appending a
+      // '\0' byte to the largest of these keys yields the smallest key that
+      // follows all of them, as encoded keys are never prefixes of each other)
+      memcpy(target, key, prefix_size);
+      size_t offset = prefix_size;
+      for(int j = i; j < count; j++)
+        offset += EncodeAttribute(types[j], NULL, target+offset, true);
+      target[offset++] = '\0';
+      *target_size = offset;
+      return kSkipScanSeek;
+    }
+
+    prefix_size += key_size;
+    min += min_size;
+    max += max_size;
+  }
+
+  return kSkipScanMatch;
+}
+
+// Return a mask of the bits of an attribute that follow its first prefix bits
+static inline uint64_t ZOrderSuffixMask(AttributeType type, int prefix){
+  int bits = FixedAttributeBits(type);
+  if(prefix <= 0)
+    return ~0ull;
+  if(prefix >= bits)
+    return 0;
+  return (1ull << (bits - prefix)) - 1;
+}
+
+// Return the smallest value of an attribute inside the box that shares its
+// first prefix bits with the value of the key (the key must not lie below the
+// box in these bits)
+static inline uint64_t ZOrderLowerBound(AttributeType type, uint64_t value,
+                                        uint64_t min, int prefix){
+  value &= ~ZOrderSuffixMask(type, prefix);
+  return (value > min) ? value : min;
+}
+
+// Check the encoded attributes of a Z-order key (see ZOrderLayout) against
+// the per-attribute bounds min and max
+//
+// If the key does not match, target is set to the smallest Z-order key greater
+// than the checked key that satisfies all bounds (target must hold at least
+// SkipScanTargetSize() bytes). This is the result of the BIGMIN algorithm,
+// which visits the bits of the key in Z-order: whenever the bounds of the
+// attribute of the current bit differ in it, the box is split in two halves.
+// If the key lies in the lower half, the smallest key of the upper half is a
+// candidate, and the search continues in the half holding the key. Once the
+// key lies outside the remaining box, the target is either the smallest key of
+// that box (if the key lies below it) or the last candidate.
+//
+// Instead of visiting every bit, both positions are computed from the
+// highest bits in which each attribute differs from its bounds:
+//
+//   - an attribute leaves the box at the first bit in which it differs from
+//     the bound it violates
+//   - the upper half of a split only holds keys inside the box if the
+//     attribute of the key is smaller than its upper bound, at the first bit
+//     in which they differ and at every later bit the key has cleared
+static inline SkipScanResult ZOrderSkipScan(const ZOrderLayout *layout,
+                                            const uint64_t *values,
+                                            const uint64_t *min,
+                                            const uint64_t *max, char *target,
+                                            size_t *target_size){
+  const AttributeType *types = layout->types;
+  uint8_t count = layout->count;
+
+  // Find the first bit (in Z-order) at which the key leaves the box, given by
+  // its attribute and its index inside the attribute (starting with the most
+  // significant bit)
+  int exit = -1;
+  int exit_bit = 64;
+  bool below = false;
+  for(int i = 0; i < count; i++){
+    uint64_t differs;
+    if(values[i] < min[i])
+      differs = values[i] ^ min[i];
+    else if(values[i] > max[i])
+      differs = values[i] ^ max[i];
+    else
+      continue;
+    int bit = FixedAttributeBits(types[i]) - 64 + __builtin_clzll(differs);
+    if(bit < exit_bit){
+      exit = i;
+      exit_bit = bit;
+      below = values[i] < min[i];
+    }
+  }
+  if(exit < 0)
+    return kSkipScanMatch;
+
+  // If the key lies below the remaining box, continue at its smallest key
+  uint64_t candidate[MAX_ZORDER_ATTRIBUTES];
+  if(below){
+    for(int i = 0; i < count; i++)
+      candidate[i] = ZOrderLowerBound(types[i], values[i], min[i],
+                                      exit_bit + ((i < exit) ? 1 : 0));
+    layout->interleave(layout, candidate, target);
+    *target_size = layout->size;
+    return kSkipScanSeek;
+  }
+
+  // Otherwise, find the last split before the exit whose upper half follows
+  // the key
+  int split = -1;
+  int split_bit = -1;
+  for(int i = 0; i < count; i++){
+    if(values[i] >= max[i])
+      continue;
+    int bits = FixedAttributeBits(types[i]);
+    uint64_t splits = ~values[i] & (~0ull >> __builtin_clzll(values[i] ^ max[i]));
+    splits &= ~ZOrderSuffixMask(types[i], exit_bit + ((i < exit) ? 1 : 0));
+    if(splits == 0)
+      continue;
+    int bit = bits - 1 - __builtin_ctzll(splits);
+    if(bit >= split_bit){
+      split = i;
+      split_bit = bit;
+    }
+  }
+  if(split < 0)
+    return kSkipScanEnd;
+
+  for(int i = 0; i < count; i++)
+    candidate[i] = ZOrderLowerBound(types[i], values[i], min[i],
+                                    split_bit + ((i < split) ? 1 : 0));
+  uint64_t mask = 1ull << (FixedAttributeBits(types[split]) - 1 - split_bit);
+  candidate[split] = (candidate[split] & ~(mask - 1)) | mask;
+  layout->interleave(layout, candidate, target);
+  *target_size = layout->size;
+  return kSkipScanSeek;
+}
+
+#endif // _COMMON_SKIP_SCAN_H_
@@ -396,6 +396,83 @@ ErrorCode GetNext(Iterator *it, Record** record){
   return kOk;
 }
 
+/**
+Moves the iterator to the next record and returns it using a buffer owned by
+the iterator (valid until the iterator is moved or closed).
+
+@see contest_interface.h for details
+*/
+ErrorCode GetNextBuffered(Iterator *it, Record** record){
+  // Check that all input values are valid
+  if(record == NULL)
+    return kErrorGenericFailure;
+
+  if((it == NULL) || (it->closed()))
+    return kErrorIteratorClosed;
+    
+  try {
+    // Fetch the next record
+    if(it->Next()){
+      // If the iterator reached its end, no record was found
+      if(it->end()){
+        *record = NULL;
+        return kErrorNotFound;
+      } else {
+        // Set the record to the buffer of the iterator
+        *record = it->buffered_value();
+      }
+    } else {
+      return kErrorGenericFailure;
+    }
+  } catch (DbDeadlockException &de) {
+    return kErrorDeadlock;
+  } catch (DbException &e) {
+    return kErrorGenericFailure;
+  }
+  return kOk;
+}
+
+/**
+Moves the iterator over up to max records and stores them in the given array.
+
+The records are retrieved one by one using GetNext() and kept by the iterator
+until the next batch is retrieved or the iterator is closed.
+
+@see contest_interface.h for details
+*/
+ErrorCode GetNextBatch(Iterator *it, Record* records, uint32_t max, uint32_t* count){
+  // Check that all input values are valid
+  if((records == NULL) || (count == NULL) || (max == 0))
+    return kErrorGenericFailure;
+
+  *count = 0;
+  if((it == NULL) || (it->closed()))
+    return kErrorIteratorClosed;
+
+  // The records of the previous batch are not used any more
+  it->ReleaseRecords();
+
+  while(*count < max){
+    Record* record;
+    ErrorCode result = GetNext(it, &record);
+    if(result == kErrorNotFound)
+      break;
+    if(result != kOk){
+      *count = 0;
+      return result;
+    }
+
+    it->KeepRecord(record);
+    records[*count] = *record;
+    (*count)++;
+  }
+
+  // If no record was retrieved, the iterator reached its end
+  if(*count == 0)
+    return kErrorNotFound;
+  return kOk;
+}
+
 /**
 Closes the given iterator and frees all of its resources.
 
@@ -28,7 +28,9 @@
 #include <db_cxx.h>
 #include <stdio.h>
 #include <cstdlib>
+#include <cstring>
 #include "connection_manager.h"
+#include "env_config.h"
 
 pthread_once_t ConnectionManager::once_ = PTHREAD_ONCE_INIT;
 ConnectionManager* ConnectionManager::instance_;
@@ -55,12 +57,39 @@ ConnectionManager::ConnectionManager(){
   
 	// Specify in-memory logging
 	env_->log_set_config(DB_LOG_IN_MEMORY, 1);
-  
+
+  // At snapshot isolation (CONTEST_ISOLATION=snapshot), all databases keep
+  // multiple versions of their pages, so readers do not need any locks
+  const char* isolation = getenv("CONTEST_ISOLATION");
+  snapshot_isolation_ = (isolation != NULL) && (strcmp(isolation, "snapshot") == 0);
+  if(snapshot_isolation_)
+    env_->set_flags(DB_MULTIVERSION, 1);
+
+  // Size the regions of the environment for the configured workload (see
+  // env_config.h)
+  EnvironmentSizes sizes = GetEnvironmentSizes(snapshot_isolation_);
+
   // Specify the size of the in-memory log buffer.
-  env_->set_lg_bsize(((size_t) 1 << 20) * 25 );
+  env_->set_lg_bsize(sizes.log_buffer_size);
   
   // Specify the size of the in-memory cache
-  env_->set_cachesize(4, 0, 1);
+  env_->set_cachesize(sizes.cache_size >> 30, sizes.cache_size & ((1 << 30) - 1),
+                      (sizes.cache_regions > 0) ? sizes.cache_regions : 1);
+
+  // Specify the sizes of the lock table, the transaction table and the mutex
+  // region (unless the defaults are kept)
+  if(sizes.lock_partitions > 0)
+    env_->set_lk_partitions(sizes.lock_partitions);
+  if(sizes.max_locks > 0)
+    env_->set_lk_max_locks(sizes.max_locks);
+  if(sizes.max_lock_objects > 0)
+    env_->set_lk_max_objects(sizes.max_lock_objects);
+  if(sizes.max_lockers > 0)
+    env_->set_lk_max_lockers(sizes.max_lockers);
+  if(sizes.max_transactions > 0)
+    env_->set_tx_max(sizes.max_transactions);
+  if(sizes.mutex_increment > 0)
+    env_->mutex_set_increment(sizes.mutex_increment);
 
   // Indicate that we want the db to internally perform deadlock
   // detection. Also indicate that the transaction with
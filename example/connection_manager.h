@@ -45,6 +45,9 @@ class ConnectionManager{
 		
     // Return the Berkeley DB environment that will be used
 		DbEnv *env(){ return env_; }
+
+    // Return whether transactions run at snapshot isolation
+    bool snapshot_isolation(){ return snapshot_isolation_; }
     
     // Initialize the singleton instance
     static void Initialize();
@@ -61,6 +64,10 @@ class ConnectionManager{
 		
 		// The Berkeley DB environment that will be used
 		DbEnv *env_;
+
+    // Whether transactions run at snapshot isolation (instead of read
+    // committed)
+    bool snapshot_isolation_;
     
     // The singleton instance of ConnectionManager
     static ConnectionManager* instance_;
@@ -0,0 +1,246 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+ 
+ Current version: 1.0 (released February 21, 2012)
+ 
+ Version history:
+ - 1.0 Initial release (February 21, 2012) 
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "env_config.h"
+
+// The sizes used if the workload is unknown
+#define DEFAULT_CACHE_SIZE ((uint64_t) 4 << 30)
+#define DEFAULT_LOG_BUFFER_SIZE ((uint32_t) 25 << 20)
+
+// The average size of a record (including its key) if it is not configured
+#define DEFAULT_RECORD_SIZE 128
+
+// The cache holds this many times the size of the records (leaf pages are
+// only partially filled, internal pages and page headers come on top)
+#define CACHE_OVERHEAD 3
+
+// The bounds of the derived cache size
+#define MIN_CACHE_SIZE ((uint64_t) 16 << 20)
+#define MAX_CACHE_SIZE ((uint64_t) 64 << 30)
+
+// Each cache region holds at least this many bytes and serves about this many
+// threads
+#define MIN_CACHE_REGION_SIZE ((uint64_t) 64 << 20)
+#define THREADS_PER_CACHE_REGION 4
+
+// The resources reserved per thread
+#define LOG_BUFFER_PER_THREAD ((uint32_t) 1 << 20)
+#define LOCK_PARTITIONS_PER_THREAD 8
+#define LOCKS_PER_THREAD 1000
+#define LOCKERS_PER_THREAD 32
+#define TRANSACTIONS_PER_THREAD 4
+#define MUTEXES_PER_THREAD 64
+
+// The defaults of Berkeley DB for the sizes of the lock and transaction tables
+#define BDB_DEFAULT_LOCKS 1000
+#define BDB_DEFAULT_TRANSACTIONS 100
+
+typedef std::map<std::string,std::string> Settings;
+
+// Return whether the given character separates two settings
+static bool IsSeparator(char c){
+  return isspace(c) || (c == ',') || (c == ';') || (c == '#') || (c == '\0');
+}
+
+// Parse the "name=value" pairs of the given text into the given settings
+//
+// Blanks are allowed around the equals sign.
+static void ParseSettings(const char *text, Settings &settings){
+  const char *p = text;
+  while(*p != '\0'){
+    // Skip separators and comments
+    if(*p == '#'){
+      while((*p != '\0') && (*p != '\n'))
+        p++;
+      continue;
+    }
+    if(IsSeparator(*p)){
+      p++;
+      continue;
+    }
+
+    const char *name = p;
+    while(isalnum(*p) || (*p == '_'))
+      p++;
+    size_t name_size = p - name;
+    while((*p == ' ') || (*p == '\t'))
+      p++;
+    if((name_size == 0) || (*p != '=')){
+      while(!IsSeparator(*p))
+        p++;
+      std::cerr << "Ignoring malformed environment setting '"
+                << std::string(name, p - name) << "'" << std::endl;
+      continue;
+    }
+    p++;
+    while((*p == ' ') || (*p == '\t'))
+      p++;
+
+    const char *value = p;
+    while(!IsSeparator(*p))
+      p++;
+    settings[std::string(name, name_size)] = std::string(value, p - value);
+  }
+}
+
+// Read the settings from the file with the given name
+static void ReadSettingsFile(const char *path, Settings &settings){
+  FILE *file = fopen(path, "r");
+  if(file == NULL){
+    std::cerr << "Could not open environment configuration '" << path << "'"
+              << std::endl;
+    return;
+  }
+
+  std::string text;
+  char buffer[4096];
+  size_t size;
+  while((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    text.append(buffer, size);
+  fclose(file);
+
+  ParseSettings(text.c_str(), settings);
+}
+
+// Return the given setting as a size (or 0 if it is not set or invalid)
+//
+// The setting is removed, so that only unknown settings remain in the end.
+static uint64_t TakeSize(Settings &settings, const char *name){
+  Settings::iterator it = settings.find(name);
+  if(it == settings.end())
+    return 0;
+
+  char *end;
+  uint64_t value = strtoull(it->second.c_str(), &end, 10);
+  switch(toupper(*end)){
+    case 'K': value <<= 10; end++; break;
+    case 'M': value <<= 20; end++; break;
+    case 'G': value <<= 30; end++; break;
+  }
+  if((end == it->second.c_str()) || (*end != '\0')){
+    std::cerr << "Ignoring invalid value '" << it->second << "' of environment"
+              << " setting '" << name << "'" << std::endl;
+    value = 0;
+  }
+  settings.erase(it);
+  return value;
+}
+
+// Use the given value unless it is 0 (or exceeds 32 bits)
+static void Override(uint32_t &size, uint64_t value){
+  if((value > 0) && (value <= UINT32_MAX))
+    size = (uint32_t) value;
+}
+
+// Read the configuration of the environment and derive its sizes
+EnvironmentSizes GetEnvironmentSizes(bool multiversion){
+  Settings settings;
+  const char *path = getenv("CONTEST_BDB_CONFIG_FILE");
+  if(path != NULL)
+    ReadSettingsFile(path, settings);
+  const char *text = getenv("CONTEST_BDB_CONFIG");
+  if(text != NULL)
+    ParseSettings(text, settings);
+
+  uint64_t records = TakeSize(settings, "records");
+  uint64_t record_size = TakeSize(settings, "record_size");
+  uint64_t threads = TakeSize(settings, "threads");
+  if(record_size == 0)
+    record_size = DEFAULT_RECORD_SIZE;
+
+  EnvironmentSizes sizes;
+  memset(&sizes, 0, sizeof(sizes));
+  sizes.cache_size = DEFAULT_CACHE_SIZE;
+  sizes.log_buffer_size = DEFAULT_LOG_BUFFER_SIZE;
+
+  // Size the cache for the expected records
+  if(records > 0){
+    uint64_t cache_size = records * record_size * CACHE_OVERHEAD;
+    if(multiversion)
+      cache_size *= 2;
+    if(cache_size < MIN_CACHE_SIZE)
+      cache_size = MIN_CACHE_SIZE;
+    if(cache_size > MAX_CACHE_SIZE)
+      cache_size = MAX_CACHE_SIZE;
+    sizes.cache_size = cache_size;
+  }
+
+  // Size the tables for the expected threads
+  if(threads > 0){
+    uint64_t regions = (threads + THREADS_PER_CACHE_REGION - 1)
+                       / THREADS_PER_CACHE_REGION;
+    if(regions > sizes.cache_size / MIN_CACHE_REGION_SIZE)
+      regions = sizes.cache_size / MIN_CACHE_REGION_SIZE;
+    sizes.cache_regions = (regions > 0) ? regions : 1;
+
+    if(threads * LOG_BUFFER_PER_THREAD > sizes.log_buffer_size)
+      Override(sizes.log_buffer_size, threads * LOG_BUFFER_PER_THREAD);
+    Override(sizes.lock_partitions, threads * LOCK_PARTITIONS_PER_THREAD);
+
+    uint64_t locks = threads * LOCKS_PER_THREAD;
+    if(locks < BDB_DEFAULT_LOCKS)
+      locks = BDB_DEFAULT_LOCKS;
+    Override(sizes.max_locks, locks);
+    Override(sizes.max_lock_objects, locks);
+    uint64_t lockers = threads * LOCKERS_PER_THREAD;
+    Override(sizes.max_lockers, (lockers < BDB_DEFAULT_LOCKS) ? BDB_DEFAULT_LOCKS
+                                                            : lockers);
+
+    uint64_t transactions = threads * TRANSACTIONS_PER_THREAD;
+    Override(sizes.max_transactions,
+             (transactions < BDB_DEFAULT_TRANSACTIONS) ? BDB_DEFAULT_TRANSACTIONS
+                                                       : transactions);
+    Override(sizes.mutex_increment, threads * MUTEXES_PER_THREAD);
+  }
+
+  // Apply the sizes that have been set directly
+  uint64_t cache_size = TakeSize(settings, "cache_size");
+  if(cache_size > 0)
+    sizes.cache_size = cache_size;
+  Override(sizes.cache_regions, TakeSize(settings, "cache_regions"));
+  Override(sizes.log_buffer_size, TakeSize(settings, "log_buffer_size"));
+  Override(sizes.lock_partitions, TakeSize(settings, "lock_partitions"));
+  Override(sizes.max_locks, TakeSize(settings, "max_locks"));
+  Override(sizes.max_lock_objects, TakeSize(settings, "max_lock_objects"));
+  Override(sizes.max_lockers, TakeSize(settings, "max_lockers"));
+  Override(sizes.max_transactions, TakeSize(settings, "max_transactions"));
+  Override(sizes.mutex_increment, TakeSize(settings, "mutex_increment"));
+
+  for(Settings::iterator it = settings.begin(); it != settings.end(); ++it)
+    std::cerr << "Ignoring unknown environment setting '" << it->first << "'"
+              << std::endl;
+
+  return sizes;
+}
@@ -0,0 +1,83 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+ 
+ Current version: 1.0 (released February 21, 2012)
+ 
+ Version history:
+ - 1.0 Initial release (February 21, 2012) 
+ */
+
+#ifndef _BDBIMPL_ENV_CONFIG_H_
+#define _BDBIMPL_ENV_CONFIG_H_
+
+#include <stdint.h>
+
+// The sizes of the regions of the Berkeley DB environment
+//
+// The cache and the log buffer are always sized, for all other members a
+// size of 0 keeps the default of Berkeley DB.
+struct EnvironmentSizes{
+  // The size of the in-memory cache in bytes
+  uint64_t cache_size;
+
+  // The number of regions the cache is split into
+  uint32_t cache_regions;
+
+  // The size of the in-memory log buffer in bytes
+  uint32_t log_buffer_size;
+
+  // The number of partitions of the lock table
+  uint32_t lock_partitions;
+
+  // The number of locks, lock objects and lockers the lock table is sized for
+  uint32_t max_locks;
+  uint32_t max_lock_objects;
+  uint32_t max_lockers;
+
+  // The number of concurrent transactions the environment is sized for
+  uint32_t max_transactions;
+
+  // The number of mutexes allocated in addition to those Berkeley DB
+  // computes for itself (open database handles need further mutexes)
+  uint32_t mutex_increment;
+};
+
+// Read the configuration of the environment and derive its sizes
+//
+// The settings are read from the file named by the environment variable
+// CONTEST_BDB_CONFIG_FILE and from the environment variable CONTEST_BDB_CONFIG
+// (which takes precedence). Both hold "name=value" pairs separated by commas,
+// semicolons or whitespace, '#' starts a comment. Sizes may carry a K, M or G
+// suffix.
+//
+// The workload is described by "records" (the expected number of records of
+// all indices), "record_size" (their average size including the key) and
+// "threads" (the number of threads using the library). The cache is sized for
+// the expected records, the lock table, the log buffer and the transaction
+// table for the given threads. Without these settings, the previous fixed
+// sizes are used. Every size can also be set directly using the name of its
+// EnvironmentSizes member, which overrides the derived value.
+//
+// If multiversion is set, the cache additionally has to hold the copies of
+// pages that are read by snapshots.
+EnvironmentSizes GetEnvironmentSizes(bool multiversion);
+
+#endif // _BDBIMPL_ENV_CONFIG_H_
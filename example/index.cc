@@ -30,6 +30,8 @@
 #include <string.h>
 #include <db_cxx.h>
 
+#include <common/key_codec.h>
+
 #include "connection_manager.h"
 #include "index.h"
 #include "iterator.h"
@@ -64,11 +66,10 @@ ErrorCode Index::Open(const char* name, Index** index){
   
   
   // Allow duplicates for this db instance
+  // (the keys are encoded so that Berkeley DB's default byte-wise
+  // comparison orders them correctly)
   (*index)->db_->set_flags(DB_DUP);
   
-  // Set the compare function for the b-tree
-  (*index)->db_->set_bt_compare(&keycmp);
-  
   // And finally open the index
   (*index)->db_->open(NULL,                       // Transaction pointer
                       NULL, 					            // File name (NULL, because we
@@ -117,8 +118,11 @@ void Index::Close(){
 Dbc* Index::Cursor(Transaction* tx){
   Dbc* cursor;
   
-  // Create a new cursor with isolation level read committed
-  db_->cursor((tx?tx->tid:NULL), &cursor, DB_READ_COMMITTED);
+  // Create a new cursor with isolation level read committed (or a read-only
+  // snapshot cursor, which does not take any read locks)
+  db_->cursor((tx?tx->tid:NULL), &cursor,
+              ConnectionManager::getInstance().snapshot_isolation() ?
+              DB_TXN_SNAPSHOT : DB_READ_COMMITTED);
   
   return cursor;
 }
@@ -128,6 +132,11 @@ Key Index::GetKey(const Dbt *bdb_key){
   return schema_->GetKey(bdb_key);
 }
 
+// Decodes the given Dbt into the attributes of the given key
+void Index::DecodeKey(const Dbt *bdb_key, Key &key){
+  schema_->DecodeKey(bdb_key, key);
+}
+
 // Converts the given Key of this index into a Dbt object
 Dbt* Index::GetBDBKey(Key key, bool max){
   return schema_->GetBDBKey(key, max);
@@ -156,8 +165,8 @@ ErrorCode Index::Insert(Transaction *tx, Record *record){
 	  res = kErrorGenericFailure;
   }
   
-  free(bdbkey->get_data());
-  free(bdbkey);
+  delete [] (char*) bdbkey->get_data();
+  delete bdbkey;
   return res;
 }
 
@@ -169,8 +178,11 @@ ErrorCode Index::Update(Transaction *tx, Record *record, Block *payload, uint8_t
   
   bool ignore_payload = (flags & kIgnorePayload);
   
-  // Convert the record 
-  Dbt key = *GetBDBKey(record->key);
+  // Convert the record (the key data is released below via pkey, the
+  // heap allocated Dbt wrapper right away)
+  Dbt *bdbkey = GetBDBKey(record->key);
+  Dbt key = *bdbkey;
+  delete bdbkey;
   Dbt okey = key;
   void* pkey = key.get_data();
   
@@ -188,12 +200,24 @@ ErrorCode Index::Update(Transaction *tx, Record *record, Block *payload, uint8_t
   new_value.set_data(payload->data);
   new_value.set_size(payload->size);
   
-  // Create a serializable nested transaction (to prevent the transaction
-  // from seeing data that has been inserted after the transaction begun)
-  env_->txn_begin((tx?tx->tid:NULL), &tid,  0 );
+  // Inside a larger transaction, a single record is changed by a single
+  // cursor operation, which needs no nested transaction. Otherwise create a
+  // serializable nested transaction (to prevent the transaction from seeing
+  // data that has been inserted after the transaction begun)
+  bool nested = (tx == NULL) || (flags & kMatchDuplicates);
+  bool writing;
+  if(nested){
+    env_->txn_begin((tx?tx->tid:NULL), &tid,
+                    ConnectionManager::getInstance().snapshot_isolation() ?
+                    DB_TXN_SNAPSHOT : 0);
+    writing = schema_->BeginTransaction(tid);
+  } else {
+    tid = tx->tid;
+    writing = tx->UseIndex(schema_);
+  }
   
   // Start writing on the index
-  if(schema_->BeginTransaction(tid)){
+  if(writing){
     
     // Create a cursor for this index
     db_->cursor(tid, &cursor, 0);
@@ -215,7 +239,7 @@ ErrorCode Index::Update(Transaction *tx, Record *record, Block *payload, uint8_t
       if((err = cursor->put(&key, &new_value, DB_CURRENT)) == 0){
         // If the update occured inside a larger transaction, then add
         // the parent transaction to the set of open transactions
-        if(tx != NULL){
+        if(nested && (tx != NULL)){
           tx->UseIndex(schema_);
         }
         
@@ -248,18 +272,22 @@ ErrorCode Index::Update(Transaction *tx, Record *record, Block *payload, uint8_t
       else
         result = kErrorGenericFailure;
     }
+    cursor->close();
   } else {
     // Abort the new transaction
     delete [] (char*) pkey;
-    tid->abort();
+    if(nested)
+      tid->abort();
     return kErrorUnknownIndex;
   }
   
-  // Commit the nested transaction
-  tid->commit(0);
   delete [] (char*) pkey;
-  // We finished writing on the index
-  schema_->EndTransaction(tid);
+  if(nested){
+    // Commit the nested transaction
+    tid->commit(0);
+    // We finished writing on the index
+    schema_->EndTransaction(tid);
+  }
   
   return result;
 }
@@ -272,8 +300,11 @@ ErrorCode Index::Delete(Transaction *tx, Record *record, uint8_t flags){
   
   bool ignore_payload = (flags & kIgnorePayload);
   
-  // Convert the record 
-  Dbt key = *GetBDBKey(record->key);
+  // Convert the record (the key data is released below via pkey, the
+  // heap allocated Dbt wrapper right away)
+  Dbt *bdbkey = GetBDBKey(record->key);
+  Dbt key = *bdbkey;
+  delete bdbkey;
   Dbt okey = key;
   void* pkey = key.get_data();
   
@@ -284,15 +315,29 @@ ErrorCode Index::Delete(Transaction *tx, Record *record, uint8_t flags){
     value.set_size(record->payload.size);
   }
   
-  // Create a serializable nested transaction (to prevent the transaction
-  // from seeing data that has been inserted after the transaction begun)
-  env_->txn_begin((tx?tx->tid:NULL), &tid,  0 );
+  // Inside a larger transaction, a single record is changed by a single
+  // cursor operation, which needs no nested transaction. Otherwise create a
+  // serializable nested transaction (to prevent the transaction from seeing
+  // data that has been inserted after the transaction begun)
+  bool nested = (tx == NULL) || (flags & kMatchDuplicates);
+  bool writing;
+  if(nested){
+    env_->txn_begin((tx?tx->tid:NULL), &tid,
+                    ConnectionManager::getInstance().snapshot_isolation() ?
+                    DB_TXN_SNAPSHOT : 0);
+    writing = schema_->BeginTransaction(tid);
+  } else {
+    tid = tx->tid;
+    writing = tx->UseIndex(schema_);
+  }
   
   // Start writing on the index
-  if(schema_->BeginTransaction(tid)){
+  if(writing){
     
     // Create a cursor for this index
-    db_->cursor(tid, &cursor, DB_READ_COMMITTED);
+    db_->cursor(tid, &cursor,
+                ConnectionManager::getInstance().snapshot_isolation() ?
+                0 : DB_READ_COMMITTED);
     
     // Retrieve the first record
     int err = 0;
@@ -313,7 +358,7 @@ ErrorCode Index::Delete(Transaction *tx, Record *record, uint8_t flags){
       if((err = cursor->del(0)) == 0){
         // If the deletion occured inside a larger transaction, then add
         // the parent transaction to the set of open transactions
-        if(tx != NULL){
+        if(nested && (tx != NULL)){
           tx->UseIndex(schema_);
         }
         
@@ -346,20 +391,24 @@ ErrorCode Index::Delete(Transaction *tx, Record *record, uint8_t flags){
       else
         result = kErrorGenericFailure;
     }
+    cursor->close();
   } else {
     // Abort the new transaction
     delete [] (char*) pkey;
-    tid->abort();
+    if(nested)
+      tid->abort();
     
     return kErrorUnknownIndex;
   }
   
-  // Commit the nested transaction
   delete [] (char*) pkey;
-  tid->commit(0);
-  
-  // We finished writing on the index
-  schema_->EndTransaction(tid);
+  if(nested){
+    // Commit the nested transaction
+    tid->commit(0);
+    
+    // We finished writing on the index
+    schema_->EndTransaction(tid);
+  }
   
   return result;
 }
@@ -407,13 +456,7 @@ IndexSchema::IndexSchema(uint8_t attribute_count, KeyType type){
   
   // Build the size and copy the type array
   for(int i = 0; i < attribute_count; i++){
-    if(type[i] == kShort)
-      size_ += 4;
-    else if(type[i] == kInt)
-      size_ += 8;
-    else
-      size_ += MAX_VARCHAR_LENGTH+1;
-    
+    size_ += MaxEncodedAttributeSize(type[i]);
     type_[i] = type[i];
   }
 }
@@ -452,74 +495,34 @@ Key IndexSchema::GetKey(const Dbt *bdb_key){
   key.value = (Attribute**) malloc(attribute_count_*sizeof(Attribute*));
   key.attribute_count = attribute_count_;
   
-  int offset = 8, size = 0;
   for(int i = 0; i < attribute_count_; i++){
-    // Determine the attribute size
-    if(type_[i] == kShort)
-      size = 4;
-    else if(type_[i] == kInt)
-      size = 8;
-    else
-      size = MAX_VARCHAR_LENGTH+1;
-    
     // Create the attribute
     key.value[i] = (Attribute*) malloc(sizeof(Attribute));
-    key.value[i]->type = type_[i];
-    memcpy(&(key.value[i]->char_value),((char*)bdb_key->get_data())+offset,size);
-    
-    // Set the offset to the first byte after the attribute
-    offset+=size;
   }
+  DecodeKey(bdb_key, key);
   
   return key;
 }
 
+// Decode the given Dbt into the attributes of the given key
+// (which must already hold attribute_count_ attributes)
+void IndexSchema::DecodeKey(const Dbt *bdb_key, Key &key){
+  const char* data = (const char*) bdb_key->get_data();
+  for(int i = 0; i < attribute_count_; i++)
+    data += DecodeAttribute(type_[i], data, key.value[i]);
+}
+
 // Convert the given Key of this index into a Dbt object
+//
+// The key is encoded using common/key_codec.h. If an attribute of the key is
+// NULL, a wildcard is set depending on whether it is a maximum or minimum key.
 Dbt* IndexSchema::GetBDBKey(Key key, bool max){
   // Allocate the necessary memory
-  char* data = new char[size_+8];
-  
-  IndexSchema* is = this;
-  memcpy(data,&is,sizeof(this));
-  
-  int offset = 8, size = 0;
-  
-  // If the key value is NULL we have to set a wildcard
-  // depending on if it is a maximum or minimum key
-  int32_t short_wildcard = (max?INT32_MAX:INT32_MIN);
-  int64_t int_wildcard = (max?INT64_MAX:INT64_MIN);
-
-  for(int i = 0; i < attribute_count_; i++){
-    // Determine the attribute size
-    if(type_[i] == kShort){
-      size = 4;
-      if(key.value[i] == NULL)
-        memcpy(data+offset,&short_wildcard,size);
-    }else if(type_[i] == kInt){
-      size = 8;
-      if(key.value[i] == NULL)
-        memcpy(data+offset,&int_wildcard,size);
-
-    }else{
-      size = MAX_VARCHAR_LENGTH+1;
-      if(key.value[i] == NULL){
-         memset(data+offset,127,MAX_VARCHAR_LENGTH);
-         if(max)
-          memset(data+offset+MAX_VARCHAR_LENGTH,'\0',1);
-         else
-          memset(data+offset,'\0',1);
-      }
-    }
-    if(key.value[i] != NULL){
-      // Copy the data into the buffer
-      memcpy(data+offset,&(key.value[i]->char_value),size);
-    }
-    // Set the offset to the first byte after the attribute
-    offset += size;
-  }
+  char* data = new char[size_];
+  size_t size = EncodeKey(type_, attribute_count_, key, data, max);
 
   // Return the newly created Dbt object
-  Dbt* rt = new Dbt(data,size_+8);
+  Dbt* rt = new Dbt(data,size);
   return rt;
 }
 
@@ -34,8 +34,7 @@
 
 #include <contest_interface.h>
 #include <common/macros.h>
-
-#include "mutex.h"
+#include <common/mutex.h>
 
 class Db;
 class Dbt;
@@ -61,6 +60,9 @@ class Index{
   
   // Converts the given Dbt to a key of this index
   Key GetKey(const Dbt *bdb_key);
+
+  // Decodes the given Dbt into the attributes of the given key
+  void DecodeKey(const Dbt *bdb_key, Key &key);
   
   // Converts the given Key of this index into a Dbt object
   Dbt* GetBDBKey(Key key, bool max = false);
@@ -137,6 +139,9 @@ class IndexSchema{
   
   // Convert the given Dbt to a key of this index
   Key GetKey(const Dbt *bdb_key);
+
+  // Decode the given Dbt into the attributes of the given key
+  void DecodeKey(const Dbt *bdb_key, Key &key);
   
   // Convert the given Key of this index into a Dbt object
   Dbt *GetBDBKey(Key key, bool max = false);
@@ -173,7 +178,7 @@ class IndexSchema{
   // An array of attribute types
   AttributeType* type_;
   
-  // The size of a key of this index in byte
+  // The maximum size of an encoded key of this index in byte
   size_t size_;
 
   // Whether the index is readonly
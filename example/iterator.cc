@@ -29,6 +29,7 @@
 #include "util.h"
 
 #include <db_cxx.h>
+#include <common/skip_scan.h>
 
 #include <stdint.h>
 #include <cstdlib>
@@ -44,9 +45,14 @@ Iterator::Iterator(){
   cursor_ = NULL;
   min_key_ = NULL;
   max_key_ = NULL;
+  target_ = NULL;
+  bounds_.size = 0;
   key_ = NULL;
   value_ = NULL;
   key_set_ = false;
+  attributes_ = NULL;
+  record_.key.value = NULL;
+  record_.key.attribute_count = 0;
 }
 
 // Destructor
@@ -79,6 +85,15 @@ void Iterator::Init(Transaction* tx, Index* idx, Key min_keys, Key max_keys){
   // Initialize the max_key_
   max_key_ = index_->GetBDBKey(max_keys,true);
 
+  // Allocate the buffer for the keys computed by the skip-scan
+  target_ = new char[SkipScanTargetSize(is_->type(), is_->attribute_count())];
+
+  // Keys of fixed width are checked against the bounds using vector
+  // instructions
+  PrepareBoundsCheck(&bounds_, is_->type(), is_->attribute_count(),
+                     (const char*) min_key_->get_data(),
+                     (const char*) max_key_->get_data());
+
   // Initialize the cursor
   cursor_ = index_->Cursor(tx);
   
@@ -109,6 +124,16 @@ void Iterator::Close(){
   
   delete [] (char*) max_key_->get_data();
   delete max_key_;
+
+  delete [] target_;
+  target_ = NULL;
+
+  delete [] attributes_;
+  delete [] record_.key.value;
+  attributes_ = NULL;
+  record_.key.value = NULL;
+
+  ReleaseRecords();
   
   //std::cerr<<"free"<<"("<<this<<")";
   //delete key_;
@@ -122,13 +147,14 @@ void Iterator::Close(){
 //
 // Retrieves the next value from the iterator
 //
-// It essentially applies post-filtering to the result set, in order to find 
-// the next valid key/value pair
-// (i.e., it reads the next key/value pairs until a valid one has been found 
-//  or the given range is exceeded).
+// The records are read in key order starting at the minimum key. If an
+// attribute of the retrieved key lies outside the given range, the cursor
+// does not step through all following keys. Instead the smallest key that
+// could still satisfy every attribute bound is computed (see
+// common/skip_scan.h) and the cursor jumps there using DB_SET_RANGE.
 //
-// This approach can be very inefficient (especially for partial-match queries
-// that do not restrict the dimension of the first key attribute)
+// Thus, a range or partial-match query needs one seek per qualifying prefix
+// value instead of one comparison per stored record.
 //
 bool Iterator::Next(){
   //std::cerr<<"Next"<<"("<<this<<")";
@@ -157,14 +183,34 @@ bool Iterator::Next(){
           SetEnded();
           
           return true;
-        } else if((KeyCmp(is_,min_key_,key_,true) == 0) &&
-                  (KeyCmp(is_,key_,max_key_,true) == 0)){
+        }
+
+        size_t target_size;
+        SkipScanResult result;
+        if(bounds_.size != 0)
+          result = CheckBounds(&bounds_, (const char*) key_->get_data(),
+                               target_, &target_size);
+        else
+          result = SkipScan(is_->type(), is_->attribute_count(),
+                            (const char*) key_->get_data(),
+                            (const char*) min_key_->get_data(),
+                            (const char*) max_key_->get_data(), target_,
+                            &target_size);
 
+        if(result == kSkipScanMatch){
           // We've found a record
+          return true;
+        } else if(result == kSkipScanEnd){
+          // Mark the iterator as ended
+          SetEnded();
+
           return true;
         }
-        // Move the cursor to the next key
-        err = cursor_->get(key_, value_, DB_NEXT);
+
+        // Jump to the next key that could be in range
+        key_->set_data(target_);
+        key_->set_size(target_size);
+        err = cursor_->get(key_, value_, DB_SET_RANGE);
     } else {
       key_set_ = false;
       // Mark the iterator as ended because no new record could be fetched
@@ -204,6 +250,52 @@ Record* Iterator::value(){
   return record;
 }
 
+// Return the record to which the iterator refers using a buffer owned by the
+// iterator
+//
+// The attributes are allocated by the first call, later calls only decode the
+// current key into them. The payload points to the data returned by the
+// cursor, which stays valid until the cursor is moved.
+Record* Iterator::buffered_value(){
+  // If the iterator has already ended, don't return a record
+  if(end_)
+    return NULL;
+
+  if(attributes_ == NULL){
+    uint8_t count = is_->attribute_count();
+    attributes_ = new Attribute[count];
+    record_.key.value = new Attribute*[count];
+    record_.key.attribute_count = count;
+    for(int i = 0; i < count; i++)
+      record_.key.value[i] = &attributes_[i];
+  }
+
+  index_->DecodeKey(key_, record_.key);
+  record_.payload.data = value_->get_data();
+  record_.payload.size = value_->get_size();
+  return &record_;
+}
+
+// Keep a record returned by value() until ReleaseRecords() is called
+void Iterator::KeepRecord(Record* record){
+  records_.push_back(record);
+}
+
+// Free all records kept by the iterator
+//
+// The records have been allocated by value() (see IndexSchema::GetKey()).
+void Iterator::ReleaseRecords(){
+  for(size_t i = 0; i < records_.size(); i++){
+    Record* record = records_[i];
+    for(int j = 0; j < record->key.attribute_count; j++)
+      free(record->key.value[j]);
+    free(record->key.value);
+    free(record->payload.data);
+    free(record);
+  }
+  records_.clear();
+}
+
 // Close the Berkeley DB Cursor
 //
 // This function is needed to prevent closing of cursors that are already closed
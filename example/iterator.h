@@ -28,6 +28,9 @@
 #ifndef _BDBIMPL_ITERATOR_H_
 #define _BDBIMPL_ITERATOR_H_
 
+#include <vector>
+#include <common/bounds_check.h>
+
 #include "index.h"
 
 class Dbc;
@@ -59,6 +62,17 @@ class Iterator {
 
   // Return the record to which the iterator refers
   Record* value();
+
+  // Return the record to which the iterator refers using a buffer owned by
+  // the iterator (valid until the iterator is moved or closed)
+  Record* buffered_value();
+
+  // Keep a record returned by value() until ReleaseRecords() is called (used
+  // by GetNextBatch())
+  void KeepRecord(Record* record);
+
+  // Free all records kept by the iterator
+  void ReleaseRecords();
     
  private:
   // Close the Berkeley DB Cursor
@@ -73,11 +87,27 @@ class Iterator {
   // The current value to which the iterator refers
   Dbt *value_;
 
+  // The record returned by buffered_value()
+  Record record_;
+
+  // The attributes of the record returned by buffered_value() (allocated on
+  // first use)
+  Attribute *attributes_;
+
+  // The records kept by KeepRecord()
+  std::vector<Record*> records_;
+
   // The maximum key that limits the range of this iterator
   Dbt *max_key_;
 
   // The minimum key for this iterator
   Dbt *min_key_;
+
+  // A buffer for the keys computed by the skip-scan
+  char *target_;
+
+  // The prepared bounds of the range (if the index has keys of fixed width)
+  BoundsCheck bounds_;
   
   // The index which is iterated over
   Index *index_;
@@ -45,9 +45,11 @@ Transaction::~Transaction(){
 
 // Begin the transaction
 void Transaction::Begin(){
-  // Start the new transaction with isolation level read committed
-  ConnectionManager::getInstance().env()->txn_begin(NULL, &tid,
-                                                    DB_READ_COMMITTED );
+  // Start the new transaction with isolation level read committed (or at
+  // snapshot isolation, if configured)
+  ConnectionManager &manager = ConnectionManager::getInstance();
+  manager.env()->txn_begin(NULL, &tid, manager.snapshot_isolation() ?
+                                       DB_TXN_SNAPSHOT : DB_READ_COMMITTED);
 }
 
 // Abort the transaction
@@ -28,71 +28,16 @@
 #include <string.h>
 #include <cstdlib>
 
-#include "util.h"
+#include <common/key_codec.h>
 
-// Compares two Berkeley DB keys (used for the b-tree)
-int keycmp(Db *db, const Dbt *a,  const Dbt *b){
-  // Retrieve the index schema from key a
-  IndexSchema *is;
-  memcpy(&is, a->get_data(), sizeof(is));
-    
-  // Compare the keys
-  return KeyCmp(is,a,b);
-}
+#include "util.h"
 
 // Compares two Berkeley DB keys using the given schema
 //
-// If full is true the result will be 0 if every attribute of key a
-// is smaller than or equal to key b (1 otherwise)
-int KeyCmp(IndexSchema *is, const Dbt *a, const Dbt *b, bool full){
-  
-  // This union mimics the unnamed union defined inside the Attribute
-  // struct in contest_interface.h
-  typedef union {
-    int32_t short_value;
-    int64_t int_value;
-    char char_value[MAX_VARCHAR_LENGTH+1];
-  } Value;
-  
-  // Skip the first 64bit of each key (they are used to save the index schema)
-  Value *av, *bv;
-  char* ak = ((char*) a->get_data())+8;
-  char* bk = ((char*) b->get_data())+8;
-  
-  // Compare the keys
-  int result = 0;
-  for(int i = 0; i < is->attribute_count(); i++){
-    av = (Value*) (ak);
-    bv = (Value*) (bk);
-    result = 0;
-    switch(is->type()[i]){
-      case kShort:
-        if( av->short_value< bv->short_value )
-          result = -1;
-        else if (av->short_value > bv->short_value )
-          result = 1;
-        ak+=4;
-        bk+=4;
-        break;
-      case kInt:
-        if(av->int_value < bv->int_value )
-          result = -1;
-        else if (av->int_value > bv->int_value )
-          result = 1;
-        ak+=8;
-        bk+=8;
-        break;
-      case kVarchar:
-        result = strcmp(av->char_value, bv->char_value);
-        ak+=MAX_VARCHAR_LENGTH+1;
-        bk+=MAX_VARCHAR_LENGTH+1;
-      }
-    if(!full && (result != 0)){
-      return result;
-    } else if(full && (result > 0)){
-      return 1;
-    }
-  }
-
-  return 0;
-}
\ No newline at end of file
+// The keys are encoded using common/key_codec.h, so they can be compared
+// using memcmp (which is also the order used by the b-tree). Per-attribute
+// range checks are done by SkipScan() (see common/skip_scan.h).
+int KeyCmp(IndexSchema *is, const Dbt *a, const Dbt *b){
+  return CompareEncoded((const char*) a->get_data(), a->get_size(),
+                        (const char*) b->get_data(), b->get_size());
+}
@@ -33,10 +33,7 @@
 
 #include "index.h"
 
-// Compares two Berkeley DB keys (used for the b-tree)
-int keycmp(Db *db, const Dbt *a, const Dbt *b);
-
 // Compares two Berkeley DB keys using the given schema
-int KeyCmp(IndexSchema *is, const Dbt *a, const Dbt *b, bool full = false);
+int KeyCmp(IndexSchema *is, const Dbt *a, const Dbt *b);
 
 #endif // _BDBIMPL_UTIL_H_
@@ -617,6 +617,206 @@ An iterator may only be closed once, otherwise \ref kErrorIteratorClosed will be
 */
 ErrorCode CloseIterator(Iterator **it);
 
+/*
+Extensions
+
+The following functions are not part of the contest API. Implementations may
+provide them to allow callers to avoid some of the overhead of the functions
+above. Callers that want to work with any implementation should declare them
+as weak symbols and check whether they are available before using them.
+*/
+
+/**
+Moves the \ref Iterator to the next record just like GetNext(), but returns a
+record that is owned by the iterator.
+
+The returned record (including its key attributes and its payload) is stored
+inside a buffer of the iterator, which is reused by every call. It remains
+valid until GetNext(), GetNextBuffered() or CloseIterator() is called on the
+same iterator and must not be modified or freed by the caller. Thus, reading a
+range does not need any heap allocations per record.
+
+@param[in,out] it
+  the Iterator used to retrieve the next record
+
+@param[out] record
+  returns the next record of the Iterator (or NULL if the end of the range has
+  been reached)
+
+@see GetNext()
+
+@return ErrorCode
+  - \ref kOk
+         if the next record was successfully retrieved
+  - \ref kErrorIteratorClosed
+         if the given iterator has been closed already or never existed
+  - \ref kErrorNotFound
+         if a follow-up record could not be found
+  - \ref kErrorDeadlock
+         if the call could not be completed because of a deadlock
+  - \ref kErrorGenericFailure
+         if the operation did not complete for some other reason
+*/
+ErrorCode GetNextBuffered(Iterator *it, Record** record);
+
+/**
+Moves the \ref Iterator over up to max records and stores them in the given
+array of records.
+
+Calling GetNextBatch() is equivalent to calling GetNextBuffered() up to max
+times, but the records are retrieved in a single pass over the index, so the
+per-call overhead is only paid once per batch. Implementations may return fewer
+than max records even if the end of the range has not been reached yet.
+
+The keys and payloads of the returned records are stored inside buffers of the
+iterator. They remain valid until GetNext(), GetNextBuffered(), GetNextBatch()
+or CloseIterator() is called on the same iterator and must not be modified or
+freed by the caller.
+
+@param[in,out] it
+  the Iterator used to retrieve the records
+
+@param[out] records
+  a caller-provided array of at least max records that is filled with the
+  retrieved records
+
+@param[in] max
+  the maximum number of records to be retrieved
+
+@param[out] count
+  returns the number of records stored in records
+
+@see GetNextBuffered()
+
+@return ErrorCode
+  - \ref kOk
+         if at least one record was successfully retrieved
+  - \ref kErrorIteratorClosed
+         if the given iterator has been closed already or never existed
+  - \ref kErrorNotFound
+         if no follow-up record could be found (count is set to 0)
+  - \ref kErrorDeadlock
+         if the call could not be completed because of a deadlock
+  - \ref kErrorGenericFailure
+         if the operation did not complete for some other reason
+*/
+ErrorCode GetNextBatch(Iterator *it, Record* records, uint32_t max, uint32_t* count);
+
+/**
+Inserts a batch of records into the index outside of any transaction.
+
+Calling BulkLoad() is equivalent to calling InsertRecord() without a
+transaction for every record of the batch, but allows the implementation to
+sort the batch and build its index structure in one pass instead of inserting
+the records one by one. It is intended for loading large amounts of data, e.g.
+while populating an index before it is used by other threads.
+
+If an error occurs, none of the records of the batch has been inserted.
+
+@param[in] idx
+  the index the records will be inserted into
+
+@param[in] records
+  an array of count records to be inserted (the array and the records are not
+  modified and can be reused after the call)
+
+@param[in] count
+  the number of records in the batch
+
+@see InsertRecord()
+
+@return ErrorCode
+  - \ref kOk
+         if all records were successfully inserted
+  - \ref kErrorUnknownIndex
+         if the given index handle is unknown
+  - \ref kErrorIncompatibleKey
+         if the key of a record is incompatible with the index
+  - \ref kErrorOutOfMemory
+         if the records could not be inserted because of a lack of memory
+  - \ref kErrorGenericFailure
+         if the operation did not complete for some other reason
+*/
+ErrorCode BulkLoad(Index *idx, Record *records, uint32_t count);
+
+/**
+Returns the number of heap allocations the implementation has made so far.
+
+The counter covers all threads and is meant for diagnostics, e.g. to compare
+the number of allocations per operation before and after a benchmark run.
+Implementations decide which allocations they count, so the values of
+different implementations are not comparable.
+
+@param[out] count
+  returns the number of allocations
+
+@return ErrorCode
+  - \ref kOk
+         if the counter has been read
+  - \ref kErrorGenericFailure
+         if the counter is not available
+*/
+ErrorCode GetAllocationCount(uint64_t *count);
+
+/**
+Returns the number of records stored inside an index and the memory they use.
+
+The memory includes the records themselves as well as the structures used to
+find them. It is meant for diagnostics, e.g. to compare the number of bytes
+per record of different index layouts. Like GetAllocationCount(), the values of
+different implementations are not comparable.
+
+@param[in] name
+  the name of the index
+
+@param[out] records
+  returns the number of records
+
+@param[out] bytes
+  returns the memory used by the index in bytes
+
+@return ErrorCode
+  - \ref kOk
+         if the memory usage has been determined
+  - \ref kErrorUnknownIndex
+         if no index with the given name exists
+  - \ref kErrorGenericFailure
+         if the memory usage is not available
+*/
+ErrorCode GetIndexMemoryUsage(const char* name, uint64_t *records,
+                              uint64_t *bytes);
+
+/**
+Returns how the memory of an index is distributed across the NUMA nodes.
+
+The memory of the index is sampled page by page and the sampled pages are
+counted per NUMA node they are located on. Like GetIndexMemoryUsage(), this is
+meant for diagnostics, e.g. to check whether the records of an index are
+located on the same node as the threads using them.
+
+@param[in] name
+  the name of the index
+
+@param[in] node_count
+  the number of elements of pages
+
+@param[out] pages
+  returns the number of sampled pages located on NUMA node n in pages[n]
+  (pages located on nodes >= node_count are not counted)
+
+@return ErrorCode
+  - \ref kOk
+         if the placement has been determined
+  - \ref kErrorUnknownIndex
+         if no index with the given name exists
+  - \ref kErrorOutOfMemory
+         if the pages could not be sampled
+  - \ref kErrorGenericFailure
+         if the placement is not available
+*/
+ErrorCode GetIndexMemoryPlacement(const char* name, uint32_t node_count,
+                                  uint64_t *pages);
+
 
 #ifdef __cplusplus
 }
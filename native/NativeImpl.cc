@@ -0,0 +1,521 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+/** @file
+An in-memory implementation of the contest interface.
+
+Every index is stored inside a concurrent B+-tree (see btree.h) whose nodes
+are sized to a few cache lines and protected by latches that are acquired
+using latch coupling. Records are locked by the transactions that modified
+them, so uncommitted changes are only visible to their own transaction
+(isolation level read committed).
+
+If the environment variable CONTEST_ISOLATION is set to "snapshot", transactions
+and iterators instead read the snapshot taken when they started (see
+snapshot.h). Entries are stamped with the commit timestamps of the
+transactions that inserted and deleted them, so readers never lock anything and
+only concurrent writes to the same record conflict.
+
+The multidimensional keys are mapped to one dimensional keys by concatenating
+all key attributes using an order-preserving encoding (see
+common/key_codec.h), so keys can be compared using memcmp. Range and
+partial-match queries are evaluated by a skip-scan over the tree (see
+common/skip_scan.h): whenever an attribute leaves its range, the cursor seeks
+to the next key that could satisfy all bounds. Results are thereby returned in
+key order. The keys are not organized multidimensionally, though: a query that
+leaves the leading attribute unrestricted still costs one seek per distinct
+value of that attribute, which approaches a scan of the whole index if most
+leading values are distinct.
+
+Batches passed to BulkLoad() are sorted in parallel. If the loading handle is
+the only user of its index, the tree is rebuilt bottom-up from completely
+filled nodes; otherwise, the sorted records are inserted one by one.
+
+Transactions and iterators are recycled by the thread that released them,
+together with their buffers, and keys are encoded into a buffer of the calling
+thread (see pool.h). The heap allocations made by the implementation are
+counted and can be read using GetAllocationCount(). GetIndexMemoryUsage()
+reports the memory used by the records of an index, GetIndexMemoryPlacement()
+the NUMA nodes holding it.
+*/
+
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <contest_interface.h>
+
+#include "epoch.h"
+#include "index.h"
+#include "iterator.h"
+#include "pool.h"
+#include "transaction.h"
+#include "util.h"
+
+/**
+Starts a new transaction and sets the corresponding handle (tx).
+
+@see contest_interface.h for details
+*/
+ErrorCode BeginTransaction(Transaction **tx){
+  if(tx == NULL)
+    return kErrorGenericFailure;
+
+  try{
+    *tx = NewTransaction();
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+
+  return kOk;
+};
+
+/**
+ Aborts the given transaction and rolls back all changes
+ made during the course of this transaction.
+
+ @see contest_interface.h for details
+ */
+ErrorCode AbortTransaction(Transaction **tx){
+  // Check that the given transaction is valid
+  if((tx == NULL) || (*tx == NULL))
+    return kErrorTransactionClosed;
+
+  // Abort the transaction and reset the handle
+  (*tx)->Abort();
+  DeleteTransaction(*tx);
+  (*tx) = NULL;
+
+  return kOk;
+};
+
+/**
+ Ends the given transaction and persists all changes
+ made during the course of this transaction.
+
+ @see contest_interface.h for details
+ */
+ErrorCode CommitTransaction(Transaction **tx){
+  // Check that the given transaction is valid
+  if((tx == NULL) || (*tx == NULL))
+    return kErrorTransactionClosed;
+
+  // Commit the transaction and reset the handle (in optimistic mode, the
+  // transaction is aborted if its changes could not be validated)
+  bool committed = (*tx)->Commit();
+  DeleteTransaction(*tx);
+  (*tx) = NULL;
+
+  return committed ? kOk : kTransactionAborted;
+};
+
+
+/*
+Creates an empty index.
+
+@see contest_interface.h for details
+*/
+ErrorCode CreateIndex(const char* name, uint8_t column_count, KeyType types){
+  // Check that the input values are valid
+  if((!name) || (strlen(name) < 1) || (column_count < 1) || (!types))
+    return kErrorGenericFailure;
+
+  try{
+    return IndexSchema::Create(name,column_count,types);
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+}
+
+/**
+Opens an index specified by its name to be used by the current thread
+
+@see contest_interface.h for details
+*/
+ErrorCode OpenIndex(const char* name, Index **idx){
+  // Check that the given name is valid
+  if((name == NULL) || (strlen(name) == 0) || (idx == NULL))
+    return kErrorGenericFailure;
+
+  try{
+    // Open the index
+    return Index::Open(name,idx);
+  } catch(std::bad_alloc &e){
+    *idx = NULL;
+    return kErrorOutOfMemory;
+  }
+}
+
+/**
+Closes an specified index on this thread.
+
+@see contest_interface.h for Details
+*/
+ErrorCode CloseIndex(Index **idx){
+  // Check that the given index handle is valid
+  if((idx == NULL) || (*idx == NULL))
+    return kErrorUnknownIndex;
+
+  ErrorCode result = kOk;
+
+  // If the index handle has been closed already,
+  // but was not deleted, delete it
+  if(((*idx)->closed()))
+    result = kErrorUnknownIndex;
+
+  // Close the index
+  delete *idx;
+  *idx = NULL;
+
+  return result;
+}
+
+/*
+Deletes an given index and frees all its resources.
+
+@see contest_interface.h for details
+*/
+ErrorCode DeleteIndex(const char* name){
+  // Check that the given name is valid
+  if((name == NULL) || (strlen(name) < 1))
+    return kErrorGenericFailure;
+
+  try{
+    // Try to erase the index structure (closes open handles)
+    return IndexManager::getInstance().Remove(name);
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+}
+
+/**
+Inserts a record (representing a multidimensional key and an associated payload)
+into the index.
+
+@see contest_interface.h for details
+*/
+ErrorCode InsertRecord(Transaction *tx, Index *idx, Record *record){
+  // Check that all input values are valid
+  if((idx == NULL) || (idx->closed()))
+    return kErrorUnknownIndex;
+
+  if(!idx->Compatible(record))
+    return kErrorIncompatibleKey;
+
+  try {
+    // Insert the record
+    return idx->Insert(tx,record);
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+}
+
+/**
+Inserts a batch of records into the index outside of any transaction.
+
+@see contest_interface.h for details
+*/
+ErrorCode BulkLoad(Index *idx, Record *records, uint32_t count){
+  // Check that all input values are valid
+  if((idx == NULL) || (idx->closed()))
+    return kErrorUnknownIndex;
+
+  if((records == NULL) && (count > 0))
+    return kErrorGenericFailure;
+
+  for(uint32_t i = 0; i < count; i++){
+    if(!idx->Compatible(&records[i]))
+      return kErrorIncompatibleKey;
+  }
+
+  try {
+    // Insert the records
+    return idx->BulkLoad(records, count);
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+}
+
+/**
+Searches for a key/value combination given as a record and updates its value.
+
+@see contest_interface.h for details
+*/
+ErrorCode UpdateRecord(Transaction *tx, Index *idx, Record *record, Block *new_payload, uint8_t flags){
+  // Check that all input values are valid
+  if((idx == NULL) || (idx->closed()))
+    return kErrorUnknownIndex;
+
+  if(!idx->Compatible(record))
+    return kErrorIncompatibleKey;
+
+  if(new_payload == NULL)
+    return kErrorGenericFailure;
+
+  try {
+    // Update the record
+    return idx->Update(tx, record, new_payload, flags);
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+}
+
+/**
+Searches for a record and removes it from the index
+
+@see contest_interface.h for details
+*/
+ErrorCode DeleteRecord(Transaction *tx, Index *idx, Record *record, uint8_t flags){
+  // Check that all input values are valid
+  if((idx == NULL) || (idx->closed()))
+    return kErrorUnknownIndex;
+
+  if(!idx->Compatible(record))
+    return kErrorIncompatibleKey;
+
+  try {
+    // Delete the record
+    return idx->Delete(tx, record, flags);
+  } catch(std::bad_alloc &e){
+    return kErrorGenericFailure;
+  }
+}
+
+/**
+Returns an \ref Iterator that starts at the first value of the given minimum
+multidimensional key.
+
+@see contest_interface.h for details
+*/
+ErrorCode GetRecords(Transaction *tx, Index *idx, Key min_keys, Key max_keys, Iterator **it){
+  // Check that all input values are valid
+  if((idx == NULL) || (idx->closed()))
+    return kErrorUnknownIndex;
+
+  if(it == NULL)
+    return kErrorGenericFailure;
+
+  if(!idx->Compatible(min_keys) || !idx->Compatible(max_keys))
+    return kErrorIncompatibleKey;
+
+  // Create the new Iterator
+  *it = NULL;
+  try {
+    *it = NewIterator();
+    (*it)->Init(tx,idx,min_keys,max_keys);
+  } catch(std::bad_alloc &e){
+    DeleteIterator(*it);
+    *it = NULL;
+    return kErrorOutOfMemory;
+  }
+
+  return kOk;
+}
+
+/**
+Moves the iterator to the next record or reports an end of range (by returning
+an \ref kErrorNotFound status), if the maximum multidimensional key is exceeded.
+
+@see contest_interface.h for details
+*/
+ErrorCode GetNext(Iterator *it, Record** record){
+  // Check that all input values are valid
+  if(record == NULL)
+    return kErrorGenericFailure;
+
+  if((it == NULL) || (it->closed()))
+    return kErrorIteratorClosed;
+
+  try {
+    // Fetch the next record
+    if(it->Next()){
+      // If the iterator reached its end, no record was found
+      if(it->end()){
+        *record = NULL;
+        return kErrorNotFound;
+      } else {
+        // Set the record to the retrieved record
+        *record = it->value();
+      }
+    } else {
+      return kErrorGenericFailure;
+    }
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+  return kOk;
+}
+
+/**
+Moves the iterator to the next record and returns it using a buffer owned by
+the iterator (valid until the iterator is moved or closed).
+
+@see contest_interface.h for details
+*/
+ErrorCode GetNextBuffered(Iterator *it, Record** record){
+  // Check that all input values are valid
+  if(record == NULL)
+    return kErrorGenericFailure;
+
+  if((it == NULL) || (it->closed()))
+    return kErrorIteratorClosed;
+
+  try {
+    // Fetch the next record
+    if(it->Next()){
+      // If the iterator reached its end, no record was found
+      if(it->end()){
+        *record = NULL;
+        return kErrorNotFound;
+      } else {
+        // Set the record to the buffer of the iterator
+        *record = it->buffered_value();
+      }
+    } else {
+      return kErrorGenericFailure;
+    }
+  } catch(std::bad_alloc &e){
+    return kErrorOutOfMemory;
+  }
+  return kOk;
+}
+
+/**
+Moves the iterator over up to max records and stores them in the given array
+(using buffers owned by the iterator).
+
+@see contest_interface.h for details
+*/
+ErrorCode GetNextBatch(Iterator *it, Record* records, uint32_t max, uint32_t* count){
+  // Check that all input values are valid
+  if((records == NULL) || (count == NULL) || (max == 0))
+    return kErrorGenericFailure;
+
+  if((it == NULL) || (it->closed()))
+    return kErrorIteratorClosed;
+
+  try {
+    // Fetch the next records
+    *count = it->NextBatch(records, max);
+  } catch(std::bad_alloc &e){
+    *count = 0;
+    return kErrorOutOfMemory;
+  }
+
+  // If no record was retrieved, the iterator reached its end
+  if(*count == 0)
+    return kErrorNotFound;
+  return kOk;
+}
+
+/**
+Closes the given iterator and frees all of its resources.
+
+@see contest_interface.h for details
+*/
+ErrorCode CloseIterator(Iterator **it){
+  // Check that all input values are valid
+  if((it == NULL) || (*it == NULL)){
+    return kErrorIteratorClosed;
+  }
+
+  ErrorCode result = kOk;
+
+  // If the iterator is already closed we just clean up
+  if((*it)->closed())
+    result = kErrorIteratorClosed;
+  else
+    (*it)->Close();
+
+  DeleteIterator(*it);
+  *it = NULL;
+
+  return result;
+}
+
+/**
+Returns the number of heap allocations made by the implementation so far.
+
+@see contest_interface.h for details
+*/
+ErrorCode GetAllocationCount(uint64_t *count){
+  if(count == NULL)
+    return kErrorGenericFailure;
+
+  *count = AllocationCount();
+  return kOk;
+}
+
+/**
+Returns the number of records of an index and the memory used by them.
+
+@see contest_interface.h for details
+*/
+ErrorCode GetIndexMemoryUsage(const char* name, uint64_t *records,
+                              uint64_t *bytes){
+  if((name == NULL) || (records == NULL) || (bytes == NULL))
+    return kErrorGenericFailure;
+
+  // The schema can not be deleted while it is used inside the epoch
+  EnterEpoch();
+  IndexSchema* schema = IndexManager::getInstance().Find(name);
+  if(schema != NULL)
+    schema->CountMemory(records, bytes);
+  LeaveEpoch();
+
+  return (schema != NULL) ? kOk : kErrorUnknownIndex;
+}
+
+/**
+Returns the number of sampled pages of an index per NUMA node.
+
+@see contest_interface.h for details
+*/
+ErrorCode GetIndexMemoryPlacement(const char* name, uint32_t node_count,
+                                  uint64_t *pages){
+  if((name == NULL) || (pages == NULL))
+    return kErrorGenericFailure;
+
+  // The schema can not be deleted while it is used inside the epoch
+  EnterEpoch();
+  IndexSchema* schema = IndexManager::getInstance().Find(name);
+  if(schema == NULL){
+    LeaveEpoch();
+    return kErrorUnknownIndex;
+  }
+
+  ErrorCode result;
+  try{
+    result = schema->CountPlacement(node_count, pages) ? kOk
+                                                       : kErrorGenericFailure;
+  } catch(std::bad_alloc &e){
+    result = kErrorOutOfMemory;
+  }
+  LeaveEpoch();
+  return result;
+}
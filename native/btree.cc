@@ -0,0 +1,1349 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "btree.h"
+#include "index.h"
+#include "pool.h"
+#include "radix_tree.h"
+#include "util.h"
+
+// The maximum height of a tree
+#define MAX_TREE_HEIGHT 64
+
+// Make sure that the nodes do not exceed their size
+typedef char leaf_size_check[(sizeof(LeafNode) <= NODE_SIZE) ? 1 : -1];
+typedef char inner_size_check[(sizeof(InnerNode) <= INNER_NODE_SIZE) ? 1 : -1];
+
+// Make sure that half of the separators of a full inner node (plus the added
+// one) always fit into a node of their own, even if it chooses the longest
+// prefix (see BTree::SplitInner())
+typedef char inner_data_check[(INNER_DATA_SIZE >= 2*INNER_MAX_PREFIX
+                               + INNER_MAX_SEPARATOR_SIZE) ? 1 : -1];
+
+// The size of a buffer holding all separator keys stored inside an inner node
+// (see BTree::ReadSeparators())
+#define SEPARATOR_BUFFER_SIZE \
+  (INNER_CAPACITY * (INNER_MAX_PREFIX + INNER_MAX_SUFFIX))
+
+// Create a new leaf node
+static LeafNode* NewLeaf(void* memory){
+  LeafNode* leaf = new (memory) LeafNode();
+  leaf->count = 0;
+  leaf->level = 0;
+  leaf->version = 0;
+  leaf->next = NULL;
+  leaf->low = NULL;
+  return leaf;
+}
+
+// Create a new inner node on the given level
+static InnerNode* NewInner(void* memory, uint16_t level){
+  InnerNode* inner = new (memory) InnerNode();
+  inner->count = 0;
+  inner->prefix_size = 0;
+  inner->used = 0;
+  inner->level = level;
+  inner->version = 0;
+  inner->next = NULL;
+  return inner;
+}
+
+// Return whether any separator can be added to the given inner node
+static inline bool HasRoom(const InnerNode *inner){
+  return (inner->count < INNER_CAPACITY)
+         && (inner->used + INNER_MAX_SEPARATOR_SIZE <= INNER_DATA_SIZE);
+}
+
+// Release the latch of the given node
+static inline void Unlatch(Node* node, bool exclusive){
+  if(exclusive)
+    node->latch.UnlockExclusive();
+  else
+    node->latch.UnlockShared();
+}
+
+// Return whether the given separator key is stored inside an inner node using
+// the given prefix (otherwise it is allocated separately)
+static inline bool StoredInline(const SeparatorKey &key, const char *prefix,
+                                size_t prefix_size){
+  return (key.separator == NULL) && (key.key_size >= prefix_size)
+         && (key.key_size - prefix_size <= INNER_MAX_SUFFIX)
+         && (memcmp(key.key, prefix, prefix_size) == 0);
+}
+
+// Return the number of bytes the given separator key takes up inside an inner
+// node using the given prefix
+static inline size_t SeparatorSize(const SeparatorKey &key, const char *prefix,
+                                   size_t prefix_size){
+  if(!StoredInline(key, prefix, prefix_size))
+    return sizeof(Separator*);
+  return key.key_size - prefix_size + ((key.id != 0) ? sizeof(uint64_t) : 0);
+}
+
+// Choose the prefix of an inner node holding the given separator keys
+//
+// Only the keys that start with the given base prefix and that have not been
+// allocated separately are considered. As the keys are sorted, the prefix
+// shared by all of them is the one shared by the first and the last key.
+// Returns the number of bytes the keys take up inside the node.
+static size_t ChoosePrefix(const SeparatorKey *keys, int count,
+                           const char *base, size_t base_size,
+                           const char **prefix, size_t *prefix_size){
+  int first = -1, last = -1;
+  for(int i = 0; i < count; i++){
+    if((keys[i].separator == NULL) && (keys[i].key_size >= base_size)
+       && (memcmp(keys[i].key, base, base_size) == 0)){
+      if(first < 0)
+        first = i;
+      last = i;
+    }
+  }
+
+  *prefix = "";
+  *prefix_size = 0;
+  if(first >= 0){
+    size_t size = std::min(std::min(keys[first].key_size, keys[last].key_size),
+                           (uint32_t) INNER_MAX_PREFIX);
+    size_t common = 0;
+    while((common < size) && (keys[first].key[common] == keys[last].key[common]))
+      common++;
+    *prefix = keys[first].key;
+    *prefix_size = common;
+  }
+
+  size_t used = *prefix_size;
+  for(int i = 0; i < count; i++)
+    used += SeparatorSize(keys[i], *prefix, *prefix_size);
+  return used;
+}
+
+// Constructor for BTree
+BTree::BTree(IndexSchema *schema){
+  schema_ = schema;
+  compare_ = schema->comparator();
+  radix_ = NULL;
+  radix_key_size_ = schema->size() + sizeof(uint64_t);
+  leaf_count_ = 1;
+  if(schema->radix())
+    radix_ = new RadixTree(radix_key_size_);
+  try{
+    root_ = NewLeaf(AllocateNode());
+  } catch(...){
+    delete radix_;
+    throw;
+  }
+}
+
+// Destructor for BTree
+BTree::~BTree(){
+  if(radix_ != NULL){
+    FreeLeaves(root_, true);
+    delete radix_;
+  } else {
+    FreeNode(root_);
+  }
+}
+
+// Insert the given entry
+//
+// If the tree uses a radix tree, a full leaf is split right away (see
+// SplitLeaf()), as no other node has to be changed.
+void BTree::Insert(Entry *entry){
+  if(radix_ == NULL){
+    if(!InsertOptimistic(entry))
+      InsertPessimistic(entry);
+    return;
+  }
+
+  LeafNode* leaf = FindLeaf(entry->key(), entry->key_size, entry->id, true);
+  if(leaf->count >= LEAF_CAPACITY){
+    SplitLeaf(leaf, entry);
+    return;
+  }
+
+  int pos = LowerBound(leaf, entry->key(), entry->key_size, entry->id);
+  memmove(&leaf->entries[pos+1], &leaf->entries[pos],
+          (leaf->count-pos)*sizeof(Entry*));
+  leaf->entries[pos] = entry;
+  leaf->count++;
+  leaf->version++;
+  leaf->latch.UnlockExclusive();
+}
+
+// Remove the given entry from the tree
+bool BTree::Remove(const Entry *entry){
+  LeafNode* leaf = FindLeaf(entry->key(), entry->key_size, entry->id, true);
+
+  int pos = LowerBound(leaf, entry->key(), entry->key_size, entry->id);
+  bool found = (pos < leaf->count) && (leaf->entries[pos] == entry);
+  if(found){
+    memmove(&leaf->entries[pos], &leaf->entries[pos+1],
+            (leaf->count-pos-1)*sizeof(Entry*));
+    leaf->count--;
+    leaf->version++;
+  }
+
+  leaf->latch.UnlockExclusive();
+  return found;
+}
+
+// Return an upper bound of the number of entries stored inside the tree
+//
+// Only the inner nodes are visited (or the leaves are counted if the tree
+// uses a radix tree), so every leaf is assumed to be full.
+size_t BTree::EstimateSize() const{
+  if(radix_ != NULL)
+    return leaf_count_ * LEAF_CAPACITY;
+  return LeafCount(root_) * LEAF_CAPACITY;
+}
+
+// Merge the given entries with the entries of the tree and rebuild the tree
+//
+// The existing entries are read from the leaf chain (which is already sorted),
+// so only the new entries have to be sorted beforehand. The old nodes are
+// freed, while all entries are moved into the new tree.
+void BTree::Rebuild(Entry **entries, size_t count){
+  // Find the first leaf
+  Node* node = root_;
+  while(node->level > 0)
+    node = static_cast<InnerNode*>(node)->children[0];
+
+  // Merge the existing and the new entries (leaves that do not receive new
+  // entries are copied without comparing their entries)
+  std::vector<Entry*> merged;
+  size_t i = 0;
+  for(LeafNode* leaf = static_cast<LeafNode*>(node); leaf != NULL;
+      leaf = static_cast<LeafNode*>(leaf->next)){
+    int j = 0;
+    while((i < count) && (leaf->count > 0)
+          && (Compare(entries[i]->key(), entries[i]->key_size, entries[i]->id,
+                      leaf->entries[leaf->count-1]) < 0)){
+      int position = UpperBound(leaf, entries[i]->key(), entries[i]->key_size,
+                                entries[i]->id);
+      merged.insert(merged.end(), leaf->entries + j, leaf->entries + position);
+      merged.push_back(entries[i++]);
+      j = position;
+    }
+    merged.insert(merged.end(), leaf->entries + j, leaf->entries + leaf->count);
+  }
+  merged.insert(merged.end(), entries+i, entries+count);
+
+  if(radix_ != NULL){
+    RadixTree* radix = new RadixTree(radix_key_size_);
+    LeafNode* first;
+    try{
+      first = BuildLeaves(merged.empty() ? NULL : &merged[0], merged.size(),
+                          radix);
+    } catch(...){
+      delete radix;
+      throw;
+    }
+    FreeLeaves(root_, false);
+    delete radix_;
+    radix_ = radix;
+    root_ = first;
+    leaf_count_ = std::max((merged.size() + LEAF_CAPACITY - 1) / LEAF_CAPACITY,
+                           (size_t) 1);
+    return;
+  }
+
+  Node* root = Build(merged.empty() ? NULL : &merged[0], merged.size());
+  FreeNode(root_, false);
+  root_ = root;
+}
+
+// Compare the given key/id combination to the given entry
+int BTree::Compare(const char* key, size_t key_size, uint64_t id,
+                   const Entry* entry) const{
+  int result = compare_(key, key_size, entry->key(), entry->key_size);
+  if(result != 0)
+    return result;
+  return (id < entry->id) ? -1 : ((id > entry->id) ? 1 : 0);
+}
+
+// Compare the given key/id combination to the given separator
+int BTree::Compare(const char* key, size_t key_size, uint64_t id,
+                   Separator* separator) const{
+  int result = compare_(key, key_size, separator->key(), separator->key_size);
+  if(result != 0)
+    return result;
+  return (id < separator->id) ? -1 : ((id > separator->id) ? 1 : 0);
+}
+
+// Try to insert the given entry without splitting a node
+//
+// Only the target leaf is latched exclusively. If it is full, nothing is
+// changed and false is returned.
+bool BTree::InsertOptimistic(Entry *entry){
+  LeafNode* leaf = FindLeaf(entry->key(), entry->key_size, entry->id, true);
+
+  if(leaf->count >= LEAF_CAPACITY){
+    leaf->latch.UnlockExclusive();
+    return false;
+  }
+
+  int pos = LowerBound(leaf, entry->key(), entry->key_size, entry->id);
+  memmove(&leaf->entries[pos+1], &leaf->entries[pos],
+          (leaf->count-pos)*sizeof(Entry*));
+  leaf->entries[pos] = entry;
+  leaf->count++;
+  leaf->version++;
+
+  leaf->latch.UnlockExclusive();
+  return true;
+}
+
+// Insert the given entry while latching all nodes that may split
+//
+// All nodes on the path are latched exclusively. Whenever a node is reached
+// that will not split (because it has some free space left), the latches of
+// all its ancestors are released.
+//
+// The inner nodes that are changed stay marked as modified (see FindLeaf())
+// until the split is complete, including a new root. Every slot below the
+// count of an inner node always holds a valid separator and child, so a reader
+// can never follow a pointer that has not been initialized.
+//
+// The separator pushed upwards by an inner node split is copied into one of
+// two buffers, which alternate between the levels, so it stays valid while
+// the next level is changed.
+void BTree::InsertPessimistic(Entry *entry){
+  Node* path[MAX_TREE_HEIGHT];
+  int positions[MAX_TREE_HEIGHT];
+  int depth = 0;
+  // The topmost inner node on the path that is being modified
+  int modified = -1;
+
+  // Latch all nodes that might be affected by a split
+  Node* node = LatchRoot(true, true);
+  path[depth++] = node;
+  while(node->level > 0){
+    InnerNode* inner = static_cast<InnerNode*>(node);
+    int pos = ChildPosition(inner, entry->key(), entry->key_size, entry->id);
+    Node* child = inner->children[pos];
+    child->latch.LockExclusive();
+
+    bool safe = (child->level == 0)
+                ? (child->count < LEAF_CAPACITY)
+                : HasRoom(static_cast<InnerNode*>(child));
+    if(safe){
+      for(int i = 0; i < depth; i++)
+        path[i]->latch.UnlockExclusive();
+      depth = 0;
+    }
+    positions[depth] = pos;
+    path[depth++] = child;
+    node = child;
+  }
+
+  LeafNode* leaf = static_cast<LeafNode*>(node);
+  int pos = LowerBound(leaf, entry->key(), entry->key_size, entry->id);
+
+  if(leaf->count < LEAF_CAPACITY){
+    // The leaf has been split by someone else in the meantime
+    memmove(&leaf->entries[pos+1], &leaf->entries[pos],
+            (leaf->count-pos)*sizeof(Entry*));
+    leaf->entries[pos] = entry;
+    leaf->count++;
+    leaf->version++;
+  } else {
+    // Split the leaf
+    Entry* all[LEAF_CAPACITY+1];
+    memcpy(all, leaf->entries, pos*sizeof(Entry*));
+    all[pos] = entry;
+    memcpy(all+pos+1, leaf->entries+pos, (LEAF_CAPACITY-pos)*sizeof(Entry*));
+
+    LeafNode* right = NewLeaf(AllocateNode());
+    int left_count = (LEAF_CAPACITY+1)/2;
+    int right_count = LEAF_CAPACITY+1-left_count;
+    memcpy(leaf->entries, all, left_count*sizeof(Entry*));
+    memcpy(right->entries, all+left_count, right_count*sizeof(Entry*));
+    leaf->count = left_count;
+    right->count = right_count;
+    right->next = leaf->next;
+    leaf->next = right;
+    leaf->version++;
+
+    // Propagate the split upwards
+    SeparatorKey separator = SeparatorBetween(all[left_count-1],
+                                              right->entries[0]);
+    char carry[2][INNER_MAX_PREFIX+INNER_MAX_SUFFIX];
+    Node* new_child = right;
+    for(int level = depth-2; (level >= 0) && (new_child != NULL); level--){
+      InnerNode* parent = static_cast<InnerNode*>(path[level]);
+      int p = positions[level+1];
+      BeginModification(parent->version);
+      modified = level;
+
+      if(SeparatorFits(parent, separator)){
+        // Simply add the separator to the parent
+        AddSeparator(parent, p, separator, new_child);
+        new_child = NULL;
+      } else {
+        // Split the parent and push the middle separator upwards
+        InnerNode* sibling = NewInner(AllocateNode(INNER_NODE_SIZE),
+                                      parent->level);
+        separator = SplitInner(parent, sibling, p, separator, new_child,
+                               carry[level % 2]);
+        new_child = sibling;
+      }
+    }
+
+    // If the topmost node on the path was split, it has been the root
+    if(new_child != NULL){
+      InnerNode* root = NewInner(AllocateNode(INNER_NODE_SIZE),
+                                 path[0]->level+1);
+      Node* children[2] = {path[0], new_child};
+      LayoutInner(root, &separator, children, 1, "", 0);
+      __sync_synchronize();
+      root_ = root;
+    }
+
+    for(int level = modified; (level >= 0) && (level < depth-1); level++)
+      EndModification(path[level]->version);
+  }
+
+  for(int i = 0; i < depth; i++)
+    path[i]->latch.UnlockExclusive();
+}
+
+// Split the given full leaf while inserting the given entry
+//
+// The leaf is the only node that is latched. The new right sibling gets its
+// fence and its entries before it is linked into the leaf chain, so every
+// search that reaches the leaf afterwards finds the sibling. The sibling is
+// added to the radix tree after the latch has been released. If that fails,
+// the sibling is still found by following the chain, so the error is ignored.
+void BTree::SplitLeaf(LeafNode *leaf, Entry *entry){
+  LeafNode* right;
+  Separator* fence;
+  int pos = LowerBound(leaf, entry->key(), entry->key_size, entry->id);
+  Entry* all[LEAF_CAPACITY+1];
+  memcpy(all, leaf->entries, pos*sizeof(Entry*));
+  all[pos] = entry;
+  memcpy(all+pos+1, leaf->entries+pos, (LEAF_CAPACITY-pos)*sizeof(Entry*));
+  int left_count = (LEAF_CAPACITY+1)/2;
+  int right_count = LEAF_CAPACITY+1-left_count;
+
+  try{
+    right = NewLeaf(AllocateNode());
+    try{
+      fence = NewSeparator(all[left_count-1], all[left_count]);
+    } catch(...){
+      free(right);
+      throw;
+    }
+  } catch(...){
+    leaf->latch.UnlockExclusive();
+    throw;
+  }
+
+  right->low = fence;
+  right->count = right_count;
+  memcpy(right->entries, all+left_count, right_count*sizeof(Entry*));
+  right->next = leaf->next;
+  __sync_synchronize();
+  leaf->next = right;
+  memcpy(leaf->entries, all, left_count*sizeof(Entry*));
+  leaf->count = left_count;
+  leaf->version++;
+  __sync_fetch_and_add(&leaf_count_, 1);
+  leaf->latch.UnlockExclusive();
+
+  char key[RADIX_MAX_KEY_SIZE + sizeof(uint64_t)];
+  RadixKey(fence->key(), fence->key_size, fence->id, key);
+  try{
+    radix_->Insert(key, right);
+  } catch(std::bad_alloc&){
+  }
+}
+
+// Latch the root node
+//
+// The root is latched exclusively if it is a leaf and exclusive_leaf is set or
+// if it is an inner node and exclusive_inner is set.
+Node* BTree::LatchRoot(bool exclusive_leaf, bool exclusive_inner){
+  while(true){
+    Node* root = root_;
+    bool exclusive = (root->level == 0) ? exclusive_leaf : exclusive_inner;
+    if(exclusive)
+      root->latch.LockExclusive();
+    else
+      root->latch.LockShared();
+
+    // Make sure that the root has not been split in the meantime
+    if(root == root_)
+      return root;
+
+    Unlatch(root, exclusive);
+  }
+}
+
+// Descend to the leaf that is responsible for the given key/id combination
+//
+// The inner nodes are read without latching them (optimistic lock coupling).
+// Before a node is used, its version is read, and it is validated after the
+// next node has been reached. If a writer is modifying a node (odd version)
+// or has modified it in the meantime, the descent starts over. Inner nodes
+// and separators are never freed while the tree is in use, so reading a node
+// that is being modified is safe; the result is simply discarded (see
+// ChildPosition() for the separators that are allocated separately).
+//
+// The leaf is latched before its parent is validated. As a writer splitting
+// the leaf holds its latch until the parent has been updated, a validated
+// parent guarantees that the leaf is still responsible for the key.
+LeafNode* BTree::FindLeaf(const char* key, size_t key_size, uint64_t id,
+                          bool exclusive){
+  if(radix_ != NULL)
+    return FindLeafRadix(key, key_size, id, exclusive);
+
+  unsigned int spins = 0;
+  while(true){
+    Node* node = root_;
+    if(node->level == 0){
+      // Make sure that the root has not been split in the meantime
+      if(exclusive)
+        node->latch.LockExclusive();
+      else
+        node->latch.LockShared();
+      if(node == root_)
+        return static_cast<LeafNode*>(node);
+      Unlatch(node, exclusive);
+      continue;
+    }
+
+    // A root that is split stays marked as modified until the new root has
+    // been published
+    uint32_t version = node->version;
+    ReadBarrier();
+    if((version & 1) || (node != root_)){
+      LatchBackoff(spins);
+      continue;
+    }
+
+    while(true){
+      InnerNode* inner = static_cast<InnerNode*>(node);
+      int position = ChildPosition(inner, key, key_size, id, &version);
+      Node* child = inner->children[position];
+      ReadBarrier();
+
+      if(child->level == 0){
+        if(exclusive)
+          child->latch.LockExclusive();
+        else
+          child->latch.LockShared();
+        ReadBarrier();
+        if(inner->version == version)
+          return static_cast<LeafNode*>(child);
+        Unlatch(child, exclusive);
+        break;
+      }
+
+      uint32_t child_version = child->version;
+      ReadBarrier();
+      if((child_version & 1) || (inner->version != version))
+        break;
+      node = child;
+      version = child_version;
+    }
+    LatchBackoff(spins);
+  }
+}
+
+// Find the leaf responsible for the given key/id combination using the radix
+// tree
+//
+// The radix tree returns the leaf with the greatest fence not greater than
+// the key/id combination. As fences never change, the responsible leaf is
+// either this leaf or one of its successors that have not been added to the
+// radix tree yet. The chain is followed by latching the next leaf before the
+// latch of the current one is released (like a cursor does).
+LeafNode* BTree::FindLeafRadix(const char* key, size_t key_size, uint64_t id,
+                               bool exclusive){
+  char radix_key[RADIX_MAX_KEY_SIZE + sizeof(uint64_t)];
+  RadixKey(key, key_size, id, radix_key);
+  // A padded key may be greater than the original key, so the fence has to be
+  // smaller than the padded key
+  bool padded = (key_size + sizeof(uint64_t) < radix_key_size_);
+  LeafNode* leaf = radix_->FindLess(radix_key, !padded);
+  if(leaf == NULL)
+    leaf = static_cast<LeafNode*>(root_);
+
+  if(exclusive)
+    leaf->latch.LockExclusive();
+  else
+    leaf->latch.LockShared();
+  while(true){
+    LeafNode* next = static_cast<LeafNode*>(leaf->next);
+    if((next == NULL) || (Compare(key, key_size, id, next->low) < 0))
+      return leaf;
+    if(exclusive)
+      next->latch.LockExclusive();
+    else
+      next->latch.LockShared();
+    Unlatch(leaf, exclusive);
+    leaf = next;
+  }
+}
+
+// Encode the given key/id combination as a key of the radix tree
+//
+// Encoded SHORT and INT attributes already compare like their values using
+// memcmp, so only the id has to be appended in big-endian byte order. Keys
+// longer than the keys of the index (e.g. skip-scan targets) are greater than
+// every key starting with the same bytes, so they are truncated and combined
+// with the greatest id.
+void BTree::RadixKey(const char* key, size_t key_size, uint64_t id,
+                     char *buffer) const{
+  size_t size = radix_key_size_ - sizeof(uint64_t);
+  if(key_size > size){
+    key_size = size;
+    id = UINT64_MAX;
+  }
+  memcpy(buffer, key, key_size);
+  memset(buffer + key_size, 0, size - key_size);
+  uint64_t value = CodecSwap64(id);
+  memcpy(buffer + size, &value, sizeof(value));
+}
+
+// Return the position of the child responsible for the given key/id
+// combination (i.e. the number of separators <= key/id)
+//
+// The key is compared with the prefix of the node once. Unless it starts with
+// the prefix, this decides the comparison with every separator stored inside
+// the node. Otherwise, only the remaining bytes are compared.
+//
+// A node that is read without a latch may be modified at the same time, so
+// the sizes and offsets read from it are checked before they are used, and a
+// pointer to a separately allocated separator is only followed after the
+// version of the node has been validated. If the node has changed, 0 is
+// returned (the caller validates the node again anyway).
+int BTree::ChildPosition(InnerNode *node, const char* key, size_t key_size,
+                         uint64_t id, const uint32_t *version) const{
+  int count = std::min((int) node->count, INNER_CAPACITY);
+  size_t prefix_size = std::min((size_t) node->prefix_size,
+                                (size_t) INNER_MAX_PREFIX);
+  int order = memcmp(key, node->data, std::min(key_size, prefix_size));
+  if((order == 0) && (key_size < prefix_size))
+    order = -1;
+  const char* suffix = key + prefix_size;
+  size_t suffix_size = key_size - prefix_size;
+
+  int low = 0, high = count;
+  while(low < high){
+    int mid = (low+high)/2;
+    InnerSlot slot = node->slots[mid];
+    size_t size = slot.size & INNER_SLOT_SIZE_MASK;
+    size_t end = slot.offset + size
+                 + ((slot.size & INNER_SLOT_ID) ? sizeof(uint64_t) : 0);
+    if(end > INNER_DATA_SIZE)
+      return 0;
+    const char* data = node->data + slot.offset;
+
+    int result;
+    if(slot.size & INNER_SLOT_SEPARATE){
+      Separator* separator;
+      memcpy(&separator, data, sizeof(separator));
+      ReadBarrier();
+      if((version != NULL) && (node->version != *version))
+        return 0;
+      result = Compare(key, key_size, id, separator);
+    } else if(order != 0){
+      result = order;
+    } else {
+      result = KeyCmp(suffix, suffix_size, data, size);
+      if(result == 0){
+        uint64_t separator_id = 0;
+        if(slot.size & INNER_SLOT_ID)
+          memcpy(&separator_id, data + size, sizeof(separator_id));
+        result = (id < separator_id) ? -1 : ((id > separator_id) ? 1 : 0);
+      }
+    }
+
+    if(result >= 0)
+      low = mid+1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+// Return the position of the first entry >= key/id inside the given leaf
+int BTree::LowerBound(LeafNode *leaf, const char* key, size_t key_size,
+                      uint64_t id) const{
+  int low = 0, high = leaf->count;
+  while(low < high){
+    int mid = (low+high)/2;
+    if(Compare(key, key_size, id, leaf->entries[mid]) > 0)
+      low = mid+1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+// Return the position of the first entry > key/id inside the given leaf
+int BTree::UpperBound(LeafNode *leaf, const char* key, size_t key_size,
+                      uint64_t id) const{
+  int low = 0, high = leaf->count;
+  while(low < high){
+    int mid = (low+high)/2;
+    if(Compare(key, key_size, id, leaf->entries[mid]) >= 0)
+      low = mid+1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+// Return a separator key between the given adjacent entries
+//
+// A separator only has to be greater than left and not greater than right.
+// If the keys of both entries differ, the shortest prefix of the key of right
+// that differs from the key of left (combined with id 0) is used, so that long
+// keys sharing a prefix (e.g. strings) do not have to be copied completely.
+// Otherwise, the key and the id of right are used.
+SeparatorKey BTree::SeparatorBetween(const Entry *left, const Entry *right){
+  SeparatorKey separator;
+  separator.key = right->key();
+  separator.key_size = right->key_size;
+  separator.id = right->id;
+  separator.separator = NULL;
+
+  size_t size = std::min(left->key_size, right->key_size);
+  const char *a = left->key();
+  const char *b = right->key();
+  size_t common = 0;
+  while((common < size) && (a[common] == b[common]))
+    common++;
+  if((common < size) || (left->key_size != right->key_size)){
+    separator.key_size = common + 1;
+    separator.id = 0;
+  }
+  return separator;
+}
+
+// Create a separator between the given adjacent entries
+Separator* BTree::NewSeparator(const Entry *left, const Entry *right){
+  return AllocateSeparator(SeparatorBetween(left, right));
+}
+
+// Allocate a separator holding the given key
+Separator* BTree::AllocateSeparator(const SeparatorKey &key){
+  Separator* separator = (Separator*) malloc(sizeof(Separator) + key.key_size);
+  if(separator == NULL)
+    throw std::bad_alloc();
+  CountAllocation();
+  separator->id = key.id;
+  separator->key_size = key.key_size;
+  memcpy(separator->key(), key.key, key.key_size);
+  return separator;
+}
+
+// Return whether the given separator key can be added to the given inner node
+//
+// The prefix of the node is kept, so the other separators do not change.
+bool BTree::SeparatorFits(const InnerNode *node, const SeparatorKey &key){
+  if(node->count >= INNER_CAPACITY)
+    return false;
+  return node->used + SeparatorSize(key, node->data, node->prefix_size)
+         <= INNER_DATA_SIZE;
+}
+
+// Add the given separator key and the child following it to the given node
+//
+// The separator is appended to the data of the node. If it does not start
+// with the prefix of the node (or is too long), it is allocated separately.
+// Every slot below the count of the node always holds a valid separator and
+// child, so a reader never uses a slot that has not been initialized.
+void BTree::AddSeparator(InnerNode *node, int position, const SeparatorKey &key,
+                         Node *child){
+  InnerSlot slot;
+  slot.offset = node->used;
+  char* data = node->data + slot.offset;
+  if(StoredInline(key, node->data, node->prefix_size)){
+    size_t size = key.key_size - node->prefix_size;
+    memcpy(data, key.key + node->prefix_size, size);
+    slot.size = size;
+    if(key.id != 0){
+      memcpy(data + size, &key.id, sizeof(key.id));
+      slot.size |= INNER_SLOT_ID;
+      size += sizeof(key.id);
+    }
+    node->used += size;
+  } else {
+    Separator* separator = key.separator;
+    if(separator == NULL)
+      separator = AllocateSeparator(key);
+    memcpy(data, &separator, sizeof(separator));
+    slot.size = INNER_SLOT_SEPARATE | sizeof(separator);
+    node->used += sizeof(separator);
+  }
+
+  memmove(&node->slots[position+1], &node->slots[position],
+          (node->count-position)*sizeof(InnerSlot));
+  memmove(&node->children[position+2], &node->children[position+1],
+          (node->count-position)*sizeof(Node*));
+  node->slots[position] = slot;
+  node->children[position+1] = child;
+  __sync_synchronize();
+  node->count++;
+}
+
+// Read the separator keys of the given inner node
+//
+// The keys stored inside the node (prefix and remaining bytes) are copied into
+// the given buffer (holding at least SEPARATOR_BUFFER_SIZE bytes), the other
+// ones point to their separators.
+int BTree::ReadSeparators(const InnerNode *node, SeparatorKey *keys,
+                          char *buffer){
+  for(int i = 0; i < node->count; i++){
+    InnerSlot slot = node->slots[i];
+    const char* data = node->data + slot.offset;
+    if(slot.size & INNER_SLOT_SEPARATE){
+      Separator* separator;
+      memcpy(&separator, data, sizeof(separator));
+      keys[i].key = separator->key();
+      keys[i].key_size = separator->key_size;
+      keys[i].id = separator->id;
+      keys[i].separator = separator;
+      continue;
+    }
+
+    size_t size = slot.size & INNER_SLOT_SIZE_MASK;
+    memcpy(buffer, node->data, node->prefix_size);
+    memcpy(buffer + node->prefix_size, data, size);
+    keys[i].key = buffer;
+    keys[i].key_size = node->prefix_size + size;
+    keys[i].id = 0;
+    if(slot.size & INNER_SLOT_ID)
+      memcpy(&keys[i].id, data + size, sizeof(keys[i].id));
+    keys[i].separator = NULL;
+    buffer += keys[i].key_size;
+  }
+  return node->count;
+}
+
+// Write the given separator keys and children into the given inner node
+//
+// The keys must not point into the node itself. The separators that are not
+// stored inside the node are allocated before the node is changed.
+bool BTree::LayoutInner(InnerNode *node, const SeparatorKey *keys,
+                        Node* const* children, int count, const char *base,
+                        size_t base_size){
+  const char* prefix;
+  size_t prefix_size;
+  if((count > INNER_CAPACITY)
+     || (ChoosePrefix(keys, count, base, base_size, &prefix, &prefix_size)
+         > INNER_DATA_SIZE))
+    return false;
+
+  Separator* separate[INNER_CAPACITY];
+  int i = 0;
+  try{
+    for(; i < count; i++){
+      separate[i] = keys[i].separator;
+      if((separate[i] == NULL) && !StoredInline(keys[i], prefix, prefix_size))
+        separate[i] = AllocateSeparator(keys[i]);
+    }
+  } catch(...){
+    while(i-- > 0){
+      if(keys[i].separator == NULL)
+        free(separate[i]);
+    }
+    throw;
+  }
+
+  memcpy(node->data, prefix, prefix_size);
+  size_t offset = prefix_size;
+  for(i = 0; i < count; i++){
+    InnerSlot &slot = node->slots[i];
+    slot.offset = offset;
+    if(separate[i] != NULL){
+      memcpy(node->data + offset, &separate[i], sizeof(Separator*));
+      slot.size = INNER_SLOT_SEPARATE | sizeof(Separator*);
+      offset += sizeof(Separator*);
+      continue;
+    }
+
+    size_t size = keys[i].key_size - prefix_size;
+    memcpy(node->data + offset, keys[i].key + prefix_size, size);
+    slot.size = size;
+    offset += size;
+    if(keys[i].id != 0){
+      memcpy(node->data + offset, &keys[i].id, sizeof(keys[i].id));
+      slot.size |= INNER_SLOT_ID;
+      offset += sizeof(keys[i].id);
+    }
+  }
+  memcpy(node->children, children, (count+1)*sizeof(Node*));
+  node->prefix_size = prefix_size;
+  node->used = offset;
+  node->count = count;
+  return true;
+}
+
+// Split the given full inner node while adding a separator key
+//
+// The separator moved upwards is chosen such that both halves take up about
+// the same number of bytes. Each half chooses a prefix of its own, which
+// starts with the prefix of the split node, so the separators stored inside
+// the node only get shorter. Half of the bytes of a full node plus a prefix
+// and the added separator always fit into a node (see inner_data_check), so
+// the halves never have to be split again.
+SeparatorKey BTree::SplitInner(InnerNode *node, InnerNode *sibling,
+                               int position, const SeparatorKey &key,
+                               Node *child, char *carry){
+  SeparatorKey keys[INNER_CAPACITY+1];
+  Node* children[INNER_CAPACITY+2];
+  char buffer[SEPARATOR_BUFFER_SIZE];
+  char prefix[INNER_MAX_PREFIX];
+  size_t prefix_size = node->prefix_size;
+  memcpy(prefix, node->data, prefix_size);
+
+  int count = ReadSeparators(node, keys, buffer);
+  memmove(keys+position+1, keys+position, (count-position)*sizeof(SeparatorKey));
+  keys[position] = key;
+  memcpy(children, node->children, (position+1)*sizeof(Node*));
+  children[position+1] = child;
+  memcpy(children+position+2, node->children+position+1,
+         (count-position)*sizeof(Node*));
+  count++;
+
+  size_t total = 0;
+  for(int i = 0; i < count; i++)
+    total += SeparatorSize(keys[i], prefix, prefix_size);
+  int middle = 0;
+  size_t lower = 0;
+  while((middle < count-1)
+        && (2*(lower + SeparatorSize(keys[middle], prefix, prefix_size))
+            < total)){
+    lower += SeparatorSize(keys[middle], prefix, prefix_size);
+    middle++;
+  }
+  middle = std::max(1, std::min(middle, count-2));
+
+  SeparatorKey separator = keys[middle];
+  if(separator.separator == NULL){
+    if(separator.key_size <= INNER_MAX_PREFIX + INNER_MAX_SUFFIX){
+      memcpy(carry, separator.key, separator.key_size);
+      separator.key = carry;
+    } else {
+      separator.separator = AllocateSeparator(separator);
+      separator.key = separator.separator->key();
+    }
+  }
+
+  LayoutInner(sibling, keys+middle+1, children+middle+1, count-middle-1,
+              prefix, prefix_size);
+  LayoutInner(node, keys, children, middle, prefix, prefix_size);
+  return separator;
+}
+
+// Return the number of leaves below the given node
+size_t BTree::LeafCount(const Node *node){
+  if(node->level == 0)
+    return 1;
+
+  const InnerNode* inner = static_cast<const InnerNode*>(node);
+  if(node->level == 1)
+    return inner->count + 1;
+
+  size_t leaves = 0;
+  for(int i = 0; i <= inner->count; i++)
+    leaves += LeafCount(inner->children[i]);
+  return leaves;
+}
+
+// Add the number of entries and the memory used by the tree to the counters
+//
+// The nodes are latched in shared mode top-down, like a reader does.
+//
+// If the tree uses a radix tree, the leaf chain is read like a cursor does.
+void BTree::CountMemory(uint64_t *records, uint64_t *bytes){
+  if(radix_ == NULL){
+    CountMemory(LatchRoot(false, false), records, bytes);
+    return;
+  }
+
+  *bytes += radix_->MemoryUsage();
+  Node* leaf = root_;
+  leaf->latch.LockShared();
+  while(leaf != NULL){
+    Separator* fence = static_cast<LeafNode*>(leaf)->low;
+    if(fence != NULL)
+      *bytes += sizeof(Separator) + fence->key_size;
+    Node* next = leaf->next;
+    if(next != NULL)
+      next->latch.LockShared();
+    // Count the leaf and release its latch
+    CountMemory(leaf, records, bytes);
+    leaf = next;
+  }
+}
+
+// Count the memory used by the given node and everything below it
+//
+// As the node stays latched while its children are visited, none of them can
+// be split in the meantime.
+void BTree::CountMemory(Node *node, uint64_t *records, uint64_t *bytes){
+  *bytes += (node->level == 0) ? NODE_SIZE : INNER_NODE_SIZE;
+  if(node->level == 0){
+    LeafNode* leaf = static_cast<LeafNode*>(node);
+    for(int i = 0; i < leaf->count; i++){
+      const Entry* entry = leaf->entries[i];
+      *records += 1;
+      *bytes += sizeof(Entry) + entry->key_size + entry->payload_size;
+    }
+  } else {
+    InnerNode* inner = static_cast<InnerNode*>(node);
+    for(int i = 0; i < inner->count; i++){
+      if(inner->slots[i].size & INNER_SLOT_SEPARATE){
+        Separator* separator;
+        memcpy(&separator, inner->data + inner->slots[i].offset,
+               sizeof(separator));
+        *bytes += sizeof(Separator) + separator->key_size;
+      }
+    }
+    for(int i = 0; i <= inner->count; i++){
+      inner->children[i]->latch.LockShared();
+      CountMemory(inner->children[i], records, bytes);
+    }
+  }
+  node->latch.UnlockShared();
+}
+
+// Add the addresses of the leaves and their first entries to the given vector
+//
+// The first leaf is found by latching the leftmost path top-down, and the leaf
+// chain is read like a cursor does.
+void BTree::SamplePages(std::vector<void*> *pages){
+  Node* node = LatchRoot(false, false);
+  while(node->level > 0){
+    Node* child = static_cast<InnerNode*>(node)->children[0];
+    child->latch.LockShared();
+    node->latch.UnlockShared();
+    node = child;
+  }
+
+  while(node != NULL){
+    LeafNode* leaf = static_cast<LeafNode*>(node);
+    try{
+      pages->push_back(leaf);
+      if(leaf->count > 0)
+        pages->push_back(leaf->entries[0]);
+    } catch(...){
+      leaf->latch.UnlockShared();
+      throw;
+    }
+    node = leaf->next;
+    if(node != NULL)
+      node->latch.LockShared();
+    leaf->latch.UnlockShared();
+  }
+}
+
+// Build a tree bottom-up from the given sorted entries and return its root
+//
+// All leaves are filled completely (except for the last one), inner nodes
+// take as many children as their separators fit into. If an allocation fails,
+// all nodes created so far are freed again.
+Node* BTree::Build(Entry **entries, size_t count){
+  std::vector<Node*> nodes;
+  // The position of the first entry below each node
+  std::vector<size_t> first;
+  size_t leaves = (count + LEAF_CAPACITY - 1) / LEAF_CAPACITY;
+  nodes.reserve(std::max(leaves, (size_t) 1));
+  first.reserve(std::max(leaves, (size_t) 1));
+
+  // Create the leaves
+  try{
+    LeafNode* previous = NULL;
+    for(size_t i = 0; (i < count) || nodes.empty(); i += LEAF_CAPACITY){
+      LeafNode* leaf = NewLeaf(AllocateNode());
+      leaf->count = std::min(count - i, (size_t) LEAF_CAPACITY);
+      memcpy(leaf->entries, entries + i, leaf->count*sizeof(Entry*));
+      if(previous != NULL)
+        previous->next = leaf;
+      previous = leaf;
+      nodes.push_back(leaf);
+      first.push_back(i);
+    }
+  }catch(std::bad_alloc&){
+    for(size_t i = 0; i < nodes.size(); i++)
+      free(nodes[i]);
+    throw;
+  }
+
+  // Create the inner nodes level by level
+  for(uint16_t level = 1; nodes.size() > 1; level++){
+    std::vector<Node*> parents;
+    std::vector<size_t> parent_first;
+    // The number of nodes that already got a parent
+    size_t adopted = 0;
+    try{
+      parents.reserve(nodes.size() / (INNER_CAPACITY+1) + 1);
+      parent_first.reserve(nodes.size() / (INNER_CAPACITY+1) + 1);
+      for(size_t i = 0; i < nodes.size();){
+        InnerNode* inner = NewInner(AllocateNode(INNER_NODE_SIZE), level);
+        inner->children[0] = nodes[i];
+        parents.push_back(inner);
+        parent_first.push_back(first[i]);
+        adopted++;
+
+        // Take as many children as the separators between them fit into
+        SeparatorKey keys[INNER_CAPACITY];
+        size_t children = std::min(nodes.size() - i, (size_t) INNER_CAPACITY+1);
+        for(size_t j = 1; j < children; j++)
+          keys[j-1] = SeparatorBetween(entries[first[i+j]-1],
+                                       entries[first[i+j]]);
+        while(!LayoutInner(inner, keys, &nodes[i], children-1, "", 0))
+          children--;
+        adopted += children-1;
+        i += children;
+      }
+    }catch(std::bad_alloc&){
+      for(size_t i = 0; i < parents.size(); i++)
+        FreeNode(parents[i], false);
+      for(size_t i = adopted; i < nodes.size(); i++)
+        FreeNode(nodes[i], false);
+      throw;
+    }
+    nodes.swap(parents);
+    first.swap(parent_first);
+  }
+
+  return nodes[0];
+}
+
+// Build a leaf chain from the given sorted entries
+//
+// All leaves are filled completely (except for the last one). If an
+// allocation fails, all leaves and fences created so far are freed again and
+// the radix tree has to be discarded by the caller.
+LeafNode* BTree::BuildLeaves(Entry **entries, size_t count, RadixTree *radix){
+  LeafNode* first = NULL;
+  LeafNode* previous = NULL;
+  char key[RADIX_MAX_KEY_SIZE + sizeof(uint64_t)];
+  try{
+    for(size_t i = 0; (i < count) || (first == NULL); i += LEAF_CAPACITY){
+      LeafNode* leaf = NewLeaf(AllocateNode());
+      leaf->count = std::min(count - i, (size_t) LEAF_CAPACITY);
+      memcpy(leaf->entries, entries + i, leaf->count*sizeof(Entry*));
+      if(previous != NULL)
+        previous->next = leaf;
+      else
+        first = leaf;
+      previous = leaf;
+
+      if(i > 0){
+        leaf->low = NewSeparator(entries[i-1], entries[i]);
+        RadixKey(leaf->low->key(), leaf->low->key_size, leaf->low->id, key);
+        radix->Insert(key, leaf);
+      }
+    }
+  }catch(std::bad_alloc&){
+    if(first != NULL)
+      FreeLeaves(first, false);
+    throw;
+  }
+  return first;
+}
+
+// Free the given leaf and all its successors
+void BTree::FreeLeaves(Node *leaf, bool free_entries){
+  while(leaf != NULL){
+    Node* next = leaf->next;
+    free(static_cast<LeafNode*>(leaf)->low);
+    FreeNode(leaf, free_entries);
+    leaf = next;
+  }
+}
+
+// Allocate a new, cache line aligned node
+void* BTree::AllocateNode(size_t size){
+  void* memory;
+  if(posix_memalign(&memory, CACHE_LINE_SIZE, size) != 0)
+    throw std::bad_alloc();
+  CountAllocation();
+  return memory;
+}
+
+// Free the given node and everything below it
+void BTree::FreeNode(Node *node, bool free_entries){
+  if(node->level > 0){
+    InnerNode* inner = static_cast<InnerNode*>(node);
+    for(int i = 0; i < inner->count; i++){
+      if(inner->slots[i].size & INNER_SLOT_SEPARATE){
+        Separator* separator;
+        memcpy(&separator, inner->data + inner->slots[i].offset,
+               sizeof(separator));
+        free(separator);
+      }
+    }
+    for(int i = 0; i <= inner->count; i++)
+      FreeNode(inner->children[i], free_entries);
+  } else if(free_entries){
+    LeafNode* leaf = static_cast<LeafNode*>(node);
+    for(int i = 0; i < leaf->count; i++)
+      FreeEntry(leaf->entries[i]);
+  }
+  free(node);
+}
+
+// Constructor for BTreeCursor
+BTreeCursor::BTreeCursor(BTree *tree){
+  tree_ = tree;
+  leaf_ = NULL;
+  slot_ = 0;
+  version_ = 0;
+  latched_ = false;
+}
+
+// Destructor for BTreeCursor
+BTreeCursor::~BTreeCursor(){
+  Release();
+}
+
+// Position the cursor on the first entry >= key/id
+void BTreeCursor::Seek(const char* key, size_t key_size, uint64_t id){
+  Release();
+
+  leaf_ = tree_->FindLeaf(key, key_size, id, false);
+  latched_ = true;
+  version_ = leaf_->version;
+  slot_ = tree_->LowerBound(leaf_, key, key_size, id);
+  SkipToValid();
+}
+
+// Position the cursor on the first entry following the given key/id
+// combination
+//
+// If the leaf has not been modified since the cursor released it, the cursor
+// simply moves to the next slot. Otherwise, it searches the leaf again.
+// As entries only move to the right when a leaf is split, all entries following
+// the given key are either inside the current leaf or one of its successors.
+// If the leaf holds no greater entry, the given key may have moved into a
+// successor together with smaller entries, so the cursor seeks from the root.
+void BTreeCursor::SeekAfter(const char* key, size_t key_size, uint64_t id){
+  if(leaf_ == NULL)
+    return;
+
+  if(!latched_){
+    leaf_->latch.LockShared();
+    latched_ = true;
+  }
+
+  if(leaf_->version == version_){
+    slot_++;
+  } else {
+    version_ = leaf_->version;
+    slot_ = tree_->UpperBound(leaf_, key, key_size, id);
+    if(slot_ >= leaf_->count){
+      Seek(key, key_size, id + 1);
+      return;
+    }
+  }
+  SkipToValid();
+}
+
+// Move the cursor forward to the first entry >= key/id
+//
+// If the target is not greater than the last entry of the current leaf, the
+// entry has to be inside this leaf. Otherwise the cursor seeks from the root.
+void BTreeCursor::SeekForward(const char* key, size_t key_size, uint64_t id){
+  if(leaf_ == NULL)
+    return;
+
+  if(latched_ && (leaf_->count > 0)
+     && (tree_->Compare(key, key_size, id, leaf_->entries[leaf_->count-1]) <= 0)){
+    slot_ = tree_->LowerBound(leaf_, key, key_size, id);
+    return;
+  }
+
+  Seek(key, key_size, id);
+}
+
+// Re-latch the current leaf and move the cursor to the first entry >= key/id
+//
+// As entries only move to the right, the entry is either inside the current
+// leaf or found by seeking from the root.
+void BTreeCursor::Resume(const char* key, size_t key_size, uint64_t id){
+  if(leaf_ == NULL)
+    return;
+
+  if(!latched_){
+    leaf_->latch.LockShared();
+    latched_ = true;
+    version_ = leaf_->version;
+  }
+  SeekForward(key, key_size, id);
+}
+
+// Move the cursor to the next entry
+bool BTreeCursor::Next(){
+  if(leaf_ == NULL)
+    return false;
+
+  slot_++;
+  SkipToValid();
+  return valid();
+}
+
+// Release the latch of the current leaf
+void BTreeCursor::Release(){
+  if(latched_){
+    leaf_->latch.UnlockShared();
+    latched_ = false;
+  }
+}
+
+// Skip empty leaves (and the end of the current leaf)
+//
+// The next leaf is latched before the latch of the current leaf is released.
+// If the end of the tree has been reached, the cursor becomes invalid.
+void BTreeCursor::SkipToValid(){
+  while(slot_ >= leaf_->count){
+    LeafNode* next = static_cast<LeafNode*>(leaf_->next);
+    if(next == NULL){
+      Release();
+      leaf_ = NULL;
+      return;
+    }
+    next->latch.LockShared();
+    leaf_->latch.UnlockShared();
+    leaf_ = next;
+    version_ = leaf_->version;
+    slot_ = 0;
+  }
+}
@@ -0,0 +1,489 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+/** @file
+ A concurrent in-memory B+-tree.
+
+ The tree stores pointers to entries ordered by (key, id). Nodes have a fixed
+ size of a few cache lines and are protected by reader/writer latches. Only
+ writers latch inner nodes: descending to a leaf uses optimistic lock coupling,
+ which reads the version of every inner node before and after using it and
+ starts over if a writer has modified the node in the meantime. Only the leaf
+ itself is latched (shared by readers, exclusively by writers), so readers do
+ not write to the cache lines of the root and the upper levels. Inserts first
+ try to change the leaf alone and only latch the whole path exclusively if the
+ leaf has to be split.
+
+ Nodes are never merged or freed while the tree exists: a leaf that became
+ empty simply stays in the leaf chain. This keeps deletions cheap and allows
+ cursors to keep a pointer to their current leaf between calls.
+
+ Inner nodes store their separator keys themselves. The prefix shared by all
+ separators of a node is stored only once, followed by the remaining bytes of
+ every separator, so long keys sharing a prefix (e.g. strings) take up only a
+ few bytes per separator and a descent does not have to follow a pointer for
+ every comparison. Separators that do not fit (or that do not share the prefix
+ of the node they are added to) are allocated separately. The prefix of a node
+ is only chosen when the node is written as a whole (when it is built or
+ split), so adding a separator never changes the other separators.
+
+ If all attributes of the keys are SHORT or INT (see IndexSchema::radix()),
+ the tree has no inner nodes. Instead, every leaf but the first one stores
+ the smallest key/id combination it is responsible for (its fence), and an
+ adaptive radix tree maps the byte-comparable fences to the leaves (see
+ radix_tree.h). Finding a leaf then costs one step per key byte instead of a
+ comparison per level. A leaf is split while only the leaf itself is latched:
+ the new right sibling is linked into the leaf chain first and added to the
+ radix tree afterwards, so a search that finds a leaf left of the responsible
+ one simply follows the chain to the right (as in a B-link tree).
+*/
+
+#ifndef _NATIVEIMPL_BTREE_H_
+#define _NATIVEIMPL_BTREE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include <common/macros.h>
+
+#include "entry.h"
+#include "latch.h"
+#include "util.h"
+
+class IndexSchema;
+class RadixTree;
+
+// The size of a cache line in bytes
+#define CACHE_LINE_SIZE 64
+
+// The size of a tree node in bytes (a small multiple of the cache line size)
+#define NODE_SIZE (4 * CACHE_LINE_SIZE)
+
+// The header shared by leaf and inner nodes
+struct Node{
+  // The latch protecting the node
+  Latch latch;
+
+  // The number of entries (leaf) or separator keys (inner node)
+  uint16_t count;
+
+  // The level of the node inside the tree (0 for leaves, never changes)
+  uint16_t level;
+
+  // A counter that is incremented on every modification of a leaf
+  //
+  // The version of an inner node is odd while a writer modifies the node.
+  volatile uint32_t version;
+
+  // The right sibling of a leaf (NULL for the last leaf and inner nodes)
+  Node* next;
+};
+
+// The number of entries that fit into a leaf node
+#define LEAF_CAPACITY \
+  ((NODE_SIZE - sizeof(Node) - sizeof(void*)) / sizeof(Entry*))
+
+// The maximum size of the keys of a tree using a radix tree (see
+// IndexSchema::radix())
+#define RADIX_MAX_KEY_SIZE 64
+
+// A separator key stored inside an inner node (or the fence of a leaf)
+struct Separator{
+  // The id of the entry the separator was copied from
+  uint64_t id;
+
+  // The size of the key in bytes
+  uint32_t key_size;
+
+  // Return the key of the separator
+  char* key(){ return reinterpret_cast<char*>(this + 1); };
+};
+
+// A separator key that is about to be stored inside an inner node
+//
+// The key is either part of an entry, of a buffer or of a separator that is
+// allocated separately (which is then stored as it is).
+struct SeparatorKey{
+  // The key and its size in bytes
+  const char* key;
+  uint32_t key_size;
+
+  // The id of the entry the separator was copied from
+  uint64_t id;
+
+  // The separately allocated separator holding the key (or NULL)
+  Separator* separator;
+};
+
+// The size of an inner node in bytes
+#define INNER_NODE_SIZE (2 * NODE_SIZE)
+
+// The maximum number of separator keys of an inner node
+#define INNER_CAPACITY 20
+
+// The maximum size of the prefix shared by the separators of an inner node
+#define INNER_MAX_PREFIX 64
+
+// The maximum size of a separator stored inside an inner node (not counting
+// the prefix), longer separators are allocated separately
+#define INNER_MAX_SUFFIX 24
+
+// The flags stored in the size of an inner node slot: the separator is
+// followed by its id (which is 0 otherwise), or the slot holds a pointer to a
+// separately allocated separator
+#define INNER_SLOT_ID 0x8000
+#define INNER_SLOT_SEPARATE 0x4000
+#define INNER_SLOT_SIZE_MASK 0x3FFF
+
+// The position of a separator inside the data of an inner node
+struct InnerSlot{
+  // The offset of the separator inside the data
+  uint16_t offset;
+
+  // The size of the separator (without the prefix) and the flags
+  uint16_t size;
+};
+
+// The number of bytes of an inner node holding the prefix and the separators
+#define INNER_DATA_SIZE \
+  (INNER_NODE_SIZE - sizeof(Node) - (INNER_CAPACITY + 1) * sizeof(Node*) \
+   - INNER_CAPACITY * sizeof(InnerSlot) - 2 * sizeof(uint16_t))
+
+// The maximum number of bytes a separator takes up inside an inner node
+#define INNER_MAX_SEPARATOR_SIZE (INNER_MAX_SUFFIX + sizeof(uint64_t))
+
+// A leaf node
+struct LeafNode: public Node{
+  // The smallest key/id combination the leaf is responsible for (only set if
+  // the tree uses a radix tree, NULL for the first leaf, never changes)
+  Separator* low;
+
+  // The entries stored inside the leaf (sorted by key and id)
+  Entry* entries[LEAF_CAPACITY];
+};
+
+// An inner node
+//
+// children[i] holds all entries e with keys[i-1] <= e < keys[i], where the
+// separator key keys[i] is described by slots[i]. The data starts with the
+// prefix shared by all separators that are stored inside the node, followed by
+// the remaining bytes of every separator (and its id, if it is not 0) or a
+// pointer to a separately allocated separator.
+struct InnerNode: public Node{
+  // The child nodes
+  Node* children[INNER_CAPACITY + 1];
+
+  // The size of the prefix
+  uint16_t prefix_size;
+
+  // The number of bytes of data in use
+  uint16_t used;
+
+  // The positions of the separator keys
+  InnerSlot slots[INNER_CAPACITY];
+
+  // The prefix and the separator keys
+  char data[INNER_DATA_SIZE];
+};
+
+// A concurrent B+-tree holding the entries of a single index
+class BTree{
+ public:
+  // Constructor
+  BTree(IndexSchema *schema);
+
+  // Destructor (frees all nodes and all entries)
+  ~BTree();
+
+  // Insert the given entry
+  void Insert(Entry *entry);
+
+  // Remove the given entry from the tree (the entry itself is not freed)
+  //
+  // Returns false if the entry was not found.
+  bool Remove(const Entry *entry);
+
+  // Latch the leaf that is responsible for the given entry exclusively and
+  // return it (the caller has to release the latch)
+  LeafNode* LatchLeaf(const Entry *entry){
+    return FindLeaf(entry->key(), entry->key_size, entry->id, true);
+  };
+
+  // Return an upper bound of the number of entries stored inside the tree
+  //
+  // The caller has to guarantee that no other thread modifies the tree.
+  size_t EstimateSize() const;
+
+  // Add the number of entries and the memory used by the tree (including the
+  // entries) in bytes to the given counters
+  //
+  // The tree may be modified concurrently, but must not be rebuilt.
+  void CountMemory(uint64_t *records, uint64_t *bytes);
+
+  // Add the addresses of all leaves and of the first entry of every leaf to
+  // the given vector (see IndexSchema::CountPlacement())
+  //
+  // The tree may be modified concurrently, but must not be rebuilt.
+  void SamplePages(std::vector<void*> *pages);
+
+  // Merge the given entries (sorted by key and id) with the entries of the
+  // tree and rebuild the tree bottom-up using completely filled nodes
+  //
+  // The caller has to guarantee that no other thread accesses the tree.
+  void Rebuild(Entry **entries, size_t count);
+
+  // Compare the given key/id combination to the given entry
+  int Compare(const char* key, size_t key_size, uint64_t id,
+              const Entry* entry) const;
+
+  // Compare the given key/id combination to the given separator
+  int Compare(const char* key, size_t key_size, uint64_t id,
+              Separator* separator) const;
+
+  // Return the schema of the indexed keys
+  IndexSchema* schema() const { return schema_; };
+
+  // Return the function comparing the indexed keys
+  KeyComparator comparator() const { return compare_; };
+
+ private:
+  // Try to insert the given entry without splitting a node
+  bool InsertOptimistic(Entry *entry);
+
+  // Insert the given entry while latching all nodes that may split
+  void InsertPessimistic(Entry *entry);
+
+  // Split the given full leaf (latched exclusively) while inserting the given
+  // entry into a tree using a radix tree
+  void SplitLeaf(LeafNode *leaf, Entry *entry);
+
+  // Latch the root node (exclusively if it is a leaf and exclusive is set)
+  Node* LatchRoot(bool exclusive_leaf, bool exclusive_inner);
+
+  // Descend to the leaf that is responsible for the given key/id combination
+  // without latching the inner nodes
+  //
+  // The returned leaf is latched (exclusively if exclusive is set).
+  LeafNode* FindLeaf(const char* key, size_t key_size, uint64_t id,
+                     bool exclusive);
+
+  // Find the leaf responsible for the given key/id combination using the
+  // radix tree and the leaf chain
+  //
+  // The returned leaf is latched (exclusively if exclusive is set).
+  LeafNode* FindLeafRadix(const char* key, size_t key_size, uint64_t id,
+                          bool exclusive);
+
+  // Encode the given key/id combination as a key of the radix tree (keys
+  // shorter than the keys of the index are padded with zero bytes)
+  void RadixKey(const char* key, size_t key_size, uint64_t id,
+                char *buffer) const;
+
+  // Return the position of the child of the given inner node responsible for
+  // the given key/id combination
+  //
+  // If version is given, the node is read without being latched and has to
+  // have this version (otherwise the result is meaningless).
+  int ChildPosition(InnerNode *node, const char* key, size_t key_size,
+                    uint64_t id, const uint32_t *version = NULL) const;
+
+  // Return the position of the first entry >= key/id inside the given leaf
+  int LowerBound(LeafNode *leaf, const char* key, size_t key_size,
+                 uint64_t id) const;
+
+  // Return the position of the first entry > key/id inside the given leaf
+  int UpperBound(LeafNode *leaf, const char* key, size_t key_size,
+                 uint64_t id) const;
+
+  // Return a separator key between the given adjacent entries
+  static SeparatorKey SeparatorBetween(const Entry *left, const Entry *right);
+
+  // Create a separator between the given adjacent entries
+  static Separator* NewSeparator(const Entry *left, const Entry *right);
+
+  // Allocate a separator holding the given key
+  static Separator* AllocateSeparator(const SeparatorKey &key);
+
+  // Return whether the given separator key can be added to the given inner
+  // node without splitting it
+  static bool SeparatorFits(const InnerNode *node, const SeparatorKey &key);
+
+  // Add the given separator key and the child following it to the given
+  // inner node at the given position (the separator has to fit)
+  static void AddSeparator(InnerNode *node, int position,
+                           const SeparatorKey &key, Node *child);
+
+  // Read the separator keys of the given inner node (the keys stored inside
+  // the node are copied into the given buffer) and return their number
+  static int ReadSeparators(const InnerNode *node, SeparatorKey *keys,
+                            char *buffer);
+
+  // Write the given separator keys and children into the given inner node
+  //
+  // The prefix of the node is the longest prefix that is shared by the keys
+  // starting with the given base prefix (and that have not been allocated
+  // separately). Returns false (without changing the node) if the keys do not
+  // fit into the node.
+  static bool LayoutInner(InnerNode *node, const SeparatorKey *keys,
+                          Node* const* children, int count, const char *base,
+                          size_t base_size);
+
+  // Split the given full inner node while adding the given separator key and
+  // the child following it at the given position
+  //
+  // The upper half is moved into the given sibling. Returns the separator key
+  // between both nodes, which is copied into the given buffer (holding at
+  // least INNER_MAX_PREFIX + INNER_MAX_SUFFIX bytes) unless it has been
+  // allocated separately.
+  static SeparatorKey SplitInner(InnerNode *node, InnerNode *sibling,
+                                 int position, const SeparatorKey &key,
+                                 Node *child, char *carry);
+
+  // Allocate a new, cache line aligned node of the given size
+  static void* AllocateNode(size_t size = NODE_SIZE);
+
+  // Return the number of leaves below the given node
+  static size_t LeafCount(const Node *node);
+
+  // Count the memory used by the given node and everything below it (the
+  // node has to be latched in shared mode and is released afterwards)
+  static void CountMemory(Node *node, uint64_t *records, uint64_t *bytes);
+
+  // Build a tree bottom-up from the given sorted entries and return its root
+  Node* Build(Entry **entries, size_t count);
+
+  // Build a leaf chain from the given sorted entries, add the fences of the
+  // leaves to the given radix tree and return the first leaf
+  LeafNode* BuildLeaves(Entry **entries, size_t count, RadixTree *radix);
+
+  // Free the given leaf, all its successors and their fences (including the
+  // entries if free_entries is set)
+  void FreeLeaves(Node *leaf, bool free_entries);
+
+  // Free the given node and everything below it (including the entries if
+  // free_entries is set)
+  void FreeNode(Node *node, bool free_entries = true);
+
+  // The schema of the indexed keys
+  IndexSchema *schema_;
+
+  // The function comparing the indexed keys (taken from the schema)
+  KeyComparator compare_;
+
+  // The root of the tree (the first leaf if the tree uses a radix tree)
+  Node* volatile root_;
+
+  // The radix tree mapping the fences to the leaves (or NULL if the tree uses
+  // inner nodes)
+  RadixTree* radix_;
+
+  // The size of the keys of the radix tree in bytes (the size of the keys of
+  // the index plus the id)
+  size_t radix_key_size_;
+
+  // The number of leaves (only maintained if the tree uses a radix tree)
+  volatile size_t leaf_count_;
+
+  friend class BTreeCursor;
+
+  DISALLOW_COPY_AND_ASSIGN(BTree);
+};
+
+// A cursor used to read the entries of a B+-tree in ascending order
+//
+// While the cursor is positioned, its current leaf is latched in shared mode.
+// The latch can be released (e.g. between two GetNext() calls) and the cursor
+// can later continue after the last entry it returned.
+class BTreeCursor{
+ public:
+  // Constructor
+  BTreeCursor(BTree *tree = NULL);
+
+  // Destructor
+  ~BTreeCursor();
+
+  // Set the tree to be read
+  void set_tree(BTree *tree){ tree_ = tree; };
+
+  // Position the cursor on the first entry >= key/id
+  void Seek(const char* key, size_t key_size, uint64_t id);
+
+  // Re-latch the current leaf and position the cursor on the first entry
+  // following the given key/id combination (the last entry that was read)
+  void SeekAfter(const char* key, size_t key_size, uint64_t id);
+
+  // Move the cursor forward to the first entry >= key/id (which must follow
+  // the current entry)
+  //
+  // Targets inside the current leaf are found without descending the tree.
+  void SeekForward(const char* key, size_t key_size, uint64_t id);
+
+  // Re-latch the current leaf and move the cursor to the first entry >= key/id
+  // (which must not precede the entry the cursor pointed to when it was
+  // released)
+  void Resume(const char* key, size_t key_size, uint64_t id);
+
+  // Move the cursor to the next entry
+  //
+  // Returns false if the end of the tree has been reached.
+  bool Next();
+
+  // Release the latch of the current leaf
+  void Release();
+
+  // Whether the cursor points to a valid entry
+  bool valid() const {
+    return (leaf_ != NULL) && (slot_ < leaf_->count);
+  };
+
+  // Return the entry the cursor points to
+  Entry* entry() const { return leaf_->entries[slot_]; };
+
+ private:
+  // Skip empty leaves (and the end of the current leaf)
+  void SkipToValid();
+
+  // The tree to be read
+  BTree *tree_;
+
+  // The current leaf
+  LeafNode *leaf_;
+
+  // The current position inside the leaf
+  int slot_;
+
+  // The version of the leaf when the cursor was positioned
+  uint32_t version_;
+
+  // Whether the leaf is currently latched
+  bool latched_;
+
+  DISALLOW_COPY_AND_ASSIGN(BTreeCursor);
+};
+
+#endif // _NATIVEIMPL_BTREE_H_
@@ -0,0 +1,329 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include <common/key_codec.h>
+
+#include "dictionary.h"
+#include "hash_table.h"
+#include "latch.h"
+#include "pool.h"
+
+// The smallest and the largest byte of a code
+#define CODE_MIN 0x02
+#define CODE_MAX 0xFE
+
+// The byte separating the code of the next smaller value from a value that is
+// not part of a frozen dictionary
+#define DICTIONARY_ESCAPE '\x01'
+
+// Write the code following the given one (used if no larger code exists)
+static size_t IncrementCode(const char *low, size_t low_size, char *code){
+  memcpy(code, low, low_size);
+  if((uint8_t) code[low_size-1] < CODE_MAX){
+    code[low_size-1]++;
+    return low_size;
+  }
+  code[low_size] = (char) 0x80;
+  return low_size+1;
+}
+
+// Write the code preceding the given one (used if no smaller code exists)
+//
+// As no code ends with CODE_MIN, the last byte can be decremented or replaced
+// by CODE_MIN followed by another byte.
+static size_t DecrementCode(const char *high, size_t high_size, char *code){
+  memcpy(code, high, high_size);
+  if((uint8_t) code[high_size-1] > CODE_MIN+1){
+    code[high_size-1]--;
+    return high_size;
+  }
+  code[high_size-1] = CODE_MIN;
+  code[high_size] = (char) 0x80;
+  return high_size+1;
+}
+
+// Write a code between the two given codes
+//
+// The codes are read as fractions whose digits are the bytes (missing bytes
+// count as CODE_MIN). The first digit that differs is replaced by the digit
+// in the middle. If both digits are adjacent, the smaller one is kept and the
+// remaining digits only have to be larger than the ones of low. Returns
+// DICTIONARY_MAX_CODE+1 if the code would get longer than DICTIONARY_MAX_CODE
+// bytes (code must hold DICTIONARY_MAX_CODE+1 bytes).
+static size_t CodeBetween(const char *low, size_t low_size, const char *high,
+                          size_t high_size, char *code){
+  bool bounded = true;
+  for(size_t i = 0; i < DICTIONARY_MAX_CODE; i++){
+    int l = (i < low_size) ? (uint8_t) low[i] : CODE_MIN;
+    int h = !bounded ? CODE_MAX+1 : ((i < high_size) ? (uint8_t) high[i]
+                                                      : CODE_MIN);
+    int middle = (l + h) / 2;
+    if(middle > l){
+      code[i] = (char) middle;
+      return i+1;
+    }
+    code[i] = (char) l;
+    if(h > l)
+      bounded = false;
+  }
+  return DICTIONARY_MAX_CODE+1;
+}
+
+// Return the first bytes of the given value as a big-endian number (missing
+// bytes are 0, so the numbers are ordered like the values)
+static inline uint64_t Head(const char *value, size_t value_size){
+  uint64_t head = 0;
+  memcpy(&head, value, (value_size < sizeof(head)) ? value_size : sizeof(head));
+  return CodecSwap64(head);
+}
+
+// Constructor for Dictionary
+Dictionary::Dictionary(){
+  count_ = 0;
+  frozen_ = false;
+  item_bytes_ = 0;
+  sorted_ = new SortedItem[DICTIONARY_CAPACITY];
+  CountAllocation();
+  try{
+    values_ = new Slot[DICTIONARY_SLOTS]();
+    CountAllocation();
+    try{
+      codes_ = new Slot[DICTIONARY_SLOTS]();
+      CountAllocation();
+    } catch(...){
+      delete[] values_;
+      throw;
+    }
+  } catch(...){
+    delete[] sorted_;
+    throw;
+  }
+}
+
+// Destructor for Dictionary
+Dictionary::~Dictionary(){
+  for(uint32_t i = 0; i < count_; i++)
+    free((void*) sorted_[i].item);
+  delete[] codes_;
+  delete[] values_;
+  delete[] sorted_;
+}
+
+// Encode the given value (or a wildcard if attribute is NULL) into data
+//
+// Values that are not part of the dictionary yet are added, unless the
+// dictionary is frozen.
+size_t Dictionary::Encode(const Attribute *attribute, char *data, bool max){
+  if(attribute == NULL)
+    return EncodeAttribute(kVarchar, NULL, data, max);
+
+  const char* value = attribute->char_value;
+  size_t value_size = strnlen(value, MAX_VARCHAR_LENGTH);
+  const Item* item = FindValue(value, value_size);
+  if((item == NULL) && !frozen_)
+    item = Add(value, value_size);
+
+  size_t size = 0;
+  if(item != NULL){
+    memcpy(data, item->code(), item->code_size);
+    size = item->code_size;
+  } else {
+    // The dictionary is frozen, so the sorted items do not change anymore
+    ReadBarrier();
+    uint32_t position = LowerBound(value, value_size);
+    if(position > 0){
+      const Item* lower = sorted_[position-1].item;
+      memcpy(data, lower->code(), lower->code_size);
+      size = lower->code_size;
+    }
+    data[size++] = DICTIONARY_ESCAPE;
+    memcpy(data+size, value, value_size);
+    size += value_size;
+  }
+  data[size++] = '\0';
+  return size;
+}
+
+// Decode the encoded value stored at data
+//
+// Only encoded values are decoded (never wildcards), so every code has been
+// published before.
+size_t Dictionary::Decode(const char *data, Attribute *attribute) const{
+  attribute->type = kVarchar;
+  size_t size = strlen(data);
+  const char* value;
+  size_t value_size;
+  const char* escape = (const char*) memchr(data, DICTIONARY_ESCAPE, size);
+  if(escape != NULL){
+    value = escape+1;
+    value_size = data + size - value;
+  } else {
+    const Item* item = FindCode(data, size);
+    value = item->value();
+    value_size = item->value_size;
+  }
+  memcpy(attribute->char_value, value, value_size);
+  attribute->char_value[value_size] = '\0';
+  return size+1;
+}
+
+// Return the number of bytes used by the dictionary
+size_t Dictionary::MemoryUsage() const{
+  return sizeof(Dictionary) + DICTIONARY_CAPACITY*sizeof(SortedItem)
+         + 2*DICTIONARY_SLOTS*sizeof(Slot) + item_bytes_;
+}
+
+// Return the item holding the given value (or NULL)
+//
+// Only the items whose hash matches are read.
+const Dictionary::Item* Dictionary::FindValue(const char *value,
+                                              size_t value_size) const{
+  uint64_t hash = HashTable::Hash(value, value_size);
+  uint32_t slot = hash % DICTIONARY_SLOTS;
+  const Item* item;
+  while((item = values_[slot].item) != NULL){
+    ReadBarrier();
+    if((values_[slot].hash == hash) && (item->value_size == value_size)
+       && (memcmp(item->value(), value, value_size) == 0))
+      return item;
+    slot = (slot+1) % DICTIONARY_SLOTS;
+  }
+  return NULL;
+}
+
+// Return the item holding the given code (or NULL)
+const Dictionary::Item* Dictionary::FindCode(const char *code,
+                                             size_t code_size) const{
+  uint64_t hash = HashTable::Hash(code, code_size);
+  uint32_t slot = hash % DICTIONARY_SLOTS;
+  const Item* item;
+  while((item = codes_[slot].item) != NULL){
+    ReadBarrier();
+    if((codes_[slot].hash == hash) && (item->code_size == code_size)
+       && (memcmp(item->code(), code, code_size) == 0))
+      return item;
+    slot = (slot+1) % DICTIONARY_SLOTS;
+  }
+  return NULL;
+}
+
+// Insert the given item into the given hash table at the first free slot
+//
+// The item must have been written completely before.
+void Dictionary::Publish(Slot *table, uint64_t hash, const Item *item){
+  uint32_t slot = hash % DICTIONARY_SLOTS;
+  while(table[slot].item != NULL)
+    slot = (slot+1) % DICTIONARY_SLOTS;
+  table[slot].hash = hash;
+  __sync_synchronize();
+  table[slot].item = item;
+}
+
+// Add the given value and return its item
+//
+// The dictionary is frozen instead if it is full or if the code of the value
+// would get too long.
+const Dictionary::Item* Dictionary::Add(const char *value, size_t value_size){
+  lock(mutex_){
+    // Another thread may have added the value in the meantime
+    const Item* item = FindValue(value, value_size);
+    if((item != NULL) || frozen_)
+      return item;
+
+    uint32_t position = LowerBound(value, value_size);
+    const Item* lower = (position > 0) ? sorted_[position-1].item : NULL;
+    const Item* upper = (position < count_) ? sorted_[position].item : NULL;
+    char code[DICTIONARY_MAX_CODE+1];
+    size_t code_size;
+    if((lower == NULL) && (upper == NULL)){
+      code[0] = (char) 0x80;
+      code_size = 1;
+    } else if(upper == NULL){
+      code_size = IncrementCode(lower->code(), lower->code_size, code);
+    } else if(lower == NULL){
+      code_size = DecrementCode(upper->code(), upper->code_size, code);
+    } else {
+      code_size = CodeBetween(lower->code(), lower->code_size, upper->code(),
+                              upper->code_size, code);
+    }
+
+    if((count_ == DICTIONARY_CAPACITY) || (code_size > DICTIONARY_MAX_CODE)){
+      __sync_synchronize();
+      frozen_ = true;
+      return NULL;
+    }
+
+    size_t size = sizeof(Item) + value_size + code_size;
+    Item* added = (Item*) malloc(size);
+    if(added == NULL)
+      throw std::bad_alloc();
+    CountAllocation();
+    added->value_size = value_size;
+    added->code_size = code_size;
+    memcpy((char*) added->value(), value, value_size);
+    memcpy((char*) added->code(), code, code_size);
+
+    memmove(sorted_+position+1, sorted_+position,
+            (count_-position)*sizeof(SortedItem));
+    sorted_[position].head = Head(value, value_size);
+    sorted_[position].item = added;
+    count_++;
+    item_bytes_ += size;
+
+    __sync_synchronize();
+    Publish(values_, HashTable::Hash(value, value_size), added);
+    Publish(codes_, HashTable::Hash(code, code_size), added);
+    return added;
+  }
+  return NULL;
+}
+
+// Return the position of the first item whose value is not smaller than the
+// given value inside the sorted items
+//
+// The values are only read if their first bytes match. The search halves the
+// range without branching on the result of a comparison (which could not be
+// predicted).
+uint32_t Dictionary::LowerBound(const char *value, size_t value_size) const{
+  uint64_t head = Head(value, value_size);
+  const SortedItem* base = sorted_;
+  uint32_t count = count_;
+  while(count > 0){
+    uint32_t half = count / 2;
+    const SortedItem& sorted = base[half];
+    bool less = sorted.head < head;
+    if(__builtin_expect(sorted.head == head, 0)){
+      const Item* item = sorted.item;
+      less = CompareEncoded(item->value(), item->value_size, value,
+                            value_size) < 0;
+    }
+    base = less ? base + half + 1 : base;
+    count = less ? count - half - 1 : half;
+  }
+  return base - sorted_;
+}
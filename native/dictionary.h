@@ -0,0 +1,168 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+ */
+
+
+/** @file
+ An order-preserving dictionary for the values of a VARCHAR attribute.
+
+ Every value added to the dictionary gets a code: a short string of bytes
+ between 0x02 and 0xFE that never ends with 0x02. The byte-wise order of the
+ codes matches the order of the values, so an encoded key holding codes
+ instead of values can still be compared using memcmp. A new value gets a
+ code between the codes of its neighbours (if its neighbours' codes are
+ adjacent, the new code is one byte longer). Such a code always exists, as
+ no code ends with the smallest byte.
+
+ Values are added when they are encoded for the first time, whether they are
+ stored or only queried, until the dictionary holds DICTIONARY_CAPACITY values
+ or a new code would get longer than DICTIONARY_MAX_CODE bytes. Then the
+ dictionary is frozen and never changes again. A value that is not part of a
+ frozen dictionary is encoded as the code of the largest smaller value in the
+ dictionary (if any), followed by a 0x01 byte and the value itself. This still
+ sorts between the codes of its neighbours, as codes never contain bytes below
+ 0x02. Only frozen dictionaries use such encodings, so the code of a value
+ never changes.
+
+ An encoded attribute is terminated by a '\0' byte like a plain VARCHAR
+ attribute, so the comparators and the range checks work on it unchanged (see
+ EncodedAttributeSize() in common/key_codec.h). Maximum wildcards start with
+ 0xFF, which no encoded value does.
+
+ The values and codes are found using two hash tables that are read without
+ latching them: items are never changed or removed once they have been
+ published. Adding a value is serialized by a mutex. The sorted values start
+ with their first bytes, so searching them rarely has to read the items.
+*/
+
+#ifndef _NATIVEIMPL_DICTIONARY_H_
+#define _NATIVEIMPL_DICTIONARY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <common/macros.h>
+#include <common/mutex.h>
+#include <contest_interface.h>
+
+// The maximum number of values of a dictionary
+#define DICTIONARY_CAPACITY 1024
+
+// The maximum size of a code in bytes
+#define DICTIONARY_MAX_CODE 16
+
+// The maximum size of an attribute encoded using a dictionary (the code of the
+// next smaller value, the 0x01 byte, the value and the terminating '\0')
+#define DICTIONARY_MAX_ENCODED_SIZE \
+  (DICTIONARY_MAX_CODE + 1 + MAX_VARCHAR_LENGTH + 1)
+
+// The number of slots of both hash tables of a dictionary
+#define DICTIONARY_SLOTS (2 * DICTIONARY_CAPACITY)
+
+// A dictionary mapping the values of a VARCHAR attribute to order-preserving
+// codes
+class Dictionary{
+ public:
+  // Constructor
+  Dictionary();
+
+  // Destructor
+  ~Dictionary();
+
+  // Encode the given value (or a wildcard if attribute is NULL) into data
+  //
+  // Returns the number of bytes written to data (at most
+  // DICTIONARY_MAX_ENCODED_SIZE).
+  size_t Encode(const Attribute *attribute, char *data, bool max = false);
+
+  // Decode the encoded value stored at data
+  //
+  // Returns the number of bytes read from data.
+  size_t Decode(const char *data, Attribute *attribute) const;
+
+  // Return the number of bytes used by the dictionary
+  size_t MemoryUsage() const;
+
+ private:
+  // A value and its code
+  struct Item{
+    // The size of the value (without a terminating '\0') and of the code
+    uint16_t value_size;
+    uint8_t code_size;
+
+    // The value is stored directly after the item, followed by the code
+    const char* value() const { return reinterpret_cast<const char*>(this + 1); };
+    const char* code() const { return value() + value_size; };
+  };
+
+  // A slot of a hash table (the hash is written before the item is published)
+  struct Slot{
+    volatile uint64_t hash;
+    const Item* volatile item;
+  };
+
+  // An item of the sorted values and the first bytes of its value (as a
+  // big-endian number)
+  struct SortedItem{
+    uint64_t head;
+    const Item* item;
+  };
+
+  // Return the item holding the given value (or NULL)
+  const Item* FindValue(const char *value, size_t value_size) const;
+
+  // Return the item holding the given code (or NULL)
+  const Item* FindCode(const char *code, size_t code_size) const;
+
+  // Insert the given item into the given hash table
+  static void Publish(Slot *table, uint64_t hash, const Item *item);
+
+  // Add the given value and return its item
+  //
+  // Returns NULL if the dictionary is frozen.
+  const Item* Add(const char *value, size_t value_size);
+
+  // Return the position of the first item whose value is not smaller than
+  // the given value inside the sorted items
+  uint32_t LowerBound(const char *value, size_t value_size) const;
+
+  // The items sorted by their values (only changed while the mutex is held
+  // and never after the dictionary has been frozen)
+  SortedItem* sorted_;
+  uint32_t count_;
+
+  // The items hashed by their values and by their codes
+  Slot* values_;
+  Slot* codes_;
+
+  // Whether no more values are added
+  volatile bool frozen_;
+
+  // The number of bytes used by the items
+  size_t item_bytes_;
+
+  // Serializes adding values
+  Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(Dictionary);
+};
+
+#endif // _NATIVEIMPL_DICTIONARY_H_
@@ -0,0 +1,242 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "entry.h"
+#include "pool.h"
+#include "util.h"
+
+// The number of ids a thread reserves at once
+#define ENTRY_ID_BLOCK_SIZE 1024
+
+// The minimum number of entries that is worth sorting in a separate thread
+// (a run of this size takes about as long to sort as starting a thread)
+#define SORT_MIN_RUN_SIZE 2048
+
+// The last id that has been reserved by any thread
+static uint64_t last_reserved_id = 0;
+
+// The next id to be used by the current thread
+static __thread uint64_t next_id = 0;
+
+// The first id that has not been reserved by the current thread
+static __thread uint64_t end_id = 0;
+
+// Create a new entry holding the given key and payload
+Entry* NewEntry(const char* key, size_t key_size, const Block& payload){
+  Entry* entry = (Entry*) AllocateEntry(sizeof(Entry) + key_size + payload.size);
+
+  entry->id = NextEntryId();
+  entry->lock = 0;
+  entry->begin = TIMESTAMP_INFINITY;
+  entry->end = TIMESTAMP_INFINITY;
+  entry->hash_next = NULL;
+  entry->payload_next = NULL;
+  entry->payload_size = payload.size;
+  entry->key_size = key_size;
+  memcpy(entry->key(), key, key_size);
+  memcpy(entry->payload(), payload.data, payload.size);
+
+  return entry;
+}
+
+// Make the given entries, which have been inserted outside of any
+// transaction, visible
+//
+// At snapshot isolation, all entries get the same commit timestamp, so they
+// become visible at once.
+void PublishEntries(Entry** entries, size_t count){
+  if(GetIsolationLevel() == kReadCommitted){
+    for(size_t i = 0; i < count; i++)
+      entries[i]->begin = 0;
+    return;
+  }
+
+  uint64_t timestamp = BeginCommit();
+  for(size_t i = 0; i < count; i++)
+    entries[i]->begin = timestamp;
+  EndCommit(timestamp);
+}
+
+// Free an entry
+//
+// Its memory is kept for new entries of the same size class (see pool.h).
+void FreeEntry(Entry* entry){
+  ReleaseEntry(entry, sizeof(Entry) + entry->key_size + entry->payload_size);
+}
+
+// Return a new id that is unique across all entries
+//
+// To avoid contention on a single counter, every thread reserves a block of
+// ids at once.
+uint64_t NextEntryId(){
+  if(next_id == end_id){
+    next_id = __sync_add_and_fetch(&last_reserved_id, ENTRY_ID_BLOCK_SIZE)
+              - ENTRY_ID_BLOCK_SIZE + 1;
+    end_id = next_id + ENTRY_ID_BLOCK_SIZE;
+  }
+  return next_id++;
+}
+
+// An entry together with the first bytes of its key, so that most comparisons
+// while sorting do not have to access the entry itself
+struct SortItem{
+  // The first 16 bytes of the key (big-endian, padded with zeros)
+  uint64_t prefix[2];
+
+  // The entry
+  Entry* entry;
+};
+
+// Load the given part of a key as a big-endian number (padded with zeros)
+static inline uint64_t KeyPrefix(const char* key, size_t key_size, size_t offset){
+  unsigned char bytes[sizeof(uint64_t)] = {0};
+  if(key_size > offset)
+    memcpy(bytes, key + offset, std::min(key_size - offset, sizeof(bytes)));
+
+  uint64_t prefix = 0;
+  for(size_t i = 0; i < sizeof(bytes); i++)
+    prefix = (prefix << 8) | bytes[i];
+  return prefix;
+}
+
+// Checks whether the first item is ordered before the second one
+//
+// The entries are only compared if their key prefixes are equal (padding a
+// key with zeros never changes the order of two keys with different
+// prefixes).
+static bool SortItemLess(const SortItem& a, const SortItem& b){
+  if(a.prefix[0] != b.prefix[0])
+    return a.prefix[0] < b.prefix[0];
+  if(a.prefix[1] != b.prefix[1])
+    return a.prefix[1] < b.prefix[1];
+
+  int result = KeyCmp(a.entry->key(), a.entry->key_size,
+                      b.entry->key(), b.entry->key_size);
+  if(result != 0)
+    return result < 0;
+  return a.entry->id < b.entry->id;
+}
+
+// A part of the array that is sorted (middle is NULL) or merged by one thread
+struct SortTask{
+  SortItem* begin;
+  SortItem* middle;
+  SortItem* end;
+};
+
+// Sort or merge the part of the array described by the given task
+static void* RunSortTask(void* argument){
+  SortTask* task = static_cast<SortTask*>(argument);
+  if(task->middle == NULL)
+    std::sort(task->begin, task->end, SortItemLess);
+  else
+    std::inplace_merge(task->begin, task->middle, task->end, SortItemLess);
+  return NULL;
+}
+
+// Run the given tasks in parallel (the first one in the calling thread)
+//
+// If a thread cannot be created, its task is run by the calling thread.
+static void RunSortTasks(std::vector<SortTask> &tasks){
+  std::vector<pthread_t> threads(tasks.size());
+  std::vector<bool> started(tasks.size(), false);
+
+  for(size_t i = 1; i < tasks.size(); i++)
+    started[i] = (pthread_create(&threads[i], NULL, &RunSortTask, &tasks[i]) == 0);
+
+  for(size_t i = 0; i < tasks.size(); i++){
+    if(started[i])
+      pthread_join(threads[i], NULL);
+    else
+      RunSortTask(&tasks[i]);
+  }
+}
+
+// Sort the given entries by key and id
+//
+// The entries are sorted by their key prefixes first. For large arrays, the
+// array is split into one run per processor, the runs are sorted in parallel
+// and then merged pairwise (again in parallel) until a single run is left.
+void SortEntries(Entry** entries, size_t count){
+  std::vector<SortItem> items(count);
+  for(size_t i = 0; i < count; i++){
+    items[i].prefix[0] = KeyPrefix(entries[i]->key(), entries[i]->key_size, 0);
+    items[i].prefix[1] = KeyPrefix(entries[i]->key(), entries[i]->key_size,
+                                   sizeof(uint64_t));
+    items[i].entry = entries[i];
+  }
+
+  // Use one run per processor, unless the runs would get too small (a batch
+  // of the benchmark holds 16384 records, which are split into 8 runs on a
+  // machine with 8 processors)
+  size_t runs = count / SORT_MIN_RUN_SIZE;
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  if(processors < 1)
+    processors = 1;
+  if(runs > (size_t) processors)
+    runs = processors;
+
+  if(runs <= 1){
+    if(count > 0)
+      std::sort(&items[0], &items[0] + count, SortItemLess);
+  } else {
+    // Split the array into runs of (almost) the same size
+    std::vector<SortItem*> bounds(runs + 1);
+    for(size_t i = 0; i <= runs; i++)
+      bounds[i] = &items[0] + (count * i) / runs;
+
+    // Sort the runs
+    std::vector<SortTask> tasks;
+    for(size_t i = 0; i < runs; i++){
+      SortTask task = {bounds[i], NULL, bounds[i+1]};
+      tasks.push_back(task);
+    }
+    RunSortTasks(tasks);
+
+    // Merge neighbouring runs until the whole array is sorted
+    for(size_t width = 1; width < runs; width *= 2){
+      tasks.clear();
+      for(size_t i = 0; i + width < runs; i += 2*width){
+        SortTask task = {bounds[i], bounds[i+width],
+                         bounds[std::min(i + 2*width, runs)]};
+        tasks.push_back(task);
+      }
+      RunSortTasks(tasks);
+    }
+  }
+
+  for(size_t i = 0; i < count; i++)
+    entries[i] = items[i].entry;
+}
@@ -0,0 +1,128 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#ifndef _NATIVEIMPL_ENTRY_H_
+#define _NATIVEIMPL_ENTRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <contest_interface.h>
+
+#include "snapshot.h"
+
+// The states an entry can be in (stored in the lower bits of its lock word)
+enum EntryState{
+  // The entry has been inserted by a transaction that is still running
+  kPendingInsert = 1,
+  // The entry has been deleted by a transaction that is still running
+  kPendingDelete = 2
+};
+
+// The mask used to extract the state bits from a lock word
+#define ENTRY_STATE_MASK ((uintptr_t) 3)
+
+// Represents a single record stored inside an index
+//
+// The key (encoded using common/key_codec.h) and the payload are stored
+// directly behind the header, so that a record only needs one allocation.
+// Entries are ordered by their key first and by their id second, which makes
+// all entries (even full duplicates) unique inside the tree.
+struct Entry{
+  // The unique id of the entry
+  uint64_t id;
+
+  // The lock word of the entry
+  //
+  // It is 0 for committed entries that are not locked. Otherwise it holds the
+  // pointer to the owning transaction combined with the EntryState bits.
+  volatile uintptr_t lock;
+
+  // The commit timestamp of the transaction that inserted the entry (0 at read
+  // committed, TIMESTAMP_INFINITY while the insert is uncommitted)
+  volatile uint64_t begin;
+
+  // The commit timestamp of the transaction that deleted the entry
+  // (TIMESTAMP_INFINITY while the entry has not been deleted)
+  volatile uint64_t end;
+
+  // The next entry inside the same bucket of the hash table of the index
+  // (see hash_table.h)
+  Entry* hash_next;
+
+  // The next entry inside the same bucket of the payload table of the index,
+  // which hashes the key together with the payload (see hash_table.h)
+  Entry* payload_next;
+
+  // The size of the payload in bytes
+  uint32_t payload_size;
+
+  // The size of the key in bytes
+  uint32_t key_size;
+
+  // Return the key of the entry
+  char* key(){ return reinterpret_cast<char*>(this + 1); };
+  const char* key() const { return reinterpret_cast<const char*>(this + 1); };
+
+  // Return the payload of the entry
+  char* payload(){ return key() + key_size; };
+  const char* payload() const { return key() + key_size; };
+};
+
+// Create a new entry holding the given key and payload
+Entry* NewEntry(const char* key, size_t key_size, const Block& payload);
+
+// Make the given entries, which have been inserted outside of any
+// transaction, visible
+void PublishEntries(Entry** entries, size_t count);
+
+// Free an entry
+void FreeEntry(Entry* entry);
+
+// Return a new id that is unique across all entries
+uint64_t NextEntryId();
+
+// Sort the given entries by key and id (large arrays are sorted in parallel)
+void SortEntries(Entry** entries, size_t count);
+
+// Checks whether the given entry is visible to the given transaction, which
+// reads the given snapshot
+//
+// Changes of a transaction are always visible to itself. All other entries
+// are visible if they have been inserted, but not deleted, by a transaction
+// that committed at or before the snapshot. At read committed, the snapshot
+// is TIMESTAMP_LATEST, so every committed change is visible.
+static inline bool Visible(const Entry* entry, const Transaction* tx,
+                           uint64_t snapshot){
+  uintptr_t lock = entry->lock;
+  if((lock & ENTRY_STATE_MASK)
+     && ((lock & ~ENTRY_STATE_MASK) == (uintptr_t) tx))
+    return !(lock & kPendingDelete);
+  return (entry->begin <= snapshot) && (snapshot < entry->end);
+}
+
+#endif // _NATIVEIMPL_ENTRY_H_
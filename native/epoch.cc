@@ -0,0 +1,164 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <common/mutex.h>
+
+#include "btree.h"
+#include "epoch.h"
+
+// The read-side state of a single thread (occupies a cache line of its own)
+struct EpochSlot{
+  // Incremented whenever the thread enters or leaves a critical section (so it
+  // is odd while the thread is inside a section)
+  volatile uint64_t sequence;
+
+  // The list of all slots
+  EpochSlot* prev;
+  EpochSlot* next;
+
+  char padding[CACHE_LINE_SIZE - sizeof(uint64_t) - 2*sizeof(EpochSlot*)];
+};
+
+// The slot of the current thread
+static __thread EpochSlot* thread_slot = NULL;
+
+// The key used to free the slot of a thread when it exits
+static pthread_key_t slot_key;
+
+// Makes sure that the key is only created once
+static pthread_once_t slot_once = PTHREAD_ONCE_INIT;
+
+// The slots of all running threads
+static EpochSlot* slots = NULL;
+
+// The number of readers inside a critical section that have no slot of their
+// own (because it could not be allocated)
+static volatile uint64_t slotless_readers = 0;
+
+// A mutex protecting the list of slots
+static Mutex slot_mutex;
+
+// Free the slot of a thread that exits
+static void FreeSlot(void* data){
+  EpochSlot* slot = (EpochSlot*) data;
+  thread_slot = NULL;
+
+  lock(slot_mutex){
+    if(slot->prev != NULL)
+      slot->prev->next = slot->next;
+    else
+      slots = slot->next;
+    if(slot->next != NULL)
+      slot->next->prev = slot->prev;
+  }
+  free(slot);
+}
+
+// Create the key used to free the slots
+static void CreateSlotKey(){
+  pthread_key_create(&slot_key, &FreeSlot);
+}
+
+// Return the slot of the calling thread (or NULL if it could not be created)
+static EpochSlot* GetSlot(){
+  if(thread_slot != NULL)
+    return thread_slot;
+
+  pthread_once(&slot_once, &CreateSlotKey);
+  void* memory;
+  if(posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(EpochSlot)) != 0)
+    return NULL;
+  EpochSlot* slot = (EpochSlot*) memory;
+  if(pthread_setspecific(slot_key, slot) != 0){
+    free(slot);
+    return NULL;
+  }
+  slot->sequence = 0;
+  slot->prev = NULL;
+
+  lock(slot_mutex){
+    slot->next = slots;
+    if(slots != NULL)
+      slots->prev = slot;
+    slots = slot;
+  }
+  thread_slot = slot;
+  return slot;
+}
+
+// Enter a read-side critical section
+void EnterEpoch(){
+  EpochSlot* slot = GetSlot();
+  if(slot != NULL)
+    slot->sequence++;
+  else
+    __sync_fetch_and_add(&slotless_readers, 1);
+
+  // The announcement has to be visible before the shared data is read
+  __sync_synchronize();
+}
+
+// Leave the read-side critical section of the calling thread
+void LeaveEpoch(){
+  EpochSlot* slot = thread_slot;
+  if(slot != NULL){
+    // All reads of the section have completed before the store (stores are not
+    // reordered with earlier loads on x86)
+    __asm__ __volatile__("" ::: "memory");
+    slot->sequence++;
+  } else {
+    __sync_fetch_and_sub(&slotless_readers, 1);
+  }
+}
+
+// Wait until all read-side critical sections that were active when this
+// function was called have been left
+//
+// A thread that is inside a section (odd sequence) only has to leave it once:
+// a section it enters afterwards already sees the new version of the data.
+void WaitForReaders(){
+  // Make the new version visible before the slots are read
+  __sync_synchronize();
+
+  lock(slot_mutex){
+    for(EpochSlot* slot = slots; slot != NULL; slot = slot->next){
+      uint64_t sequence = slot->sequence;
+      if((sequence & 1) == 0)
+        continue;
+      while(slot->sequence == sequence)
+        sched_yield();
+    }
+  }
+  while(slotless_readers != 0)
+    sched_yield();
+}
@@ -0,0 +1,56 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+/** @file
+ Read-side critical sections for data that is read far more often than it is
+ changed (read-copy-update).
+
+ Readers announce that they are inside a critical section by incrementing a
+ counter that is owned by their thread and lives in a cache line of its own,
+ so entering and leaving a section does not write to any shared memory. A
+ writer replaces the shared data by a new version and then calls
+ WaitForReaders(): once it returns, no reader can still hold a reference to
+ the old version, which may then be freed.
+*/
+
+#ifndef _NATIVEIMPL_EPOCH_H_
+#define _NATIVEIMPL_EPOCH_H_
+
+// Enter a read-side critical section (sections must not be nested)
+void EnterEpoch();
+
+// Leave the read-side critical section of the calling thread
+void LeaveEpoch();
+
+// Wait until all read-side critical sections that were active when this
+// function was called have been left
+//
+// Must not be called inside a read-side critical section.
+void WaitForReaders();
+
+#endif // _NATIVEIMPL_EPOCH_H_
@@ -0,0 +1,325 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <new>
+
+#include "hash_table.h"
+#include "pool.h"
+#include "util.h"
+
+// Constructor
+HashTable::HashTable(bool payloads){
+  payloads_ = payloads;
+  for(int i = 0; i < HASH_STRIPE_COUNT; i++)
+    stripes_[i].count = 0;
+
+  bucket_count_ = HASH_INITIAL_BUCKETS;
+  buckets_ = (Entry**) calloc(HASH_INITIAL_BUCKETS, sizeof(Entry*));
+  if(buckets_ == NULL)
+    throw std::bad_alloc();
+  CountAllocation();
+}
+
+// Destructor
+HashTable::~HashTable(){
+  free(buckets_);
+}
+
+// Insert the given entry
+//
+// The entry is inserted into the chain of its bucket according to its key,
+// (payload) and id. If its stripe exceeds the load factor afterwards, the table grows.
+void HashTable::Insert(Entry *entry){
+  uint64_t hash = Hash(entry);
+  HashStripe &stripe = Stripe(hash);
+
+  stripe.latch.LockExclusive();
+  Entry** link = &buckets_[hash & (bucket_count_ - 1)];
+  while((*link != NULL)
+        && (Compare(entry->key(), entry->key_size, entry->payload(),
+                    entry->payload_size, entry->id, *link) > 0))
+    link = Next(*link);
+  *Next(entry) = *link;
+  *link = entry;
+  size_t count = ++stripe.count;
+  size_t bucket_count = bucket_count_;
+  stripe.latch.UnlockExclusive();
+
+  if(count > HASH_LOAD_FACTOR * (bucket_count / HASH_STRIPE_COUNT))
+    Grow(bucket_count);
+}
+
+// Remove the given entry
+bool HashTable::Remove(const Entry *entry){
+  uint64_t hash = Hash(entry);
+  HashStripe &stripe = Stripe(hash);
+
+  stripe.latch.LockExclusive();
+  Entry** link = &buckets_[hash & (bucket_count_ - 1)];
+  while((*link != NULL) && (*link != entry))
+    link = Next(*link);
+  bool found = (*link != NULL);
+  if(found){
+    *link = *Next(*link);
+    stripe.count--;
+  }
+  stripe.latch.UnlockExclusive();
+
+  return found;
+}
+
+// Replace the payload of the given entry by a payload of the same size
+//
+// The stripes of the old and the new chain are latched exclusively (in the
+// order of their addresses, like Grow() does) while the entry is unlinked,
+// changed and linked again, so concurrent lookups of the record either find
+// the entry with its old or with its new payload.
+void HashTable::Overwrite(Entry *entry, const Block &payload){
+  uint64_t old_hash = Hash(entry);
+  uint64_t new_hash = Hash(entry->key(), entry->key_size,
+                           (const char*) payload.data, payload.size);
+  HashStripe* first = &Stripe(old_hash);
+  HashStripe* second = &Stripe(new_hash);
+  if(second < first)
+    std::swap(first, second);
+
+  first->latch.LockExclusive();
+  if(second != first)
+    second->latch.LockExclusive();
+
+  Entry** link = &buckets_[old_hash & (bucket_count_ - 1)];
+  while((*link != NULL) && (*link != entry))
+    link = Next(*link);
+  bool found = (*link != NULL);
+  if(found){
+    *link = *Next(entry);
+    Stripe(old_hash).count--;
+  }
+
+  memcpy(entry->payload(), payload.data, payload.size);
+
+  if(found){
+    link = &buckets_[new_hash & (bucket_count_ - 1)];
+    while((*link != NULL)
+          && (Compare(entry->key(), entry->key_size, entry->payload(),
+                      entry->payload_size, entry->id, *link) > 0))
+      link = Next(*link);
+    *Next(entry) = *link;
+    *link = entry;
+    Stripe(new_hash).count++;
+  }
+
+  if(second != first)
+    second->latch.UnlockExclusive();
+  first->latch.UnlockExclusive();
+}
+
+// Return the hash value of the given encoded key
+//
+// The key is mixed in words of 8 bytes, followed by a final avalanche step,
+// as the lower bits select the stripe and the bucket.
+uint64_t HashTable::Hash(const char* key, size_t key_size){
+  uint64_t hash = 0xcbf29ce484222325ull ^ key_size;
+  while(key_size >= sizeof(uint64_t)){
+    uint64_t word;
+    memcpy(&word, key, sizeof(word));
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 32;
+    key += sizeof(word);
+    key_size -= sizeof(word);
+  }
+  if(key_size > 0){
+    uint64_t word = 0;
+    memcpy(&word, key, key_size);
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+  }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// Return the hash value of the given key (and payload, if the table hashes
+// the payloads)
+uint64_t HashTable::Hash(const char* key, size_t key_size, const char* payload,
+                         uint32_t payload_size) const{
+  uint64_t hash = Hash(key, key_size);
+  if(payloads_)
+    hash ^= Hash(payload, payload_size) * 0x9e3779b97f4a7c15ull;
+  return hash;
+}
+
+// Compare the given record to the given entry
+//
+// Entries are ordered by their key, their payload (if the table hashes the
+// payloads; shorter payloads first) and their id.
+int HashTable::Compare(const char* key, size_t key_size, const char* payload,
+                       uint32_t payload_size, uint64_t id,
+                       const Entry* entry) const{
+  int result = KeyCmp(key, key_size, entry->key(), entry->key_size);
+  if(result != 0)
+    return result;
+  if(payloads_){
+    if(payload_size != entry->payload_size)
+      return (payload_size < entry->payload_size) ? -1 : 1;
+    result = memcmp(payload, entry->payload(), payload_size);
+    if(result != 0)
+      return result;
+  }
+  return (id < entry->id) ? -1 : ((id > entry->id) ? 1 : 0);
+}
+
+// Double the number of buckets (unless another thread did so already)
+//
+// All stripes are latched exclusively (in a fixed order). Every chain is split
+// into two chains, which keeps the order of the entries. If the new buckets
+// can not be allocated, the table keeps its size.
+void HashTable::Grow(size_t bucket_count){
+  for(int i = 0; i < HASH_STRIPE_COUNT; i++)
+    stripes_[i].latch.LockExclusive();
+
+  Entry** buckets = NULL;
+  if(bucket_count_ == bucket_count)
+    buckets = (Entry**) malloc(2 * bucket_count * sizeof(Entry*));
+
+  if(buckets != NULL){
+    CountAllocation();
+    for(size_t i = 0; i < bucket_count; i++){
+      Entry** tails[2] = {&buckets[i], &buckets[i + bucket_count]};
+      Entry* entry = buckets_[i];
+      while(entry != NULL){
+        Entry* next = *Next(entry);
+        int half = (Hash(entry) & bucket_count) ? 1 : 0;
+        *tails[half] = entry;
+        tails[half] = Next(entry);
+        entry = next;
+      }
+      *tails[0] = NULL;
+      *tails[1] = NULL;
+    }
+    free(buckets_);
+    buckets_ = buckets;
+    bucket_count_ = 2 * bucket_count;
+  }
+
+  for(int i = HASH_STRIPE_COUNT; i > 0; i--)
+    stripes_[i-1].latch.UnlockExclusive();
+}
+
+// Add an address inside every page of the buckets to the given vector
+//
+// Holding a single stripe keeps the table from growing, so the buckets can
+// not be freed in the meantime.
+void HashTable::SamplePages(std::vector<void*> *pages){
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  stripes_[0].latch.LockShared();
+  try{
+    char* buckets = (char*) buckets_;
+    size_t size = bucket_count_ * sizeof(Entry*);
+    for(size_t offset = 0; offset < size; offset += page_size)
+      pages->push_back(buckets + offset);
+  } catch(...){
+    stripes_[0].latch.UnlockShared();
+    throw;
+  }
+  stripes_[0].latch.UnlockShared();
+}
+
+// Constructor
+HashCursor::HashCursor(HashTable *table){
+  table_ = table;
+  stripe_ = NULL;
+  entry_ = NULL;
+  key_ = NULL;
+  key_size_ = 0;
+  payload_ = NULL;
+  payload_size_ = 0;
+}
+
+// Destructor
+HashCursor::~HashCursor(){
+  Release();
+}
+
+// Position the cursor on the first entry with the given key (and payload) and
+// an id >= id
+void HashCursor::Seek(const char* key, size_t key_size, uint64_t id,
+                      const Block *payload){
+  Release();
+  key_ = key;
+  key_size_ = key_size;
+  payload_ = (payload != NULL) ? (const char*) payload->data : NULL;
+  payload_size_ = (payload != NULL) ? payload->size : 0;
+
+  uint64_t hash = table_->Hash(key, key_size, payload_, payload_size_);
+  stripe_ = &table_->Stripe(hash);
+  stripe_->latch.LockShared();
+
+  Entry* entry = table_->buckets_[hash & (table_->bucket_count_ - 1)];
+  while((entry != NULL)
+        && (table_->Compare(key, key_size, payload_, payload_size_, id,
+                            entry) > 0))
+    entry = *table_->Next(entry);
+  if((entry != NULL) && !Matches(entry))
+    entry = NULL;
+  entry_ = entry;
+}
+
+// Move the cursor to the next entry with the same key (and payload)
+bool HashCursor::Next(){
+  if(entry_ == NULL)
+    return false;
+
+  entry_ = *table_->Next(entry_);
+  if((entry_ != NULL) && !Matches(entry_))
+    entry_ = NULL;
+  return entry_ != NULL;
+}
+
+// Return whether the given entry holds the key (and payload) looked up
+bool HashCursor::Matches(const Entry *entry) const{
+  if(KeyCmp(key_, key_size_, entry->key(), entry->key_size) != 0)
+    return false;
+  return !table_->payloads()
+         || ((entry->payload_size == payload_size_)
+             && (memcmp(entry->payload(), payload_, payload_size_) == 0));
+}
+
+// Release the latch of the current stripe
+void HashCursor::Release(){
+  entry_ = NULL;
+  if(stripe_ != NULL){
+    stripe_->latch.UnlockShared();
+    stripe_ = NULL;
+  }
+}
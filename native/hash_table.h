@@ -0,0 +1,243 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+/** @file
+ A concurrent hash table mapping encoded keys to their entries.
+
+ It is maintained next to the B+-tree of an index and serves lookups of a
+ single, completely specified key without descending the tree. All entries
+ with the same key (the duplicate chain) are stored next to each other and
+ ordered by their ids, so a lookup returns them in the same order as the tree.
+
+ The buckets are protected by a fixed number of latch stripes. A bucket always
+ belongs to the same stripe, even after the table has grown, so growing only
+ has to acquire all stripes once.
+
+ A second table of every index (the payload table) hashes the key together
+ with the payload and links the entries using their payload_next pointers.
+ Its chains are ordered by key, payload and id, so a lookup of a complete
+ record only reads the copies of that record instead of all duplicates of its
+ key.
+*/
+
+#ifndef _NATIVEIMPL_HASH_TABLE_H_
+#define _NATIVEIMPL_HASH_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include <common/macros.h>
+
+#include "btree.h"
+#include "entry.h"
+#include "latch.h"
+
+// The number of latch stripes (a power of two)
+#define HASH_STRIPE_COUNT 64
+
+// The number of buckets of an empty table (a power of two and a multiple of
+// HASH_STRIPE_COUNT)
+#define HASH_INITIAL_BUCKETS 1024
+
+// The table grows once the entries of a stripe exceed this many entries per
+// bucket on average
+#define HASH_LOAD_FACTOR 2
+
+// A latch stripe
+struct HashStripe{
+  // The number of entries stored inside the buckets of the stripe
+  size_t count;
+
+  // The latch protecting the buckets of the stripe
+  Latch latch;
+
+  // Padding, so that every stripe uses its own cache line
+  char padding[CACHE_LINE_SIZE - sizeof(size_t) - sizeof(Latch)];
+};
+
+// A concurrent hash table holding the entries of a single index
+//
+// The table does not own the entries.
+class HashTable{
+ public:
+  // Constructor (the table hashes the payloads as well if payloads is set)
+  HashTable(bool payloads = false);
+
+  // Destructor
+  ~HashTable();
+
+  // Insert the given entry
+  //
+  // Never throws: if the table can not grow, the chains become longer.
+  void Insert(Entry *entry);
+
+  // Remove the given entry
+  //
+  // Returns false if the entry was not found.
+  bool Remove(const Entry *entry);
+
+  // Replace the payload of the given entry by a payload of the same size
+  //
+  // The entry is moved to the chain of its new payload (if the table hashes
+  // the payloads) without ever being missing from the table.
+  void Overwrite(Entry *entry, const Block &payload);
+
+  // Return the hash value of the given encoded key
+  static uint64_t Hash(const char* key, size_t key_size);
+
+  // Return the latch of the stripe holding the given entry
+  Latch& EntryLatch(const Entry *entry){
+    return Stripe(Hash(entry)).latch;
+  };
+
+  // Return whether the table hashes the payloads as well
+  bool payloads() const { return payloads_; };
+
+  // Return the memory used by the table (without the entries) in bytes
+  size_t MemoryUsage() const {
+    return sizeof(HashTable) + bucket_count_ * sizeof(Entry*);
+  };
+
+  // Add an address inside every page of the buckets to the given vector (see
+  // IndexSchema::CountPlacement())
+  void SamplePages(std::vector<void*> *pages);
+
+ private:
+  // Return the hash value of the given key (and payload, if the table hashes
+  // the payloads)
+  uint64_t Hash(const char* key, size_t key_size, const char* payload,
+                uint32_t payload_size) const;
+
+  // Return the hash value of the given entry
+  uint64_t Hash(const Entry *entry) const {
+    return Hash(entry->key(), entry->key_size, entry->payload(),
+                entry->payload_size);
+  };
+
+  // Return the link to the entry following the given entry inside its chain
+  Entry** Next(Entry *entry) const {
+    return payloads_ ? &entry->payload_next : &entry->hash_next;
+  };
+
+  // Compare the given record to the given entry (the payload is only
+  // compared if the table hashes the payloads)
+  int Compare(const char* key, size_t key_size, const char* payload,
+              uint32_t payload_size, uint64_t id, const Entry* entry) const;
+
+  // Double the number of buckets (unless another thread did so already)
+  void Grow(size_t bucket_count);
+
+  // Return the stripe responsible for the given hash value
+  HashStripe& Stripe(uint64_t hash){
+    return stripes_[hash & (HASH_STRIPE_COUNT - 1)];
+  };
+
+  // The latch stripes
+  HashStripe stripes_[HASH_STRIPE_COUNT];
+
+  // The buckets (each bucket holds a chain of entries ordered by key and id)
+  Entry** volatile buckets_;
+
+  // The number of buckets (a power of two)
+  volatile size_t bucket_count_;
+
+  // Whether the table hashes the payloads as well
+  bool payloads_;
+
+  friend class HashCursor;
+
+  DISALLOW_COPY_AND_ASSIGN(HashTable);
+};
+
+// A cursor used to read all entries with a given key from a hash table
+//
+// While the cursor is positioned, the stripe holding the key is latched in
+// shared mode.
+class HashCursor{
+ public:
+  // Constructor
+  HashCursor(HashTable *table = NULL);
+
+  // Destructor
+  ~HashCursor();
+
+  // Set the table to be read
+  void set_table(HashTable *table){ table_ = table; };
+
+  // Position the cursor on the first entry with the given key and an id >= id
+  //
+  // If the table hashes the payloads, only entries with the given payload are
+  // read. The key and the payload have to stay valid while the cursor is
+  // positioned.
+  void Seek(const char* key, size_t key_size, uint64_t id,
+            const Block *payload = NULL);
+
+  // Move the cursor to the next entry with the same key (and payload)
+  //
+  // Returns false if there is no such entry.
+  bool Next();
+
+  // Release the latch of the current stripe
+  void Release();
+
+  // Whether the cursor points to a valid entry
+  bool valid() const { return entry_ != NULL; };
+
+  // Return the entry the cursor points to
+  Entry* entry() const { return entry_; };
+
+ private:
+  // Return whether the given entry holds the key (and payload) looked up
+  bool Matches(const Entry *entry) const;
+
+  // The table to be read
+  HashTable *table_;
+
+  // The latched stripe (NULL if the cursor has been released)
+  HashStripe *stripe_;
+
+  // The current entry
+  Entry *entry_;
+
+  // The key that is looked up
+  const char *key_;
+
+  // The size of the key
+  size_t key_size_;
+
+  // The payload that is looked up (if the table hashes the payloads)
+  const char *payload_;
+
+  // The size of the payload
+  uint32_t payload_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(HashCursor);
+};
+
+#endif // _NATIVEIMPL_HASH_TABLE_H_
@@ -0,0 +1,1337 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <cstdlib>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include <common/numa.h>
+
+#include "epoch.h"
+#include "index.h"
+#include "iterator.h"
+#include "pool.h"
+#include "transaction.h"
+#include "util.h"
+
+// A batch is loaded by rebuilding the tree if the tree holds at most this many
+// times as many entries as the batch (rebuilding costs much less per entry
+// than inserting, but touches all existing entries)
+#define BULK_REBUILD_FACTOR 16
+
+// The maximum number of partitions of an index
+#define MAX_PARTITIONS 64
+
+// The number of pages whose NUMA nodes are determined at once (see
+// CountPlacement())
+#define PLACEMENT_BATCH_SIZE 1024
+
+// The initial capacity of the ring buffer of retired entries (a power of two)
+#define RETIRED_INITIAL_CAPACITY 1024
+
+// The number of partitions of newly created indices
+static uint32_t partition_count = 1;
+
+// Makes sure that the number of partitions is only read once
+static pthread_once_t partition_once = PTHREAD_ONCE_INIT;
+
+// Read the number of partitions from the environment
+//
+// The environment variable CONTEST_PARTITIONS may be set to a number between 1
+// (the default) and MAX_PARTITIONS.
+static void InitializePartitionCount(){
+  const char* value = getenv("CONTEST_PARTITIONS");
+  if(value == NULL)
+    return;
+  int count = atoi(value);
+  if(count > MAX_PARTITIONS)
+    count = MAX_PARTITIONS;
+  if(count > 1)
+    partition_count = count;
+}
+
+// Return the number of partitions of newly created indices
+static uint32_t GetPartitionCount(){
+  pthread_once(&partition_once, &InitializePartitionCount);
+  return partition_count;
+}
+
+// Whether indices with integer keys use radix trees
+static bool radix_enabled = true;
+
+// Makes sure that the radix tree setting is only read once
+static pthread_once_t radix_once = PTHREAD_ONCE_INIT;
+
+// Read the radix tree setting from the environment
+//
+// Setting the environment variable CONTEST_RADIX to 0 makes all indices use
+// inner nodes, even if their keys consist of SHORT and INT attributes only.
+static void InitializeRadix(){
+  const char* value = getenv("CONTEST_RADIX");
+  if((value != NULL) && (strcmp(value, "0") == 0))
+    radix_enabled = false;
+}
+
+// Return whether an index using the given attribute types uses radix trees
+static bool UseRadix(const AttributeType *types, uint8_t count, size_t size){
+  pthread_once(&radix_once, &InitializeRadix);
+  if(!radix_enabled || (size > RADIX_MAX_KEY_SIZE))
+    return false;
+  for(int i = 0; i < count; i++){
+    if((types[i] != kShort) && (types[i] != kInt))
+      return false;
+  }
+  return true;
+}
+
+// Whether indices with multidimensional integer keys store them in Z-order
+static bool zorder_enabled = false;
+
+// Makes sure that the Z-order setting is only read once
+static pthread_once_t zorder_once = PTHREAD_ONCE_INIT;
+
+// Read the Z-order setting from the environment
+//
+// Setting the environment variable CONTEST_ZORDER to 1 makes indices whose
+// keys consist of several SHORT and INT attributes store them in Z-order.
+static void InitializeZOrder(){
+  const char* value = getenv("CONTEST_ZORDER");
+  if((value != NULL) && (strcmp(value, "1") == 0))
+    zorder_enabled = true;
+}
+
+// Return whether an index using the given attribute types stores its keys in
+// Z-order (see common/key_codec.h)
+static bool UseZOrder(const AttributeType *types, uint8_t count){
+  pthread_once(&zorder_once, &InitializeZOrder);
+  return zorder_enabled && CanInterleave(types, count);
+}
+
+// Whether the VARCHAR attributes of indices are encoded using dictionaries
+static bool dictionary_enabled = false;
+
+// Makes sure that the dictionary setting is only read once
+static pthread_once_t dictionary_once = PTHREAD_ONCE_INIT;
+
+// Read the dictionary setting from the environment
+//
+// Setting the environment variable CONTEST_DICTIONARY to 1 makes indices
+// encode their VARCHAR attributes using a dictionary per attribute.
+static void InitializeDictionary(){
+  const char* value = getenv("CONTEST_DICTIONARY");
+  if((value != NULL) && (strcmp(value, "1") == 0))
+    dictionary_enabled = true;
+}
+
+// Return whether an index using the given attribute types encodes its VARCHAR
+// attributes using dictionaries (see dictionary.h)
+static bool UseDictionaries(const AttributeType *types, uint8_t count){
+  pthread_once(&dictionary_once, &InitializeDictionary);
+  if(!dictionary_enabled)
+    return false;
+  for(int i = 0; i < count; i++){
+    if(types[i] == kVarchar)
+      return true;
+  }
+  return false;
+}
+
+// The owner stored in the lock words of entries that are modified outside of
+// any transaction (see Index::ModifySingle())
+static const uint32_t autocommit_owner = 0;
+
+// Return the value of the lock word for entries locked outside of any
+// transaction
+static inline uintptr_t AutocommitLockWord(EntryState state){
+  return reinterpret_cast<uintptr_t>(&autocommit_owner) | state;
+}
+
+// Constructor for Index
+Index::Index(const char* name){
+  name_ = name;
+  schema_ = NULL;
+  iterators_ = NULL;
+  closed_ = true;
+}
+
+// Destructor for Index
+Index::~Index(){
+  Close();
+}
+
+// Opens an index
+ErrorCode Index::Open(const char* name, Index** index){
+  *index = new Index(name);
+
+  // The schema can not be deleted before the handle has been registered (and
+  // is closed by the deletion afterwards)
+  EnterEpoch();
+  try{
+    // Try to get the structure of the requested index
+    if(!((*index)->schema_ = IndexManager::getInstance().Find(name))){
+      LeaveEpoch();
+      delete *index;
+      *index = NULL;
+      return kErrorUnknownIndex;
+    }
+
+    // Initialize the structure
+    (*index)->schema_->RegisterHandle(*index);
+  } catch(...){
+    LeaveEpoch();
+    delete *index;
+    *index = NULL;
+    throw;
+  }
+  LeaveEpoch();
+
+  // The index was successfully opened
+  (*index)->closed_ = false;
+
+  return kOk;
+}
+
+// Close the index
+void Index::Close(){
+  if(CloseUnregistered() && (schema_ != NULL)){
+    schema_->UnregisterHandle(this);
+  }
+}
+
+// Close the index without unregistering it from its schema
+//
+// All iterators that use this handle are closed while holding the mutex, as
+// their owners may close them at the same time (see CloseIterator()). Returns
+// false if the handle has been closed already.
+bool Index::CloseUnregistered(){
+  lock(mutex_){
+    if(closed_)
+      return false;
+    closed_ = true;
+    while(iterators_ != NULL)
+      iterators_->CloseRegistered();
+  }
+  return true;
+}
+
+// Insert the given record into the index
+ErrorCode Index::Insert(Transaction *tx, Record *record){
+  // If the insert occured inside a larger transaction, then add
+  // the transaction to the set of open transactions
+  if(tx != NULL){
+    if(!tx->UseIndex(schema_))
+      return kErrorUnknownIndex;
+  }
+
+  // Create the new entry
+  char* key = KeyBuffer(schema_->size());
+  size_t key_size = schema_->GetEncodedKey(record->key, key);
+  Entry* entry = NewEntry(key, key_size, record->payload);
+
+  // Lock the entry until the transaction has been resolved
+  if(tx != NULL){
+    entry->lock = tx->LockWord(kPendingInsert);
+    tx->LogInsert(schema_, entry);
+    schema_->Insert(entry);
+    return kOk;
+  }
+
+  // Without a transaction, the insert is counted as an operation of its own
+  // (see IndexSchema::BulkLoad()) and the entry is committed right away
+  uint32_t stripe = CurrentStripe();
+  if(!schema_->BeginOperation(stripe)){
+    FreeEntry(entry);
+    return kErrorUnknownIndex;
+  }
+  try{
+    schema_->Insert(entry);
+  } catch(...){
+    schema_->EndOperation(stripe);
+    throw;
+  }
+  PublishEntries(&entry, 1);
+  schema_->EndOperation(stripe);
+
+  return kOk;
+}
+
+// Update the given record with the given payload
+ErrorCode Index::Update(Transaction *tx, Record *record, Block *payload, uint8_t flags){
+  if(tx != NULL)
+    return Modify(tx, record, payload, flags);
+
+  // Wrap the update into its own transaction
+  return ModifyAutocommit(record, payload, flags);
+}
+
+// Delete the given record
+ErrorCode Index::Delete(Transaction *tx, Record *record, uint8_t flags){
+  if(tx != NULL)
+    return Modify(tx, record, NULL, flags);
+
+  // Wrap the deletion into its own transaction
+  return ModifyAutocommit(record, NULL, flags);
+}
+
+// Insert the given batch of records outside of any transaction
+//
+// The entries are created and sorted before the tree is touched, so the tree
+// can be built from the sorted batch in a single pass.
+ErrorCode Index::BulkLoad(Record *records, uint32_t count){
+  std::vector<Entry*> entries;
+  entries.reserve(count);
+  try{
+    char* key = KeyBuffer(schema_->size());
+    for(uint32_t i = 0; i < count; i++){
+      size_t key_size = schema_->GetEncodedKey(records[i].key, key);
+      entries.push_back(NewEntry(key, key_size, records[i].payload));
+    }
+
+    if(count > 0){
+      SortEntries(&entries[0], count);
+      if(!schema_->BulkLoad(this, &entries[0], count)){
+        for(uint32_t i = 0; i < count; i++)
+          FreeEntry(entries[i]);
+        return kErrorUnknownIndex;
+      }
+      PublishEntries(&entries[0], count);
+    }
+  } catch(...){
+    for(size_t i = 0; i < entries.size(); i++)
+      FreeEntry(entries[i]);
+    throw;
+  }
+
+  return kOk;
+}
+
+// Delete all records matching the given record and (if payload is not NULL)
+// insert them again using the new payload
+//
+// Matching records are locked without waiting: if a matching record is
+// locked by another transaction (or, at snapshot isolation, has been deleted
+// by a transaction that committed after the snapshot was taken), all changes
+// made by this call are undone and kErrorDeadlock is returned (unless
+// kMatchDuplicates is not set and another matching record could be locked
+// instead). In optimistic mode, committed entries are not locked before the
+// transaction commits.
+//
+// The record is looked up using the hash table of the index, which keeps all
+// entries with the same key together, or (if the payload has to match as
+// well) using the payload table, which only reads the copies of the record
+// itself. Records inserted by the transaction
+// itself are updated in place if the size of the payload does not change.
+ErrorCode Index::Modify(Transaction *tx, Record *record, Block *payload, uint8_t flags){
+  if(!tx->UseIndex(schema_))
+    return kErrorUnknownIndex;
+
+  bool ignore_payload = (flags & kIgnorePayload);
+  bool match_duplicates = (flags & kMatchDuplicates);
+  size_t savepoint = tx->Savepoint();
+
+  // Convert the key of the record (both buffers belong to the calling thread)
+  char* key = KeyBuffer(schema_->size());
+  size_t key_size = schema_->GetEncodedKey(record->key, key);
+
+  // Find and lock all matching entries
+  std::vector<Entry*>& matches = EntryBuffer();
+  bool conflict = false;
+  try{
+    HashCursor cursor(ignore_payload ? schema_->hash_table()
+                                     : schema_->payload_table());
+    for(cursor.Seek(key, key_size, 0, &record->payload); cursor.valid();
+        cursor.Next()){
+      Entry* entry = cursor.entry();
+
+      if(!Visible(entry, tx, tx->snapshot()) || tx->Deletes(entry))
+        continue;
+
+      uintptr_t lock_word = entry->lock;
+      bool own = ((lock_word & ~ENTRY_STATE_MASK) == (uintptr_t) tx);
+      if(tx->optimistic() && !own){
+        // Defer locking the entry until the transaction commits
+        matches.push_back(entry);
+        tx->LogDeferredDelete(schema_, entry);
+      } else if(lock_word == 0){
+        // Lock a committed entry
+        if(!__sync_bool_compare_and_swap(&entry->lock, 0,
+                                         tx->LockWord(kPendingDelete))){
+          conflict = true;
+          continue;
+        }
+        // The entry has been deleted by a transaction that committed after
+        // the snapshot of this transaction was taken (snapshot isolation)
+        if(entry->end != TIMESTAMP_INFINITY){
+          entry->lock = 0;
+          conflict = true;
+          continue;
+        }
+        matches.push_back(entry);
+        tx->LogDelete(schema_, entry);
+      } else if(own && (payload != NULL)
+                && (lock_word == tx->LockWord(kPendingInsert))
+                && (entry->payload_size == payload->size)){
+        // An entry inserted by this transaction is invisible to all others,
+        // so it keeps its place and only gets the new payload (see below)
+        matches.push_back(entry);
+      } else if(own){
+        // Delete an entry that has been inserted by this transaction
+        entry->lock = lock_word | kPendingDelete;
+        matches.push_back(entry);
+        tx->LogDeleteOwn(schema_, entry);
+      } else {
+        // The entry is locked by another transaction
+        conflict = true;
+        continue;
+      }
+
+      if(!match_duplicates)
+        break;
+    }
+  } catch(...){
+    tx->Rollback(savepoint);
+    throw;
+  }
+
+  if(conflict && (match_duplicates || matches.empty())){
+    tx->Rollback(savepoint);
+    return kErrorDeadlock;
+  }
+
+  if(matches.empty())
+    return kErrorNotFound;
+
+  // Insert the updated records (entries inserted by this transaction that
+  // have not been deleted are overwritten in place)
+  if(payload != NULL){
+    for(size_t i = 0; i < matches.size(); i++){
+      if(matches[i]->lock == tx->LockWord(kPendingInsert)){
+        schema_->OverwritePayload(matches[i], *payload);
+        continue;
+      }
+      Entry* entry = NewEntry(matches[i]->key(), matches[i]->key_size, *payload);
+      entry->lock = tx->LockWord(kPendingInsert);
+      tx->LogInsert(schema_, entry);
+      schema_->Insert(entry);
+    }
+  }
+
+  return kOk;
+}
+
+// Call Modify() inside a transaction of its own and commit it
+//
+// Unless duplicates have to be matched, only a single record is changed,
+// which does not need a transaction at all (see ModifySingle()); it is only
+// counted as an operation on the index schema (see IndexSchema::BulkLoad()).
+// Otherwise the transaction is taken from the pool of the calling thread (see
+// pool.h).
+ErrorCode Index::ModifyAutocommit(Record *record, Block *payload, uint8_t flags){
+  if(!(flags & kMatchDuplicates)){
+    uint32_t stripe = CurrentStripe();
+    if(!schema_->BeginOperation(stripe))
+      return kErrorUnknownIndex;
+    ErrorCode result;
+    try{
+      result = ModifySingle(record, payload, flags);
+    } catch(...){
+      schema_->EndOperation(stripe);
+      throw;
+    }
+    schema_->EndOperation(stripe);
+    return result;
+  }
+
+  Transaction* autocommit = NewTransaction();
+  ErrorCode result;
+  try{
+    result = Modify(autocommit, record, payload, flags);
+  } catch(...){
+    DeleteTransaction(autocommit);
+    throw;
+  }
+
+  if(result != kOk)
+    autocommit->Abort();
+  else if(!autocommit->Commit())
+    result = kErrorDeadlock;
+  DeleteTransaction(autocommit);
+  return result;
+}
+
+// Delete the first record matching the given record outside of any
+// transaction and (if payload is not NULL) insert it again using the new
+// payload
+//
+// The matching entry is locked like it would be by a transaction, and the new
+// entry is inserted while locked as well, so neither change is visible before
+// both are published at once. As nothing else has to be undone, no log and no
+// snapshot are needed (the caller counts the operation on the index schema,
+// see ModifyAutocommit()). Entries
+// locked or inserted by a transaction (or deleted in the meantime) are
+// skipped; if no other entry matches, kErrorDeadlock is returned.
+//
+// At read committed, a new payload of the same size overwrites the old one in
+// place instead (see IndexSchema::OverwritePayload()).
+ErrorCode Index::ModifySingle(Record *record, Block *payload, uint8_t flags){
+  bool ignore_payload = (flags & kIgnorePayload);
+
+  // Convert the key of the record
+  char* key = KeyBuffer(schema_->size());
+  size_t key_size = schema_->GetEncodedKey(record->key, key);
+
+  // Find and lock the first matching entry
+  Entry* match = NULL;
+  bool conflict = false;
+  {
+    HashCursor cursor(ignore_payload ? schema_->hash_table()
+                                     : schema_->payload_table());
+    for(cursor.Seek(key, key_size, 0, &record->payload); cursor.valid();
+        cursor.Next()){
+      Entry* entry = cursor.entry();
+
+      // An uncommitted insert may replace an entry that is deleted before
+      // the cursor reaches it
+      if(entry->lock & kPendingInsert){
+        conflict = true;
+        continue;
+      }
+
+      if(!Visible(entry, NULL, TIMESTAMP_LATEST))
+        continue;
+
+      if(!__sync_bool_compare_and_swap(&entry->lock, 0,
+                                       AutocommitLockWord(kPendingDelete))){
+        conflict = true;
+        continue;
+      }
+      // The entry has been deleted by a transaction that committed in the
+      // meantime (snapshot isolation)
+      if(entry->end != TIMESTAMP_INFINITY){
+        entry->lock = 0;
+        conflict = true;
+        continue;
+      }
+      match = entry;
+      break;
+    }
+  }
+
+  if(match == NULL)
+    return conflict ? kErrorDeadlock : kErrorNotFound;
+
+  // At read committed, no snapshot needs the old payload, so a payload of the
+  // same size simply replaces it
+  if((payload != NULL) && (payload->size == match->payload_size)
+     && (GetIsolationLevel() == kReadCommitted)){
+    schema_->OverwritePayload(match, *payload);
+    match->lock = 0;
+    return kOk;
+  }
+
+  // Insert the updated record
+  Entry* entry = NULL;
+  if(payload != NULL){
+    try{
+      entry = NewEntry(match->key(), match->key_size, *payload);
+      entry->lock = AutocommitLockWord(kPendingInsert);
+      schema_->Insert(entry);
+    } catch(...){
+      if(entry != NULL)
+        FreeEntry(entry);
+      match->lock = 0;
+      throw;
+    }
+  }
+
+  // Publish both changes (see Transaction::Commit()). The new entry is
+  // unlocked first, so that concurrent updates always find one of both
+  // entries.
+  if(GetIsolationLevel() == kReadCommitted){
+    if(entry != NULL){
+      entry->begin = 0;
+      entry->lock = 0;
+    }
+    schema_->Remove(match);
+    FreeEntry(match);
+  } else {
+    uint64_t timestamp = BeginCommit();
+    if(entry != NULL){
+      entry->begin = timestamp;
+      entry->lock = 0;
+    }
+    match->end = timestamp;
+    match->lock = 0;
+    EndCommit(timestamp);
+    schema_->RetireEntry(match);
+    schema_->CollectGarbage();
+  }
+
+  return kOk;
+}
+
+// Checks whether the given record is compatible with this index
+bool Index::Compatible(Record *record){
+  if((record == NULL) || closed_)
+    return false;
+
+  return Compatible(record->key);
+}
+
+// Checks whether the given key is compatible with this index
+bool Index::Compatible(Key &key){
+  if(closed_)
+    return false;
+
+  return schema_->Compatible(key);
+}
+
+// Register a new iterator handle
+//
+// The open iterators are linked into a list through their own members, which
+// needs no allocation. The list is protected by the mutex of the handle, as
+// the handle may be closed by a thread deleting the index. The registration
+// is counted as an operation on the index schema, so that BulkLoad() either
+// sees the iterator or finishes rebuilding the trees before it is registered
+// (the operation is started before the mutex is locked, as BulkLoad() locks
+// it while the index is quiesced). A read-only index is not rebuilt anymore.
+bool Index::RegisterIterator(Iterator* iterator){
+  uint32_t stripe = CurrentStripe();
+  bool counted = schema_->BeginOperation(stripe);
+  bool registered = false;
+  lock(mutex_){
+    if(!closed_){
+      if(iterator != NULL){
+        iterator->previous_ = NULL;
+        iterator->next_ = iterators_;
+        if(iterators_ != NULL)
+          iterators_->previous_ = iterator;
+        iterators_ = iterator;
+      }
+      registered = true;
+    }
+  }
+  if(counted)
+    schema_->EndOperation(stripe);
+  return registered;
+}
+
+// Unregister an iterator (iterators that have not been registered are ignored)
+void Index::UnregisterIterator(Iterator* iterator){
+  if((iterator->previous_ == NULL) && (iterators_ != iterator))
+    return;
+
+  if(iterator->previous_ != NULL)
+    iterator->previous_->next_ = iterator->next_;
+  else
+    iterators_ = iterator->next_;
+  if(iterator->next_ != NULL)
+    iterator->next_->previous_ = iterator->previous_;
+  iterator->previous_ = NULL;
+  iterator->next_ = NULL;
+}
+
+// Close the given iterator that has been opened on this handle
+//
+// Holding the mutex makes sure that Close() does not close the iterator at the
+// same time, so the iterator can be released as soon as this returns.
+void Index::CloseIterator(Iterator* iterator){
+  lock(mutex_){
+    iterator->CloseRegistered();
+  }
+}
+
+// Return whether iterators are open on this handle
+bool Index::HasIterators(){
+  lock(mutex_){
+    return iterators_ != NULL;
+  }
+  return false;
+}
+
+// Constructor for IndexSchema
+IndexSchema::IndexSchema(uint8_t attribute_count, KeyType type){
+  attribute_count_ = attribute_count;
+  type_ = new AttributeType[attribute_count];
+  size_ = 0;
+  state_ = kWritable;
+  bool dictionaries = UseDictionaries(type, attribute_count);
+
+  // Build the size and copy the type array
+  for(int i = 0; i < attribute_count; i++){
+    if(dictionaries && (type[i] == kVarchar))
+      size_ += DICTIONARY_MAX_ENCODED_SIZE;
+    else
+      size_ += MaxEncodedAttributeSize(type[i]);
+    type_[i] = type[i];
+  }
+  comparator_ = SelectComparator(type_, attribute_count_);
+  radix_ = UseRadix(type_, attribute_count_, size_);
+  zorder_ = UseZOrder(type_, attribute_count_);
+  if(zorder_)
+    InitZOrderLayout(&zorder_layout_, type_, attribute_count_);
+  retired_first_ = 0;
+  retired_count_ = 0;
+
+  partition_count_ = GetPartitionCount();
+  trees_ = NULL;
+  hash_ = NULL;
+  payload_hash_ = NULL;
+  dictionaries_ = NULL;
+  try{
+    trees_ = new BTree*[partition_count_]();
+    for(uint32_t i = 0; i < partition_count_; i++)
+      trees_[i] = new BTree(this);
+    hash_ = new HashTable();
+    payload_hash_ = new HashTable(true);
+    if(dictionaries){
+      dictionaries_ = new Dictionary*[attribute_count_]();
+      for(int i = 0; i < attribute_count_; i++){
+        if(type_[i] == kVarchar)
+          dictionaries_[i] = new Dictionary();
+      }
+    }
+  } catch(...){
+    DeleteDictionaries();
+    delete payload_hash_;
+    delete hash_;
+    DeleteTrees();
+    delete[] type_;
+    throw;
+  }
+
+  void* counters;
+  if(posix_memalign(&counters, CACHE_LINE_SIZE,
+                    TRANSACTION_STRIPES * sizeof(TransactionCounter)) != 0){
+    DeleteDictionaries();
+    delete payload_hash_;
+    delete hash_;
+    DeleteTrees();
+    delete[] type_;
+    throw std::bad_alloc();
+  }
+  CountAllocation();
+  counters_ = (TransactionCounter*) counters;
+  for(int i = 0; i < TRANSACTION_STRIPES; i++)
+    counters_[i].count = 0;
+}
+
+// Destructor for IndexSchema
+IndexSchema::~IndexSchema(){
+  // Close all open Handles of this structure
+  CloseHandles();
+  free(counters_);
+  delete payload_hash_;
+  delete hash_;
+  DeleteTrees();
+  DeleteDictionaries();
+  delete[] type_;
+}
+
+// Delete all trees (and the entries they hold)
+void IndexSchema::DeleteTrees(){
+  if(trees_ == NULL)
+    return;
+  for(uint32_t i = 0; i < partition_count_; i++)
+    delete trees_[i];
+  delete[] trees_;
+  trees_ = NULL;
+}
+
+// Delete all dictionaries
+void IndexSchema::DeleteDictionaries(){
+  if(dictionaries_ == NULL)
+    return;
+  for(int i = 0; i < attribute_count_; i++)
+    delete dictionaries_[i];
+  delete[] dictionaries_;
+  dictionaries_ = NULL;
+}
+
+// Return the partition the given entry belongs to
+//
+// The upper half of the hash is used, as the hash table selects its buckets
+// using the lower bits.
+uint32_t IndexSchema::Partition(const Entry *entry) const{
+  if(partition_count_ == 1)
+    return 0;
+  uint64_t hash = HashTable::Hash(entry->key(), entry->key_size);
+  return (hash >> 32) % partition_count_;
+}
+
+// Create a new index schema
+ErrorCode IndexSchema::Create(const char* name, uint8_t column_count, KeyType types){
+  IndexSchema* schema = new IndexSchema(column_count, types);
+
+  // Insert new Index into the catalog
+  bool inserted;
+  try{
+    inserted = IndexManager::getInstance().Insert(name, schema);
+  } catch(...){
+    delete schema;
+    throw;
+  }
+  if(!inserted){
+    delete schema;
+    return kErrorIndexExists;
+  }
+
+  return kOk;
+}
+
+// Convert the given encoded key to a key of this index
+Key IndexSchema::GetKey(const char *encoded_key) const{
+  // Create the new key object
+  Key key;
+  key.value = (Attribute**) malloc(attribute_count_*sizeof(Attribute*));
+  key.attribute_count = attribute_count_;
+
+  for(int i = 0; i < attribute_count_; i++){
+    // Create the attribute
+    key.value[i] = (Attribute*) malloc(sizeof(Attribute));
+  }
+  DecodeKey(encoded_key, key);
+
+  return key;
+}
+
+// Decode the given encoded key into the attributes of the given key
+void IndexSchema::DecodeKey(const char *encoded_key, Key &key) const{
+  if(zorder_){
+    DecodeZOrderKey(&zorder_layout_, encoded_key, key);
+    return;
+  }
+  for(int i = 0; i < attribute_count_; i++){
+    if((dictionaries_ != NULL) && (dictionaries_[i] != NULL))
+      encoded_key += dictionaries_[i]->Decode(encoded_key, key.value[i]);
+    else
+      encoded_key += DecodeAttribute(type_[i], encoded_key, key.value[i]);
+  }
+}
+
+// Encode the given Key of this index (stored in data)
+//
+// If an attribute of the key is NULL, a wildcard is set depending on whether
+// it is a maximum or minimum key. The attributes are interleaved if the index
+// stores its keys in Z-order. VARCHAR attributes are replaced by their codes
+// if the index uses dictionaries (which may add the values to them).
+size_t IndexSchema::GetEncodedKey(Key key, char *data, bool max) const{
+  if(zorder_)
+    return EncodeZOrderKey(&zorder_layout_, key, data, max);
+  if(dictionaries_ == NULL)
+    return EncodeKey(type_, attribute_count_, key, data, max);
+
+  size_t offset = 0;
+  for(int i = 0; i < attribute_count_; i++){
+    if(dictionaries_[i] != NULL)
+      offset += dictionaries_[i]->Encode(key.value[i], data+offset, max);
+    else
+      offset += EncodeAttribute(type_[i], key.value[i], data+offset, max);
+  }
+  return offset;
+}
+
+// Checks whether the given key is compatible with this schema
+bool IndexSchema::Compatible(Key &key){
+  if(key.attribute_count != attribute_count_)
+    return false;
+
+  for(int i = 0; i < key.attribute_count; i++){
+    if(key.value[i]){
+      if(key.value[i]->type != type_[i])
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// Register a new index handle
+void IndexSchema::RegisterHandle(Index* handle){
+  lock(mutex_){
+    handles_.insert(handle);
+  }
+}
+
+// Unregister an index handle
+void IndexSchema::UnregisterHandle(Index* handle){
+  lock(mutex_){
+    handles_.erase(handle);
+  }
+}
+
+// Close all registered handles
+//
+// The handles are closed while holding the mutex, so their owners can not
+// delete them in the meantime (Index::Close() waits for the mutex to
+// unregister them).
+void IndexSchema::CloseHandles(){
+  lock(mutex_){
+    std::set<Index*>::iterator it;
+    for(it = handles_.begin(); it != handles_.end(); ++it)
+      (*it)->CloseUnregistered();
+    handles_.clear();
+  }
+}
+
+// Start a new modifying transaction on this index
+bool IndexSchema::BeginTransaction(Transaction *tx){
+  return BeginOperation(tx->stripe());
+}
+
+// End a modifying transaction on this index
+void IndexSchema::EndTransaction(Transaction *tx){
+  EndOperation(tx->stripe());
+}
+
+// Start an operation on this index that must not overlap with a rebuild of
+// the trees
+//
+// Besides transactions, autocommit modifications and the registration of
+// iterators are counted (see BulkLoad()). The operation is counted on the
+// counter of the given stripe, which is usually only written by threads
+// running on the same core. This function returns false if the index is
+// read-only (otherwise, true). While another thread checks whether the index
+// is quiescent, it waits for the outcome.
+bool IndexSchema::BeginOperation(uint32_t stripe){
+  volatile int64_t* count = &counters_[stripe].count;
+  while(true){
+    // The increment has to be visible before the state is read (and the other
+    // way around in Quiesce())
+    __sync_fetch_and_add(count, 1);
+    uint32_t state = state_;
+    if(state == kWritable)
+      return true;
+
+    __sync_fetch_and_sub(count, 1);
+    if(state == kReadOnly)
+      return false;
+    while(state_ == kQuiescing)
+      sched_yield();
+  }
+}
+
+// End an operation started by BeginOperation()
+void IndexSchema::EndOperation(uint32_t stripe){
+  __sync_fetch_and_sub(&counters_[stripe].count, 1);
+}
+
+// Try to make this index read-only
+//
+// This function will return false if currently unresolved transactions have
+// written to this index.
+bool IndexSchema::MakeReadOnly(){
+  if(!Quiesce())
+    return false;
+  state_ = kReadOnly;
+  return true;
+}
+
+// Block new modifying transactions if no transaction is unresolved
+//
+// Returns false (without blocking anything) if a transaction is unresolved or
+// the index is read-only. Otherwise, new transactions wait until Resume() is
+// called or the index is made read-only.
+bool IndexSchema::Quiesce(){
+  while(!__sync_bool_compare_and_swap(&state_, kWritable, kQuiescing)){
+    if(state_ == kReadOnly)
+      return false;
+    sched_yield();
+  }
+
+  int64_t unresolved = 0;
+  for(int i = 0; i < TRANSACTION_STRIPES; i++)
+    unresolved += counters_[i].count;
+  if(unresolved == 0)
+    return true;
+
+  state_ = kWritable;
+  return false;
+}
+
+// Allow new modifying transactions again after Quiesce()
+void IndexSchema::Resume(){
+  state_ = kWritable;
+}
+
+// Insert the given entry into the tree and the hash table
+void IndexSchema::Insert(Entry *entry){
+  trees_[Partition(entry)]->Insert(entry);
+  hash_->Insert(entry);
+  payload_hash_->Insert(entry);
+}
+
+// Remove the given entry from the tree and the hash tables
+void IndexSchema::Remove(const Entry *entry){
+  hash_->Remove(entry);
+  payload_hash_->Remove(entry);
+  trees_[Partition(entry)]->Remove(entry);
+}
+
+// Replace the payload of the given entry by a payload of the same size
+//
+// The entry stays where it is. Its leaf and its hash table stripe are latched
+// exclusively while the payload is copied, so readers of the tree and of the
+// hash table see either the old or the new payload. The payload table orders
+// the entries by their payloads, so the entry is moved to its new chain while
+// the latches are still held (see HashTable::Overwrite()): an exact-match
+// lookup never misses it. Nothing is allocated.
+void IndexSchema::OverwritePayload(Entry *entry, const Block &payload){
+  LeafNode* leaf = trees_[Partition(entry)]->LatchLeaf(entry);
+  Latch& stripe = hash_->EntryLatch(entry);
+  stripe.LockExclusive();
+  payload_hash_->Overwrite(entry, payload);
+  stripe.UnlockExclusive();
+  leaf->latch.UnlockExclusive();
+}
+
+// Insert the given entries (sorted by key and id) using the given handle
+//
+// If the handle is the only user of this index (no other handles, no open
+// iterators and no unresolved operations), no other thread can access the
+// tree, so it is rebuilt from completely filled nodes. The index is quiesced
+// before the iterators are checked, as iterators are registered and other
+// threads may use the same handle for autocommit operations (see
+// BeginOperation()). As a rebuild has to touch every entry of the tree, this
+// is only done if the tree is small compared to the batch. Otherwise, the
+// entries are inserted one by one, which still benefits from their order.
+// Returns false if the index is read-only.
+//
+// If inserting an entry fails, the entries inserted so far are removed again
+// before the exception is passed on.
+bool IndexSchema::BulkLoad(Index *handle, Entry **entries, size_t count){
+  lock(mutex_){
+    if(state_ == kReadOnly)
+      return false;
+
+    if((handles_.size() == 1) && (*handles_.begin() == handle)
+       && (EstimateSize() <= BULK_REBUILD_FACTOR*count) && Quiesce()){
+      if(!handle->HasIterators()){
+        try{
+          Rebuild(entries, count);
+        } catch(...){
+          Resume();
+          throw;
+        }
+        for(size_t i = 0; i < count; i++){
+          hash_->Insert(entries[i]);
+          payload_hash_->Insert(entries[i]);
+        }
+        Resume();
+        return true;
+      }
+      Resume();
+    }
+  }
+
+  uint32_t stripe = CurrentStripe();
+  if(!BeginOperation(stripe))
+    return false;
+
+  size_t i = 0;
+  try{
+    for(; i < count; i++)
+      Insert(entries[i]);
+  } catch(...){
+    while(i > 0)
+      Remove(entries[--i]);
+    EndOperation(stripe);
+    throw;
+  }
+  EndOperation(stripe);
+  return true;
+}
+
+// Count the records of the index and the memory they use in bytes
+//
+// Besides the trees (including the entries), the memory used by the hash tables
+// and the dictionaries is counted. Holding the mutex prevents BulkLoad() from rebuilding the trees
+// in the meantime.
+void IndexSchema::CountMemory(uint64_t *records, uint64_t *bytes){
+  *records = 0;
+  *bytes = 0;
+  lock(mutex_){
+    for(uint32_t i = 0; i < partition_count_; i++)
+      trees_[i]->CountMemory(records, bytes);
+    *bytes += hash_->MemoryUsage() + payload_hash_->MemoryUsage();
+    for(int i = 0; (dictionaries_ != NULL) && (i < attribute_count_); i++){
+      if(dictionaries_[i] != NULL)
+        *bytes += dictionaries_[i]->MemoryUsage();
+    }
+  }
+}
+
+// Count the sampled pages of the index per NUMA node
+//
+// The leaves of the trees, the first entry of every leaf and all pages of the
+// hash tables are sampled. Pages that have been freed since they were sampled
+// are not counted.
+bool IndexSchema::CountPlacement(uint32_t node_count, uint64_t *pages){
+  std::vector<void*> samples;
+  lock(mutex_){
+    for(uint32_t i = 0; i < partition_count_; i++)
+      trees_[i]->SamplePages(&samples);
+    hash_->SamplePages(&samples);
+    payload_hash_->SamplePages(&samples);
+  }
+
+  uintptr_t mask = ~((uintptr_t) sysconf(_SC_PAGESIZE) - 1);
+  for(size_t i = 0; i < samples.size(); i++)
+    samples[i] = (void*) ((uintptr_t) samples[i] & mask);
+
+  for(uint32_t n = 0; n < node_count; n++)
+    pages[n] = 0;
+  int nodes[PLACEMENT_BATCH_SIZE];
+  for(size_t i = 0; i < samples.size(); i += PLACEMENT_BATCH_SIZE){
+    size_t count = std::min(samples.size() - i, (size_t) PLACEMENT_BATCH_SIZE);
+    if(!NumaPageNodes(&samples[i], count, nodes))
+      return false;
+    for(size_t j = 0; j < count; j++){
+      if((nodes[j] >= 0) && ((uint32_t) nodes[j] < node_count))
+        pages[nodes[j]]++;
+    }
+  }
+  return true;
+}
+
+// Return an upper bound of the number of entries stored inside the trees
+size_t IndexSchema::EstimateSize() const{
+  size_t size = 0;
+  for(uint32_t i = 0; i < partition_count_; i++)
+    size += trees_[i]->EstimateSize();
+  return size;
+}
+
+// Merge the given entries (sorted by key and id) with the entries of the
+// trees and rebuild all trees
+//
+// The entries are split up by partition first, which keeps them sorted. If
+// rebuilding a tree fails, the entries are removed from the trees that have
+// already been rebuilt before the exception is passed on.
+void IndexSchema::Rebuild(Entry **entries, size_t count){
+  if(partition_count_ == 1){
+    trees_[0]->Rebuild(entries, count);
+    return;
+  }
+
+  std::vector<std::vector<Entry*> > partitions(partition_count_);
+  for(size_t i = 0; i < count; i++)
+    partitions[Partition(entries[i])].push_back(entries[i]);
+
+  uint32_t p = 0;
+  try{
+    for(; p < partition_count_; p++){
+      std::vector<Entry*> &partition = partitions[p];
+      if(!partition.empty())
+        trees_[p]->Rebuild(&partition[0], partition.size());
+    }
+  } catch(...){
+    while(p > 0){
+      p--;
+      for(size_t i = 0; i < partitions[p].size(); i++)
+        trees_[p]->Remove(partitions[p][i]);
+    }
+    throw;
+  }
+}
+
+// Hand a deleted entry over to the garbage collection (snapshot isolation)
+//
+// If the entry can not be queued, it stays inside the tree, where it is not
+// visible to any new snapshot, until the index is deleted.
+void IndexSchema::RetireEntry(Entry *entry){
+  lock(retired_mutex_){
+    if(retired_count_ == retired_.size()){
+      // Double the ring buffer, moving the oldest entry to its beginning
+      std::vector<Entry*> retired;
+      try{
+        retired.resize(std::max(2 * retired_.size(),
+                                (size_t) RETIRED_INITIAL_CAPACITY));
+      } catch(std::bad_alloc &e){
+        return;
+      }
+      CountAllocation();
+      for(size_t i = 0; i < retired_count_; i++)
+        retired[i] = retired_[(retired_first_ + i) & (retired_.size() - 1)];
+      retired_.swap(retired);
+      retired_first_ = 0;
+    }
+
+    retired_[(retired_first_ + retired_count_) & (retired_.size() - 1)] =
+      entry;
+    retired_count_++;
+  }
+}
+
+// Remove all retired entries that are not visible in any snapshot
+//
+// Entries are removed in the order they have been retired, so an entry that is
+// still visible delays the removal of the entries retired after it.
+void IndexSchema::CollectGarbage(){
+  uint64_t oldest = OldestSnapshot();
+  while(true){
+    Entry* entry = NULL;
+    lock(retired_mutex_){
+      if((retired_count_ > 0) && (retired_[retired_first_]->end <= oldest)){
+        entry = retired_[retired_first_];
+        retired_first_ = (retired_first_ + 1) & (retired_.size() - 1);
+        retired_count_--;
+      }
+    }
+    if(entry == NULL)
+      break;
+
+    Remove(entry);
+    FreeEntry(entry);
+  }
+}
+
+pthread_once_t IndexManager::once_ = PTHREAD_ONCE_INIT;
+IndexManager* IndexManager::instance_;
+
+// Return the singleton instance of IndexManager
+IndexManager& IndexManager::getInstance(){
+  pthread_once(&once_, &Initialize);
+  return *instance_;
+}
+
+// Constructor for IndexManager
+IndexManager::IndexManager(){
+  catalog_ = new Catalog();
+}
+
+// Destructor for IndexManager
+IndexManager::~IndexManager(){
+  delete catalog_;
+}
+
+// Returns the index schema with the given name
+IndexSchema* IndexManager::Find(const char* name){
+  const Catalog* catalog = catalog_;
+
+  // Binary search for the name
+  size_t begin = 0;
+  size_t end = catalog->size();
+  while(begin < end){
+    size_t middle = begin + (end - begin) / 2;
+    int cmp = strcmp((*catalog)[middle].first.c_str(), name);
+    if(cmp == 0)
+      return (*catalog)[middle].second;
+    if(cmp < 0)
+      begin = middle + 1;
+    else
+      end = middle;
+  }
+  return NULL;
+}
+
+// Insert a index schema (returns false if the name is already in use)
+bool IndexManager::Insert(std::string name, IndexSchema* structure){
+  lock(mutex_){
+    Catalog::iterator it = catalog_->begin();
+    while((it != catalog_->end()) && (it->first < name))
+      ++it;
+    if((it != catalog_->end()) && (it->first == name))
+      return false;
+
+    Catalog* catalog = new Catalog();
+    try{
+      catalog->reserve(catalog_->size() + 1);
+      catalog->insert(catalog->end(), catalog_->begin(), it);
+      catalog->push_back(std::make_pair(name, structure));
+      catalog->insert(catalog->end(), it, catalog_->end());
+    } catch(...){
+      delete catalog;
+      throw;
+    }
+    Publish(catalog);
+    return true;
+  }
+  return false;
+}
+
+// Search and delete the index structure with the given name
+//
+// The schema is only deleted after all readers that may have found it in the
+// old catalog are done with it.
+ErrorCode IndexManager::Remove(std::string name){
+  lock(mutex_){
+    Catalog::iterator it = catalog_->begin();
+    while((it != catalog_->end()) && (it->first != name))
+      ++it;
+    if(it == catalog_->end())
+      return kErrorUnknownIndex;
+
+    Catalog* catalog = new Catalog();
+    try{
+      catalog->reserve(catalog_->size() - 1);
+      catalog->insert(catalog->end(), catalog_->begin(), it);
+      catalog->insert(catalog->end(), it + 1, catalog_->end());
+    } catch(...){
+      delete catalog;
+      throw;
+    }
+
+    // Try to make the index structure read-only
+    IndexSchema* schema = it->second;
+    if(!schema->MakeReadOnly()){
+      delete catalog;
+      return kErrorOpenTransactions;
+    }
+
+    Publish(catalog);
+    delete schema;
+  }
+  return kOk;
+}
+
+// Replace the current catalog by the given one and free the old catalog
+// once no reader can use it anymore (the caller holds mutex_)
+void IndexManager::Publish(Catalog* catalog){
+  Catalog* old = catalog_;
+  catalog_ = catalog;
+  WaitForReaders();
+  delete old;
+}
+
+// Initialize the singleton instance of IndexManager
+void IndexManager::Initialize(){
+  instance_ = new IndexManager();
+  atexit(&Destroy);
+}
+
+// Destroy the singleton instance of IndexManager
+void IndexManager::Destroy(){
+  delete instance_;
+  instance_ = 0;
+}
@@ -0,0 +1,429 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#ifndef _NATIVEIMPL_INDEX_H_
+#define _NATIVEIMPL_INDEX_H_
+
+#include <sched.h>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <contest_interface.h>
+#include <common/macros.h>
+#include <common/mutex.h>
+
+#include "btree.h"
+#include "dictionary.h"
+#include "hash_table.h"
+#include "util.h"
+
+class IndexSchema;
+
+// The number of counters of unresolved transactions per index (a power of two)
+//
+// Each transaction is counted on the counter of the core it started on.
+#define TRANSACTION_STRIPES 64
+
+// Return the stripe of the core the calling thread runs on
+static inline uint32_t CurrentStripe(){
+  int cpu = sched_getcpu();
+  return (cpu < 0) ? 0 : (cpu & (TRANSACTION_STRIPES - 1));
+}
+
+// A counter of unresolved transactions occupying a cache line of its own
+struct TransactionCounter{
+  volatile int64_t count;
+  char padding[CACHE_LINE_SIZE - sizeof(int64_t)];
+};
+
+// Class representing an index handle
+class Index{
+ public:
+  // Destructor
+  ~Index();
+
+  // Opens an index
+  static ErrorCode Open(const char* name, Index** index);
+
+  // Close this index
+  void Close();
+
+  // Close this index without unregistering it from its schema (which holds its
+  // mutex, see IndexSchema::CloseHandles())
+  //
+  // Returns false if the index has been closed already.
+  bool CloseUnregistered();
+
+  // Insert the given record into the index
+  ErrorCode Insert(Transaction *tx, Record *record);
+
+  // Update the given record with the given payload
+  ErrorCode Update(Transaction *tx, Record *record, Block *payload, uint8_t flags);
+
+  // Delete the given record
+  ErrorCode Delete(Transaction *tx, Record *record, uint8_t flags);
+
+  // Insert the given batch of records outside of any transaction
+  ErrorCode BulkLoad(Record *records, uint32_t count);
+
+  // Checks whether the given record is compatible with this index
+  bool Compatible(Record *record);
+
+  // Checks whether the given key is compatible with this index
+  bool Compatible(Key &key);
+
+  // Register a new iterator handle
+  bool RegisterIterator(Iterator* iterator);
+
+  // Unregister an iterator (the caller holds the mutex of the handle)
+  void UnregisterIterator(Iterator* iterator);
+
+  // Close the given iterator that has been opened on this handle
+  void CloseIterator(Iterator* iterator);
+
+  // Return the name of this index
+  const char* name() const { return name_.c_str(); };
+
+  // Return whether the index has been closed
+  bool closed () const { return closed_; };
+
+  // Return whether iterators are open on this handle
+  bool HasIterators();
+
+  // Get the schema of the referenced index
+  IndexSchema* schema() { return schema_; };
+
+ private:
+  // Constructor
+  Index(const char* name);
+
+  // Delete all records matching the given record and (if payload is not NULL)
+  // insert them again using the new payload
+  ErrorCode Modify(Transaction *tx, Record *record, Block *payload, uint8_t flags);
+
+  // Call Modify() inside a transaction of its own and commit it
+  ErrorCode ModifyAutocommit(Record *record, Block *payload, uint8_t flags);
+
+  // Delete the first record matching the given record outside of any
+  // transaction and (if payload is not NULL) insert it again using the new
+  // payload
+  ErrorCode ModifySingle(Record *record, Block *payload, uint8_t flags);
+
+  // The name of this index
+  std::string name_;
+
+  // The structure of this index
+  IndexSchema* schema_;
+
+  // Whether the index has been closed
+  bool closed_;
+
+  // The first of all open iterators that use this index handle (the iterators
+  // form an intrusive list, see RegisterIterator())
+  Iterator* iterators_;
+
+  // A mutex protecting the list of iterators and serializing concurrent
+  // attempts to close the handle
+  Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(Index);
+};
+
+// Represents a single or multicolumn index
+//
+// Besides the structure of the keys, the schema owns the B+-trees holding all
+// records of the index and two hash tables holding the same entries: one is
+// used to look up single keys, the other one (the payload table) to look up
+// complete records, even if their key has many duplicates.
+//
+// The records may be hash-partitioned across several trees (see
+// CONTEST_PARTITIONS in index.cc), so that concurrent writers do not all
+// contend for the latches of the same root and inner nodes. All entries with
+// the same key belong to the same partition. Range scans merge the ordered
+// partitions (see merge_cursor.h).
+//
+// If all attributes are SHORT or INT, the trees find their leaves using a
+// radix tree instead of inner nodes (see btree.h and CONTEST_RADIX in
+// index.cc). Such keys of several attributes may be stored in Z-order (see
+// common/key_codec.h and CONTEST_ZORDER in index.cc). VARCHAR attributes may
+// be encoded using an order-preserving dictionary per attribute (see
+// dictionary.h and CONTEST_DICTIONARY in index.cc).
+class IndexSchema{
+  public:
+  // Constructor
+  IndexSchema(uint8_t attribute_count, KeyType type);
+
+  // Destructor
+  ~IndexSchema();
+
+  // Create a new index schema
+  static ErrorCode Create(const char* name, uint8_t column_count, KeyType types);
+
+  // Convert the given encoded key to a key of this index
+  Key GetKey(const char *encoded_key) const;
+
+  // Decode the given encoded key into the attributes of the given key
+  // (which must already hold attribute_count() attributes)
+  void DecodeKey(const char *encoded_key, Key &key) const;
+
+  // Encode the given Key of this index (stored in data)
+  //
+  // Returns the size of the encoded key, which is at most size() bytes.
+  size_t GetEncodedKey(Key key, char *data, bool max = false) const;
+
+  // Checks whether the given key is compatible with this schema
+  bool Compatible(Key &key);
+
+  // Register a new index handle
+  void RegisterHandle(Index* handle);
+
+  // Unregister an index handle
+  void UnregisterHandle(Index* handle);
+
+  // Close all registered handles
+  void CloseHandles();
+
+  // Start a new modifying transaction on this index
+  bool BeginTransaction(Transaction *tx);
+
+  // End a modifying transaction on this index
+  void EndTransaction(Transaction *tx);
+
+  // Start an operation on this index that must not overlap with a rebuild of
+  // the trees, counted on the given stripe (see BeginTransaction())
+  bool BeginOperation(uint32_t stripe);
+
+  // End an operation started by BeginOperation()
+  void EndOperation(uint32_t stripe);
+
+  // Try to make this index read-only
+  bool MakeReadOnly();
+
+  // Block new modifying transactions if no transaction is unresolved
+  bool Quiesce();
+
+  // Allow new modifying transactions again after Quiesce()
+  void Resume();
+
+  // Insert the given entry into its tree and the hash table
+  void Insert(Entry *entry);
+
+  // Remove the given entry from its tree and the hash table (the entry itself
+  // is not freed)
+  void Remove(const Entry *entry);
+
+  // Replace the payload of the given entry by a payload of the same size
+  void OverwritePayload(Entry *entry, const Block &payload);
+
+  // Insert the given entries (sorted by key and id) using the given handle
+  bool BulkLoad(Index *handle, Entry **entries, size_t count);
+
+  // Count the records of the index and the memory they use in bytes
+  void CountMemory(uint64_t *records, uint64_t *bytes);
+
+  // Count the sampled pages of the index per NUMA node (pages[n] receives the
+  // pages on node n < node_count)
+  //
+  // Returns false if the nodes of the pages can not be determined.
+  bool CountPlacement(uint32_t node_count, uint64_t *pages);
+
+  // Hand a deleted entry over to the garbage collection (snapshot isolation)
+  void RetireEntry(Entry *entry);
+
+  // Remove all retired entries that are not visible in any snapshot
+  void CollectGarbage();
+
+  uint8_t attribute_count() const { return attribute_count_; };
+  AttributeType* type() const { return type_; };
+  size_t size() const { return size_; };
+  BTree** trees() { return trees_; };
+  KeyComparator comparator() const { return comparator_; };
+  uint32_t partition_count() const { return partition_count_; };
+  bool radix() const { return radix_; };
+  bool zorder() const { return zorder_; };
+  const ZOrderLayout* zorder_layout() const { return &zorder_layout_; };
+  HashTable* hash_table() { return hash_; };
+  HashTable* payload_table() { return payload_hash_; };
+
+ private:
+  // Return the partition the given entry belongs to
+  uint32_t Partition(const Entry *entry) const;
+
+  // Return an upper bound of the number of entries stored inside the trees
+  size_t EstimateSize() const;
+
+  // Merge the given entries (sorted by key and id) with the entries of the
+  // trees and rebuild all trees
+  void Rebuild(Entry **entries, size_t count);
+
+  // Delete all trees
+  void DeleteTrees();
+
+  // Delete all dictionaries
+  void DeleteDictionaries();
+
+  // The number of attributes that form a key of this index
+  uint8_t attribute_count_;
+
+  // An array of attribute types
+  AttributeType* type_;
+
+  // The maximum size of an encoded key of this index in byte
+  size_t size_;
+
+  // The function comparing the keys of this index (specialized for the
+  // attribute types, see SelectComparator())
+  KeyComparator comparator_;
+
+  // Whether the trees use radix trees instead of inner nodes
+  bool radix_;
+
+  // Whether the keys are stored in Z-order
+  bool zorder_;
+
+  // The positions of the attribute bits inside the keys (if stored in Z-order)
+  ZOrderLayout zorder_layout_;
+
+  // The dictionaries of the VARCHAR attributes (NULL if no dictionaries are
+  // used, the other attributes have none)
+  Dictionary** dictionaries_;
+
+  // The trees holding the records of this index (one per partition)
+  BTree** trees_;
+
+  // The number of partitions
+  uint32_t partition_count_;
+
+  // The hash table holding the records of this index
+  HashTable* hash_;
+
+  // The hash table holding the records of this index by key and payload
+  HashTable* payload_hash_;
+
+  // The states of an index with respect to modifying transactions
+  enum State{
+    kWritable,
+    // New transactions wait until the state changes (see Quiesce())
+    kQuiescing,
+    kReadOnly
+  };
+
+  // The state of the index (one of State)
+  volatile uint32_t state_;
+
+  // A set of all open handles of this index structure
+  std::set<Index*> handles_;
+
+  // The numbers of unresolved transactions that have modified this index
+  // (an array of TRANSACTION_STRIPES cache-aligned counters)
+  TransactionCounter* counters_;
+
+  // A mutex for protecting the insert and read operations on the handle set
+  Mutex mutex_;
+
+  // The deleted entries that are still inside the tree (a ring buffer ordered
+  // by the time they have been retired, which only grows, so retiring entries
+  // does not allocate once it is large enough)
+  std::vector<Entry*> retired_;
+
+  // The position of the oldest retired entry inside the ring buffer
+  size_t retired_first_;
+
+  // The number of retired entries
+  size_t retired_count_;
+
+  // A mutex protecting the retired entries
+  Mutex retired_mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(IndexSchema);
+};
+
+
+// Defines a simple index manager.
+//
+// It is used to manage the schemas of the created indices. The schemas are
+// kept in an immutable, sorted catalog. Lookups search the current catalog
+// inside a read-side critical section (see epoch.h) without taking any lock,
+// while creating or deleting an index replaces the catalog by a modified copy.
+//
+// IndexManager implements the Singleton Pattern.
+class IndexManager{
+ public:
+  // Return the singleton instance of IndexManager
+  static IndexManager& getInstance();
+
+  // Returns the index schema with the given name
+  //
+  // Must be called inside a read-side critical section, which also has to
+  // enclose every use of the returned schema.
+  IndexSchema *Find(const char* name);
+
+  // Insert a index schema (returns false if the name is already in use)
+  bool Insert(std::string name, IndexSchema* structure);
+
+  // Search and delete the index structure with the given name
+  ErrorCode Remove(std::string name);
+
+  // Initialize the singleton instance
+  static void Initialize();
+
+  // Destroy the singleton instance
+  static void Destroy();
+
+ private:
+  // A catalog of index schemas, sorted by their names
+  typedef std::vector<std::pair<std::string,IndexSchema*> > Catalog;
+
+  // Private constructor (don't allow instanciation from outside)
+  IndexManager();
+
+  // Destructor
+  ~IndexManager();
+
+  // Replace the current catalog by the given one and free the old catalog
+  // once no reader can use it anymore
+  void Publish(Catalog* catalog);
+
+  // The current catalog (only replaced, never modified)
+  Catalog* volatile catalog_;
+
+  // A mutex serializing the modifications of the catalog
+  Mutex mutex_;
+
+  // The singleton instance of IndexManager
+  static IndexManager* instance_;
+
+  // A pthread once handle to guarantee that the singleton instance is
+  // only initialized once
+  static pthread_once_t once_;
+
+  DISALLOW_COPY_AND_ASSIGN(IndexManager);
+};
+
+#endif // _NATIVEIMPL_INDEX_H_
@@ -0,0 +1,676 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#include "iterator.h"
+#include "pool.h"
+#include "transaction.h"
+#include "util.h"
+
+#include <common/skip_scan.h>
+
+#include <stdint.h>
+#include <cstdlib>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+// Orders the records read by Collect() by key and id
+//
+// The data of every record starts with its key in concatenated encoding, which
+// is compared using memcmp (all keys of a Z-order index have the same size).
+struct Iterator::SortedOrder{
+  const char *data;
+
+  SortedOrder(const char *data) : data(data) {}
+
+  bool operator()(const BatchSlot &a, const BatchSlot &b) const{
+    int result = memcmp(data + a.offset, data + b.offset, a.key_size);
+    if(result != 0)
+      return result < 0;
+    return a.id < b.id;
+  }
+};
+
+// Constructor
+Iterator::Iterator(){
+  index_ = NULL;
+  is_ = NULL;
+  tx_ = NULL;
+  snapshot_ = TIMESTAMP_LATEST;
+  snapshot_slot_ = NULL;
+  previous_ = NULL;
+  next_ = NULL;
+  closed_ = true;
+  end_ = false;
+  initialized_ = false;
+  point_ = false;
+  zorder_ = false;
+  sorted_data_ = NULL;
+  sorted_data_capacity_ = 0;
+  position_ = 0;
+  attribute_count_ = 0;
+  key_buffer_ = NULL;
+  key_buffer_capacity_ = 0;
+  min_key_ = NULL;
+  min_key_size_ = 0;
+  max_key_ = NULL;
+  max_key_size_ = 0;
+  target_ = NULL;
+  bounds_.size = 0;
+  key_ = NULL;
+  key_size_ = 0;
+  id_ = 0;
+  payload_ = NULL;
+  payload_size_ = 0;
+  payload_capacity_ = 0;
+  attributes_ = NULL;
+  record_.key.value = NULL;
+  record_.key.attribute_count = 0;
+  batch_data_ = NULL;
+  batch_data_capacity_ = 0;
+  batch_slots_ = NULL;
+  batch_attributes_ = NULL;
+  batch_values_ = NULL;
+  batch_capacity_ = 0;
+}
+
+// Destructor
+Iterator::~Iterator(){
+  Close();
+  FreeAttributes();
+  FreeBatch();
+  delete [] key_buffer_;
+  free(payload_);
+  free(batch_data_);
+  free(sorted_data_);
+}
+
+// Initialize the iterator to iterate over a given index.
+//
+// The buffers of a previous use are kept, unless they do not fit the schema of
+// the index.
+void Iterator::Init(Transaction* tx, Index* idx, Key min_keys, Key max_keys){
+  if(!closed_)
+    Close();
+
+  index_ = idx;
+  is_ = index_->schema();
+  tx_ = tx;
+  end_ = false;
+  initialized_ = false;
+  // A skip-scan target may be one byte longer than a key (see
+  // SkipScanTargetSize(), the keys may hold dictionary codes)
+  cursor_.set_trees(is_->trees(), is_->partition_count(), is_->size() + 1);
+  hash_cursor_.set_table(is_->hash_table());
+
+  if(attribute_count_ != is_->attribute_count()){
+    FreeAttributes();
+    FreeBatch();
+    attribute_count_ = is_->attribute_count();
+  }
+
+  // Initialize the keys (the current key and the skip-scan target buffer
+  // follow min and max key)
+  size_t key_buffer_size = 4*is_->size() + 1;
+  if(key_buffer_size > key_buffer_capacity_){
+    char* buffer = new char[key_buffer_size];
+    CountAllocation();
+    delete [] key_buffer_;
+    key_buffer_ = buffer;
+    key_buffer_capacity_ = key_buffer_size;
+  }
+  min_key_ = key_buffer_;
+  max_key_ = min_key_ + is_->size();
+  key_ = max_key_ + is_->size();
+  target_ = key_ + is_->size();
+  min_key_size_ = is_->GetEncodedKey(min_keys, min_key_);
+  max_key_size_ = is_->GetEncodedKey(max_keys, max_key_, true);
+
+  // A range holding a single key is read from the hash table
+  point_ = (min_key_size_ == max_key_size_)
+           && (memcmp(min_key_, max_key_, min_key_size_) == 0);
+
+  // Other ranges of a Z-order index are read and sorted at once (see
+  // Collect()). Keys of fixed width are checked against the bounds using
+  // vector instructions.
+  zorder_ = is_->zorder() && !point_;
+  if(zorder_)
+    bounds_.size = 0;
+  else
+    PrepareBoundsCheck(&bounds_, is_->type(), attribute_count_, min_key_,
+                       max_key_);
+
+  // Read the snapshot of the transaction (or take an own snapshot unless the
+  // isolation level is read committed)
+  if(tx != NULL)
+    snapshot_ = tx->snapshot();
+  else if(GetIsolationLevel() != kReadCommitted)
+    snapshot_ = AcquireSnapshot(&snapshot_slot_);
+  else
+    snapshot_ = TIMESTAMP_LATEST;
+
+  closed_ = false;
+
+  // Register the new iterator
+  index_->RegisterIterator(this);
+}
+
+// Close the iterator
+//
+// The iterator is closed under the mutex of its handle, which may be closed by
+// another thread at the same time (see Index::CloseIterator()).
+void Iterator::Close(){
+  if(closed_)
+    return;
+
+  index_->CloseIterator(this);
+}
+
+// Close the iterator and unregister it from its handle
+//
+// The buffers are kept for the next use of the iterator.
+void Iterator::CloseRegistered(){
+  if(closed_)
+    return;
+
+  closed_ = true;
+
+  // Cleanup
+  ReleaseCursor();
+  if((tx_ == NULL) && (snapshot_ != TIMESTAMP_LATEST))
+    ReleaseSnapshot(snapshot_, snapshot_slot_);
+  snapshot_ = TIMESTAMP_LATEST;
+  min_key_ = max_key_ = key_ = target_ = NULL;
+
+  // Unregister the iterator
+  index_->UnregisterIterator(this);
+}
+
+//
+// Retrieves the next value from the iterator
+//
+// Entries are read in key order starting at the minimum key. Whenever an
+// attribute of an entry lies outside the given range, the cursor skips
+// directly to the next key that could satisfy all bounds (see
+// common/skip_scan.h). So partial-match queries that leave the leading
+// attributes unrestricted need one seek per distinct prefix instead of one
+// comparison per entry. Entries that are not visible to the
+// transaction are skipped until the maximum key has been exceeded. Ranges of
+// a Z-order index are read at once instead (see Collect()).
+//
+bool Iterator::Next(){
+  if(end_)
+    return true;
+
+  if(zorder_){
+    if(!initialized_)
+      Collect();
+    if(position_ == sorted_.size()){
+      SetEnded();
+      return true;
+    }
+    const BatchSlot &slot = sorted_[position_++];
+    const char* key = sorted_data_ + slot.offset + slot.key_size;
+    SetCurrent(key, slot.key_size, key + slot.key_size, slot.payload_size,
+               slot.id);
+    return true;
+  }
+
+  Advance();
+
+  Entry* entry = FindMatch();
+  if(entry != NULL){
+    // We've found a record
+    SetCurrent(entry);
+    ReleaseCursor();
+    if((tx_ != NULL) && tx_->optimistic())
+      tx_->LogRead(entry);
+    return true;
+  }
+
+  // Mark the iterator as ended
+  SetEnded();
+  return true;
+}
+
+// Retrieve up to max records at once and store them in the given array
+//
+// All matching entries are copied into the batch buffer during a single pass
+// of the cursor, so the leaf latch is only acquired once per leaf. The keys
+// are decoded after the latch has been released. The last record of the
+// batch becomes the current record of the iterator.
+uint32_t Iterator::NextBatch(Record *records, uint32_t max){
+  if(end_ || (max == 0))
+    return 0;
+
+  if(max > MAX_BATCH_SIZE)
+    max = MAX_BATCH_SIZE;
+  ReserveBatch(max);
+
+  // The records read by Collect() stay in their buffer until the iterator is
+  // closed, so the batch refers to them directly
+  if(zorder_){
+    if(!initialized_)
+      Collect();
+    uint32_t count = std::min((size_t) max, sorted_.size() - position_);
+    uint8_t attribute_count = is_->attribute_count();
+    for(uint32_t i = 0; i < count; i++){
+      const BatchSlot &slot = sorted_[position_ + i];
+      const char* key = sorted_data_ + slot.offset + slot.key_size;
+      Record &record = records[i];
+      record.key.attribute_count = attribute_count;
+      record.key.value = batch_values_ + i*attribute_count;
+      is_->DecodeKey(key, record.key);
+      record.payload.data = (void*) (key + slot.key_size);
+      record.payload.size = slot.payload_size;
+    }
+    position_ += count;
+
+    if(count > 0){
+      const BatchSlot &last = sorted_[position_-1];
+      const char* key = sorted_data_ + last.offset + last.key_size;
+      SetCurrent(key, last.key_size, key + last.key_size, last.payload_size,
+                 last.id);
+    }
+    if(position_ == sorted_.size())
+      SetEnded();
+    return count;
+  }
+
+  Advance();
+
+  uint32_t count = 0;
+  size_t offset = 0;
+  Entry* entry;
+  while((entry = FindMatch()) != NULL){
+    // Copy the key and the payload into the batch buffer
+    size_t size = entry->key_size + entry->payload_size;
+    if(offset + size > batch_data_capacity_){
+      size_t capacity = 2*(offset + size);
+      char* data = (char*) realloc(batch_data_, capacity);
+      if(data == NULL){
+        ReleaseCursor();
+        throw std::bad_alloc();
+      }
+      CountAllocation();
+      batch_data_ = data;
+      batch_data_capacity_ = capacity;
+    }
+    memcpy(batch_data_ + offset, entry->key(), size);
+
+    BatchSlot &slot = batch_slots_[count];
+    slot.offset = offset;
+    slot.key_size = entry->key_size;
+    slot.payload_size = entry->payload_size;
+    slot.id = entry->id;
+    slot.entry = entry;
+    offset += size;
+
+    if(++count == max)
+      break;
+    NextEntry();
+  }
+
+  if(entry != NULL)
+    ReleaseCursor();
+  else
+    SetEnded();
+
+  // Remember the read entries (they are not freed while the snapshot of the
+  // transaction is in use)
+  if((tx_ != NULL) && tx_->optimistic()){
+    for(uint32_t i = 0; i < count; i++)
+      tx_->LogRead(batch_slots_[i].entry);
+  }
+
+  // Build the records
+  uint8_t attribute_count = is_->attribute_count();
+  for(uint32_t i = 0; i < count; i++){
+    BatchSlot &slot = batch_slots_[i];
+    Record &record = records[i];
+    record.key.attribute_count = attribute_count;
+    record.key.value = batch_values_ + i*attribute_count;
+    is_->DecodeKey(batch_data_ + slot.offset, record.key);
+    record.payload.data = batch_data_ + slot.offset + slot.key_size;
+    record.payload.size = slot.payload_size;
+  }
+
+  // Continue after the last record of the batch
+  if(count > 0){
+    BatchSlot &last = batch_slots_[count-1];
+    SetCurrent(batch_data_ + last.offset, last.key_size,
+               batch_data_ + last.offset + last.key_size, last.payload_size,
+               last.id);
+  }
+
+  return count;
+}
+
+// Return the record to which the iterator refers
+//
+// GetNext() hands the record over to the caller, who frees it, so it needs
+// one allocation per attribute plus three per record. These make up nearly all
+// allocations of a default benchmark run; GetNextBuffered() and GetNextBatch()
+// return records owned by the iterator instead.
+Record* Iterator::value(){
+  Record *record = NULL;
+
+  // If the iterator has already ended, don't return a record
+  if(!end_){
+    // The record, the attribute array, each attribute and the payload
+    for(int i = 0; i < is_->attribute_count() + 3; i++)
+      CountAllocation();
+
+    record = (Record*) malloc(sizeof(Record));
+    // Set the key
+    record->key = is_->GetKey(key_);
+
+    // Set the payload
+    record->payload.data = malloc(payload_size_);
+    memcpy(record->payload.data, payload_, payload_size_);
+    record->payload.size = payload_size_;
+  }
+  return record;
+}
+
+// Return the record to which the iterator refers using a buffer owned by the
+// iterator
+//
+// The attributes are allocated by the first call, later calls only decode the
+// current key into them. The payload points to the payload buffer.
+Record* Iterator::buffered_value(){
+  // If the iterator has already ended, don't return a record
+  if(end_)
+    return NULL;
+
+  if(attributes_ == NULL){
+    uint8_t count = is_->attribute_count();
+    attributes_ = new Attribute[count];
+    CountAllocation();
+    record_.key.value = new Attribute*[count];
+    CountAllocation();
+    record_.key.attribute_count = count;
+    for(int i = 0; i < count; i++)
+      record_.key.value[i] = &attributes_[i];
+  }
+
+  is_->DecodeKey(key_, record_.key);
+  record_.payload.data = payload_;
+  record_.payload.size = payload_size_;
+  return &record_;
+}
+
+// Read all matching records of a Z-order index and sort them by key
+//
+// The tree is scanned from the Z-order key of the lower corner of the box to
+// the one of its upper corner. Whenever an entry lies outside the box, the
+// cursor skips directly to the next Z-order key inside it (see
+// ZOrderSkipScan()), so only the parts of the range intersecting the box are
+// read, whichever attributes are restricted. The visible entries are copied
+// into the buffer of the iterator, so no latch is held afterwards, and sorted
+// by key. As the records are read at once, records inserted into the range
+// later on are not returned.
+void Iterator::Collect(){
+  initialized_ = true;
+  sorted_.clear();
+  position_ = 0;
+
+  const ZOrderLayout* layout = is_->zorder_layout();
+  uint64_t min[MAX_ZORDER_ATTRIBUTES], max[MAX_ZORDER_ATTRIBUTES];
+  uint64_t values[MAX_ZORDER_ATTRIBUTES];
+  layout->deinterleave(layout, min_key_, min);
+  layout->deinterleave(layout, max_key_, max);
+
+  cursor_.Seek(min_key_, min_key_size_, 0);
+  try{
+    while(cursor_.valid()){
+      Entry* entry = cursor_.entry();
+      if(KeyCmp(entry->key(), entry->key_size, max_key_, max_key_size_) > 0)
+        break;
+      size_t target_size;
+      layout->deinterleave(layout, entry->key(), values);
+      SkipScanResult result = ZOrderSkipScan(layout, values, min, max, target_,
+                                             &target_size);
+      if(result == kSkipScanEnd)
+        break;
+      if(result == kSkipScanSeek){
+        cursor_.SeekForward(target_, target_size, 0);
+        continue;
+      }
+      if(Visible(entry, tx_, snapshot_)
+         && ((tx_ == NULL) || !tx_->Deletes(entry))){
+        AppendSorted(entry, values);
+        if((tx_ != NULL) && tx_->optimistic())
+          tx_->LogRead(entry);
+      }
+      cursor_.Next();
+    }
+  } catch(...){
+    ReleaseCursor();
+    throw;
+  }
+  ReleaseCursor();
+
+  if(!sorted_.empty())
+    std::sort(sorted_.begin(), sorted_.end(), SortedOrder(sorted_data_));
+}
+
+// Copy the given entry into the buffer of the records read by Collect()
+//
+// The key is stored twice, once converted into the concatenated encoding
+// (given the encoded attributes of the entry), which is used for sorting.
+void Iterator::AppendSorted(const Entry *entry, const uint64_t *values){
+  size_t offset = 0;
+  if(!sorted_.empty()){
+    const BatchSlot &last = sorted_.back();
+    offset = last.offset + 2*last.key_size + last.payload_size;
+  }
+
+  size_t size = 2*entry->key_size + entry->payload_size;
+  if(offset + size > sorted_data_capacity_){
+    size_t capacity = 2*(offset + size);
+    char* data = (char*) realloc(sorted_data_, capacity);
+    if(data == NULL)
+      throw std::bad_alloc();
+    CountAllocation();
+    sorted_data_ = data;
+    sorted_data_capacity_ = capacity;
+  }
+
+  char* data = sorted_data_ + offset;
+  ConcatenateAttributes(is_->zorder_layout(), values, data);
+  memcpy(data + entry->key_size, entry->key(),
+         entry->key_size + entry->payload_size);
+
+  BatchSlot slot;
+  slot.offset = offset;
+  slot.key_size = entry->key_size;
+  slot.payload_size = entry->payload_size;
+  slot.id = entry->id;
+  slot.entry = NULL;
+  if(sorted_.size() == sorted_.capacity())
+    CountAllocation();
+  sorted_.push_back(slot);
+}
+
+// Position the cursor on the entry following the current record (or on the
+// first entry in the range of this iterator)
+void Iterator::Advance(){
+  if(point_){
+    hash_cursor_.Seek(min_key_, min_key_size_, initialized_ ? id_ + 1 : 0);
+    initialized_ = true;
+  } else if(!initialized_){
+    cursor_.Seek(min_key_, min_key_size_, 0);
+    initialized_ = true;
+  } else {
+    cursor_.SeekAfter(key_, key_size_, id_);
+  }
+}
+
+// Return the first matching entry at or after the position of the cursor
+//
+// The leaf holding the returned entry stays latched. If the range of the
+// iterator has been exceeded, NULL is returned.
+Entry* Iterator::FindMatch(){
+  if(point_){
+    // All entries returned by the hash cursor have the requested key
+    while(hash_cursor_.valid()){
+      Entry* entry = hash_cursor_.entry();
+      if(Visible(entry, tx_, snapshot_)
+         && ((tx_ == NULL) || !tx_->Deletes(entry)))
+        return entry;
+      hash_cursor_.Next();
+    }
+    return NULL;
+  }
+
+  while(cursor_.valid()){
+    Entry* entry = cursor_.entry();
+
+    // As the entries are ordered starting with the first key attribute
+    // we have exceeded our key range when the key of the entry is greater
+    // than the maximum key
+    if(KeyCmp(entry->key(), entry->key_size, max_key_, max_key_size_) > 0)
+      return NULL;
+
+    size_t target_size;
+    SkipScanResult result;
+    if(bounds_.size != 0)
+      result = CheckBounds(&bounds_, entry->key(), target_, &target_size);
+    else
+      result = SkipScan(is_->type(), is_->attribute_count(), entry->key(),
+                        min_key_, max_key_, target_, &target_size);
+    if(result == kSkipScanEnd)
+      return NULL;
+
+    if(result == kSkipScanSeek){
+      // Skip all entries that can not match
+      cursor_.SeekForward(target_, target_size, 0);
+      continue;
+    }
+
+    if(Visible(entry, tx_, snapshot_) && ((tx_ == NULL) || !tx_->Deletes(entry)))
+      return entry;
+    cursor_.Next();
+  }
+  return NULL;
+}
+
+// Move the cursor to the next entry
+void Iterator::NextEntry(){
+  if(point_)
+    hash_cursor_.Next();
+  else
+    cursor_.Next();
+}
+
+// Release the latch held by the cursor
+void Iterator::ReleaseCursor(){
+  if(point_)
+    hash_cursor_.Release();
+  else
+    cursor_.Release();
+}
+
+// Make sure that the batch buffers can hold the given number of records
+void Iterator::ReserveBatch(uint32_t count){
+  if(count <= batch_capacity_)
+    return;
+
+  uint8_t attribute_count = is_->attribute_count();
+  FreeBatch();
+  batch_slots_ = new BatchSlot[count];
+  batch_attributes_ = new Attribute[count*attribute_count];
+  batch_values_ = new Attribute*[count*attribute_count];
+  for(int i = 0; i < 3; i++)
+    CountAllocation();
+  for(uint32_t i = 0; i < count*attribute_count; i++)
+    batch_values_[i] = &batch_attributes_[i];
+  batch_capacity_ = count;
+}
+
+// Free the batch buffers (except for the data buffer)
+void Iterator::FreeBatch(){
+  delete [] batch_slots_;
+  delete [] batch_attributes_;
+  delete [] batch_values_;
+  batch_slots_ = NULL;
+  batch_attributes_ = NULL;
+  batch_values_ = NULL;
+  batch_capacity_ = 0;
+}
+
+// Free the attributes returned by buffered_value()
+void Iterator::FreeAttributes(){
+  delete [] attributes_;
+  delete [] record_.key.value;
+  attributes_ = NULL;
+  record_.key.value = NULL;
+  record_.key.attribute_count = 0;
+}
+
+// Copy the given entry into the buffers of the iterator
+//
+// The copy is taken while the leaf holding the entry is latched, so the entry
+// can not be freed or changed in the meantime.
+void Iterator::SetCurrent(const Entry *entry){
+  try{
+    SetCurrent(entry->key(), entry->key_size, entry->payload(),
+               entry->payload_size, entry->id);
+  } catch(std::bad_alloc &e){
+    ReleaseCursor();
+    throw;
+  }
+}
+
+// Copy the given record into the buffers of the iterator
+void Iterator::SetCurrent(const char *key, size_t key_size,
+                          const char *payload, uint32_t payload_size,
+                          uint64_t id){
+  if(payload_size > payload_capacity_){
+    char* buffer = (char*) realloc(payload_, payload_size);
+    if(buffer == NULL)
+      throw std::bad_alloc();
+    CountAllocation();
+    payload_ = buffer;
+    payload_capacity_ = payload_size;
+  }
+
+  memcpy(key_, key, key_size);
+  key_size_ = key_size;
+  memcpy(payload_, payload, payload_size);
+  payload_size_ = payload_size;
+  id_ = id;
+}
+
+// Mark the iterator as ended
+void Iterator::SetEnded(){
+  end_ = true;
+
+  // Release the current leaf
+  ReleaseCursor();
+}
@@ -0,0 +1,282 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#ifndef _NATIVEIMPL_ITERATOR_H_
+#define _NATIVEIMPL_ITERATOR_H_
+
+#include <vector>
+#include <common/bounds_check.h>
+
+#include "btree.h"
+#include "hash_table.h"
+#include "index.h"
+#include "merge_cursor.h"
+
+// The maximum number of records returned by a single NextBatch() call
+#define MAX_BATCH_SIZE 256
+
+// Represents an iterator
+//
+// The iterator does not hold any latches between two calls of Next(). Instead
+// it remembers the last entry it returned and continues right after it. If
+// the minimum and the maximum key are equal, the entries are read from the
+// hash table of the index instead of the tree.
+//
+// If the index stores its keys in Z-order, the tree order is not the key order
+// anymore. The iterator then reads all matching records when it is first
+// moved, sorts them by key and returns them from its own buffer (see
+// Collect()).
+//
+// A closed iterator can be initialized again. It keeps its buffers, so an
+// iterator that is reused (see pool.h) usually does not allocate any memory.
+class Iterator {
+ public:
+  // Constructor
+  Iterator();
+
+  // Destructor;
+  ~Iterator();
+
+  // Initialize the iterator
+  void Init(Transaction* tx, Index* idx, Key min_keys, Key max_keys);
+
+  // Close the iterator (see Index::CloseIterator())
+  void Close();
+
+  // Move the iterator to the next record
+  bool Next();
+
+  // Move the iterator over up to max records and store them in the given
+  // array (the records use buffers owned by the iterator)
+  //
+  // Returns the number of records stored, which is 0 if the end of the range
+  // has been reached.
+  uint32_t NextBatch(Record *records, uint32_t max);
+
+  // Return whether the iterator has been closed
+  bool closed() const { return closed_; };
+
+  // Return whether the iterator has exceeded its range
+  bool end() const { return end_; };
+
+  // Return the record to which the iterator refers
+  Record* value();
+
+  // Return the record to which the iterator refers using a buffer owned by
+  // the iterator (valid until the iterator is moved or closed)
+  Record* buffered_value();
+
+ private:
+  // The position of a record copied by NextBatch() inside the batch buffer
+  struct BatchSlot{
+    // The offset of the key (the payload follows the key)
+    size_t offset;
+    uint32_t key_size;
+    uint32_t payload_size;
+    uint64_t id;
+    // The entry the record has been copied from
+    Entry* entry;
+  };
+
+  // Orders the records read by Collect() by key and id
+  struct SortedOrder;
+
+  // Read all matching records of a Z-order index and sort them by key
+  void Collect();
+
+  // Copy the given entry into the buffer of the records read by Collect()
+  void AppendSorted(const Entry *entry, const uint64_t *values);
+
+  // Position the cursor on the entry following the current record
+  void Advance();
+
+  // Return the first matching entry at or after the position of the cursor
+  Entry* FindMatch();
+
+  // Move the cursor to the next entry
+  void NextEntry();
+
+  // Release the latch held by the cursor
+  void ReleaseCursor();
+
+  // Close the iterator and unregister it from its handle (the caller holds
+  // the mutex of the handle)
+  void CloseRegistered();
+
+  // Make sure that the batch buffers can hold the given number of records
+  void ReserveBatch(uint32_t count);
+
+  // Free the batch buffers
+  void FreeBatch();
+
+  // Free the attributes returned by buffered_value()
+  void FreeAttributes();
+
+  // Copy the given entry into the buffers of the iterator
+  void SetCurrent(const Entry *entry);
+
+  // Copy the given record into the buffers of the iterator
+  void SetCurrent(const char *key, size_t key_size, const char *payload,
+                  uint32_t payload_size, uint64_t id);
+
+  // Mark the iterator as ended
+  void SetEnded();
+
+  // The key of the current record
+  char *key_;
+
+  // The size of the key of the current record
+  size_t key_size_;
+
+  // The id of the current record
+  uint64_t id_;
+
+  // The payload of the current record
+  char *payload_;
+
+  // The size of the payload of the current record
+  uint32_t payload_size_;
+
+  // The size of the payload buffer
+  uint32_t payload_capacity_;
+
+  // The record returned by buffered_value()
+  Record record_;
+
+  // The attributes of the record returned by buffered_value() (allocated on
+  // first use)
+  Attribute *attributes_;
+
+  // The keys and payloads of the records returned by NextBatch()
+  char *batch_data_;
+
+  // The size of the batch data buffer
+  size_t batch_data_capacity_;
+
+  // The positions of the records inside the batch data buffer
+  BatchSlot *batch_slots_;
+
+  // The attributes of the records returned by NextBatch()
+  Attribute *batch_attributes_;
+
+  // The attribute pointers of the records returned by NextBatch()
+  Attribute **batch_values_;
+
+  // The number of records the batch buffers can hold
+  uint32_t batch_capacity_;
+
+  // The number of attributes the record buffers have been allocated for
+  uint8_t attribute_count_;
+
+  // The buffer holding the minimum, the maximum and the current key as well as
+  // the skip-scan target
+  char *key_buffer_;
+
+  // The size of the key buffer
+  size_t key_buffer_capacity_;
+
+  // The maximum key that limits the range of this iterator
+  char *max_key_;
+
+  // The size of the maximum key
+  size_t max_key_size_;
+
+  // The minimum key for this iterator
+  char *min_key_;
+
+  // The size of the minimum key
+  size_t min_key_size_;
+
+  // A buffer for the keys computed by the skip-scan
+  char *target_;
+
+  // The prepared bounds of the range (if the index has keys of fixed width)
+  BoundsCheck bounds_;
+
+  // The index which is iterated over
+  Index *index_;
+
+  // The index schema of that index
+  IndexSchema *is_;
+
+  // The transaction the iterator belongs to (may be NULL)
+  Transaction *tx_;
+
+  // The snapshot read by the iterator (owned by the iterator if there is no
+  // transaction)
+  uint64_t snapshot_;
+
+  // The slot announcing the own snapshot (see AcquireSnapshot())
+  SnapshotSlot* snapshot_slot_;
+
+  // The cursor used to read the trees (merging the partitions of the index)
+  MergeCursor cursor_;
+
+  // The cursor used to read the hash table (if the range holds a single key)
+  HashCursor hash_cursor_;
+
+  // Whether the range holds a single key
+  bool point_;
+
+  // Whether the records are read by Collect() (the index stores its keys in
+  // Z-order and the range holds more than a single key)
+  bool zorder_;
+
+  // The records read by Collect() in key order (the data of every record
+  // starts with its key in concatenated encoding, followed by its Z-order key
+  // and its payload)
+  std::vector<BatchSlot> sorted_;
+
+  // The buffer holding the data of the records read by Collect()
+  char *sorted_data_;
+
+  // The size of the sorted data buffer
+  size_t sorted_data_capacity_;
+
+  // The number of records read by Collect() that have been returned
+  size_t position_;
+
+  // The neighbours of the iterator inside the list of open iterators of its
+  // index handle (see Index::RegisterIterator())
+  Iterator *previous_;
+  Iterator *next_;
+
+  // Whether the iterator has been closed
+  bool closed_;
+
+  // Whether the iterator has exceeded its range
+  bool end_;
+
+  // Whether the iterator is initialized
+  bool initialized_;
+
+  friend class Index;
+
+  DISALLOW_COPY_AND_ASSIGN(Iterator);
+};
+
+#endif // _NATIVEIMPL_ITERATOR_H_
@@ -0,0 +1,141 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+/** @file
+ A small reader/writer spin latch used to protect the nodes of the in-memory
+ B+-tree.
+
+ In contrast to a pthread rwlock the latch only occupies a single 32-bit word,
+ so it can be embedded into the header of cache-line-sized tree nodes.
+*/
+
+#ifndef _NATIVEIMPL_LATCH_H_
+#define _NATIVEIMPL_LATCH_H_
+
+#include <stdint.h>
+#include <sched.h>
+
+#include <common/macros.h>
+
+// The number of busy-wait iterations before a waiting thread yields its CPU
+#define LATCH_SPIN_COUNT 64
+
+// Spin (and eventually yield) while waiting for a latch
+static inline void LatchBackoff(unsigned int &spins){
+  if(++spins < LATCH_SPIN_COUNT){
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause");
+#endif
+  } else {
+    spins = 0;
+    sched_yield();
+  }
+}
+
+// Order the reads of a node between reading and validating its version
+//
+// Nodes that are read without a latch (optimistic lock coupling) carry a
+// version, which is odd while a writer modifies the node.
+static inline void ReadBarrier(){
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("" ::: "memory");
+#else
+  __sync_synchronize();
+#endif
+}
+
+// Mark a node with the given version as being modified
+static inline void BeginModification(volatile uint32_t &version){
+  version++;
+  __sync_synchronize();
+}
+
+// Publish the modification of a node with the given version
+static inline void EndModification(volatile uint32_t &version){
+  __sync_synchronize();
+  version++;
+}
+
+// A reader/writer latch that fits into a single 32-bit word
+//
+// Writers announce themselves using a waiting bit, so that a continuous
+// stream of readers cannot starve them.
+class Latch{
+ public:
+  Latch():word_(0){};
+
+  // Acquire the latch in shared mode
+  void LockShared(){
+    unsigned int spins = 0;
+    while(true){
+      uint32_t word = word_;
+      if(!(word & (kWriter | kWaiting))
+         && __sync_bool_compare_and_swap(&word_, word, word + 1))
+        return;
+      LatchBackoff(spins);
+    }
+  };
+
+  // Release a shared latch
+  void UnlockShared(){
+    __sync_fetch_and_sub(&word_, 1);
+  };
+
+  // Acquire the latch in exclusive mode
+  void LockExclusive(){
+    unsigned int spins = 0;
+    while(true){
+      uint32_t word = word_;
+      if((word & ~kWaiting) == 0){
+        if(__sync_bool_compare_and_swap(&word_, word, kWriter))
+          return;
+      } else if(!(word & kWaiting)){
+        __sync_bool_compare_and_swap(&word_, word, word | kWaiting);
+      }
+      LatchBackoff(spins);
+    }
+  };
+
+  // Release an exclusive latch
+  void UnlockExclusive(){
+    __sync_fetch_and_and(&word_, ~kWriter);
+  };
+
+ private:
+  // The bit that is set while a writer holds the latch
+  static const uint32_t kWriter = 0x80000000u;
+
+  // The bit that is set while a writer waits for the latch
+  static const uint32_t kWaiting = 0x40000000u;
+
+  // The latch word (writer bit, waiting bit and the number of readers)
+  volatile uint32_t word_;
+
+  DISALLOW_COPY_AND_ASSIGN(Latch);
+};
+
+#endif // _NATIVEIMPL_LATCH_H_
@@ -0,0 +1,251 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+#include <string.h>
+
+#include "merge_cursor.h"
+#include "pool.h"
+#include "util.h"
+
+// Constructor for MergeCursor
+MergeCursor::MergeCursor(){
+  heads_ = NULL;
+  count_ = 0;
+  compare_ = NULL;
+  capacity_ = 0;
+  key_buffer_ = NULL;
+  key_buffer_capacity_ = 0;
+  current_ = -1;
+  next_ = -1;
+}
+
+// Destructor for MergeCursor
+MergeCursor::~MergeCursor(){
+  delete[] heads_;
+  delete[] key_buffer_;
+}
+
+// Set the trees to be read and the maximum size of their keys
+//
+// The buffers are kept if they are large enough already.
+void MergeCursor::set_trees(BTree **trees, uint32_t count, size_t key_size){
+  if(count > capacity_){
+    Head* heads = new Head[count];
+    CountAllocation();
+    delete[] heads_;
+    heads_ = heads;
+    capacity_ = count;
+  }
+  if((count > 1) && (count*key_size > key_buffer_capacity_)){
+    char* buffer = new char[count*key_size];
+    CountAllocation();
+    delete[] key_buffer_;
+    key_buffer_ = buffer;
+    key_buffer_capacity_ = count*key_size;
+  }
+
+  for(uint32_t i = 0; i < count; i++){
+    heads_[i].cursor.set_tree(trees[i]);
+    heads_[i].key = (count > 1) ? key_buffer_ + i*key_size : NULL;
+    heads_[i].key_size = 0;
+    heads_[i].id = 0;
+    heads_[i].valid = false;
+  }
+  count_ = count;
+  compare_ = trees[0]->comparator();
+  current_ = -1;
+  next_ = -1;
+}
+
+// Position the cursor on the first entry >= key/id
+//
+// Every partition is searched, but only the partition holding the smallest
+// entry stays latched.
+void MergeCursor::Seek(const char* key, size_t key_size, uint64_t id){
+  if(count_ == 1){
+    heads_[0].cursor.Seek(key, key_size, id);
+    return;
+  }
+
+  for(uint32_t i = 0; i < count_; i++){
+    heads_[i].cursor.Seek(key, key_size, id);
+    Park(i);
+  }
+  SelectMinimum();
+}
+
+// Re-latch the current partition and position the cursor on the first entry
+// following the given key/id combination (the last entry that was read)
+//
+// The other partitions continue at their heads. Entries that have been
+// inserted into them in front of their heads in the meantime are not read,
+// just like entries inserted in front of the cursor of a single tree.
+void MergeCursor::SeekAfter(const char* key, size_t key_size, uint64_t id){
+  if(count_ == 1){
+    heads_[0].cursor.SeekAfter(key, key_size, id);
+    return;
+  }
+
+  if(current_ < 0)
+    return;
+  heads_[current_].cursor.SeekAfter(key, key_size, id);
+  Reselect();
+}
+
+// Move the cursor forward to the first entry >= key/id (which must follow
+// the current entry)
+//
+// Heads of other partitions that precede the target are replaced by the
+// target, their cursors are moved once they become current.
+void MergeCursor::SeekForward(const char* key, size_t key_size, uint64_t id){
+  if(count_ == 1){
+    heads_[0].cursor.SeekForward(key, key_size, id);
+    return;
+  }
+
+  if(current_ < 0)
+    return;
+  for(uint32_t i = 0; i < count_; i++){
+    Head &head = heads_[i];
+    if(((int) i != current_) && head.valid && (Compare(key, key_size, id, i) > 0)){
+      memcpy(head.key, key, key_size);
+      head.key_size = key_size;
+      head.id = id;
+    }
+  }
+  heads_[current_].cursor.SeekForward(key, key_size, id);
+  Park(current_);
+  SelectMinimum();
+}
+
+// Move the cursor to the next entry
+bool MergeCursor::Next(){
+  if(count_ == 1)
+    return heads_[0].cursor.Next();
+
+  if(current_ < 0)
+    return false;
+  heads_[current_].cursor.Next();
+  Reselect();
+  return current_ >= 0;
+}
+
+// Release the latch of the current partition
+void MergeCursor::Release(){
+  if(count_ == 1)
+    heads_[0].cursor.Release();
+  else if(current_ >= 0)
+    heads_[current_].cursor.Release();
+}
+
+// Remember the entry the cursor of the given partition points to as its head
+// and release the cursor
+void MergeCursor::Park(int partition){
+  Head &head = heads_[partition];
+  head.valid = head.cursor.valid();
+  if(head.valid){
+    Entry* entry = head.cursor.entry();
+    memcpy(head.key, entry->key(), entry->key_size);
+    head.key_size = entry->key_size;
+    head.id = entry->id;
+  }
+  head.cursor.Release();
+}
+
+// Make the partition holding the smallest entry the current one
+//
+// The cursor of the partition with the smallest head is moved to the first
+// entry at or after its head. If that entry is greater than the head of
+// another partition (because the remembered entry has been removed or the
+// head was a lower bound), the partition is parked again and the search is
+// repeated. All cursors have to be released (parked) beforehand.
+void MergeCursor::SelectMinimum(){
+  while(true){
+    // Find the smallest and the second smallest head
+    current_ = -1;
+    next_ = -1;
+    for(uint32_t i = 0; i < count_; i++){
+      Head &head = heads_[i];
+      if(!head.valid)
+        continue;
+      if((current_ < 0)
+         || (Compare(head.key, head.key_size, head.id, current_) < 0)){
+        next_ = current_;
+        current_ = i;
+      } else if((next_ < 0)
+                || (Compare(head.key, head.key_size, head.id, next_) < 0)){
+        next_ = i;
+      }
+    }
+    if(current_ < 0)
+      return;
+
+    Head &head = heads_[current_];
+    head.cursor.Resume(head.key, head.key_size, head.id);
+    if(!head.cursor.valid()){
+      head.valid = false;
+      continue;
+    }
+    Entry* entry = head.cursor.entry();
+    if((next_ < 0)
+       || (Compare(entry->key(), entry->key_size, entry->id, next_) <= 0))
+      return;
+    Park(current_);
+  }
+}
+
+// Make the current partition (which has moved) give way to another one if
+// that holds a smaller entry
+//
+// As the heads of the other partitions did not change, the current entry only
+// has to be compared to the smallest of them.
+void MergeCursor::Reselect(){
+  Head &head = heads_[current_];
+  if(!head.cursor.valid()){
+    head.valid = false;
+    SelectMinimum();
+    return;
+  }
+
+  Entry* entry = head.cursor.entry();
+  if((next_ < 0)
+     || (Compare(entry->key(), entry->key_size, entry->id, next_) <= 0))
+    return;
+  Park(current_);
+  SelectMinimum();
+}
+
+// Compare the given key/id combination to the head of the given partition
+int MergeCursor::Compare(const char* key, size_t key_size, uint64_t id,
+                         int partition) const{
+  const Head &head = heads_[partition];
+  int result = compare_(key, key_size, head.key, head.key_size);
+  if(result != 0)
+    return result;
+  return (id < head.id) ? -1 : ((id > head.id) ? 1 : 0);
+}
@@ -0,0 +1,156 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+/** @file
+ A cursor reading the entries of several B+-trees as a single ordered stream.
+
+ An index may be hash-partitioned across several trees (see IndexSchema). The
+ merge cursor keeps one tree cursor per partition and always returns the
+ smallest entry (by key and id) of all partitions.
+
+ Only the partition holding the current entry is latched. For every other
+ partition the cursor remembers a copy of the key and the id of the next entry
+ it will return (its head), so it never has to wait for a latch of one tree
+ while holding a latch of another. When a partition becomes current again,
+ its cursor is moved to the first entry at or after its head, which may differ
+ from the remembered entry if that has been removed in the meantime.
+*/
+
+#ifndef _NATIVEIMPL_MERGE_CURSOR_H_
+#define _NATIVEIMPL_MERGE_CURSOR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <common/macros.h>
+
+#include "btree.h"
+#include "entry.h"
+
+// A cursor used to read the entries of several B+-trees in ascending order
+//
+// It offers the same operations as BTreeCursor. With a single tree, all
+// operations are passed to the cursor of that tree.
+class MergeCursor{
+ public:
+  // Constructor
+  MergeCursor();
+
+  // Destructor
+  ~MergeCursor();
+
+  // Set the trees to be read and the maximum size of their keys
+  void set_trees(BTree **trees, uint32_t count, size_t key_size);
+
+  // Position the cursor on the first entry >= key/id
+  void Seek(const char* key, size_t key_size, uint64_t id);
+
+  // Re-latch the current partition and position the cursor on the first entry
+  // following the given key/id combination (the last entry that was read)
+  void SeekAfter(const char* key, size_t key_size, uint64_t id);
+
+  // Move the cursor forward to the first entry >= key/id (which must follow
+  // the current entry)
+  void SeekForward(const char* key, size_t key_size, uint64_t id);
+
+  // Move the cursor to the next entry
+  //
+  // Returns false if the end of all trees has been reached.
+  bool Next();
+
+  // Release the latch of the current partition
+  void Release();
+
+  // Whether the cursor points to a valid entry
+  bool valid() const {
+    return (count_ == 1) ? heads_[0].cursor.valid() : (current_ >= 0);
+  };
+
+  // Return the entry the cursor points to
+  Entry* entry() const {
+    return heads_[(count_ == 1) ? 0 : current_].cursor.entry();
+  };
+
+ private:
+  // The state of a single partition
+  struct Head{
+    // The cursor reading the tree of the partition
+    BTreeCursor cursor;
+
+    // A copy of the key and the id of the next entry (or a lower bound of
+    // them), which is only valid while the partition is not current
+    char *key;
+    size_t key_size;
+    uint64_t id;
+
+    // Whether the partition may hold further entries
+    bool valid;
+  };
+
+  // Remember the entry the cursor of the given partition points to as its head
+  // and release the cursor
+  void Park(int partition);
+
+  // Make the partition holding the smallest entry the current one
+  void SelectMinimum();
+
+  // Make the current partition (which has moved) give way to another one if
+  // that holds a smaller entry
+  void Reselect();
+
+  // Compare the given key/id combination to the head of the given partition
+  int Compare(const char* key, size_t key_size, uint64_t id, int partition) const;
+
+  // The states of all partitions
+  Head *heads_;
+
+  // The number of partitions
+  uint32_t count_;
+
+  // The function comparing the keys of the trees
+  KeyComparator compare_;
+
+  // The number of partitions the state array has been allocated for
+  uint32_t capacity_;
+
+  // The buffer holding the keys of all heads
+  char *key_buffer_;
+
+  // The size of the key buffer
+  size_t key_buffer_capacity_;
+
+  // The partition holding the current entry (or -1 if all have ended)
+  int current_;
+
+  // The partition with the smallest head besides the current one (or -1)
+  int next_;
+
+  DISALLOW_COPY_AND_ASSIGN(MergeCursor);
+};
+
+#endif // _NATIVEIMPL_MERGE_CURSOR_H_
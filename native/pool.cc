@@ -0,0 +1,337 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+#include <pthread.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <common/mutex.h>
+#include <common/numa.h>
+
+#include "iterator.h"
+#include "pool.h"
+#include "transaction.h"
+
+// The objects cached by a single thread
+struct ThreadCache{
+  // The released transactions
+  Transaction* transactions[POOL_CAPACITY];
+  size_t transaction_count;
+
+  // The released iterators
+  Iterator* iterators[POOL_CAPACITY];
+  size_t iterator_count;
+
+  // The buffer returned by KeyBuffer()
+  char* key;
+  size_t key_capacity;
+
+  // The vector returned by EntryBuffer()
+  std::vector<Entry*> entries;
+
+  // The released entries per size class (linked by their first word)
+  void* free_entries[ENTRY_POOL_MAX_SIZE / ENTRY_SIZE_CLASS];
+  size_t free_entry_count[ENTRY_POOL_MAX_SIZE / ENTRY_SIZE_CLASS];
+
+  // The number of allocations counted by the thread
+  volatile uint64_t allocations;
+
+  // The list of all caches
+  ThreadCache* prev;
+  ThreadCache* next;
+};
+
+// The cache of the current thread
+static __thread ThreadCache* thread_cache = NULL;
+
+// The key used to free the cache of a thread when it exits
+static pthread_key_t cache_key;
+
+// Makes sure that the key is only created once
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+// The caches of all running threads
+static ThreadCache* caches = NULL;
+
+// The number of allocations counted by threads that have exited (or by
+// threads whose cache could not be created)
+static volatile uint64_t retired_allocations = 0;
+
+// A mutex protecting the list of caches and the retired allocations
+static Mutex cache_mutex;
+
+// Whether the threads interleave their memory across all NUMA nodes
+static bool interleave_memory = false;
+
+// Makes sure that the memory placement is only read once
+static pthread_once_t placement_once = PTHREAD_ONCE_INIT;
+
+// Read the memory placement from the environment
+//
+// By default, a page is placed on the NUMA node of the thread that touches it
+// first, so the records of an index end up on the node of the thread that
+// populated it. If the environment variable CONTEST_NUMA is set to
+// "interleave", the pages touched first by any thread using the
+// implementation are spread round-robin across all nodes instead.
+static void InitializeMemoryPlacement(){
+  const char* value = getenv("CONTEST_NUMA");
+  if((value != NULL) && (strcmp(value, "interleave") == 0))
+    interleave_memory = true;
+}
+
+// Free the cache of a thread that exits
+static void FreeCache(void* data){
+  ThreadCache* cache = (ThreadCache*) data;
+  thread_cache = NULL;
+  for(size_t i = 0; i < cache->transaction_count; i++)
+    delete cache->transactions[i];
+  for(size_t i = 0; i < cache->iterator_count; i++)
+    delete cache->iterators[i];
+  free(cache->key);
+  for(size_t i = 0; i < ENTRY_POOL_MAX_SIZE / ENTRY_SIZE_CLASS; i++){
+    while(cache->free_entries[i] != NULL){
+      void* entry = cache->free_entries[i];
+      cache->free_entries[i] = *(void**) entry;
+      free(entry);
+    }
+  }
+
+  lock(cache_mutex){
+    if(cache->prev != NULL)
+      cache->prev->next = cache->next;
+    else
+      caches = cache->next;
+    if(cache->next != NULL)
+      cache->next->prev = cache->prev;
+    retired_allocations += cache->allocations;
+  }
+  delete cache;
+}
+
+// Create the key used to free the caches
+static void CreateCacheKey(){
+  pthread_key_create(&cache_key, &FreeCache);
+}
+
+// Return the cache of the calling thread (or NULL if it could not be created)
+static ThreadCache* GetCache(){
+  if(thread_cache != NULL)
+    return thread_cache;
+
+  pthread_once(&cache_once, &CreateCacheKey);
+  ThreadCache* cache = new (std::nothrow) ThreadCache();
+  if(cache == NULL)
+    return NULL;
+  if(pthread_setspecific(cache_key, cache) != 0){
+    delete cache;
+    return NULL;
+  }
+  cache->transaction_count = 0;
+  cache->iterator_count = 0;
+  cache->key = NULL;
+  cache->key_capacity = 0;
+  for(size_t i = 0; i < ENTRY_POOL_MAX_SIZE / ENTRY_SIZE_CLASS; i++){
+    cache->free_entries[i] = NULL;
+    cache->free_entry_count[i] = 0;
+  }
+  cache->allocations = 1;
+  cache->prev = NULL;
+
+  lock(cache_mutex){
+    cache->next = caches;
+    if(caches != NULL)
+      caches->prev = cache;
+    caches = cache;
+  }
+  thread_cache = cache;
+
+  // The cache is created by the first operation of a thread, which is the
+  // right time to set its memory policy (this also affects the pages touched
+  // by the application afterwards)
+  pthread_once(&placement_once, &InitializeMemoryPlacement);
+  if(interleave_memory)
+    NumaSetThreadPolicy(true);
+  return cache;
+}
+
+// Return a transaction that has been started by the calling thread
+//
+// A cached transaction is restarted, so it keeps the capacity of its log.
+Transaction* NewTransaction(){
+  ThreadCache* cache = GetCache();
+  if((cache != NULL) && (cache->transaction_count > 0)){
+    Transaction* tx = cache->transactions[cache->transaction_count - 1];
+    tx->Begin();
+    cache->transaction_count--;
+    return tx;
+  }
+
+  CountAllocation();
+  return new Transaction();
+}
+
+// Release a transaction that has been committed or aborted
+void DeleteTransaction(Transaction* tx){
+  if(tx == NULL)
+    return;
+
+  if(!tx->finished())
+    tx->Abort();
+
+  ThreadCache* cache = GetCache();
+  if((cache != NULL) && (cache->transaction_count < POOL_CAPACITY))
+    cache->transactions[cache->transaction_count++] = tx;
+  else
+    delete tx;
+}
+
+// Return a closed iterator
+//
+// A cached iterator keeps the buffers allocated by its previous uses.
+Iterator* NewIterator(){
+  ThreadCache* cache = GetCache();
+  if((cache != NULL) && (cache->iterator_count > 0))
+    return cache->iterators[--cache->iterator_count];
+
+  CountAllocation();
+  return new Iterator();
+}
+
+// Release a closed iterator
+void DeleteIterator(Iterator* it){
+  if(it == NULL)
+    return;
+
+  if(!it->closed())
+    it->Close();
+
+  ThreadCache* cache = GetCache();
+  if((cache != NULL) && (cache->iterator_count < POOL_CAPACITY))
+    cache->iterators[cache->iterator_count++] = it;
+  else
+    delete it;
+}
+
+// Return the memory for an entry of the given size
+//
+// Entries of up to ENTRY_POOL_MAX_SIZE bytes are rounded up to a multiple of
+// ENTRY_SIZE_CLASS and taken from the free list of their class, if possible.
+void* AllocateEntry(size_t size){
+  ThreadCache* cache = GetCache();
+  size_t size_class = (size + ENTRY_SIZE_CLASS - 1) / ENTRY_SIZE_CLASS;
+  if(size_class * ENTRY_SIZE_CLASS <= ENTRY_POOL_MAX_SIZE){
+    if((cache != NULL) && (cache->free_entries[size_class - 1] != NULL)){
+      void* entry = cache->free_entries[size_class - 1];
+      cache->free_entries[size_class - 1] = *(void**) entry;
+      cache->free_entry_count[size_class - 1]--;
+      return entry;
+    }
+    size = size_class * ENTRY_SIZE_CLASS;
+  }
+
+  void* entry = malloc(size);
+  if(entry == NULL)
+    throw std::bad_alloc();
+  CountAllocation();
+  return entry;
+}
+
+// Release the memory of an entry of the given size
+//
+// The memory is kept by the calling thread unless the free list of its size
+// class is full (entries may be released by other threads than the ones that
+// allocated them).
+void ReleaseEntry(void* entry, size_t size){
+  size_t size_class = (size + ENTRY_SIZE_CLASS - 1) / ENTRY_SIZE_CLASS;
+  if(size_class * ENTRY_SIZE_CLASS <= ENTRY_POOL_MAX_SIZE){
+    ThreadCache* cache = GetCache();
+    if((cache != NULL)
+       && (cache->free_entry_count[size_class - 1] < ENTRY_POOL_CAPACITY)){
+      *(void**) entry = cache->free_entries[size_class - 1];
+      cache->free_entries[size_class - 1] = entry;
+      cache->free_entry_count[size_class - 1]++;
+      return;
+    }
+  }
+  free(entry);
+}
+
+// Return a buffer of the calling thread that can hold a key of the given size
+char* KeyBuffer(size_t size){
+  ThreadCache* cache = GetCache();
+  if(cache == NULL)
+    throw std::bad_alloc();
+
+  if(size > cache->key_capacity){
+    char* key = (char*) realloc(cache->key, size);
+    if(key == NULL)
+      throw std::bad_alloc();
+    cache->key = key;
+    cache->key_capacity = size;
+    cache->allocations++;
+  }
+  return cache->key;
+}
+
+// Return an empty vector of the calling thread used to collect entries
+std::vector<Entry*>& EntryBuffer(){
+  ThreadCache* cache = GetCache();
+  if(cache == NULL)
+    throw std::bad_alloc();
+
+  cache->entries.clear();
+  return cache->entries;
+}
+
+// Count a heap allocation made on behalf of the calling thread
+//
+// The counter of the thread is only written by the thread itself, so no
+// atomic operation is needed unless the cache could not be created.
+void CountAllocation(){
+  ThreadCache* cache = GetCache();
+  if(cache != NULL){
+    cache->allocations++;
+  } else {
+    __sync_fetch_and_add(&retired_allocations, 1);
+  }
+}
+
+// Return the number of heap allocations counted so far (by all threads)
+//
+// The counters of running threads are read without synchronizing with them,
+// so allocations made concurrently may be missing.
+uint64_t AllocationCount(){
+  lock(cache_mutex){
+    uint64_t count = retired_allocations;
+    for(ThreadCache* cache = caches; cache != NULL; cache = cache->next)
+      count += cache->allocations;
+    return count;
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+#ifndef _NATIVEIMPL_POOL_H_
+#define _NATIVEIMPL_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct Entry;
+class Iterator;
+class Transaction;
+
+// The maximum number of transactions and iterators cached per thread
+#define POOL_CAPACITY 16
+
+// The granularity of the size classes of entries in bytes
+#define ENTRY_SIZE_CLASS 16
+
+// The largest entry (header, key and payload) that is cached in bytes
+#define ENTRY_POOL_MAX_SIZE 512
+
+// The maximum number of released entries cached per thread and size class
+#define ENTRY_POOL_CAPACITY 128
+
+// Per-thread caches of frequently created objects
+//
+// Transactions and iterators that have been released are kept by the thread
+// that released them and handed out again by its next request, together with
+// the buffers they have already allocated. Released entries are kept in
+// free lists per size class and reused for new entries of the same class.
+// Each thread furthermore owns the
+// scratch buffers used to encode keys and to collect matching entries. The
+// caches of a thread are freed when the thread exits. When the cache of a
+// thread is created, its NUMA memory policy is set (see CONTEST_NUMA in
+// pool.cc).
+
+// Return a transaction that has been started by the calling thread
+Transaction* NewTransaction();
+
+// Release a transaction that has been committed or aborted
+void DeleteTransaction(Transaction* tx);
+
+// Return a closed iterator
+Iterator* NewIterator();
+
+// Release a closed iterator
+void DeleteIterator(Iterator* it);
+
+// Return the memory for an entry of the given size (header, key and payload)
+//
+// Throws std::bad_alloc if no memory is available.
+void* AllocateEntry(size_t size);
+
+// Release the memory of an entry of the given size
+void ReleaseEntry(void* entry, size_t size);
+
+// Return a buffer of the calling thread that can hold a key of the given size
+//
+// The buffer stays valid until the next call of this function by the same
+// thread.
+char* KeyBuffer(size_t size);
+
+// Return an empty vector of the calling thread used to collect entries
+//
+// The vector stays valid until the next call of this function by the same
+// thread.
+std::vector<Entry*>& EntryBuffer();
+
+// Count a heap allocation made on behalf of the calling thread
+void CountAllocation();
+
+// Return the number of heap allocations counted so far (by all threads)
+uint64_t AllocationCount();
+
+#endif // _NATIVEIMPL_POOL_H_
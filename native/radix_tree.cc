@@ -0,0 +1,633 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+#include "latch.h"
+#include "pool.h"
+#include "radix_tree.h"
+
+// The types of the nodes
+enum RadixNodeType{
+  kNode4,
+  kNode16,
+  kNode48,
+  kNode256
+};
+
+// The header shared by all nodes
+struct RadixNode{
+  // The version of the node (odd while the node is modified and once it has
+  // been replaced)
+  volatile uint32_t version;
+
+  // The type of the node (one of RadixNodeType)
+  uint8_t type;
+
+  // The number of bytes of the prefix
+  uint8_t prefix_length;
+
+  // The number of children
+  volatile uint16_t count;
+
+  // The position of the first byte of the prefix inside the keys (changes if
+  // the prefix is split, see RadixTree::Insert())
+  uint8_t depth;
+
+  // The bytes shared by all keys below the node (following the bytes that
+  // lead to the node)
+  uint8_t prefix[RADIX_MAX_PREFIX];
+};
+
+// Make sure that the header of a node does not exceed 16 bytes
+typedef char header_size_check[(sizeof(RadixNode) <= 16) ? 1 : -1];
+
+// A node holding up to 4 children (sorted by their key bytes)
+struct RadixNode4: public RadixNode{
+  uint8_t keys[4];
+  volatile uintptr_t children[4];
+};
+
+// A node holding up to 16 children (sorted by their key bytes)
+struct RadixNode16: public RadixNode{
+  uint8_t keys[16];
+  volatile uintptr_t children[16];
+};
+
+// A node holding up to 48 children, which are found using an index of all
+// possible key bytes (storing the position of the child plus one)
+struct RadixNode48: public RadixNode{
+  volatile uint8_t index[256];
+  volatile uintptr_t children[48];
+};
+
+// A node holding a child for every possible key byte
+struct RadixNode256: public RadixNode{
+  volatile uintptr_t children[256];
+};
+
+// A leaf of the tree (the key is stored directly behind the leaf)
+struct RadixLeaf{
+  LeafNode* volatile value;
+
+  char* key(){ return reinterpret_cast<char*>(this + 1); };
+  const char* key() const { return reinterpret_cast<const char*>(this + 1); };
+};
+
+// Leaves are stored inside the children slots with the lowest bit set
+static inline bool IsLeaf(uintptr_t child){
+  return (child & 1) != 0;
+}
+
+// Return the leaf stored inside the given child slot
+static inline RadixLeaf* AsLeaf(uintptr_t child){
+  return reinterpret_cast<RadixLeaf*>(child & ~((uintptr_t) 1));
+}
+
+// Return the node stored inside the given child slot
+static inline RadixNode* AsNode(uintptr_t child){
+  return reinterpret_cast<RadixNode*>(child);
+}
+
+// Return the size of a node of the given type in bytes
+static size_t NodeSize(uint8_t type){
+  switch(type){
+    case kNode4: return sizeof(RadixNode4);
+    case kNode16: return sizeof(RadixNode16);
+    case kNode48: return sizeof(RadixNode48);
+    default: return sizeof(RadixNode256);
+  }
+}
+
+// Return the slot of the child for the given key byte (or NULL)
+//
+// Readers may call this while the node is modified, so the number of children
+// is never trusted beyond the capacity of the node.
+static volatile uintptr_t* ChildSlot(RadixNode *node, uint8_t byte){
+  switch(node->type){
+    case kNode4:{
+      RadixNode4* n = static_cast<RadixNode4*>(node);
+      int count = std::min((int) n->count, 4);
+      for(int i = 0; i < count; i++){
+        if(n->keys[i] == byte)
+          return &n->children[i];
+      }
+      return NULL;
+    }
+    case kNode16:{
+      RadixNode16* n = static_cast<RadixNode16*>(node);
+      int count = std::min((int) n->count, 16);
+      for(int i = 0; i < count; i++){
+        if(n->keys[i] == byte)
+          return &n->children[i];
+      }
+      return NULL;
+    }
+    case kNode48:{
+      RadixNode48* n = static_cast<RadixNode48*>(node);
+      uint8_t position = n->index[byte];
+      return (position != 0) ? &n->children[position-1] : NULL;
+    }
+    default:{
+      RadixNode256* n = static_cast<RadixNode256*>(node);
+      return (n->children[byte] != 0) ? &n->children[byte] : NULL;
+    }
+  }
+}
+
+// Return the child with the greatest key byte smaller than the given byte
+// (which may be 256 to find the last child), or 0 if there is none
+static uintptr_t ChildBelow(RadixNode *node, int byte){
+  switch(node->type){
+    case kNode4:{
+      RadixNode4* n = static_cast<RadixNode4*>(node);
+      for(int i = std::min((int) n->count, 4); i > 0; i--){
+        if(n->keys[i-1] < byte)
+          return n->children[i-1];
+      }
+      return 0;
+    }
+    case kNode16:{
+      RadixNode16* n = static_cast<RadixNode16*>(node);
+      for(int i = std::min((int) n->count, 16); i > 0; i--){
+        if(n->keys[i-1] < byte)
+          return n->children[i-1];
+      }
+      return 0;
+    }
+    case kNode48:{
+      RadixNode48* n = static_cast<RadixNode48*>(node);
+      for(int b = byte; b > 0; b--){
+        uint8_t position = n->index[b-1];
+        if(position != 0)
+          return n->children[position-1];
+      }
+      return 0;
+    }
+    default:{
+      RadixNode256* n = static_cast<RadixNode256*>(node);
+      for(int b = byte; b > 0; b--){
+        if(n->children[b-1] != 0)
+          return n->children[b-1];
+      }
+      return 0;
+    }
+  }
+}
+
+// Check that the given node still has the given (even) version
+static inline bool Validate(const RadixNode *node, uint32_t version){
+  ReadBarrier();
+  return node->version == version;
+}
+
+// Constructor
+RadixTree::RadixTree(size_t key_size){
+  key_size_ = key_size;
+  root_ = 0;
+  obsolete_bytes_ = 0;
+}
+
+// Destructor
+RadixTree::~RadixTree(){
+  Free(root_);
+  for(size_t i = 0; i < obsolete_.size(); i++)
+    free(obsolete_[i]);
+}
+
+// Map the given key to the given leaf
+//
+// The leaf (and all nodes) are completely initialized before they are
+// published by a single store into the slot of their parent.
+void RadixTree::Insert(const char* key, LeafNode* value){
+  lock(mutex_){
+    uintptr_t leaf = NewLeaf(key, value);
+    bool inserted;
+    try{
+      inserted = Insert(&root_, leaf, key, 0);
+    } catch(...){
+      free(AsLeaf(leaf));
+      throw;
+    }
+    if(!inserted)
+      free(AsLeaf(leaf));
+  }
+}
+
+// Return the leaf mapped to the greatest key smaller than (or equal to) the
+// given key
+//
+// The search starts over whenever it has read a node that has been modified
+// in the meantime.
+LeafNode* RadixTree::FindLess(const char* key, bool inclusive) const{
+  unsigned int spins = 0;
+  while(true){
+    uintptr_t root = root_;
+    if(root == 0)
+      return NULL;
+
+    bool restart = false;
+    const RadixLeaf* leaf = FindLess(root, key, 0, inclusive, &restart);
+    if(!restart)
+      return (leaf != NULL) ? leaf->value : NULL;
+    LatchBackoff(spins);
+  }
+}
+
+// Return the memory used by the tree in bytes (including replaced nodes)
+size_t RadixTree::MemoryUsage(){
+  size_t bytes = sizeof(RadixTree);
+  lock(mutex_){
+    bytes += MemoryUsage(root_) + obsolete_bytes_;
+  }
+  return bytes;
+}
+
+// Return the leaf holding the greatest key in the subtree of the given child
+// that is smaller than (or equal to) the given key
+//
+// If the subtree holding the next byte of the key has no smaller key, the
+// greatest key below the preceding child is returned.
+const RadixLeaf* RadixTree::FindLess(uintptr_t child, const char* key,
+                                     size_t depth, bool inclusive,
+                                     bool *restart) const{
+  if(IsLeaf(child)){
+    const RadixLeaf* leaf = AsLeaf(child);
+    int result = memcmp(leaf->key(), key, key_size_);
+    return ((result < 0) || (inclusive && (result == 0))) ? leaf : NULL;
+  }
+
+  // A node that has been moved down by splitting its prefix may still be
+  // reached using a pointer read before the split
+  RadixNode* node = AsNode(child);
+  uint32_t version = node->version;
+  ReadBarrier();
+  size_t length = node->prefix_length;
+  if((version & 1) || (node->depth != depth) || (depth + length >= key_size_)){
+    *restart = true;
+    return NULL;
+  }
+
+  for(size_t i = 0; i < length; i++){
+    uint8_t byte = key[depth+i];
+    if(node->prefix[i] != byte){
+      bool smaller = (node->prefix[i] < byte);
+      if(!Validate(node, version)){
+        *restart = true;
+        return NULL;
+      }
+      return smaller ? Maximum(child, restart) : NULL;
+    }
+  }
+  depth += length;
+
+  uint8_t byte = key[depth];
+  volatile uintptr_t* slot = ChildSlot(node, byte);
+  uintptr_t exact = (slot != NULL) ? *slot : 0;
+  uintptr_t below = ChildBelow(node, byte);
+  if(!Validate(node, version)){
+    *restart = true;
+    return NULL;
+  }
+
+  if(exact != 0){
+    const RadixLeaf* leaf = FindLess(exact, key, depth+1, inclusive, restart);
+    if((leaf != NULL) || *restart)
+      return leaf;
+  }
+  return (below != 0) ? Maximum(below, restart) : NULL;
+}
+
+// Return the leaf holding the greatest key in the subtree of the given child
+const RadixLeaf* RadixTree::Maximum(uintptr_t child, bool *restart){
+  while(!IsLeaf(child)){
+    RadixNode* node = AsNode(child);
+    uint32_t version = node->version;
+    ReadBarrier();
+    child = (version & 1) ? 0 : ChildBelow(node, 256);
+    if((child == 0) || !Validate(node, version)){
+      *restart = true;
+      return NULL;
+    }
+  }
+  return AsLeaf(child);
+}
+
+// Create a leaf for the given key and value
+uintptr_t RadixTree::NewLeaf(const char* key, LeafNode* value){
+  RadixLeaf* leaf = (RadixLeaf*) malloc(sizeof(RadixLeaf) + key_size_);
+  if(leaf == NULL)
+    throw std::bad_alloc();
+  CountAllocation();
+  leaf->value = value;
+  memcpy(leaf->key(), key, key_size_);
+  return reinterpret_cast<uintptr_t>(leaf) | 1;
+}
+
+// Insert the given leaf into the subtree referenced by the given slot
+//
+// All allocations happen before the tree is changed. A node is changed in
+// place if the change is a single store (adding a child to a node with 48 or
+// 256 children) or while its version is odd (the other cases).
+bool RadixTree::Insert(volatile uintptr_t *slot, uintptr_t leaf,
+                       const char* key, size_t depth){
+  while(true){
+    uintptr_t child = *slot;
+    if(child == 0){
+      // The tree is empty
+      __sync_synchronize();
+      *slot = leaf;
+      return true;
+    }
+
+    if(IsLeaf(child)){
+      // Replace the leaf by a node holding both leaves
+      RadixLeaf* existing = AsLeaf(child);
+      size_t mismatch = depth;
+      while((mismatch < key_size_) && (existing->key()[mismatch] == key[mismatch]))
+        mismatch++;
+      if(mismatch == key_size_){
+        existing->value = AsLeaf(leaf)->value;
+        return false;
+      }
+      RadixNode* node = NewNode(child, existing->key(), leaf, key, depth,
+                                mismatch);
+      __sync_synchronize();
+      *slot = reinterpret_cast<uintptr_t>(node);
+      return true;
+    }
+
+    RadixNode* node = AsNode(child);
+    size_t length = node->prefix_length;
+    size_t common = 0;
+    while((common < length) && (node->prefix[common] == (uint8_t) key[depth+common]))
+      common++;
+    if(common < length){
+      // Split the prefix of the node: a new node takes the common part of the
+      // prefix and gets the node and the leaf as children
+      RadixNode4* parent = static_cast<RadixNode4*>(AllocateNode(kNode4));
+      parent->depth = depth;
+      parent->prefix_length = common;
+      memcpy(parent->prefix, node->prefix, common);
+      uint8_t node_byte = node->prefix[common];
+      uint8_t leaf_byte = key[depth+common];
+      int first = (node_byte < leaf_byte) ? 0 : 1;
+      parent->keys[first] = node_byte;
+      parent->children[first] = child;
+      parent->keys[1-first] = leaf_byte;
+      parent->children[1-first] = leaf;
+      parent->count = 2;
+
+      BeginModification(node->version);
+      *slot = reinterpret_cast<uintptr_t>(parent);
+      memmove(node->prefix, node->prefix + common + 1, length - common - 1);
+      node->prefix_length = length - common - 1;
+      node->depth = depth + common + 1;
+      EndModification(node->version);
+      return true;
+    }
+    depth += length;
+
+    volatile uintptr_t* next = ChildSlot(node, key[depth]);
+    if(next == NULL){
+      AddChild(slot, node, key[depth], leaf);
+      return true;
+    }
+    slot = next;
+    depth++;
+  }
+}
+
+// Create a node on the given depth holding the two given leaves
+//
+// If the leaves share more bytes than fit into a prefix, a chain of nodes
+// with a single child is created.
+RadixNode* RadixTree::NewNode(uintptr_t first, const char* first_key,
+                              uintptr_t second, const char* second_key,
+                              size_t depth, size_t mismatch){
+  if(mismatch - depth > RADIX_MAX_PREFIX){
+    RadixNode* child = NewNode(first, first_key, second, second_key,
+                               depth + RADIX_MAX_PREFIX + 1, mismatch);
+    RadixNode4* node;
+    try{
+      node = static_cast<RadixNode4*>(AllocateNode(kNode4));
+    } catch(...){
+      FreeChain(child);
+      throw;
+    }
+    node->depth = depth;
+    node->prefix_length = RADIX_MAX_PREFIX;
+    memcpy(node->prefix, first_key + depth, RADIX_MAX_PREFIX);
+    node->keys[0] = first_key[depth + RADIX_MAX_PREFIX];
+    node->children[0] = reinterpret_cast<uintptr_t>(child);
+    node->count = 1;
+    return node;
+  }
+
+  RadixNode4* node = static_cast<RadixNode4*>(AllocateNode(kNode4));
+  node->depth = depth;
+  node->prefix_length = mismatch - depth;
+  memcpy(node->prefix, first_key + depth, mismatch - depth);
+  int position = ((uint8_t) first_key[mismatch] < (uint8_t) second_key[mismatch]) ? 0 : 1;
+  node->keys[position] = first_key[mismatch];
+  node->children[position] = first;
+  node->keys[1-position] = second_key[mismatch];
+  node->children[1-position] = second;
+  node->count = 2;
+  return node;
+}
+
+// Add the given child to the given node
+//
+// A full node is copied into a node of the next larger type, which replaces
+// it inside the given slot. The old node stays marked as modified, so readers
+// that still read it start over, and is only freed with the tree.
+void RadixTree::AddChild(volatile uintptr_t *slot, RadixNode *node,
+                         uint8_t byte, uintptr_t child){
+  switch(node->type){
+    case kNode4:{
+      RadixNode4* n = static_cast<RadixNode4*>(node);
+      if(n->count == 4)
+        break;
+      BeginModification(n->version);
+      int position = n->count;
+      while((position > 0) && (n->keys[position-1] > byte)){
+        n->keys[position] = n->keys[position-1];
+        n->children[position] = n->children[position-1];
+        position--;
+      }
+      n->keys[position] = byte;
+      n->children[position] = child;
+      n->count++;
+      EndModification(n->version);
+      return;
+    }
+    case kNode16:{
+      RadixNode16* n = static_cast<RadixNode16*>(node);
+      if(n->count == 16)
+        break;
+      BeginModification(n->version);
+      int position = n->count;
+      while((position > 0) && (n->keys[position-1] > byte)){
+        n->keys[position] = n->keys[position-1];
+        n->children[position] = n->children[position-1];
+        position--;
+      }
+      n->keys[position] = byte;
+      n->children[position] = child;
+      n->count++;
+      EndModification(n->version);
+      return;
+    }
+    case kNode48:{
+      RadixNode48* n = static_cast<RadixNode48*>(node);
+      if(n->count == 48)
+        break;
+      n->children[n->count] = child;
+      __sync_synchronize();
+      n->index[byte] = n->count + 1;
+      n->count++;
+      return;
+    }
+    default:{
+      RadixNode256* n = static_cast<RadixNode256*>(node);
+      __sync_synchronize();
+      n->children[byte] = child;
+      n->count++;
+      return;
+    }
+  }
+
+  // Copy the full node into a larger one
+  RadixNode* larger = AllocateNode(node->type + 1);
+  larger->depth = node->depth;
+  larger->prefix_length = node->prefix_length;
+  memcpy(larger->prefix, node->prefix, node->prefix_length);
+  if(node->type == kNode4){
+    RadixNode4* n = static_cast<RadixNode4*>(node);
+    RadixNode16* l = static_cast<RadixNode16*>(larger);
+    int position = 0;
+    for(int i = 0; i < 4; i++){
+      if(n->keys[i] < byte)
+        position = i + 1;
+      l->keys[i + ((n->keys[i] < byte) ? 0 : 1)] = n->keys[i];
+      l->children[i + ((n->keys[i] < byte) ? 0 : 1)] = n->children[i];
+    }
+    l->keys[position] = byte;
+    l->children[position] = child;
+  } else if(node->type == kNode16){
+    RadixNode16* n = static_cast<RadixNode16*>(node);
+    RadixNode48* l = static_cast<RadixNode48*>(larger);
+    for(int i = 0; i < 16; i++){
+      l->children[i] = n->children[i];
+      l->index[n->keys[i]] = i + 1;
+    }
+    l->children[16] = child;
+    l->index[byte] = 17;
+  } else {
+    RadixNode48* n = static_cast<RadixNode48*>(node);
+    RadixNode256* l = static_cast<RadixNode256*>(larger);
+    for(int b = 0; b < 256; b++){
+      if(n->index[b] != 0)
+        l->children[b] = n->children[n->index[b]-1];
+    }
+    l->children[byte] = child;
+  }
+  larger->count = node->count + 1;
+
+  try{
+    if(obsolete_.size() == obsolete_.capacity())
+      CountAllocation();
+    obsolete_.push_back(node);
+  } catch(...){
+    free(larger);
+    throw;
+  }
+  obsolete_bytes_ += NodeSize(node->type);
+
+  BeginModification(node->version);
+  *slot = reinterpret_cast<uintptr_t>(larger);
+}
+
+// Allocate a node of the given type (all children are cleared)
+RadixNode* RadixTree::AllocateNode(uint8_t type){
+  RadixNode* node = (RadixNode*) calloc(1, NodeSize(type));
+  if(node == NULL)
+    throw std::bad_alloc();
+  CountAllocation();
+  node->type = type;
+  return node;
+}
+
+// Free the given chain of nodes created by NewNode() (but not the leaves)
+void RadixTree::FreeChain(RadixNode *node){
+  while(node != NULL){
+    RadixNode4* n = static_cast<RadixNode4*>(node);
+    node = ((n->count == 1) && !IsLeaf(n->children[0])) ? AsNode(n->children[0])
+                                                         : NULL;
+    free(n);
+  }
+}
+
+// Free the given child and everything below it
+void RadixTree::Free(uintptr_t child){
+  if(child == 0)
+    return;
+  if(IsLeaf(child)){
+    free(AsLeaf(child));
+    return;
+  }
+
+  RadixNode* node = AsNode(child);
+  for(int b = 0; b < 256; b++){
+    volatile uintptr_t* slot = ChildSlot(node, b);
+    if(slot != NULL)
+      Free(*slot);
+  }
+  free(node);
+}
+
+// Add the memory used by the given child and everything below it
+size_t RadixTree::MemoryUsage(uintptr_t child) const{
+  if(child == 0)
+    return 0;
+  if(IsLeaf(child))
+    return sizeof(RadixLeaf) + key_size_;
+
+  RadixNode* node = AsNode(child);
+  size_t bytes = NodeSize(node->type);
+  for(int b = 0; b < 256; b++){
+    volatile uintptr_t* slot = ChildSlot(node, b);
+    if(slot != NULL)
+      bytes += MemoryUsage(*slot);
+  }
+  return bytes;
+}
@@ -0,0 +1,160 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+
+/** @file
+ An adaptive radix tree (ART) mapping fixed-length byte strings to the leaves
+ of a B+-tree.
+
+ For indices whose keys only consist of SHORT and INT attributes, the encoded
+ keys have a fixed length and compare byte-wise, so they can be indexed by a
+ radix tree instead of a tree of inner nodes (see BTree). Descending the radix
+ tree takes at most one step per key byte, independent of the number of
+ records, and does not compare whole keys.
+
+ Inner nodes adapt their size to the number of children (4, 16, 48 or 256).
+ Paths with a single child are compressed into the prefix of the next node
+ (up to RADIX_MAX_PREFIX bytes), and a leaf is stored at the first byte that
+ distinguishes it from all other leaves (lazy expansion).
+
+ Readers do not latch any node. Like the inner nodes of the B+-tree, every
+ node has a version that is odd while a writer modifies the node, and readers
+ validate the versions of the nodes they have read (optimistic lock coupling).
+ Writers are serialized by a mutex. A node that is replaced by a larger one is
+ marked as obsolete (its version stays odd) and kept until the tree is
+ deleted, so readers never access freed memory. As nodes only grow, at most
+ three smaller nodes are kept per node. A node whose prefix is split moves
+ down by a level; it records its depth, so a reader that reaches it through
+ an outdated pointer notices this and starts over.
+*/
+
+#ifndef _NATIVEIMPL_RADIX_TREE_H_
+#define _NATIVEIMPL_RADIX_TREE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include <common/macros.h>
+#include <common/mutex.h>
+
+struct LeafNode;
+struct RadixLeaf;
+struct RadixNode;
+
+// The maximum number of bytes stored inside the prefix of a node (chosen so
+// that the header of a node fills 16 bytes)
+#define RADIX_MAX_PREFIX 7
+
+// A radix tree mapping keys of a fixed length to B+-tree leaves
+class RadixTree{
+ public:
+  // Constructor (all keys have the given size in bytes)
+  RadixTree(size_t key_size);
+
+  // Destructor (the leaves of the B+-tree are not freed)
+  ~RadixTree();
+
+  // Map the given key to the given leaf
+  //
+  // If the key is already present, the leaf replaces the old one. Throws
+  // std::bad_alloc if the tree can not be extended (the tree is unchanged).
+  void Insert(const char* key, LeafNode* value);
+
+  // Return the leaf mapped to the greatest key that is smaller than (or, if
+  // inclusive is set, equal to) the given key
+  //
+  // Returns NULL if there is no such key.
+  LeafNode* FindLess(const char* key, bool inclusive) const;
+
+  // Return the memory used by the tree in bytes
+  size_t MemoryUsage();
+
+ private:
+  // Return the leaf holding the greatest key in the subtree of the given child
+  // that is smaller than (or equal to) the given key
+  //
+  // Sets restart if a node has been modified while it was read.
+  const RadixLeaf* FindLess(uintptr_t child, const char* key, size_t depth,
+                            bool inclusive, bool *restart) const;
+
+  // Return the leaf holding the greatest key in the subtree of the given child
+  //
+  // Sets restart if a node has been modified while it was read.
+  static const RadixLeaf* Maximum(uintptr_t child, bool *restart);
+
+  // Create a leaf for the given key and value
+  uintptr_t NewLeaf(const char* key, LeafNode* value);
+
+  // Insert the given leaf into the subtree referenced by the given slot
+  //
+  // Returns false if the key is already present (only its value is replaced
+  // then).
+  bool Insert(volatile uintptr_t *slot, uintptr_t leaf, const char* key,
+              size_t depth);
+
+  // Create a node on the given depth holding the two given leaves, which
+  // share the bytes up to (but not including) position mismatch
+  RadixNode* NewNode(uintptr_t first, const char* first_key, uintptr_t second,
+                     const char* second_key, size_t depth, size_t mismatch);
+
+  // Add the given child to the given node, which is referenced by the given
+  // slot (the node is replaced by a larger one if it is full)
+  void AddChild(volatile uintptr_t *slot, RadixNode *node, uint8_t byte,
+                uintptr_t child);
+
+  // Allocate a node of the given type
+  static RadixNode* AllocateNode(uint8_t type);
+
+  // Free the given chain of nodes created by NewNode() (but not the leaves)
+  static void FreeChain(RadixNode *node);
+
+  // Free the given child and everything below it
+  static void Free(uintptr_t child);
+
+  // Add the memory used by the given child and everything below it
+  size_t MemoryUsage(uintptr_t child) const;
+
+  // The size of the keys in bytes
+  size_t key_size_;
+
+  // The root of the tree (a node or a tagged leaf, 0 if the tree is empty)
+  volatile uintptr_t root_;
+
+  // The nodes that have been replaced by larger ones
+  std::vector<RadixNode*> obsolete_;
+
+  // The memory used by the nodes that have been replaced
+  size_t obsolete_bytes_;
+
+  // A mutex serializing the writers
+  Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(RadixTree);
+};
+
+#endif // _NATIVEIMPL_RADIX_TREE_H_
@@ -0,0 +1,281 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+
+#include <common/mutex.h>
+
+#include "btree.h"
+#include "snapshot.h"
+
+// The number of snapshots a thread can announce at the same time (more
+// snapshots are kept in the shared overflow set)
+#define SNAPSHOT_SLOTS 6
+
+// The number of commits that may have started but not ended yet (a power of
+// two)
+#define COMMIT_TABLE_SIZE 4096
+
+// The snapshot slots of a single thread (occupies a cache line of its own)
+//
+// Only the owner of the slots announces snapshots inside them, but any thread
+// may release them. The slots are never freed: when their thread exits, they
+// are handed over to the next thread that starts using snapshots.
+struct SnapshotSlots{
+  // The timestamps of the announced snapshots (TIMESTAMP_INFINITY if unused)
+  SnapshotSlot timestamps[SNAPSHOT_SLOTS];
+
+  // Whether the slots belong to a running thread
+  volatile uint64_t owned;
+
+  // The list of all slots
+  SnapshotSlots* next;
+};
+
+// The isolation level used by all transactions
+static IsolationLevel isolation_level = kReadCommitted;
+
+// Makes sure that the isolation level is only read once
+static pthread_once_t isolation_once = PTHREAD_ONCE_INIT;
+
+// The last commit timestamp that has been handed out
+static volatile uint64_t last_commit = 0;
+
+// The last commit timestamp whose changes have been published (all commits
+// up to this timestamp have ended)
+static volatile uint64_t last_published = 0;
+
+// The timestamps of the commits that have ended (the commit with timestamp t
+// stores t at position t % COMMIT_TABLE_SIZE)
+static volatile uint64_t commit_table[COMMIT_TABLE_SIZE];
+
+// The slots of the current thread
+static __thread SnapshotSlots* thread_slots = NULL;
+
+// The key used to hand the slots of a thread over when it exits
+static pthread_key_t slots_key;
+
+// Makes sure that the key is only created once
+static pthread_once_t slots_once = PTHREAD_ONCE_INIT;
+
+// The slots of all threads (only extended at the head, never shortened)
+static SnapshotSlots* volatile slots = NULL;
+
+// The snapshots that did not fit into the slots of their thread
+static std::multiset<uint64_t> overflow;
+
+// The number of snapshots inside the overflow set
+static volatile uint64_t overflow_count = 0;
+
+// A mutex protecting the overflow set
+static Mutex overflow_mutex;
+
+// Read the isolation level from the environment
+static void InitializeIsolationLevel(){
+  const char* value = getenv("CONTEST_ISOLATION");
+  if(value == NULL)
+    return;
+  if(strcmp(value, "snapshot") == 0)
+    isolation_level = kSnapshotIsolation;
+  else if(strcmp(value, "optimistic") == 0)
+    isolation_level = kOptimistic;
+}
+
+// Return the isolation level used by all transactions
+IsolationLevel GetIsolationLevel(){
+  pthread_once(&isolation_once, &InitializeIsolationLevel);
+  return isolation_level;
+}
+
+// Hand the slots of a thread that exits over to the next thread
+static void ReleaseSlots(void* data){
+  SnapshotSlots* thread = (SnapshotSlots*) data;
+  thread_slots = NULL;
+  __sync_synchronize();
+  thread->owned = 0;
+}
+
+// Create the key used to hand the slots over
+static void CreateSlotsKey(){
+  pthread_key_create(&slots_key, &ReleaseSlots);
+}
+
+// Return the slots of the calling thread (or NULL if they could not be
+// created)
+//
+// Slots left behind by a thread that has exited are reused first.
+static SnapshotSlots* GetSlots(){
+  if(thread_slots != NULL)
+    return thread_slots;
+
+  pthread_once(&slots_once, &CreateSlotsKey);
+  SnapshotSlots* thread = NULL;
+  for(SnapshotSlots* s = slots; s != NULL; s = s->next){
+    if((s->owned == 0) && __sync_bool_compare_and_swap(&s->owned, 0, 1)){
+      thread = s;
+      break;
+    }
+  }
+
+  if(thread == NULL){
+    void* memory;
+    if(posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(SnapshotSlots)) != 0)
+      return NULL;
+    thread = (SnapshotSlots*) memory;
+    for(int i = 0; i < SNAPSHOT_SLOTS; i++)
+      thread->timestamps[i] = TIMESTAMP_INFINITY;
+    thread->owned = 1;
+    SnapshotSlots* head;
+    do{
+      head = slots;
+      thread->next = head;
+    } while(!__sync_bool_compare_and_swap(&slots, head, thread));
+  }
+
+  if(pthread_setspecific(slots_key, thread) != 0){
+    thread->owned = 0;
+    return NULL;
+  }
+  thread_slots = thread;
+  return thread;
+}
+
+// Take a snapshot of all committed changes and return its timestamp
+//
+// The snapshot is announced before the last published timestamp is read
+// again: if it changed in the meantime, OldestSnapshot() may not have seen
+// the announcement, so the newer timestamp is announced instead.
+uint64_t AcquireSnapshot(SnapshotSlot** slot){
+  SnapshotSlots* thread = GetSlots();
+  *slot = NULL;
+  if(thread != NULL){
+    for(int i = 0; i < SNAPSHOT_SLOTS; i++){
+      if(thread->timestamps[i] == TIMESTAMP_INFINITY){
+        *slot = &thread->timestamps[i];
+        break;
+      }
+    }
+  }
+
+  if(*slot == NULL){
+    lock(overflow_mutex){
+      __sync_fetch_and_add(&overflow_count, 1);
+      uint64_t snapshot = last_published;
+      overflow.insert(snapshot);
+      return snapshot;
+    }
+  }
+
+  uint64_t snapshot = last_published;
+  while(true){
+    **slot = snapshot;
+    __sync_synchronize();
+    uint64_t published = last_published;
+    if(published == snapshot)
+      return snapshot;
+    snapshot = published;
+  }
+}
+
+// Release a snapshot that has been taken using AcquireSnapshot()
+void ReleaseSnapshot(uint64_t snapshot, SnapshotSlot* slot){
+  if(slot != NULL){
+    *slot = TIMESTAMP_INFINITY;
+    return;
+  }
+
+  lock(overflow_mutex){
+    overflow.erase(overflow.find(snapshot));
+    __sync_fetch_and_sub(&overflow_count, 1);
+  }
+}
+
+// Return the timestamp of the oldest snapshot that may still be taken or used
+//
+// The last published timestamp is read before the slots: a snapshot whose
+// announcement is not seen yet has re-read the published timestamp afterwards
+// (see AcquireSnapshot()), so it can not be older.
+uint64_t OldestSnapshot(){
+  uint64_t oldest = last_published;
+  __sync_synchronize();
+
+  for(SnapshotSlots* s = slots; s != NULL; s = s->next){
+    for(int i = 0; i < SNAPSHOT_SLOTS; i++){
+      uint64_t timestamp = s->timestamps[i];
+      if(timestamp < oldest)
+        oldest = timestamp;
+    }
+  }
+
+  if(overflow_count != 0){
+    lock(overflow_mutex){
+      if(!overflow.empty() && (*overflow.begin() < oldest))
+        oldest = *overflow.begin();
+    }
+  }
+  return oldest;
+}
+
+// Start committing a transaction and return its commit timestamp
+//
+// Waits if the commit table is full, i.e. if the oldest commit that has not
+// ended yet would share its position with the new one.
+uint64_t BeginCommit(){
+  uint64_t timestamp = __sync_add_and_fetch(&last_commit, 1);
+  while(timestamp - last_published > COMMIT_TABLE_SIZE)
+    sched_yield();
+  return timestamp;
+}
+
+// Make the changes stamped with the given commit timestamp visible to new
+// snapshots
+//
+// The commit is marked as ended in the commit table. Then the published
+// timestamp is advanced over all consecutive commits that have ended: the
+// commit that ends last always sees all others, so no commit is left behind.
+// Returns once the commit has been published (possibly by another thread), so
+// new snapshots of the committing thread always include its own changes.
+void EndCommit(uint64_t timestamp){
+  __sync_synchronize();
+  commit_table[timestamp & (COMMIT_TABLE_SIZE - 1)] = timestamp;
+  __sync_synchronize();
+
+  while(true){
+    uint64_t published = last_published;
+    uint64_t next = published + 1;
+    if(commit_table[next & (COMMIT_TABLE_SIZE - 1)] != next)
+      break;
+    __sync_bool_compare_and_swap(&last_published, published, next);
+  }
+
+  while(last_published < timestamp)
+    sched_yield();
+}
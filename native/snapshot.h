@@ -0,0 +1,91 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#ifndef _NATIVEIMPL_SNAPSHOT_H_
+#define _NATIVEIMPL_SNAPSHOT_H_
+
+#include <stdint.h>
+
+// The isolation levels supported by the native implementation
+enum IsolationLevel{
+  // Transactions see all changes committed before each single read (default)
+  kReadCommitted,
+  // Transactions see all changes committed before they started
+  kSnapshotIsolation,
+  // Like kSnapshotIsolation, but records are only locked when committing:
+  // the commit fails if a record read or deleted by the transaction has been
+  // deleted by another transaction in the meantime
+  kOptimistic
+};
+
+// The timestamp of entries that have not been inserted or deleted by a
+// committed transaction yet
+#define TIMESTAMP_INFINITY UINT64_MAX
+
+// The snapshot read at read committed (it contains every committed change)
+#define TIMESTAMP_LATEST (UINT64_MAX - 1)
+
+// Return the isolation level used by all transactions
+//
+// It is read once from the environment variable CONTEST_ISOLATION, which may be
+// set to "read-committed", "snapshot" or "optimistic".
+IsolationLevel GetIsolationLevel();
+
+// A slot announcing a snapshot that is in use (see AcquireSnapshot())
+typedef volatile uint64_t SnapshotSlot;
+
+// Take a snapshot of all committed changes and return its timestamp
+//
+// The snapshot is announced in a slot of the calling thread (stored in slot,
+// which is set to NULL if all slots of the thread are in use) until it is
+// released again, so that the entries visible inside it are not garbage
+// collected. The snapshot may be released by any thread.
+uint64_t AcquireSnapshot(SnapshotSlot** slot);
+
+// Release a snapshot that has been taken using AcquireSnapshot()
+void ReleaseSnapshot(uint64_t snapshot, SnapshotSlot* slot);
+
+// Return the timestamp of the oldest snapshot that may still be taken or used
+//
+// Entries deleted at or before this timestamp are not visible in any snapshot.
+uint64_t OldestSnapshot();
+
+// Start committing a transaction and return its commit timestamp
+//
+// The changes of the transaction have to be stamped with the returned
+// timestamp and published using EndCommit() (which must not be omitted).
+uint64_t BeginCommit();
+
+// Make the changes stamped with the given commit timestamp visible to new
+// snapshots
+//
+// Commits may end in any order. New snapshots contain a commit only once all
+// commits with a smaller timestamp have ended as well, but EndCommit() does
+// not wait for them.
+void EndCommit(uint64_t timestamp);
+
+#endif // _NATIVEIMPL_SNAPSHOT_H_
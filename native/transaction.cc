@@ -0,0 +1,341 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#include <algorithm>
+
+#include "pool.h"
+#include "transaction.h"
+
+// The log of a transaction that is started again is shrunk, if it has grown
+// beyond this many records
+#define LOG_RETAIN_CAPACITY 4096
+
+// Constructor
+Transaction::Transaction(){
+  snapshot_ = TIMESTAMP_LATEST;
+  snapshot_slot_ = NULL;
+  finished_ = true;
+  Begin();
+}
+
+// Destructor
+Transaction::~Transaction(){
+  if(!finished_){
+    Abort();
+  }
+}
+
+// Start the transaction (again)
+//
+// The log keeps its capacity unless a previous use has grown it beyond
+// LOG_RETAIN_CAPACITY records.
+void Transaction::Begin(){
+  if(log_.capacity() > LOG_RETAIN_CAPACITY)
+    std::vector<LogRecord>().swap(log_);
+  if(reads_.capacity() > LOG_RETAIN_CAPACITY)
+    std::vector<Entry*>().swap(reads_);
+  if(deferred_.capacity() > LOG_RETAIN_CAPACITY)
+    std::vector<const Entry*>().swap(deferred_);
+
+  optimistic_ = (GetIsolationLevel() == kOptimistic);
+  if(GetIsolationLevel() != kReadCommitted)
+    snapshot_ = AcquireSnapshot(&snapshot_slot_);
+  else
+    snapshot_ = TIMESTAMP_LATEST;
+  stripe_ = CurrentStripe();
+  finished_ = false;
+}
+
+// Abort the transaction
+//
+// All changes are undone in reverse order.
+void Transaction::Abort(){
+  for(size_t i = log_.size(); i > 0; i--)
+    Undo(log_[i-1], false);
+  log_.clear();
+  CloseTransaction();
+}
+
+// Commit the transaction
+//
+// Inserted entries are unlocked (or removed, if they have been deleted again
+// by this transaction). At read committed, deleted entries are removed from
+// their trees. Otherwise, they are only stamped with the commit timestamp and
+// removed once no snapshot can see them anymore.
+//
+// In optimistic mode, the changes are validated first. If this fails, the
+// transaction is aborted and false is returned.
+bool Transaction::Commit(){
+  if(optimistic_ && !Validate()){
+    Abort();
+    return false;
+  }
+
+  bool snapshot_isolation = (GetIsolationLevel() != kReadCommitted);
+  uint64_t timestamp = 0;
+  if(snapshot_isolation && !log_.empty())
+    timestamp = BeginCommit();
+
+  // Handle the inserted entries first, so that a concurrent update of an
+  // updated record always finds either the old or the new entry (once
+  // unlocked, the inserted entries must not be accessed anymore)
+  for(size_t i = 0; i < log_.size(); i++){
+    LogRecord &record = log_[i];
+    Entry *entry = record.entry;
+    if(record.type != kInsert)
+      continue;
+    if(entry->lock & kPendingDelete){
+      record.structure->Remove(entry);
+      FreeEntry(entry);
+    } else {
+      entry->begin = timestamp;
+      entry->lock = 0;
+    }
+  }
+
+  for(size_t i = 0; i < log_.size(); i++){
+    LogRecord &record = log_[i];
+    Entry *entry = record.entry;
+    switch(record.type){
+      case kInsert:
+        // The entry has been handled above
+        break;
+      case kDelete:
+      case kDeferredDelete:
+        if(snapshot_isolation){
+          entry->end = timestamp;
+          entry->lock = 0;
+        } else {
+          record.structure->Remove(entry);
+          FreeEntry(entry);
+        }
+        break;
+      case kDeleteOwn:
+        // The entry is handled by its insert record
+        break;
+    }
+  }
+
+  if(snapshot_isolation && !log_.empty()){
+    EndCommit(timestamp);
+
+    // Hand the deleted entries over to the garbage collection
+    for(size_t i = 0; i < log_.size(); i++){
+      if((log_[i].type == kDelete) || (log_[i].type == kDeferredDelete))
+        log_[i].structure->RetireEntry(log_[i].entry);
+    }
+    for(size_t i = 0; i < indices_.size(); i++)
+      indices_[i]->CollectGarbage();
+  }
+
+  log_.clear();
+  CloseTransaction();
+  return true;
+}
+
+// Lock the entries of all deferred deletes and validate the read entries
+//
+// The deleted entries are locked like any other deleted entry. Locking fails
+// if another transaction holds the lock or if the entry has been deleted by a
+// transaction that committed after the snapshot was taken. Afterwards, none of
+// the read entries may have been deleted or be locked for deletion by another
+// transaction. As the locks are held until the changes are installed, two
+// transactions can not both succeed if each one deletes a record the other
+// one has read.
+bool Transaction::Validate(){
+  size_t locked = 0;
+  for(size_t i = 0; i < log_.size(); i++){
+    if(log_[i].type != kDeferredDelete)
+      continue;
+
+    Entry* entry = log_[i].entry;
+    if(!__sync_bool_compare_and_swap(&entry->lock, 0,
+                                     LockWord(kPendingDelete))){
+      UnlockDeferred(locked);
+      return false;
+    }
+    locked++;
+    if(entry->end != TIMESTAMP_INFINITY){
+      UnlockDeferred(locked);
+      return false;
+    }
+  }
+
+  for(size_t i = 0; i < reads_.size(); i++){
+    Entry* entry = reads_[i];
+    uintptr_t lock = entry->lock;
+    bool own = ((lock & ~ENTRY_STATE_MASK) == (uintptr_t) this);
+    if((entry->end != TIMESTAMP_INFINITY)
+       || ((lock & kPendingDelete) && !own)){
+      UnlockDeferred(locked);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Release the locks of the first count deferred deletes
+void Transaction::UnlockDeferred(size_t count){
+  for(size_t i = 0; (i < log_.size()) && (count > 0); i++){
+    if(log_[i].type == kDeferredDelete){
+      log_[i].entry->lock = 0;
+      count--;
+    }
+  }
+}
+
+// Use a given index schema with this transaction
+//
+// Transactions use only a few indices, so they are kept in a vector.
+bool Transaction::UseIndex(IndexSchema *structure){
+  if(std::find(indices_.begin(), indices_.end(), structure) != indices_.end())
+    return true;
+
+  if(indices_.size() == indices_.capacity())
+    CountAllocation();
+  indices_.push_back(structure);
+  if(!structure->BeginTransaction(this)){
+    indices_.pop_back();
+    return false;
+  }
+  return true;
+}
+
+// Undo all changes made after the given savepoint
+void Transaction::Rollback(size_t savepoint){
+  for(size_t i = log_.size(); i > savepoint; i--)
+    Undo(log_[i-1], true);
+  log_.resize(savepoint);
+}
+
+// Log an entry that has been inserted by this transaction
+void Transaction::LogInsert(IndexSchema *structure, Entry *entry){
+  Log(kInsert, structure, entry);
+}
+
+// Log an entry that has been deleted by this transaction
+void Transaction::LogDelete(IndexSchema *structure, Entry *entry){
+  Log(kDelete, structure, entry);
+}
+
+// Log an entry that has been inserted and deleted by this transaction
+void Transaction::LogDeleteOwn(IndexSchema *structure, Entry *entry){
+  Log(kDeleteOwn, structure, entry);
+}
+
+// Log an entry that will be deleted when committing (optimistic mode)
+//
+// The entry is neither locked nor marked, it is only hidden from this
+// transaction until the commit.
+void Transaction::LogDeferredDelete(IndexSchema *structure, Entry *entry){
+  std::vector<const Entry*>::iterator position =
+    std::lower_bound(deferred_.begin(), deferred_.end(), entry);
+  if(deferred_.size() == deferred_.capacity())
+    CountAllocation();
+  position = deferred_.insert(position, entry);
+  try{
+    Log(kDeferredDelete, structure, entry);
+  } catch(...){
+    deferred_.erase(position);
+    throw;
+  }
+}
+
+// Forget an entry that will be deleted when committing (optimistic mode)
+void Transaction::ForgetDeferredDelete(const Entry *entry){
+  std::vector<const Entry*>::iterator position =
+    std::lower_bound(deferred_.begin(), deferred_.end(), entry);
+  if((position != deferred_.end()) && (*position == entry))
+    deferred_.erase(position);
+}
+
+// Remember an entry that has been read by this transaction (optimistic mode)
+//
+// Uncommitted entries of the transaction itself do not need to be validated.
+void Transaction::LogRead(Entry *entry){
+  uintptr_t lock = entry->lock;
+  if((lock & ENTRY_STATE_MASK)
+     && ((lock & ~ENTRY_STATE_MASK) == (uintptr_t) this))
+    return;
+  if(reads_.size() == reads_.capacity())
+    CountAllocation();
+  reads_.push_back(entry);
+}
+
+// Append a record to the log
+void Transaction::Log(LogType type, IndexSchema *structure, Entry *entry){
+  LogRecord record;
+  record.type = type;
+  record.structure = structure;
+  record.entry = entry;
+  if(log_.size() == log_.capacity())
+    CountAllocation();
+  log_.push_back(record);
+}
+
+// Undo the given log record
+//
+// When rolling back to a savepoint, entries that have been inserted before
+// the savepoint still exist, so deleting them has to be undone as well.
+void Transaction::Undo(const LogRecord &record, bool savepoint){
+  Entry *entry = record.entry;
+  switch(record.type){
+    case kInsert:
+      record.structure->Remove(entry);
+      FreeEntry(entry);
+      break;
+    case kDelete:
+      entry->lock = 0;
+      break;
+    case kDeleteOwn:
+      if(savepoint)
+        entry->lock = entry->lock & ~((uintptr_t) kPendingDelete);
+      break;
+    case kDeferredDelete:
+      ForgetDeferredDelete(entry);
+      break;
+  }
+}
+
+// Close the transaction
+//
+// This unregisters this transaction on all used index schemas
+void Transaction::CloseTransaction(){
+  for(size_t i = 0; i < indices_.size(); i++){
+    indices_[i]->EndTransaction(this);
+  }
+  indices_.clear();
+  reads_.clear();
+  deferred_.clear();
+  finished_ = true;
+
+  if(snapshot_ != TIMESTAMP_LATEST){
+    ReleaseSnapshot(snapshot_, snapshot_slot_);
+    snapshot_ = TIMESTAMP_LATEST;
+  }
+}
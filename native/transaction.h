@@ -0,0 +1,189 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#ifndef _NATIVEIMPL_TRANSACTION_H_
+#define _NATIVEIMPL_TRANSACTION_H_
+
+#include <algorithm>
+#include <vector>
+#include <common/macros.h>
+
+#include "entry.h"
+#include "index.h"
+
+// Represents a transaction
+//
+// Modifications are applied to the trees directly, but the affected entries
+// are locked by the transaction (see entry.h). The transaction keeps a log of
+// these entries, which is used to either make the changes visible (commit) or
+// to undo them (abort).
+//
+// At snapshot isolation, the transaction reads the snapshot taken when it
+// started and stamps its changes with a commit timestamp. Deleted entries stay
+// inside the trees until no snapshot can see them anymore.
+//
+// In optimistic mode, deleted entries are not locked right away. Instead, the
+// transaction keeps them and all entries it has read, and validates them when
+// committing (see Commit()).
+//
+// Once it has been resolved, a transaction can be started again using
+// Begin(), which keeps the memory allocated for its log (see pool.h).
+class Transaction {
+ public:
+  // Constructor (starts the transaction)
+  Transaction();
+
+  // Destructor
+  ~Transaction();
+
+  // Start the transaction (again)
+  void Begin();
+
+  // Abort this transaction
+  void Abort();
+
+  // Commit this transaction
+  //
+  // Returns false if the transaction had to be aborted instead.
+  bool Commit();
+
+  // Use a given index schema with this transaction
+  bool UseIndex(IndexSchema *structure);
+
+  // Return the current position inside the log
+  size_t Savepoint() const { return log_.size(); };
+
+  // Undo all changes made after the given savepoint
+  void Rollback(size_t savepoint);
+
+  // Log an entry that has been inserted by this transaction
+  void LogInsert(IndexSchema *structure, Entry *entry);
+
+  // Log an entry that has been deleted by this transaction
+  void LogDelete(IndexSchema *structure, Entry *entry);
+
+  // Log an entry that has been inserted and deleted by this transaction
+  void LogDeleteOwn(IndexSchema *structure, Entry *entry);
+
+  // Log an entry that will be deleted when committing (optimistic mode)
+  void LogDeferredDelete(IndexSchema *structure, Entry *entry);
+
+  // Remember an entry that has been read by this transaction (optimistic mode)
+  void LogRead(Entry *entry);
+
+  // Checks whether the given entry will be deleted when committing
+  bool Deletes(const Entry *entry) const {
+    return !deferred_.empty()
+        && std::binary_search(deferred_.begin(), deferred_.end(), entry);
+  };
+
+  // Return the value of the lock word for entries locked by this transaction
+  uintptr_t LockWord(EntryState state) const {
+    return reinterpret_cast<uintptr_t>(this) | state;
+  };
+
+  // Return the snapshot read by this transaction
+  uint64_t snapshot() const { return snapshot_; };
+
+  // Return whether the transaction runs in optimistic mode
+  bool optimistic() const { return optimistic_; };
+
+  // Return whether the transaction has been committed or aborted
+  bool finished() const { return finished_; };
+
+  // Return the stripe the transaction is counted on by the modified indices
+  uint32_t stripe() const { return stripe_; };
+
+ private:
+  // The types of log records
+  enum LogType{
+    kInsert,
+    kDelete,
+    kDeleteOwn,
+    kDeferredDelete
+  };
+
+  // A single log record
+  struct LogRecord{
+    LogType type;
+    IndexSchema *structure;
+    Entry *entry;
+  };
+
+  // Append a record to the log
+  void Log(LogType type, IndexSchema *structure, Entry *entry);
+
+  // Undo the given log record
+  void Undo(const LogRecord &record, bool savepoint);
+
+  // Forget an entry that will be deleted when committing (optimistic mode)
+  void ForgetDeferredDelete(const Entry *entry);
+
+  // Lock the entries of all deferred deletes and validate the read entries
+  //
+  // Returns false (and releases all locks again) if a conflict was detected.
+  bool Validate();
+
+  // Release the locks of the first count deferred deletes
+  void UnlockDeferred(size_t count);
+
+  // Close the transaction
+  void CloseTransaction();
+
+  // The indices that have been modified using this transaction
+  std::vector<IndexSchema*> indices_;
+
+  // The log of all modified entries
+  std::vector<LogRecord> log_;
+
+  // The snapshot read by this transaction
+  uint64_t snapshot_;
+
+  // The slot announcing the snapshot (see AcquireSnapshot())
+  SnapshotSlot* snapshot_slot_;
+
+  // Whether the transaction runs in optimistic mode
+  bool optimistic_;
+
+  // The stripe of the core the transaction has been started on (see
+  // IndexSchema::BeginTransaction())
+  uint32_t stripe_;
+
+  // The entries read by this transaction (optimistic mode)
+  std::vector<Entry*> reads_;
+
+  // The entries that will be deleted when committing (optimistic mode, sorted
+  // by address, so the capacity is kept when the transaction is reused)
+  std::vector<const Entry*> deferred_;
+
+  // Whether the transaction has been resolved
+  bool finished_;
+
+  DISALLOW_COPY_AND_ASSIGN(Transaction);
+};
+
+#endif // _NATIVEIMPL_TRANSACTION_H_
@@ -0,0 +1,102 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#include "index.h"
+#include "util.h"
+
+// Checks whether every attribute of the given key lies between the respective
+// attributes of the minimum and the maximum key
+//
+// All keys are encoded, so every attribute can be compared using memcmp.
+bool InRange(const IndexSchema *is, const char *key, const char *min,
+             const char *max){
+  for(int i = 0; i < is->attribute_count(); i++){
+    AttributeType type = is->type()[i];
+    size_t key_size = EncodedAttributeSize(type, key);
+    size_t min_size = EncodedAttributeSize(type, min);
+    size_t max_size = EncodedAttributeSize(type, max);
+
+    if((CompareEncoded(min, min_size, key, key_size) > 0)
+       || (CompareEncoded(key, key_size, max, max_size) > 0))
+      return false;
+
+    key += key_size;
+    min += min_size;
+    max += max_size;
+  }
+  return true;
+}
+
+// Compares two encoded keys of an arbitrary schema
+static int CompareKeys(const char *a, size_t a_size, const char *b, size_t b_size){
+  return KeyCmp(a, a_size, b, b_size);
+}
+
+// Compares two encoded keys consisting of a single VARCHAR attribute
+int CompareVarcharKeys(const char *a, size_t a_size, const char *b, size_t b_size){
+  size_t size = (a_size < b_size) ? a_size : b_size;
+  size_t offset = 0;
+  for(; offset + 8 <= size; offset += 8){
+    uint64_t x, y;
+    memcpy(&x, a + offset, sizeof(x));
+    memcpy(&y, b + offset, sizeof(y));
+    if(x != y)
+      return (CodecSwap64(x) < CodecSwap64(y)) ? -1 : 1;
+  }
+  for(; offset < size; offset++){
+    if(a[offset] != b[offset])
+      return ((uint8_t) a[offset] < (uint8_t) b[offset]) ? -1 : 1;
+  }
+  return (a_size < b_size) ? -1 : ((a_size > b_size) ? 1 : 0);
+}
+
+// Return the comparator specialized for keys of the given attribute types
+//
+// Specialized comparators exist for 1 to 4 INT attributes, for a SHORT
+// followed by an INT and for a single VARCHAR.
+KeyComparator SelectComparator(const AttributeType *types, uint8_t count){
+  if((count == 1) && (types[0] == kVarchar))
+    return CompareVarcharKeys;
+  if((count == 2) && (types[0] == kShort) && (types[1] == kInt))
+    return CompareFixedKeys<12>;
+
+  for(int i = 0; i < count; i++){
+    if(types[i] != kInt)
+      return CompareKeys;
+  }
+  switch(count){
+    case 1:
+      return CompareFixedKeys<8>;
+    case 2:
+      return CompareFixedKeys<16>;
+    case 3:
+      return CompareFixedKeys<24>;
+    case 4:
+      return CompareFixedKeys<32>;
+  }
+  return CompareKeys;
+}
@@ -0,0 +1,92 @@
+/*
+ Copyright (c) 2012 TU Dresden - Database Technology Group
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Author: Lukas M. Maas <Lukas_Michael.Maas@mailbox.tu-dresden.de>
+
+ Current version: 1.0 (released May 19, 2012)
+
+ Version history:
+ - 1.0 Initial release (May 19, 2012)
+ */
+
+#ifndef _NATIVEIMPL_UTIL_H_
+#define _NATIVEIMPL_UTIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <contest_interface.h>
+#include <common/key_codec.h>
+
+class IndexSchema;
+
+// A function comparing two encoded keys of an index
+typedef int (*KeyComparator)(const char *a, size_t a_size,
+                             const char *b, size_t b_size);
+
+// Compares two encoded keys (see common/key_codec.h)
+static inline int KeyCmp(const char *a, size_t a_size, const char *b, size_t b_size){
+  return CompareEncoded(a, a_size, b, b_size);
+}
+
+// Compares two encoded keys of kSize bytes (a multiple of 4) each
+//
+// The keys are compared as a sequence of big-endian words. As kSize is known
+// at compile time, the loop is unrolled completely. Keys of other sizes (e.g.
+// the targets of a skip-scan) are compared by KeyCmp().
+template<size_t kSize>
+int CompareFixedKeys(const char *a, size_t a_size, const char *b, size_t b_size){
+  if((a_size != kSize) || (b_size != kSize))
+    return KeyCmp(a, a_size, b, b_size);
+
+  for(size_t offset = 0; offset + 8 <= kSize; offset += 8){
+    uint64_t x, y;
+    memcpy(&x, a + offset, sizeof(x));
+    memcpy(&y, b + offset, sizeof(y));
+    if(x != y)
+      return (CodecSwap64(x) < CodecSwap64(y)) ? -1 : 1;
+  }
+  if(kSize % 8 != 0){
+    uint32_t x, y;
+    memcpy(&x, a + kSize - 4, sizeof(x));
+    memcpy(&y, b + kSize - 4, sizeof(y));
+    if(x != y)
+      return (CodecSwap32(x) < CodecSwap32(y)) ? -1 : 1;
+  }
+  return 0;
+}
+
+// Compares two encoded keys consisting of a single VARCHAR attribute
+//
+// The strings are compared eight bytes at a time without calling memcmp,
+// which pays off for the short strings usually stored in an index.
+int CompareVarcharKeys(const char *a, size_t a_size, const char *b, size_t b_size);
+
+// Return the comparator specialized for keys of the given attribute types
+//
+// Schemas without a specialized comparator use KeyCmp().
+KeyComparator SelectComparator(const AttributeType *types, uint8_t count);
+
+// Checks whether every attribute of the given key lies between the respective
+// attributes of the minimum and the maximum key
+bool InRange(const IndexSchema *is, const char *key, const char *min,
+             const char *max);
+
+#endif // _NATIVEIMPL_UTIL_H_
@@ -41,10 +41,27 @@
 #include <contest_interface.h>
 #include <common/macros.h>
 #include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "test_util.h"
 #include "util.h"
 
+// Optional extensions of the contest interface are referenced weakly, so the
+// tests can be linked against implementations that do not provide them (in
+// this case their addresses are NULL and the tests using them are skipped)
+extern "C" ErrorCode GetNextBuffered(Iterator *it, Record** record)
+  __attribute__((weak));
+extern "C" ErrorCode GetNextBatch(Iterator *it, Record* records, uint32_t max,
+                                  uint32_t* count) __attribute__((weak));
+extern "C" ErrorCode BulkLoad(Index *idx, Record *records, uint32_t count)
+  __attribute__((weak));
+extern "C" ErrorCode GetIndexMemoryPlacement(const char* name,
+                                             uint32_t node_count,
+                                             uint64_t *pages)
+  __attribute__((weak));
+
 // The names of all indices used by the test cases
 #define BASIC_TEST_INDEX "BasicIndex"
 #define PARTIAL_MATCH_TEST_INDEX "PartialMatchIndex"
@@ -53,6 +70,25 @@
 #define AUTO_COMMIT_TEST_INDEX "AutoCommitIndex"
 #define BULK_TEST_INDEX "BulkIndex"
 #define ERROR_HANDLING_TEST_INDEX "ErrorHandlingIndex"
+#define CODEC_TEST_INDEX "CodecIndex"
+#define BUFFERED_TEST_INDEX "BufferedIndex"
+#define BATCH_TEST_INDEX "BatchIndex"
+#define BULK_LOAD_TEST_INDEX "BulkLoadIndex"
+#define SNAPSHOT_TEST_INDEX "SnapshotIndex"
+#define OPTIMISTIC_TEST_INDEX "OptimisticIndex"
+#define LOOKUP_TEST_INDEX "LookupIndex"
+#define CATALOG_TEST_INDEX "CatalogIndex"
+#define ITERATOR_TEST_INDEX "IteratorIndex"
+#define PARTITION_TEST_INDEX "PartitionIndex"
+#define COMPARATOR_TEST_INDEX "ComparatorIndex"
+#define OVERWRITE_TEST_INDEX "OverwriteIndex"
+#define PAYLOAD_TEST_INDEX "PayloadIndex"
+#define SPLIT_TEST_INDEX "SplitIndex"
+#define RADIX_TEST_INDEX "RadixIndex"
+#define PLACEMENT_TEST_INDEX "PlacementIndex"
+#define QUIESCE_TEST_INDEX "QuiesceIndex"
+#define ZORDER_TEST_INDEX "ZOrderIndex"
+#define DICTIONARY_TEST_INDEX "DictionaryIndex"
 
 // The name of an index that will not be created during the test
 // (this index is used by the ErrorHandlingTest to ensure that non-existent
@@ -1561,3 +1597,2041 @@ TEST(ErrorHandlingTest){
   // Cleanup
   Release(a);
 }
+
+
+// Check that a range query of the given transaction returns exactly the
+// given records (in the given order)
+static void CheckScan(Transaction *tx, Index *idx, Key min_key, Key max_key,
+                      Record **expected, int count){
+  Iterator *it;
+  Record *tmp;
+  ErrorCode err;
+  ASSERT_EQUALS(err = GetRecords(tx, idx, min_key, max_key, &it), kOk,
+                "Could not open iterator");
+  if(err != kOk)
+    return;
+
+  for(int i = 0; i < count; i++){
+    ASSERT_EQUALS(err = GetNext(it, &tmp), kOk,
+                  "Could not retrieve an expected record");
+    if(err != kOk)
+      break;
+    ASSERT_EQUALS(RecordCmp(*expected[i], *tmp), 0,
+                  "The retrieved record does not match the expected one");
+    Release(tmp);
+  }
+
+  if(err == kOk){
+    ASSERT_EQUALS(err = GetNext(it, &tmp), kErrorNotFound,
+                  "Iterator did not report an end of range");
+    if(err == kOk)
+      Release(tmp);
+  }
+  ASSERT_EQUALS(kOk, CloseIterator(&it), "Could not close iterator");
+}
+
+// Shuffle the given array of records (using a fixed seed)
+static void ShuffleRecords(Record **records, int count){
+  unsigned int seed = 42;
+  for(int i = count - 1; i > 0; i--){
+    int j = rand_r(&seed) % (i + 1);
+    Record *tmp = records[i];
+    records[i] = records[j];
+    records[j] = tmp;
+  }
+}
+
+// Test to ensure that keys are ordered by the values of their attributes
+//
+// The records combine negative and positive values of both integer types
+// with strings that are prefixes of each other. They are inserted in random
+// order and must be returned in the order of their attributes, both by a
+// query of the whole index and by queries whose bounds contain wildcards.
+TEST(CodecTest){
+  int32_t shorts[] = {INT32_MIN, -256, -1, 0, 1, 256, INT32_MAX};
+  int64_t ints[] = {INT64_MIN, -65536, -1, 0, 1, 65536, INT64_MAX};
+  const char* varchars[] = {"", "a", "aa", "a~", "b"};
+  const int count = COUNT_OF(shorts)*COUNT_OF(ints)*COUNT_OF(varchars);
+
+  // Create the test records (ordered by key) and a shuffled copy
+  Record **records = (Record**) malloc(count*sizeof(Record*));
+  Record **shuffled = (Record**) malloc(count*sizeof(Record*));
+  int n = 0;
+  for(int i = 0; i < (int) COUNT_OF(shorts); i++){
+    for(int j = 0; j < (int) COUNT_OF(ints); j++){
+      for(int k = 0; k < (int) COUNT_OF(varchars); k++){
+        char payload[32];
+        sprintf(payload, "record %d", n);
+        Attribute *attributes[] = {ShortAttribute(shorts[i]),
+                                   IntAttribute(ints[j]),
+                                   VarcharAttribute(varchars[k])};
+        records[n] = CreateRecord(COUNT_OF(attributes), attributes, payload);
+        shuffled[n] = records[n];
+        n++;
+      }
+    }
+  }
+  ShuffleRecords(shuffled, count);
+
+  // Create an index with keys comprising all attribute types
+  KeyType schema = {kShort, kInt, kVarchar};
+  ErrorCode err = CreateIndex(CODEC_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(CODEC_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert the test records in random order
+      for(int i = 0; i < count; i++){
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, shuffled[i]), kOk,
+                      "Could not insert a record");
+        if(err != kOk)
+          break;
+      }
+
+      if(err == kOk){
+        // Query all records
+        CheckScan(NULL, idx, records[0]->key, records[count-1]->key,
+                  records, count);
+
+        // Query the records with a negative short and any other attributes
+        // (and those with a negative int and any string)
+        Attribute *wildcard[3] = {ShortAttribute(-1), NULL, NULL};
+        Key key = {wildcard, 3};
+        int first = 2*COUNT_OF(ints)*COUNT_OF(varchars);
+        CheckScan(NULL, idx, key, key, records + first,
+                  COUNT_OF(ints)*COUNT_OF(varchars));
+        wildcard[1] = IntAttribute(-1);
+        first += 2*COUNT_OF(varchars);
+        CheckScan(NULL, idx, key, key, records + first, COUNT_OF(varchars));
+
+        // Query a range whose bounds are prefixes of other strings
+        Attribute *min_attributes[] = {ShortAttribute(-1), IntAttribute(-1),
+                                       VarcharAttribute("a")};
+        Attribute *max_attributes[] = {ShortAttribute(-1), IntAttribute(-1),
+                                       VarcharAttribute("a~")};
+        Key min_key = {min_attributes, 3};
+        Key max_key = {max_attributes, 3};
+        CheckScan(NULL, idx, min_key, max_key, records + first + 1, 3);
+
+        for(int i = 0; i < 3; i++){
+          free(wildcard[i]);
+          free(min_attributes[i]);
+          free(max_attributes[i]);
+        }
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(CODEC_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < count; i++)
+    Release(records[i]);
+  free(records);
+  free(shuffled);
+}
+
+
+// Test to ensure that GetNextBuffered() (if provided) works properly
+//
+// It retrieves records using GetNextBuffered() and makes sure that they are
+// returned in key order, that the end of the range is reported by
+// kErrorNotFound and that a returned record stays valid while another
+// iterator is used.
+TEST(BufferedTest){
+  if(GetNextBuffered == NULL)
+    return;
+
+  // Create some test records
+  Record *a = CreateRecordIsolation(1,"record a");
+  Record *b = CreateRecordIsolation(2,"record b");
+  Record *c = CreateRecordIsolation(3,"record c");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(BUFFERED_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(BUFFERED_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+
+    if(err == kOk){
+      Iterator *it;
+      Iterator *other;
+      Record *tmp;
+      Record *other_tmp;
+
+      // Insert the test records (outside of any transaction)
+      ASSERT_EQUALS(InsertRecord(NULL,idx,c), kOk, "Could not insert record c");
+      ASSERT_EQUALS(InsertRecord(NULL,idx,a), kOk, "Could not insert record a");
+      ASSERT_EQUALS(InsertRecord(NULL,idx,b), kOk, "Could not insert record b");
+
+      ASSERT_EQUALS(err = GetRecords(NULL, idx, a->key, c->key, &it), kOk,
+                    "Could not open iterator");
+      if(err == kOk){
+        ASSERT_EQUALS(err = GetNextBuffered(it, &tmp), kOk,
+                      "Could not retrieve record a");
+        if(err == kOk){
+          ASSERT_EQUALS(RecordCmp(*a,*tmp), 0,
+                        "The first record does not match record a");
+
+          // Use another iterator, which must not touch the buffers of the
+          // first one
+          ASSERT_EQUALS(err = GetRecords(NULL, idx, c->key, c->key, &other),
+                        kOk, "Could not open a second iterator");
+          if(err == kOk){
+            ASSERT_EQUALS(err = GetNextBuffered(other, &other_tmp), kOk,
+                          "Could not retrieve record c using the second "
+                          "iterator");
+            if(err == kOk){
+              ASSERT_EQUALS(RecordCmp(*c,*other_tmp), 0,
+                            "The record of the second iterator does not match "
+                            "record c");
+            }
+            ASSERT_EQUALS(kOk, CloseIterator(&other),
+                          "Could not close the second iterator");
+          }
+          ASSERT_EQUALS(RecordCmp(*a,*tmp), 0,
+                        "The buffered record a has been changed by another "
+                        "iterator");
+
+          ASSERT_EQUALS(err = GetNextBuffered(it, &tmp), kOk,
+                        "Could not retrieve record b");
+          if(err == kOk){
+            ASSERT_EQUALS(RecordCmp(*b,*tmp), 0,
+                          "The second record does not match record b");
+            ASSERT_EQUALS(err = GetNextBuffered(it, &tmp), kOk,
+                          "Could not retrieve record c");
+          }
+          if(err == kOk){
+            ASSERT_EQUALS(RecordCmp(*c,*tmp), 0,
+                          "The third record does not match record c");
+            ASSERT_EQUALS(GetNextBuffered(it, &tmp), kErrorNotFound,
+                          "Iterator did not report an end of range");
+            ASSERT_EQUALS(GetNextBuffered(it, &tmp), kErrorNotFound,
+                          "Iterator did not report an end of range again");
+          }
+        }
+        ASSERT_EQUALS(kOk, CloseIterator(&it), "Could not close iterator");
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(BUFFERED_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  Release(a);
+  Release(b);
+  Release(c);
+}
+
+
+// The number of records used by the BatchTest and the size of its batches
+#define BATCH_TEST_RECORDS 10
+#define BATCH_TEST_SIZE 4
+
+// Test to ensure that GetNextBatch() (if provided) works properly
+//
+// It retrieves ten records in batches of at most four records and makes sure
+// that all records are returned exactly once in key order, that the records
+// of a batch stay valid while another iterator is used and that the end of
+// the range is reported by kErrorNotFound (with a count of 0).
+TEST(BatchTest){
+  if(GetNextBatch == NULL)
+    return;
+
+  // Create the test records (with keys 0 to BATCH_TEST_RECORDS-1)
+  Record *records[BATCH_TEST_RECORDS];
+  for(int i = 0; i < BATCH_TEST_RECORDS; i++){
+    char payload[32];
+    sprintf(payload, "record %d", i);
+    records[i] = CreateRecordIsolation(i, payload);
+  }
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(BATCH_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(BATCH_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+
+    if(err == kOk){
+      // Insert the test records in reverse order
+      for(int i = BATCH_TEST_RECORDS-1; i >= 0; i--)
+        ASSERT_EQUALS(InsertRecord(NULL,idx,records[i]), kOk,
+                      "Could not insert a test record");
+
+      Iterator *it;
+      ASSERT_EQUALS(err = GetRecords(NULL, idx, records[0]->key,
+                                     records[BATCH_TEST_RECORDS-1]->key, &it),
+                    kOk, "Could not open iterator");
+      if(err == kOk){
+        Record batch[BATCH_TEST_SIZE];
+        uint32_t count;
+        int retrieved = 0;
+        while((err = GetNextBatch(it, batch, BATCH_TEST_SIZE, &count)) == kOk){
+          ASSERT_GT(count, 0u, "GetNextBatch() returned kOk without records");
+          ASSERT_LEQ(count, (uint32_t) BATCH_TEST_SIZE,
+                     "GetNextBatch() returned more records than requested");
+          if((count == 0) || (count > BATCH_TEST_SIZE)
+             || (retrieved + count > BATCH_TEST_RECORDS))
+            break;
+
+          // Use another iterator, which must not touch the records of the
+          // batch
+          Iterator *other;
+          Record *tmp;
+          ASSERT_EQUALS(err = GetRecords(NULL, idx, records[0]->key,
+                                         records[0]->key, &other),
+                        kOk, "Could not open a second iterator");
+          if(err == kOk){
+            ASSERT_EQUALS(err = GetNext(other, &tmp), kOk,
+                          "Could not retrieve a record using the second "
+                          "iterator");
+            if(err == kOk)
+              Release(tmp);
+            ASSERT_EQUALS(kOk, CloseIterator(&other),
+                          "Could not close the second iterator");
+          }
+
+          for(uint32_t i = 0; i < count; i++){
+            ASSERT_EQUALS(RecordCmp(*records[retrieved], batch[i]), 0,
+                          "A record of the batch does not match the expected "
+                          "record");
+            retrieved++;
+          }
+        }
+
+        ASSERT_EQUALS(err, kErrorNotFound,
+                      "Iterator did not report an end of range");
+        ASSERT_EQUALS(count, 0u,
+                      "GetNextBatch() did not set the count to 0 at the end "
+                      "of the range");
+        ASSERT_EQUALS(retrieved, BATCH_TEST_RECORDS,
+                      "GetNextBatch() did not return all records");
+        ASSERT_EQUALS(GetNextBatch(it, batch, BATCH_TEST_SIZE, &count),
+                      kErrorNotFound,
+                      "Iterator did not report an end of range again");
+
+        ASSERT_EQUALS(kOk, CloseIterator(&it), "Could not close iterator");
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(BATCH_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < BATCH_TEST_RECORDS; i++)
+    Release(records[i]);
+}
+
+
+// The number of records loaded by the BulkLoadTest at once, the number of
+// distinct keys among them and the size of the second, smaller batch
+#define BULK_LOAD_TEST_RECORDS 5000
+#define BULK_LOAD_TEST_KEYS 50
+#define BULK_LOAD_TEST_SMALL_BATCH 10
+
+// Check that the BulkLoadTest index holds the first count records of the
+// given array, ordered by key and (for equal keys) by their position
+static void CheckBulkLoad(Index *idx, Record **records, int count){
+  Key min_key = records[0]->key;
+  Key max_key = records[BULK_LOAD_TEST_KEYS-1]->key;
+  Iterator *it;
+  Record *tmp;
+  ErrorCode err;
+  ASSERT_EQUALS(err = GetRecords(NULL, idx, min_key, max_key, &it), kOk,
+                "Could not open iterator");
+  if(err != kOk)
+    return;
+
+  // The records with key k have the positions k, k+BULK_LOAD_TEST_KEYS, ...
+  int retrieved = 0;
+  for(int key = 0; key < BULK_LOAD_TEST_KEYS; key++){
+    for(int i = key; i < count; i += BULK_LOAD_TEST_KEYS){
+      ASSERT_EQUALS(err = GetNext(it, &tmp), kOk,
+                    "Could not retrieve a loaded record");
+      if(err != kOk)
+        break;
+      ASSERT_EQUALS(RecordCmp(*records[i], *tmp), 0,
+                    "The loaded records are not ordered by key and by their "
+                    "position inside the batches");
+      Release(tmp);
+      retrieved++;
+    }
+    if(err != kOk)
+      break;
+  }
+  ASSERT_EQUALS(retrieved, count, "Not all loaded records have been found");
+  if(err == kOk){
+    ASSERT_EQUALS(err = GetNext(it, &tmp), kErrorNotFound,
+                  "Iterator did not report an end of range");
+    if(err == kOk)
+      Release(tmp);
+  }
+  ASSERT_EQUALS(kOk, CloseIterator(&it), "Could not close iterator");
+}
+
+// Test to ensure that BulkLoad() (if provided) works properly
+//
+// It makes sure that a batch containing an incompatible record is rejected
+// as a whole, and that records with equal keys are returned in the order in
+// which they have been loaded (both when loading into an empty index and
+// when loading a small batch into a large index).
+TEST(BulkLoadTest){
+  if(BulkLoad == NULL)
+    return;
+
+  // Create the test records (record i has the key i % BULK_LOAD_TEST_KEYS)
+  int total = BULK_LOAD_TEST_RECORDS + BULK_LOAD_TEST_SMALL_BATCH;
+  Record **records = (Record**) malloc(total*sizeof(Record*));
+  Record *batch = (Record*) malloc(total*sizeof(Record));
+  for(int i = 0; i < total; i++){
+    char payload[32];
+    sprintf(payload, "record %d", i);
+    records[i] = CreateRecordIsolation(i % BULK_LOAD_TEST_KEYS, payload);
+    batch[i] = *records[i];
+  }
+
+  // A record that is not compatible with the index
+  Record *incompatible = CreateRecordBasic(1,2,"a","incompatible record");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(BULK_LOAD_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(BULK_LOAD_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+
+    if(err == kOk){
+      Iterator *it;
+      Record *tmp;
+
+      // Try to load a batch with an incompatible record in its middle
+      Record valid = batch[BULK_LOAD_TEST_RECORDS/2];
+      batch[BULK_LOAD_TEST_RECORDS/2] = *incompatible;
+      ASSERT_EQUALS(BulkLoad(idx, batch, BULK_LOAD_TEST_RECORDS),
+                    kErrorIncompatibleKey,
+                    "BulkLoad() did not reject an incompatible record");
+      batch[BULK_LOAD_TEST_RECORDS/2] = valid;
+
+      // Make sure that none of the records has been inserted
+      ASSERT_EQUALS(err = GetRecords(NULL, idx, records[0]->key,
+                                     records[BULK_LOAD_TEST_KEYS-1]->key, &it),
+                    kOk, "Could not open iterator");
+      if(err == kOk){
+        ASSERT_EQUALS(err = GetNext(it, &tmp), kErrorNotFound,
+                      "A rejected batch has been inserted partially");
+        if(err == kOk)
+          Release(tmp);
+        ASSERT_EQUALS(kOk, CloseIterator(&it), "Could not close iterator");
+      }
+
+      // Load the records into the empty index
+      ASSERT_EQUALS(err = BulkLoad(idx, batch, BULK_LOAD_TEST_RECORDS), kOk,
+                    "Could not load the records");
+      if(err == kOk)
+        CheckBulkLoad(idx, records, BULK_LOAD_TEST_RECORDS);
+
+      // Load a small batch into the filled index
+      ASSERT_EQUALS(err = BulkLoad(idx, batch + BULK_LOAD_TEST_RECORDS,
+                                   BULK_LOAD_TEST_SMALL_BATCH), kOk,
+                    "Could not load the small batch");
+      if(err == kOk)
+        CheckBulkLoad(idx, records, total);
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(BULK_LOAD_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < total; i++)
+    Release(records[i]);
+  Release(incompatible);
+  free(records);
+  free(batch);
+}
+
+
+// Test to ensure that transactions read the right versions of the records
+//
+// A transaction takes a snapshot and then the records are updated,
+// inserted and deleted by other (auto-committed) operations. If
+// CONTEST_ISOLATION is set to "snapshot" or "optimistic", the transaction
+// must still see the records of its snapshot; otherwise (read committed), it
+// must see the committed changes. As the records it read have been changed,
+// the transaction must be aborted on commit in optimistic mode. Transactions
+// that begin afterwards must see the changes in any case.
+TEST(SnapshotTest){
+  const char* isolation = getenv("CONTEST_ISOLATION");
+  bool optimistic = (isolation != NULL) && (strcmp(isolation, "optimistic") == 0);
+  bool snapshot = optimistic
+                  || ((isolation != NULL) && (strcmp(isolation, "snapshot") == 0));
+
+  // Create some test records (a_new replaces the payload of a)
+  Record *a = CreateRecordIsolation(1,"record a");
+  Record *a_new = CreateRecordIsolation(1,"record a (updated)");
+  Record *b = CreateRecordIsolation(2,"record b");
+  Record *c = CreateRecordIsolation(3,"record c");
+
+  Record *old_records[] = {a, c};
+  Record *new_records[] = {a_new, b};
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(SNAPSHOT_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(SNAPSHOT_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      Transaction *tx;
+
+      // Insert the initial records
+      ASSERT_EQUALS(err = InsertRecord(NULL, idx, a), kOk,
+                    "Could not insert record a");
+      ASSERT_EQUALS(err = InsertRecord(NULL, idx, c), kOk,
+                    "Could not insert record c");
+
+      // Begin the reading transaction and read the initial records
+      ASSERT_EQUALS(err = BeginTransaction(&tx), kOk,
+                    "Could not begin the reading transaction");
+      if(err == kOk){
+        CheckScan(tx, idx, a->key, c->key, old_records,
+                  COUNT_OF(old_records));
+
+        // Update a, insert b and delete c
+        ASSERT_EQUALS(UpdateRecord(NULL, idx, a, &a_new->payload, 0), kOk,
+                      "Could not update record a");
+        ASSERT_EQUALS(InsertRecord(NULL, idx, b), kOk,
+                      "Could not insert record b");
+        ASSERT_EQUALS(DeleteRecord(NULL, idx, c, 0), kOk,
+                      "Could not delete record c");
+
+        // Read the records again using the reading transaction
+        if(snapshot)
+          CheckScan(tx, idx, a->key, c->key, old_records,
+                    COUNT_OF(old_records));
+        else
+          CheckScan(tx, idx, a->key, c->key, new_records,
+                    COUNT_OF(new_records));
+
+        if(optimistic)
+          ASSERT_EQUALS(CommitTransaction(&tx), kTransactionAborted,
+                        "A transaction whose reads are outdated was committed");
+        else
+          ASSERT_EQUALS(CommitTransaction(&tx), kOk,
+                        "Could not commit the reading transaction");
+      }
+
+      // A new transaction must see the changes
+      ASSERT_EQUALS(err = BeginTransaction(&tx), kOk,
+                    "Could not begin a new transaction");
+      if(err == kOk){
+        CheckScan(tx, idx, a->key, c->key, new_records,
+                  COUNT_OF(new_records));
+        ASSERT_EQUALS(CommitTransaction(&tx), kOk,
+                      "Could not commit the new transaction");
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(SNAPSHOT_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  Release(a);
+  Release(a_new);
+  Release(b);
+  Release(c);
+}
+
+
+// Test to ensure that conflicting transactions are aborted in optimistic mode
+//
+// Two transactions delete the same record. Optimistic transactions do not
+// lock the record until they commit, so both deletes succeed; the first
+// transaction to commit wins and the commit of the other one must report
+// kTransactionAborted. The test is skipped unless CONTEST_ISOLATION is set
+// to "optimistic".
+TEST(OptimisticTest){
+  const char* isolation = getenv("CONTEST_ISOLATION");
+  if((isolation == NULL) || (strcmp(isolation, "optimistic") != 0))
+    return;
+
+  // Create a test record
+  Record *a = CreateRecordIsolation(1,"record a");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(OPTIMISTIC_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(OPTIMISTIC_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      Transaction *t1;
+      Transaction *t2;
+
+      // Insert the test record
+      ASSERT_EQUALS(err = InsertRecord(NULL, idx, a), kOk,
+                    "Could not insert record a");
+
+      // Begin two transactions and delete record a with both of them
+      ASSERT_EQUALS(err = BeginTransaction(&t1), kOk,
+                    "Could not begin transaction t1");
+      if(err == kOk){
+        ASSERT_EQUALS(err = BeginTransaction(&t2), kOk,
+                      "Could not begin transaction t2");
+        if(err == kOk){
+          ASSERT_EQUALS(DeleteRecord(t1, idx, a, 0), kOk,
+                        "Could not delete record a (transaction t1)");
+          ASSERT_EQUALS(DeleteRecord(t2, idx, a, 0), kOk,
+                        "Could not delete record a (transaction t2)");
+
+          // The first commit succeeds, the second one conflicts
+          ASSERT_EQUALS(CommitTransaction(&t2), kOk,
+                        "Could not commit transaction t2");
+          ASSERT_EQUALS(CommitTransaction(&t1), kTransactionAborted,
+                        "A conflicting transaction was committed");
+        } else {
+          ASSERT_EQUALS(AbortTransaction(&t1), kOk,
+                        "Could not abort transaction t1");
+        }
+      }
+
+      // Make sure that the record has been deleted
+      CheckScan(NULL, idx, a->key, a->key, NULL, 0);
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(OPTIMISTIC_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  Release(a);
+}
+
+
+// The number of distinct keys inserted by the LookupTest
+#define LOOKUP_TEST_KEYS 1000
+
+// Test to ensure that queries for a single key find all of its records
+//
+// Each key is inserted twice (with different payloads, the second record of
+// every other key in a transaction of its own). After one of the records of
+// every third key has been deleted and one of the records of every fifth key
+// has been updated, each key (as well as a missing key next to it) is looked
+// up on its own.
+TEST(LookupTest){
+  // Create the test records (two records per key)
+  Record **records = (Record**) malloc(2*LOOKUP_TEST_KEYS*sizeof(Record*));
+  for(int i = 0; i < 2*LOOKUP_TEST_KEYS; i++){
+    char payload[32];
+    sprintf(payload, "record %d", i);
+    records[i] = CreateRecordIsolation((i/2)*2 - LOOKUP_TEST_KEYS, payload);
+  }
+  Block updated;
+  SetValue(updated, "updated record");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(LOOKUP_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(LOOKUP_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert the test records
+      for(int i = 0; (err == kOk) && (i < 2*LOOKUP_TEST_KEYS); i++){
+        Transaction *tx = NULL;
+        if(i % 4 == 3){
+          ASSERT_EQUALS(err = BeginTransaction(&tx), kOk,
+                        "Could not begin a transaction");
+          if(err != kOk)
+            break;
+        }
+        ASSERT_EQUALS(err = InsertRecord(tx, idx, records[i]), kOk,
+                      "Could not insert a record");
+        if(tx != NULL)
+          ASSERT_EQUALS(CommitTransaction(&tx), kOk,
+                        "Could not commit a transaction");
+      }
+
+      // Delete the first record of every third key and update the second
+      // record of every fifth one
+      for(int i = 0; (err == kOk) && (i < LOOKUP_TEST_KEYS); i++){
+        if(i % 3 == 0)
+          ASSERT_EQUALS(err = DeleteRecord(NULL, idx, records[2*i], 0), kOk,
+                        "Could not delete a record");
+        if((err == kOk) && (i % 5 == 0)){
+          ASSERT_EQUALS(err = UpdateRecord(NULL, idx, records[2*i+1],
+                                           &updated, 0), kOk,
+                        "Could not update a record");
+          free(records[2*i+1]->payload.data);
+          SetValue(records[2*i+1]->payload, "updated record");
+        }
+      }
+
+      if(err == kOk){
+        // Look up each key and the missing key following it
+        for(int i = 0; i < LOOKUP_TEST_KEYS; i++){
+          Record **expected = records + 2*i + ((i % 3 == 0) ? 1 : 0);
+          CheckScan(NULL, idx, records[2*i]->key, records[2*i]->key,
+                    expected, (i % 3 == 0) ? 1 : 2);
+
+          Attribute *attribute = IntAttribute(
+            records[2*i]->key.value[0]->int_value + 1);
+          Key key = {&attribute, 1};
+          CheckScan(NULL, idx, key, key, NULL, 0);
+          free(attribute);
+        }
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(LOOKUP_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < 2*LOOKUP_TEST_KEYS; i++)
+    Release(records[i]);
+  free(records);
+  free(updated.data);
+}
+
+
+// The number of threads used by the CatalogTest and the number of indices
+// each of them creates and deletes
+#define CATALOG_TEST_THREADS 4
+#define CATALOG_TEST_ROUNDS 200
+
+// Create, use and delete indices (whose names are specific to the thread)
+// while the index of the CatalogTest is opened by other threads
+static void* CatalogTestThread(void* arg){
+  long thread = (long) arg;
+  Record *a = CreateRecordIsolation(thread, "record a");
+  ErrorCode err = kOk;
+  for(int i = 0; (err == kOk) && (i < CATALOG_TEST_ROUNDS); i++){
+    char name[64];
+    sprintf(name, "%s%ld_%d", CATALOG_TEST_INDEX, thread, i);
+    Index *idx;
+
+    // Open the shared index and an index of this thread
+    ASSERT_EQUALS(err = OpenIndex(CATALOG_TEST_INDEX, &idx), kOk,
+                  "Could not open the shared index");
+    if(err != kOk)
+      break;
+    CheckScan(NULL, idx, a->key, a->key, NULL, 0);
+    ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close the shared index");
+
+    KeyType schema = {kInt};
+    ASSERT_EQUALS(err = CreateIndex(name, COUNT_OF(schema), schema), kOk,
+                  "Could not create an index");
+    if(err != kOk)
+      break;
+    ASSERT_EQUALS(err = OpenIndex(name, &idx), kOk,
+                  "Could not open a created index");
+    if(err == kOk){
+      ASSERT_EQUALS(InsertRecord(NULL, idx, a), kOk,
+                    "Could not insert a record");
+      CheckScan(NULL, idx, a->key, a->key, &a, 1);
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close an index");
+    }
+    ASSERT_EQUALS(err = DeleteIndex(name), kOk, "Could not delete an index");
+    ASSERT_EQUALS(OpenIndex(name, &idx), kErrorUnknownIndex,
+                  "A deleted index could be opened");
+  }
+  Release(a);
+  return NULL;
+}
+
+// Test to ensure that indices can be created and deleted concurrently
+//
+// Several threads create, fill and delete indices of their own, while they
+// also open an index that exists throughout the test. Each thread makes sure
+// that the indices it opens contain the right records and that its deleted
+// indices cannot be opened anymore.
+TEST(CatalogTest){
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(CATALOG_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    pthread_t threads[CATALOG_TEST_THREADS];
+    int started = 0;
+    for(; started < CATALOG_TEST_THREADS; started++){
+      int r = pthread_create(&threads[started], NULL, CatalogTestThread,
+                             (void*) (long) started);
+      ASSERT_EQUALS(r, 0, "Could not create a thread");
+      if(r != 0)
+        break;
+    }
+    for(int i = 0; i < started; i++)
+      pthread_join(threads[i], NULL);
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(CATALOG_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+}
+
+
+// The number of threads used by the IteratorTest and the number of
+// iterators each of them opens
+#define ITERATOR_TEST_THREADS 4
+#define ITERATOR_TEST_ITERATORS 500
+
+// The index handle shared by the threads of the IteratorTest
+static Index *iterator_test_index;
+
+// Open and close iterators using the shared handle (three of them are open
+// at the same time)
+static void* IteratorTestThread(void*){
+  Record *a = CreateRecordIsolation(1, "record a");
+  Iterator *iterators[3] = {NULL, NULL, NULL};
+  for(int i = 0; i < ITERATOR_TEST_ITERATORS; i++){
+    int slot = i % COUNT_OF(iterators);
+    if(iterators[slot] != NULL)
+      ASSERT_EQUALS(CloseIterator(&iterators[slot]), kOk,
+                    "Could not close an iterator");
+    iterators[slot] = NULL;
+
+    Record *tmp;
+    ErrorCode err;
+    ASSERT_EQUALS(err = GetRecords(NULL, iterator_test_index, a->key, a->key,
+                                   &iterators[slot]), kOk,
+                  "Could not open an iterator");
+    if(err != kOk){
+      iterators[slot] = NULL;
+      break;
+    }
+    ASSERT_EQUALS(err = GetNext(iterators[slot], &tmp), kOk,
+                  "Could not retrieve record a");
+    if(err == kOk){
+      ASSERT_EQUALS(RecordCmp(*a, *tmp), 0,
+                    "The retrieved record does not match record a");
+      Release(tmp);
+    }
+  }
+  for(int i = 0; i < (int) COUNT_OF(iterators); i++){
+    if(iterators[i] != NULL)
+      ASSERT_EQUALS(CloseIterator(&iterators[i]), kOk,
+                    "Could not close an iterator");
+  }
+  Release(a);
+  return NULL;
+}
+
+// Test to ensure that iterators of the same handle can be opened and closed
+// concurrently
+//
+// Several threads open and close iterators using the same index handle.
+// Afterwards, the handle is closed while some iterators are still open
+// (which closes them as well).
+TEST(IteratorTest){
+  Record *a = CreateRecordIsolation(1, "record a");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(ITERATOR_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(ITERATOR_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      ASSERT_EQUALS(err = InsertRecord(NULL, idx, a), kOk,
+                    "Could not insert record a");
+
+      if(err == kOk){
+        pthread_t threads[ITERATOR_TEST_THREADS];
+        int started = 0;
+        iterator_test_index = idx;
+        for(; started < ITERATOR_TEST_THREADS; started++){
+          int r = pthread_create(&threads[started], NULL, IteratorTestThread,
+                                 NULL);
+          ASSERT_EQUALS(r, 0, "Could not create a thread");
+          if(r != 0)
+            break;
+        }
+        for(int i = 0; i < started; i++)
+          pthread_join(threads[i], NULL);
+
+        // Leave some iterators open
+        Iterator *it;
+        for(int i = 0; i < 3; i++)
+          ASSERT_EQUALS(GetRecords(NULL, idx, a->key, a->key, &it), kOk,
+                        "Could not open an iterator");
+      }
+
+      // Close the index (and the iterators left open)
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(ITERATOR_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  Release(a);
+}
+
+
+// The number of records inserted by the PartitionTest and the distance
+// between their keys
+#define PARTITION_TEST_RECORDS 2000
+#define PARTITION_TEST_STEP 3
+
+// Test to ensure that range queries return their results in key order
+//
+// Records are inserted in random order, and several ranges (whose bounds
+// are partly not contained in the index) are queried. If CONTEST_PARTITIONS
+// is set, the records are spread over several partitions, whose results
+// must be merged in key order.
+TEST(PartitionTest){
+  // Create the test records (ordered by key) and a shuffled copy
+  Record **records = (Record**) malloc(PARTITION_TEST_RECORDS*sizeof(Record*));
+  Record **shuffled = (Record**) malloc(PARTITION_TEST_RECORDS*sizeof(Record*));
+  for(int i = 0; i < PARTITION_TEST_RECORDS; i++){
+    char payload[32];
+    sprintf(payload, "record %d", i);
+    int64_t key = (i - PARTITION_TEST_RECORDS/2) * PARTITION_TEST_STEP;
+    records[i] = CreateRecordIsolation(key, payload);
+    shuffled[i] = records[i];
+  }
+  ShuffleRecords(shuffled, PARTITION_TEST_RECORDS);
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(PARTITION_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(PARTITION_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert the test records in random order
+      for(int i = 0; i < PARTITION_TEST_RECORDS; i++){
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, shuffled[i]), kOk,
+                      "Could not insert a record");
+        if(err != kOk)
+          break;
+      }
+
+      if(err == kOk){
+        // Query all records
+        CheckScan(NULL, idx, records[0]->key,
+                  records[PARTITION_TEST_RECORDS-1]->key, records,
+                  PARTITION_TEST_RECORDS);
+
+        // Query some ranges whose bounds are (not) contained in the index
+        int ranges[][2] = {{0, 0}, {1, 10}, {100, 1500},
+                           {PARTITION_TEST_RECORDS/2 - 50,
+                            PARTITION_TEST_RECORDS/2 + 50}};
+        for(int i = 0; i < (int) COUNT_OF(ranges); i++){
+          int first = ranges[i][0];
+          int last = ranges[i][1];
+          int64_t min_value = ((first - PARTITION_TEST_RECORDS/2)
+                               * PARTITION_TEST_STEP) - 1;
+          int64_t max_value = ((last - PARTITION_TEST_RECORDS/2)
+                               * PARTITION_TEST_STEP) + 1;
+          Attribute *min_attribute = IntAttribute(min_value);
+          Attribute *max_attribute = IntAttribute(max_value);
+          Key min_key = {&min_attribute, 1};
+          Key max_key = {&max_attribute, 1};
+
+          CheckScan(NULL, idx, records[first]->key, records[last]->key,
+                    records + first, last - first + 1);
+          CheckScan(NULL, idx, min_key, max_key, records + first,
+                    last - first + 1);
+
+          free(min_attribute);
+          free(max_attribute);
+        }
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(PARTITION_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < PARTITION_TEST_RECORDS; i++)
+    Release(records[i]);
+  free(records);
+  free(shuffled);
+}
+
+
+// The maximum number of records inserted by the ComparatorTest per schema
+#define COMPARATOR_TEST_RECORDS 600
+
+// Order records by their keys (for qsort())
+static int CompareRecordKeys(const void *a, const void *b){
+  return KeyCmp((*(Record**) a)->key, (*(Record**) b)->key);
+}
+
+// Check whether each attribute of the given record lies between the
+// corresponding attributes of the given keys
+static bool InBox(const Record *record, const Key &min_key, const Key &max_key){
+  for(int i = 0; i < record->key.attribute_count; i++){
+    Key attribute = {record->key.value + i, 1};
+    Key min_attribute = {min_key.value + i, 1};
+    Key max_attribute = {max_key.value + i, 1};
+    if((KeyCmp(attribute, min_attribute) < 0)
+       || (KeyCmp(attribute, max_attribute) > 0))
+      return false;
+  }
+  return true;
+}
+
+// Test to ensure that keys are ordered the same way for all schemas
+//
+// Implementations may compare keys differently depending on their schema
+// (e.g. for keys of fixed size). For several schemas, records whose
+// attributes differ in all of their bytes are inserted in random order. They
+// are queried as a whole, in ranges and one by one, and must be returned in
+// the order of their attributes.
+TEST(ComparatorTest){
+  int64_t ints[] = {INT64_MIN, -65537, -256, -1, 0, 1, 255, 256, 65536,
+                    INT64_MAX};
+  int32_t shorts[] = {INT32_MIN, -65537, -256, -1, 0, 1, 255, 256, 65536,
+                      INT32_MAX};
+  AttributeType schemas[][5] = {{kShort, kInt}, {kInt, kInt},
+                                {kInt, kInt, kInt}, {kInt, kInt, kInt, kInt},
+                                {kVarchar}, {kInt, kInt, kInt, kInt, kInt}};
+  uint8_t attribute_counts[] = {2, 2, 3, 4, 1, 5};
+
+  for(int s = 0; s < (int) COUNT_OF(schemas); s++){
+    uint8_t attribute_count = attribute_counts[s];
+
+    // Create the test records (the digits of their number select the values
+    // of their attributes, so there are only 100 distinct keys comprising
+    // two attributes) and sort them by key
+    int count = (attribute_count == 2) ? 100 : COMPARATOR_TEST_RECORDS;
+    Record **records = (Record**) malloc(count*sizeof(Record*));
+    Record **shuffled = (Record**) malloc(count*sizeof(Record*));
+    for(int n = 0; n < count; n++){
+      char payload[32];
+      sprintf(payload, "record %d", n);
+      Attribute *attributes[5];
+      int digits = n;
+      for(int i = attribute_count - 1; i >= 0; i--){
+        if(schemas[s][i] == kVarchar){
+          char value[16];
+          sprintf(value, "%d", n);
+          attributes[i] = VarcharAttribute(value);
+        } else if(schemas[s][i] == kShort){
+          attributes[i] = ShortAttribute(shorts[digits % 10]);
+        } else {
+          attributes[i] = IntAttribute(ints[digits % 10]);
+        }
+        digits /= 10;
+      }
+      records[n] = CreateRecord(attribute_count, attributes, payload);
+      shuffled[n] = records[n];
+    }
+    ShuffleRecords(shuffled, count);
+    qsort(records, count, sizeof(Record*), CompareRecordKeys);
+
+    // Create an index using the schema
+    ErrorCode err = CreateIndex(COMPARATOR_TEST_INDEX, attribute_count,
+                                schemas[s]);
+
+    ASSERT_EQUALS(err, kOk, "Could not create the new index");
+    if(err == kOk) {
+      Index *idx;
+
+      // Open the created index
+      ASSERT_EQUALS(err = OpenIndex(COMPARATOR_TEST_INDEX, &idx), kOk,
+                    "Could not open the created index");
+      if(err == kOk){
+        // Insert the test records in random order
+        for(int i = 0; i < count; i++){
+          ASSERT_EQUALS(err = InsertRecord(NULL, idx, shuffled[i]), kOk,
+                        "Could not insert a record");
+          if(err != kOk)
+            break;
+        }
+
+        if(err == kOk){
+          // Query all records, some ranges and some single records
+          CheckScan(NULL, idx, records[0]->key, records[count-1]->key,
+                    records, count);
+          Record **expected = (Record**) malloc(count*sizeof(Record*));
+          for(int i = 0; i + 7 < count; i += count/7){
+            Key min_key = records[i]->key;
+            Key max_key = records[i+7]->key;
+            int expected_count = 0;
+            for(int j = 0; j < count; j++){
+              if(InBox(records[j], min_key, max_key))
+                expected[expected_count++] = records[j];
+            }
+            CheckScan(NULL, idx, min_key, max_key, expected, expected_count);
+            CheckScan(NULL, idx, records[i+3]->key, records[i+3]->key,
+                      records + i + 3, 1);
+          }
+          free(expected);
+        }
+
+        // Close the index
+        ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+      }
+
+      // Delete the index
+      ASSERT_EQUALS(DeleteIndex(COMPARATOR_TEST_INDEX), kOk,
+                    "Could not delete the index");
+    }
+
+    // Cleanup
+    for(int i = 0; i < count; i++)
+      Release(records[i]);
+    free(records);
+    free(shuffled);
+  }
+}
+
+
+// Test to ensure that updates keeping the size of the payload are isolated
+//
+// A record is updated (outside of any transaction) with a payload of the same
+// size while a transaction that has read it is still running. The
+// transaction must read the old payload again if CONTEST_ISOLATION is set to
+// "snapshot" or "optimistic" and the new one otherwise. A second transaction
+// inserts and updates a record of its own, which must not be visible to
+// others before it commits.
+TEST(OverwriteTest){
+  const char* isolation = getenv("CONTEST_ISOLATION");
+  bool optimistic = (isolation != NULL) && (strcmp(isolation, "optimistic") == 0);
+  bool snapshot = optimistic
+                  || ((isolation != NULL) && (strcmp(isolation, "snapshot") == 0));
+
+  // Create some test records (a_new and b_new replace the payloads of a and b
+  // with payloads of the same size)
+  Record *a = CreateRecordIsolation(1,"record a 1");
+  Record *a_new = CreateRecordIsolation(1,"record a 2");
+  Record *b = CreateRecordIsolation(2,"record b 1");
+  Record *b_new = CreateRecordIsolation(2,"record b 2");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(OVERWRITE_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(OVERWRITE_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      Transaction *tx;
+      ASSERT_EQUALS(err = InsertRecord(NULL, idx, a), kOk,
+                    "Could not insert record a");
+
+      // Read record a, then update it outside of the transaction
+      if(err == kOk)
+        ASSERT_EQUALS(err = BeginTransaction(&tx), kOk,
+                      "Could not begin the reading transaction");
+      if(err == kOk){
+        CheckScan(tx, idx, a->key, a->key, &a, 1);
+        ASSERT_EQUALS(UpdateRecord(NULL, idx, a, &a_new->payload, 0), kOk,
+                      "Could not update record a");
+        CheckScan(tx, idx, a->key, a->key, snapshot ? &a : &a_new, 1);
+
+        if(optimistic)
+          ASSERT_EQUALS(CommitTransaction(&tx), kTransactionAborted,
+                        "A transaction whose reads are outdated was committed");
+        else
+          ASSERT_EQUALS(CommitTransaction(&tx), kOk,
+                        "Could not commit the reading transaction");
+      }
+      CheckScan(NULL, idx, a->key, a->key, &a_new, 1);
+
+      // Insert and update record b inside a transaction, first aborting it
+      // and then committing it
+      for(int i = 0; (err == kOk) && (i < 2); i++){
+        ASSERT_EQUALS(err = BeginTransaction(&tx), kOk,
+                      "Could not begin the writing transaction");
+        if(err != kOk)
+          break;
+        ASSERT_EQUALS(InsertRecord(tx, idx, b), kOk,
+                      "Could not insert record b");
+        ASSERT_EQUALS(UpdateRecord(tx, idx, b, &b_new->payload, 0), kOk,
+                      "Could not update record b");
+        CheckScan(tx, idx, b->key, b->key, &b_new, 1);
+        CheckScan(NULL, idx, b->key, b->key, NULL, 0);
+        if(i == 0){
+          ASSERT_EQUALS(AbortTransaction(&tx), kOk,
+                        "Could not abort the writing transaction");
+          CheckScan(NULL, idx, b->key, b->key, NULL, 0);
+        } else {
+          ASSERT_EQUALS(CommitTransaction(&tx), kOk,
+                        "Could not commit the writing transaction");
+          CheckScan(NULL, idx, b->key, b->key, &b_new, 1);
+        }
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(OVERWRITE_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  Release(a);
+  Release(a_new);
+  Release(b);
+  Release(b_new);
+}
+
+
+// Check that a query of the given key returns exactly the given records (in
+// any order)
+static void CheckMatches(Index *idx, Key key, Record **expected, int count){
+  bool found[8] = {false};
+  Iterator *it;
+  Record *tmp;
+  ErrorCode err;
+  ASSERT_LEQ(count, (int) COUNT_OF(found), "Too many expected records");
+  ASSERT_EQUALS(err = GetRecords(NULL, idx, key, key, &it), kOk,
+                "Could not open iterator");
+  if(err != kOk)
+    return;
+
+  int retrieved = 0;
+  while((err = GetNext(it, &tmp)) == kOk){
+    int i = 0;
+    while((i < count) && (found[i] || (RecordCmp(*expected[i], *tmp) != 0)))
+      i++;
+    ASSERT_LT(i, count, "A retrieved record has not been expected");
+    if(i < count)
+      found[i] = true;
+    Release(tmp);
+    retrieved++;
+  }
+  ASSERT_EQUALS(err, kErrorNotFound, "Iterator did not report an end of range");
+  ASSERT_EQUALS(retrieved, count, "Not all expected records have been found");
+  ASSERT_EQUALS(kOk, CloseIterator(&it), "Could not close iterator");
+}
+
+// Test to ensure that records are matched by their key and payload
+//
+// The index holds several copies of the same record next to records that
+// share only its key or only its payload. Updating and deleting records
+// without kMatchDuplicates must affect one of the copies, with
+// kMatchDuplicates all of them, but never the other records. One of the
+// copies is overwritten by a payload of the same size before, so that it has
+// to be found by its new payload afterwards.
+TEST(PayloadTest){
+  // Create the test records (c shares the key of a, d shares its payload)
+  Record *a = CreateRecordIsolation(1,"record a");
+  Record *a_new = CreateRecordIsolation(1,"record A");
+  Record *a_updated = CreateRecordIsolation(1,"record a (updated)");
+  Record *c = CreateRecordIsolation(1,"record c");
+  Record *d = CreateRecordIsolation(2,"record a");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(PAYLOAD_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(PAYLOAD_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert four copies of record a as well as records c and d
+      for(int i = 0; (err == kOk) && (i < 4); i++)
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, a), kOk,
+                      "Could not insert record a");
+      if(err == kOk)
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, c), kOk,
+                      "Could not insert record c");
+      if(err == kOk)
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, d), kOk,
+                      "Could not insert record d");
+
+      if(err == kOk){
+        // Overwrite the payload of one copy and update another one
+        ASSERT_EQUALS(UpdateRecord(NULL, idx, a, &a_new->payload, 0), kOk,
+                      "Could not overwrite a copy of record a");
+        ASSERT_EQUALS(UpdateRecord(NULL, idx, a, &a_updated->payload, 0), kOk,
+                      "Could not update a copy of record a");
+        Record *updated[] = {a, a, c, a_new, a_updated};
+        CheckMatches(idx, a->key, updated, COUNT_OF(updated));
+
+        // Delete the overwritten copy (using its new payload)
+        ASSERT_EQUALS(DeleteRecord(NULL, idx, a_new, 0), kOk,
+                      "Could not delete the overwritten copy of record a");
+        ASSERT_EQUALS(DeleteRecord(NULL, idx, a_new, 0), kErrorNotFound,
+                      "A deleted record has been deleted again");
+
+        // Update the remaining copies at once and delete them at once
+        ASSERT_EQUALS(UpdateRecord(NULL, idx, a, &a_new->payload,
+                                   kMatchDuplicates), kOk,
+                      "Could not update the copies of record a");
+        Record *copies[] = {a_new, a_new, c, a_updated};
+        CheckMatches(idx, a->key, copies, COUNT_OF(copies));
+        ASSERT_EQUALS(DeleteRecord(NULL, idx, a_new, kMatchDuplicates), kOk,
+                      "Could not delete the copies of record a");
+        ASSERT_EQUALS(DeleteRecord(NULL, idx, a_new, kMatchDuplicates),
+                      kErrorNotFound,
+                      "The copies of record a have been deleted again");
+        ASSERT_EQUALS(DeleteRecord(NULL, idx, a, 0), kErrorNotFound,
+                      "A copy of record a has not been updated");
+        Record *remaining[] = {c, a_updated};
+        CheckMatches(idx, a->key, remaining, COUNT_OF(remaining));
+        CheckScan(NULL, idx, d->key, d->key, &d, 1);
+
+        // Update all records with the key of a
+        ASSERT_EQUALS(UpdateRecord(NULL, idx, a, &a_new->payload,
+                                   kMatchDuplicates | kIgnorePayload), kOk,
+                      "Could not update the records with the key of a");
+        Record *all_updated[] = {a_new, a_new};
+        CheckMatches(idx, a->key, all_updated, COUNT_OF(all_updated));
+        CheckScan(NULL, idx, d->key, d->key, &d, 1);
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(PAYLOAD_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  Release(a);
+  Release(a_new);
+  Release(a_updated);
+  Release(c);
+  Release(d);
+}
+
+
+// The number of threads used by the SplitTest and the number of records
+// each of them inserts
+#define SPLIT_TEST_THREADS 4
+#define SPLIT_TEST_RECORDS 2000
+
+// The index handle and the records used by the threads of the SplitTest
+// (the records with even numbers are inserted before the threads start)
+static Index *split_test_index;
+static Record **split_test_records;
+
+// Insert the odd records of a thread and look up the even ones in between
+static void* SplitTestThread(void* arg){
+  long thread = (long) arg;
+  Record **records = split_test_records + 2*thread*SPLIT_TEST_RECORDS;
+  for(int i = 0; i < SPLIT_TEST_RECORDS; i++){
+    ErrorCode err;
+    ASSERT_EQUALS(err = InsertRecord(NULL, split_test_index,
+                                     records[2*i+1]), kOk,
+                  "Could not insert a record");
+    if(err != kOk)
+      break;
+    CheckScan(NULL, split_test_index, records[2*i]->key, records[2*i]->key,
+              records + 2*i, 1);
+  }
+  return NULL;
+}
+
+// Test to ensure that lookups find their records while leaves are split
+//
+// Every other record is inserted first. Then several threads insert the
+// remaining records (so that many leaves and inner nodes are split) and
+// look up the records inserted before. The keys are long strings sharing
+// their prefixes, so the separators of inner nodes have different lengths.
+TEST(SplitTest){
+  // Create the test records (ordered by key)
+  int count = 2*SPLIT_TEST_THREADS*SPLIT_TEST_RECORDS;
+  Record **records = (Record**) malloc(count*sizeof(Record*));
+  for(int i = 0; i < count; i++){
+    char key[64];
+    sprintf(key, "a long common prefix/%02d/%08d", i % 17, i);
+    Attribute *attribute = VarcharAttribute(key);
+    records[i] = CreateRecord(1, &attribute, "record");
+  }
+  qsort(records, count, sizeof(Record*), CompareRecordKeys);
+
+  // Create a simple index with keys comprising 1 varchar attribute
+  KeyType schema = {kVarchar};
+  ErrorCode err = CreateIndex(SPLIT_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(SPLIT_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert every other record
+      for(int i = 0; (err == kOk) && (i < count); i += 2)
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, records[i]), kOk,
+                      "Could not insert a record");
+
+      if(err == kOk){
+        pthread_t threads[SPLIT_TEST_THREADS];
+        int started = 0;
+        split_test_index = idx;
+        split_test_records = records;
+        for(; started < SPLIT_TEST_THREADS; started++){
+          int r = pthread_create(&threads[started], NULL, SplitTestThread,
+                                 (void*) (long) started);
+          ASSERT_EQUALS(r, 0, "Could not create a thread");
+          if(r != 0)
+            break;
+        }
+        for(int i = 0; i < started; i++)
+          pthread_join(threads[i], NULL);
+
+        // Query all records
+        if(started == SPLIT_TEST_THREADS)
+          CheckScan(NULL, idx, records[0]->key, records[count-1]->key,
+                    records, count);
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(SPLIT_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < count; i++)
+    Release(records[i]);
+  free(records);
+}
+
+
+// The number of records inserted by the RadixTest and the distance between
+// their keys (which is large, so that the keys differ in several bytes)
+#define RADIX_TEST_RECORDS 5000
+#define RADIX_TEST_STEP 1000003
+
+// Test to ensure that point queries find the right records after many
+// inserts and deletes
+//
+// Records are inserted in random order (so that many leaves are split), and
+// every third record is deleted afterwards. Each inserted key (as well as a
+// key between each two of them) is looked up, and the remaining records are
+// queried as a whole. Setting CONTEST_RADIX to 0 runs the test without the
+// radix trees used for integer keys.
+TEST(RadixTest){
+  // Create the test records (ordered by key) and a shuffled copy
+  Record **records = (Record**) malloc(RADIX_TEST_RECORDS*sizeof(Record*));
+  Record **shuffled = (Record**) malloc(RADIX_TEST_RECORDS*sizeof(Record*));
+  Record **remaining = (Record**) malloc(RADIX_TEST_RECORDS*sizeof(Record*));
+  int remaining_count = 0;
+  for(int i = 0; i < RADIX_TEST_RECORDS; i++){
+    char payload[32];
+    sprintf(payload, "record %d", i);
+    int64_t key = (int64_t) (i - RADIX_TEST_RECORDS/2) * RADIX_TEST_STEP;
+    records[i] = CreateRecordIsolation(key, payload);
+    shuffled[i] = records[i];
+    if(i % 3 != 0)
+      remaining[remaining_count++] = records[i];
+  }
+  ShuffleRecords(shuffled, RADIX_TEST_RECORDS);
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(RADIX_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(RADIX_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert the test records in random order
+      for(int i = 0; i < RADIX_TEST_RECORDS; i++){
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, shuffled[i]), kOk,
+                      "Could not insert a record");
+        if(err != kOk)
+          break;
+      }
+
+      // Delete every third record
+      for(int i = 0; (err == kOk) && (i < RADIX_TEST_RECORDS); i += 3){
+        ASSERT_EQUALS(err = DeleteRecord(NULL, idx, records[i], 0), kOk,
+                      "Could not delete a record");
+      }
+
+      if(err == kOk){
+        // Look up each inserted key and the key following it
+        for(int i = 0; i < RADIX_TEST_RECORDS; i++){
+          if(i % 3 != 0)
+            CheckScan(NULL, idx, records[i]->key, records[i]->key,
+                      records + i, 1);
+          else
+            CheckScan(NULL, idx, records[i]->key, records[i]->key, NULL, 0);
+
+          Attribute *attribute = IntAttribute(
+            records[i]->key.value[0]->int_value + 1);
+          Key key = {&attribute, 1};
+          CheckScan(NULL, idx, key, key, NULL, 0);
+          free(attribute);
+        }
+
+        // Query all remaining records
+        CheckScan(NULL, idx, records[0]->key,
+                  records[RADIX_TEST_RECORDS-1]->key, remaining,
+                  remaining_count);
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(RADIX_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < RADIX_TEST_RECORDS; i++)
+    Release(records[i]);
+  free(records);
+  free(shuffled);
+  free(remaining);
+}
+
+
+// The number of records inserted by the PlacementTest and the number of NUMA
+// nodes it asks for
+#define PLACEMENT_TEST_RECORDS 1000
+#define PLACEMENT_TEST_NODES 64
+
+// Test to ensure that GetIndexMemoryPlacement() (if provided) works properly
+//
+// It makes sure that unknown indices are reported and that some pages of an
+// index holding records are found on one of the NUMA nodes. The test is
+// skipped if the placement is not available on this machine.
+TEST(PlacementTest){
+  if(GetIndexMemoryPlacement == NULL)
+    return;
+
+  uint64_t pages[PLACEMENT_TEST_NODES];
+  ASSERT_EQUALS(GetIndexMemoryPlacement(PLACEMENT_TEST_INDEX,
+                                        PLACEMENT_TEST_NODES, pages),
+                kErrorUnknownIndex,
+                "The placement of a non-existent index has been determined");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(PLACEMENT_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(PLACEMENT_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert the test records
+      for(int i = 0; (err == kOk) && (i < PLACEMENT_TEST_RECORDS); i++){
+        Record *record = CreateRecordIsolation(i, "record");
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, record), kOk,
+                      "Could not insert a record");
+        Release(record);
+      }
+
+      if(err == kOk){
+        err = GetIndexMemoryPlacement(PLACEMENT_TEST_INDEX,
+                                      PLACEMENT_TEST_NODES, pages);
+        if(err != kErrorGenericFailure){
+          ASSERT_EQUALS(err, kOk, "Could not determine the placement");
+          uint64_t total = 0;
+          for(int i = 0; (err == kOk) && (i < PLACEMENT_TEST_NODES); i++)
+            total += pages[i];
+          if(err == kOk)
+            ASSERT_GT(total, 0u, "No page of the index has been found");
+        }
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(PLACEMENT_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+}
+
+
+// The number of batches loaded by the QuiesceTest and their size (the same
+// number of records is inserted by a second thread)
+#define QUIESCE_TEST_BATCHES 20
+#define QUIESCE_TEST_BATCH_SIZE 100
+#define QUIESCE_TEST_RECORDS (QUIESCE_TEST_BATCHES*QUIESCE_TEST_BATCH_SIZE)
+
+// The index handle and the records used by the thread of the QuiesceTest
+static Index *quiesce_test_index;
+static Record **quiesce_test_records;
+
+// Insert every other record of the QuiesceTest (one by one)
+static void* QuiesceTestThread(void*){
+  for(int i = 1; i < 2*QUIESCE_TEST_RECORDS; i += 2){
+    ErrorCode err;
+    ASSERT_EQUALS(err = InsertRecord(NULL, quiesce_test_index,
+                                     quiesce_test_records[i]), kOk,
+                  "Could not insert a record");
+    if(err != kOk)
+      break;
+  }
+  return NULL;
+}
+
+// Test to ensure that BulkLoad() (if provided) respects unresolved
+// transactions and concurrent inserts
+//
+// Batches are loaded while a transaction has inserted a record it aborts
+// afterwards and has deleted a record it commits afterwards. Then, further
+// batches are loaded while a second thread inserts records using the same
+// index handle. In the end, the index must contain exactly the loaded and
+// inserted records.
+TEST(QuiesceTest){
+  if(BulkLoad == NULL)
+    return;
+
+  // Create the test records (the even ones are loaded, the odd ones are
+  // inserted by the thread)
+  Record **records = (Record**) malloc(2*QUIESCE_TEST_RECORDS*sizeof(Record*));
+  Record *batch = (Record*) malloc(QUIESCE_TEST_RECORDS*sizeof(Record));
+  for(int i = 0; i < 2*QUIESCE_TEST_RECORDS; i++){
+    char payload[32];
+    sprintf(payload, "record %d", i);
+    records[i] = CreateRecordIsolation(i, payload);
+    if(i % 2 == 0)
+      batch[i/2] = *records[i];
+  }
+  Record *aborted = CreateRecordIsolation(-1, "aborted record");
+  Record *deleted = CreateRecordIsolation(-2, "deleted record");
+
+  // Create a simple index with keys comprising 1 int attribute
+  KeyType schema = {kInt};
+  ErrorCode err = CreateIndex(QUIESCE_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(QUIESCE_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      Transaction *tx;
+      ASSERT_EQUALS(err = InsertRecord(NULL, idx, deleted), kOk,
+                    "Could not insert a record");
+
+      // Load the first batch while a transaction is unresolved
+      if(err == kOk)
+        ASSERT_EQUALS(err = BeginTransaction(&tx), kOk,
+                      "Could not begin a transaction");
+      if(err == kOk){
+        ASSERT_EQUALS(InsertRecord(tx, idx, aborted), kOk,
+                      "Could not insert a record (transaction)");
+        ASSERT_EQUALS(DeleteRecord(tx, idx, deleted, 0), kOk,
+                      "Could not delete a record (transaction)");
+        ASSERT_EQUALS(err = BulkLoad(idx, batch, QUIESCE_TEST_BATCH_SIZE), kOk,
+                      "Could not load a batch");
+        ASSERT_EQUALS(AbortTransaction(&tx), kOk,
+                      "Could not abort the transaction");
+        CheckScan(NULL, idx, aborted->key, aborted->key, NULL, 0);
+        CheckScan(NULL, idx, deleted->key, deleted->key, &deleted, 1);
+      }
+
+      if(err == kOk)
+        ASSERT_EQUALS(err = BeginTransaction(&tx), kOk,
+                      "Could not begin a transaction");
+      if(err == kOk){
+        ASSERT_EQUALS(DeleteRecord(tx, idx, deleted, 0), kOk,
+                      "Could not delete a record (transaction)");
+        ASSERT_EQUALS(err = BulkLoad(idx, batch + QUIESCE_TEST_BATCH_SIZE,
+                                     QUIESCE_TEST_BATCH_SIZE), kOk,
+                      "Could not load a batch");
+        ASSERT_EQUALS(CommitTransaction(&tx), kOk,
+                      "Could not commit the transaction");
+        CheckScan(NULL, idx, deleted->key, deleted->key, NULL, 0);
+      }
+
+      // Load the remaining batches while the thread inserts its records
+      if(err == kOk){
+        pthread_t thread;
+        quiesce_test_index = idx;
+        quiesce_test_records = records;
+        int r = pthread_create(&thread, NULL, QuiesceTestThread, NULL);
+        ASSERT_EQUALS(r, 0, "Could not create a thread");
+        for(int i = 2; (err == kOk) && (i < QUIESCE_TEST_BATCHES); i++){
+          ASSERT_EQUALS(err = BulkLoad(idx, batch + i*QUIESCE_TEST_BATCH_SIZE,
+                                       QUIESCE_TEST_BATCH_SIZE), kOk,
+                        "Could not load a batch");
+        }
+        if(r == 0)
+          pthread_join(thread, NULL);
+        else
+          QuiesceTestThread(NULL);
+      }
+
+      // Query all records
+      if(err == kOk)
+        CheckScan(NULL, idx, records[0]->key,
+                  records[2*QUIESCE_TEST_RECORDS-1]->key, records,
+                  2*QUIESCE_TEST_RECORDS);
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(QUIESCE_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < 2*QUIESCE_TEST_RECORDS; i++)
+    Release(records[i]);
+  Release(aborted);
+  Release(deleted);
+  free(records);
+  free(batch);
+}
+
+
+// Test to ensure that range queries restricting any attributes of a key
+// return the right records in key order
+//
+// The keys combine negative and positive values of both integer types. The
+// records are inserted in random order, some of them are deleted and the
+// remaining ones are queried using boxes whose bounds contain wildcards at
+// the beginning, the middle or the end of the key. Setting CONTEST_ZORDER to
+// 1 runs the test with the keys stored in Z-order.
+TEST(ZOrderTest){
+  int64_t firsts[] = {INT64_MIN, -3, -1, 0, 2, 5, INT64_MAX};
+  int32_t seconds[] = {INT32_MIN, -2, -1, 0, 1, 3, INT32_MAX};
+  int64_t thirds[] = {-1000, -1, 0, 1, 7, 1000};
+  const int count = COUNT_OF(firsts)*COUNT_OF(seconds)*COUNT_OF(thirds);
+
+  // Create the test records (ordered by key) and a shuffled copy
+  Record **records = (Record**) malloc(count*sizeof(Record*));
+  Record **shuffled = (Record**) malloc(count*sizeof(Record*));
+  Record **expected = (Record**) malloc(count*sizeof(Record*));
+  int n = 0;
+  for(int i = 0; i < (int) COUNT_OF(firsts); i++){
+    for(int j = 0; j < (int) COUNT_OF(seconds); j++){
+      for(int k = 0; k < (int) COUNT_OF(thirds); k++){
+        char payload[32];
+        sprintf(payload, "record %d", n);
+        Attribute *attributes[] = {IntAttribute(firsts[i]),
+                                   ShortAttribute(seconds[j]),
+                                   IntAttribute(thirds[k])};
+        records[n] = CreateRecord(COUNT_OF(attributes), attributes, payload);
+        shuffled[n] = records[n];
+        n++;
+      }
+    }
+  }
+  ShuffleRecords(shuffled, count);
+
+  // Create an index with keys comprising 3 integer attributes
+  KeyType schema = {kInt, kShort, kInt};
+  ErrorCode err = CreateIndex(ZORDER_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(ZORDER_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert the test records in random order and delete every fifth one
+      for(int i = 0; i < count; i++){
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, shuffled[i]), kOk,
+                      "Could not insert a record");
+        if(err != kOk)
+          break;
+      }
+      for(int i = 0; (err == kOk) && (i < count); i += 5){
+        ASSERT_EQUALS(err = DeleteRecord(NULL, idx, records[i], 0), kOk,
+                      "Could not delete a record");
+      }
+
+      if(err == kOk){
+        // The bounds of the queried boxes (NULL is a wildcard)
+        Attribute *min_attributes[][3] = {
+          {NULL, ShortAttribute(-1), IntAttribute(0)},
+          {NULL, NULL, IntAttribute(1)},
+          {IntAttribute(-1), NULL, IntAttribute(-1)},
+          {IntAttribute(-3), ShortAttribute(INT32_MIN), NULL},
+          {NULL, NULL, NULL}};
+        Attribute *max_attributes[][3] = {
+          {NULL, ShortAttribute(1), IntAttribute(7)},
+          {NULL, NULL, IntAttribute(1)},
+          {IntAttribute(INT64_MAX), NULL, IntAttribute(1)},
+          {IntAttribute(2), ShortAttribute(0), NULL},
+          {NULL, NULL, NULL}};
+
+        for(int q = 0; q < (int) COUNT_OF(min_attributes); q++){
+          Key min_key = {min_attributes[q], 3};
+          Key max_key = {max_attributes[q], 3};
+
+          // Find the remaining records inside the box (in key order)
+          int expected_count = 0;
+          for(int i = 0; i < count; i++){
+            if(i % 5 == 0)
+              continue;
+            bool inside = true;
+            for(int a = 0; a < 3; a++){
+              if(min_attributes[q][a] == NULL)
+                continue;
+              int64_t value = (a == 1) ? records[i]->key.value[a]->short_value
+                                       : records[i]->key.value[a]->int_value;
+              int64_t min = (a == 1) ? min_attributes[q][a]->short_value
+                                     : min_attributes[q][a]->int_value;
+              int64_t max = (a == 1) ? max_attributes[q][a]->short_value
+                                     : max_attributes[q][a]->int_value;
+              if((value < min) || (value > max))
+                inside = false;
+            }
+            if(inside)
+              expected[expected_count++] = records[i];
+          }
+          CheckScan(NULL, idx, min_key, max_key, expected, expected_count);
+        }
+
+        for(int q = 0; q < (int) COUNT_OF(min_attributes); q++){
+          for(int a = 0; a < 3; a++){
+            free(min_attributes[q][a]);
+            free(max_attributes[q][a]);
+          }
+        }
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(ZORDER_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < count; i++)
+    Release(records[i]);
+  free(records);
+  free(shuffled);
+  free(expected);
+}
+
+
+// The number of records inserted by the DictionaryTest
+#define DICTIONARY_TEST_RECORDS 2400
+
+// Test to ensure that VARCHAR attributes are ordered and returned correctly,
+// no matter how many distinct values they have
+//
+// Half of the records share a few strings, the other half have strings of
+// their own (more than a dictionary holds, see native/dictionary.h), some of
+// them containing 0x01 bytes, some of them as long as possible. The records
+// are inserted in random order and queried as a whole, in ranges (also
+// bounded by strings that are not stored) and one by one. Setting
+// CONTEST_DICTIONARY to 1 runs the test with the strings encoded using a
+// dictionary.
+TEST(DictionaryTest){
+  const char *common[] = {"", "http://www.example.com/a", "\x01",
+                          "http://www.example.com/b", "zzz"};
+  const int count = DICTIONARY_TEST_RECORDS;
+
+  // Create the test records and sort them by key
+  Record **records = (Record**) malloc(count*sizeof(Record*));
+  Record **shuffled = (Record**) malloc(count*sizeof(Record*));
+  char value[MAX_VARCHAR_LENGTH+1];
+  for(int n = 0; n < count; n++){
+    char payload[32];
+    sprintf(payload, "record %d", n);
+    if(n % 2 == 0){
+      strcpy(value, common[(n/2) % COUNT_OF(common)]);
+    } else if(n % 101 == 1){
+      memset(value, 'a' + n % 26, MAX_VARCHAR_LENGTH);
+      value[MAX_VARCHAR_LENGTH] = '\0';
+    } else {
+      sprintf(value, "%s%d%s", common[n % COUNT_OF(common)], (n * 7919) % 10007,
+              (n % 7 == 0) ? "\x01x" : "");
+    }
+    Attribute *attributes[] = {VarcharAttribute(value), IntAttribute(n)};
+    records[n] = CreateRecord(COUNT_OF(attributes), attributes, payload);
+    shuffled[n] = records[n];
+  }
+  ShuffleRecords(shuffled, count);
+  qsort(records, count, sizeof(Record*), CompareRecordKeys);
+
+  // Create an index with keys comprising a VARCHAR and an INT attribute
+  KeyType schema = {kVarchar, kInt};
+  ErrorCode err = CreateIndex(DICTIONARY_TEST_INDEX, COUNT_OF(schema), schema);
+
+  ASSERT_EQUALS(err, kOk, "Could not create the new index");
+  if(err == kOk) {
+    Index *idx;
+
+    // Open the created index
+    ASSERT_EQUALS(err = OpenIndex(DICTIONARY_TEST_INDEX, &idx), kOk,
+                  "Could not open the created index");
+    if(err == kOk){
+      // Insert the test records in random order
+      for(int i = 0; i < count; i++){
+        ASSERT_EQUALS(err = InsertRecord(NULL, idx, shuffled[i]), kOk,
+                      "Could not insert a record");
+        if(err != kOk)
+          break;
+      }
+
+      if(err == kOk){
+        // Query all records, some ranges and some single records
+        Attribute *wildcards[] = {NULL, NULL};
+        Key all = {wildcards, 2};
+        CheckScan(NULL, idx, all, all, records, count);
+        Record **expected = (Record**) malloc(count*sizeof(Record*));
+        for(int i = 0; i + 40 < count; i += count/13){
+          Key min_key = records[i]->key;
+          Key max_key = records[i+40]->key;
+          int expected_count = 0;
+          for(int j = 0; j < count; j++){
+            if(InBox(records[j], min_key, max_key))
+              expected[expected_count++] = records[j];
+          }
+          CheckScan(NULL, idx, min_key, max_key, expected, expected_count);
+          CheckScan(NULL, idx, records[i+3]->key, records[i+3]->key,
+                    records + i + 3, 1);
+        }
+
+        // Query ranges bounded by strings that are not stored
+        const char *bounds[][2] = {{"\x01\x01", "http://www.example.com/a5"},
+                                   {"http://www.example.com/a0", "zz"},
+                                   {"1", "2"}};
+        for(int q = 0; q < (int) COUNT_OF(bounds); q++){
+          Attribute *min_attributes[] = {VarcharAttribute(bounds[q][0]),
+                                         IntAttribute(0)};
+          Attribute *max_attributes[] = {VarcharAttribute(bounds[q][1]),
+                                         IntAttribute(count)};
+          Key min_key = {min_attributes, 2};
+          Key max_key = {max_attributes, 2};
+          int expected_count = 0;
+          for(int j = 0; j < count; j++){
+            if(InBox(records[j], min_key, max_key))
+              expected[expected_count++] = records[j];
+          }
+          CheckScan(NULL, idx, min_key, max_key, expected, expected_count);
+          for(int a = 0; a < 2; a++){
+            free(min_attributes[a]);
+            free(max_attributes[a]);
+          }
+        }
+        free(expected);
+      }
+
+      // Close the index
+      ASSERT_EQUALS(CloseIndex(&idx), kOk, "Could not close index");
+    }
+
+    // Delete the index
+    ASSERT_EQUALS(DeleteIndex(DICTIONARY_TEST_INDEX), kOk,
+                  "Could not delete the index");
+  }
+
+  // Cleanup
+  for(int i = 0; i < count; i++)
+    Release(records[i]);
+  free(records);
+  free(shuffled);
+}
@@ -90,6 +90,18 @@ Record *CreateRecordErrorHandling(int32_t attribute_1, const char* payload){
   return CreateRecordAutoCommit(attribute_1, payload);
 }
 
+// Create a record from the given attributes
+Record *CreateRecord(uint8_t attribute_count, Attribute **attributes, const char* payload){
+  Attribute** a = (Attribute**) malloc(attribute_count*sizeof(Attribute*));
+  memcpy(a, attributes, attribute_count*sizeof(Attribute*));
+
+  Record* record = (Record*) malloc(sizeof(Record));
+  record->key.value = a;
+  record->key.attribute_count = attribute_count;
+  SetValue(record->payload,payload);
+  return record;
+}
+
 // Set the value of a Block
 void SetValue(Block &block, const char* value){
   int size = strlen(value)+1;
@@ -56,6 +56,10 @@ Record *CreateRecordBulk(int32_t attribute_1, const char* payload);
 // Create a record for the ErrorHandlingTest
 Record *CreateRecordErrorHandling(int32_t attribute_1, const char* payload);
 
+// Create a record from the given attributes (the record takes ownership of
+// the attributes, but not of the array holding them)
+Record *CreateRecord(uint8_t attribute_count, Attribute **attributes, const char* payload);
+
 // Set the value of a Block
 void SetValue(Block &block, const char* value);
 